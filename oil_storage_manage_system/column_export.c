@@ -0,0 +1,297 @@
+#include "column_export.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define COLUMN_EXPORT_MIN_ROWS  16      //наименьшее количество строк в блоке
+#define COLUMN_EXPORT_MAX_ROWS  1024    //наибольшее количество строк в блоке
+
+/**
+ * буфер строк одного блока
+ */
+typedef struct _export_buffer{
+    /**
+     * такты строк
+     */
+    unsigned long long* ticks;
+    /**
+     * значения столбцов по строкам (строка - значения всех резервуаров подряд)
+     */
+    uint32_t* values[COLUMNS_COUNT];
+    /**
+     * количество заполненных строк
+     */
+    size_t rows;
+    /**
+     * буфер заполнен и ждет записи фоновым потоком
+     */
+    int full;
+} export_buffer;
+
+/**
+ * выгрузка
+ */
+struct _column_export{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * количество строк в блоке
+     */
+    size_t block_rows;
+    /**
+     * дескрипторы файлов столбцов
+     */
+    int fds[COLUMNS_COUNT];
+    /**
+     * буферы строк: один заполняется, другой записывается
+     */
+    export_buffer buffers[2];
+    /**
+     * номер заполняемого буфера
+     */
+    int filling;
+    /**
+     * номер буфера, который фоновый поток запишет следующим
+     */
+    int writing;
+    /**
+     * смещения тактов строк блока от первого такта
+     */
+    uint32_t* tick_offsets;
+    /**
+     * буфер сжатого блока
+     */
+    unsigned char* block;
+    /**
+     * фоновый поток записи
+     */
+    pthread_t thread;
+    /**
+     * фоновый поток работает (0 - должен дописать заполненные буферы и завершиться)
+     */
+    int running;
+    /**
+     * запись в файлы не удалась, строки больше не принимаются
+     */
+    int failed;
+    /**
+     * мьютекс буферов и статистики
+     */
+    pthread_mutex_t mutex;
+    /**
+     * сигнал о заполненном буфере или остановке
+     */
+    pthread_cond_t cond;
+    /**
+     * статистика
+     */
+    export_stats stats;
+};
+
+/**
+ * записать данные в файл целиком
+ * @param fd дескриптор файла
+ * @param data данные
+ * @param size размер данных в байтах
+ * @return 0 - данные записаны, -1 - ошибка
+ */
+static int _write_full(int fd, const void* data, size_t size);
+
+/**
+ * сжать строки буфера и записать по блоку в файл каждого столбца
+ * @param ce указатель на выгрузку
+ * @param buffer буфер строк
+ * @return 0 - блоки записаны, -1 - ошибка записи
+ */
+static int _write_blocks(column_export* ce, const export_buffer* buffer);
+
+/**
+ * фоновый поток: записывать заполненные буферы по очереди
+ * @param ce_ptr указатель на выгрузку
+ * @return NULL
+ */
+static void* _export_work(void* ce_ptr);
+
+/**
+ * закрыть открытые файлы столбцов
+ * @param ce указатель на выгрузку
+ */
+static void _close_files(column_export* ce);
+
+column_export* create_column_export(const char* directory, size_t tanks_count, unsigned int time_unit){
+    if (mkdir(directory, 0755) == -1 && errno != EEXIST) return NULL;
+    column_export* ce = malloc(sizeof(column_export));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    ce->tanks_count = tanks_count;
+    ce->block_rows = COLUMN_EXPORT_BLOCK_VALUES / count;
+    if (ce->block_rows < COLUMN_EXPORT_MIN_ROWS) ce->block_rows = COLUMN_EXPORT_MIN_ROWS;
+    if (ce->block_rows > COLUMN_EXPORT_MAX_ROWS) ce->block_rows = COLUMN_EXPORT_MAX_ROWS;
+    column_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic));
+    header.version = COLUMN_FILE_VERSION;
+    header.codec = COLUMN_CODEC_DELTA_RLE;
+    header.tanks_count = tanks_count;
+    header.time_unit = time_unit;
+    for(int c = 0; c < COLUMNS_COUNT; ++c){
+        ce->fds[c] = -1;
+    }
+    for(int c = 0; c < COLUMNS_COUNT; ++c){
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", directory, get_file_name_column(c));
+        ce->fds[c] = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        header.column = (uint32_t)c;
+        if (ce->fds[c] == -1 || _write_full(ce->fds[c], &header, sizeof(header)) == -1){
+            _close_files(ce);
+            free(ce);
+            return NULL;
+        }
+    }
+    for(int b = 0; b < 2; ++b){
+        ce->buffers[b].ticks = malloc(sizeof(unsigned long long) * ce->block_rows);
+        for(int c = 0; c < COLUMNS_COUNT; ++c){
+            ce->buffers[b].values[c] = malloc(sizeof(uint32_t) * ce->block_rows * count);
+        }
+        ce->buffers[b].rows = 0;
+        ce->buffers[b].full = 0;
+    }
+    ce->filling = 0;
+    ce->writing = 0;
+    ce->tick_offsets = malloc(sizeof(uint32_t) * ce->block_rows);
+    ce->block = malloc(sizeof(column_block_header) + COLUMN_SERIES_MAX_SIZE(ce->block_rows) * (tanks_count + 1));
+    ce->running = 1;
+    ce->failed = 0;
+    memset(&ce->stats, 0, sizeof(export_stats));
+    pthread_mutex_init(&ce->mutex, NULL);
+    pthread_cond_init(&ce->cond, NULL);
+    pthread_create(&ce->thread, NULL, _export_work, ce);
+    return ce;
+}
+
+int add_row_column_export(column_export* ce, unsigned long long tick, const unsigned int* const* columns){
+    pthread_mutex_lock(&ce->mutex);
+    export_buffer* buffer = &ce->buffers[ce->filling];
+    if (buffer->full || ce->failed){
+        ce->stats.dropped_rows++;
+        pthread_mutex_unlock(&ce->mutex);
+        return -1;
+    }
+    size_t offset = buffer->rows * ce->tanks_count;
+    for(int c = 0; c < COLUMNS_COUNT; ++c){
+        memcpy(buffer->values[c] + offset, columns[c], sizeof(uint32_t) * ce->tanks_count);
+    }
+    buffer->ticks[buffer->rows++] = tick;
+    ce->stats.rows++;
+    ce->stats.raw_bytes += sizeof(uint32_t) * COLUMNS_COUNT * ce->tanks_count;
+    if (buffer->rows == ce->block_rows){
+        buffer->full = 1;
+        ce->filling ^= 1;
+        pthread_cond_signal(&ce->cond);
+    }
+    pthread_mutex_unlock(&ce->mutex);
+    return 0;
+}
+
+void get_stats_column_export(column_export* ce, export_stats* stats){
+    pthread_mutex_lock(&ce->mutex);
+    *stats = ce->stats;
+    pthread_mutex_unlock(&ce->mutex);
+}
+
+void finalize_column_export(column_export* ce){
+    pthread_mutex_lock(&ce->mutex);
+    ce->running = 0;
+    pthread_cond_signal(&ce->cond);
+    pthread_mutex_unlock(&ce->mutex);
+    pthread_join(ce->thread, NULL);
+    //фоновый поток дописал заполненные буферы, остался неполный заполняемый буфер
+    export_buffer* buffer = &ce->buffers[ce->filling];
+    if (buffer->rows > 0 && !ce->failed) _write_blocks(ce, buffer);
+    _close_files(ce);
+    for(int b = 0; b < 2; ++b){
+        free(ce->buffers[b].ticks);
+        for(int c = 0; c < COLUMNS_COUNT; ++c){
+            free(ce->buffers[b].values[c]);
+        }
+    }
+    free(ce->tick_offsets);
+    free(ce->block);
+    pthread_mutex_destroy(&ce->mutex);
+    pthread_cond_destroy(&ce->cond);
+    free(ce);
+}
+
+static int _write_full(int fd, const void* data, size_t size){
+    size_t written = 0;
+    while (written < size){
+        ssize_t n = write(fd, (const char*)data + written, size - written);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        written += (size_t)n;
+    }
+    return 0;
+}
+
+static int _write_blocks(column_export* ce, const export_buffer* buffer){
+    unsigned long long span = begin_span_trace();
+    unsigned long long start = get_time_trace();
+    for(size_t r = 0; r < buffer->rows; ++r){
+        ce->tick_offsets[r] = (uint32_t)(buffer->ticks[r] - buffer->ticks[0]);
+    }
+    size_t written = 0;
+    int result = 0;
+    for(int c = 0; c < COLUMNS_COUNT && result == 0; ++c){
+        unsigned char* data = ce->block + sizeof(column_block_header);
+        size_t size = encode_column_series(ce->tick_offsets, buffer->rows, 1, data);
+        for(size_t i = 0; i < ce->tanks_count; ++i){
+            size += encode_column_series(buffer->values[c] + i, buffer->rows, ce->tanks_count, data + size);
+        }
+        column_block_header header = {COLUMN_BLOCK_MAGIC, (uint32_t)buffer->rows, buffer->ticks[0], size};
+        memcpy(ce->block, &header, sizeof(header));
+        result = _write_full(ce->fds[c], ce->block, sizeof(header) + size);
+        written += sizeof(header) + size;
+    }
+    pthread_mutex_lock(&ce->mutex);
+    if (result == 0) ce->stats.blocks += COLUMNS_COUNT;
+    else ce->failed = 1;
+    ce->stats.written_bytes += written;
+    ce->stats.busy_time += (get_time_trace() - start) / 1000;
+    pthread_mutex_unlock(&ce->mutex);
+    end_span_trace("export", "block", span, (int)buffer->rows);
+    return result;
+}
+
+static void* _export_work(void* ce_ptr){
+    column_export* ce = ce_ptr;
+    set_thread_name_trace("export");
+    pthread_mutex_lock(&ce->mutex);
+    while(1){
+        export_buffer* buffer = &ce->buffers[ce->writing];
+        while (!buffer->full && ce->running){
+            pthread_cond_wait(&ce->cond, &ce->mutex);
+        }
+        if (!buffer->full) break;
+        pthread_mutex_unlock(&ce->mutex);
+        _write_blocks(ce, buffer);
+        pthread_mutex_lock(&ce->mutex);
+        buffer->rows = 0;
+        buffer->full = 0;
+        ce->writing ^= 1;
+    }
+    pthread_mutex_unlock(&ce->mutex);
+    return NULL;
+}
+
+static void _close_files(column_export* ce){
+    for(int c = 0; c < COLUMNS_COUNT; ++c){
+        if (ce->fds[c] != -1) close(ce->fds[c]);
+    }
+}
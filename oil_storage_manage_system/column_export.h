@@ -0,0 +1,80 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_COLUMN_EXPORT_H
+#define OIL_STORAGE_MANAGE_SYSTEM_COLUMN_EXPORT_H
+
+#include "column_format.h"
+#include <stddef.h>
+
+/**
+ * потоковая выгрузка отсчетов резервуаров в столбцовом формате (column_format.h)
+ *
+ * строки (все резервуары за один такт) копируются в один из двух буферов блока; заполненный буфер сжимается
+ * и записывается фоновым потоком большими последовательными блоками, пока заполняется другой;
+ * если фоновый поток не успел освободить буфер, строка пропускается, а не задерживает вызывающий поток
+ */
+struct _column_export;
+typedef struct _column_export column_export;
+
+#define COLUMN_EXPORT_BLOCK_VALUES  (1u << 20)  //количество значений столбца в одном блоке (строк - не больше 1024)
+
+/**
+ * статистика выгрузки
+ */
+typedef struct _export_stats{
+    /**
+     * количество выгруженных строк
+     */
+    unsigned long long rows;
+    /**
+     * количество пропущенных строк (фоновый поток не успевал записывать)
+     */
+    unsigned long long dropped_rows;
+    /**
+     * количество записанных блоков во всех столбцах
+     */
+    unsigned long long blocks;
+    /**
+     * объем выгруженных значений без сжатия в байтах
+     */
+    unsigned long long raw_bytes;
+    /**
+     * объем записанных файлов в байтах
+     */
+    unsigned long long written_bytes;
+    /**
+     * время сжатия и записи блоков фоновым потоком в мкс
+     */
+    unsigned long long busy_time;
+} export_stats;
+
+/**
+ * создать каталог выгрузки (если его нет), файлы столбцов и фоновый поток записи
+ * @param directory каталог выгрузки (файлы столбцов перезаписываются)
+ * @param tanks_count количество резервуаров
+ * @param time_unit длительность такта в мс
+ * @return указатель на выгрузку, NULL - каталог или файлы не удалось создать
+ */
+column_export* create_column_export(const char* directory, size_t tanks_count, unsigned int time_unit);
+
+/**
+ * добавить строку - значения всех резервуаров за такт (не ждет фоновый поток)
+ * @param ce указатель на выгрузку
+ * @param tick такт (должен возрастать)
+ * @param columns массивы значений резервуаров по столбцам в порядке номеров столбцов (COLUMN_LEVELS, ...)
+ * @return 0 - строка добавлена, -1 - строка пропущена
+ */
+int add_row_column_export(column_export* ce, unsigned long long tick, const unsigned int* const* columns);
+
+/**
+ * получить статистику выгрузки
+ * @param ce указатель на выгрузку
+ * @param stats структура для статистики
+ */
+void get_stats_column_export(column_export* ce, export_stats* stats);
+
+/**
+ * дописать оставшиеся строки, остановить фоновый поток и закрыть файлы
+ * @param ce указатель на выгрузку
+ */
+void finalize_column_export(column_export* ce);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_COLUMN_EXPORT_H
@@ -0,0 +1,90 @@
+#include "column_format.h"
+
+/**
+ * записать число в varint
+ * @param data буфер
+ * @param value число
+ * @return количество записанных байт
+ */
+static size_t _put_varint(unsigned char* data, uint64_t value);
+
+/**
+ * прочитать число из varint
+ * @param data данные
+ * @param size размер доступных данных в байтах
+ * @param value прочитанное число
+ * @return количество прочитанных байт, 0 - данные закончились или повреждены
+ */
+static size_t _get_varint(const unsigned char* data, size_t size, uint64_t* value);
+
+const char* get_file_name_column(int column){
+    static const char* names[COLUMNS_COUNT] = {
+            "levels.col", "tank_states.col", "download_states.col", "download_speeds.col", "upload_states.col", "upload_speeds.col"
+    };
+    return column >= 0 && column < COLUMNS_COUNT ? names[column] : NULL;
+}
+
+size_t encode_column_series(const uint32_t* values, size_t count, size_t stride, unsigned char* data){
+    if (count == 0) return 0;
+    size_t used = _put_varint(data, values[0]);
+    int64_t delta = 0;
+    uint64_t run = 0;
+    for(size_t i = 1; i < count; ++i){
+        int64_t next = (int64_t)values[i * stride] - (int64_t)values[(i - 1) * stride];
+        if (run > 0 && next != delta){
+            used += _put_varint(data + used, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+            used += _put_varint(data + used, run);
+            run = 0;
+        }
+        delta = next;
+        run++;
+    }
+    if (run > 0){
+        used += _put_varint(data + used, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        used += _put_varint(data + used, run);
+    }
+    return used;
+}
+
+size_t decode_column_series(const unsigned char* data, size_t size, uint32_t* values, size_t count){
+    if (count == 0) return 0;
+    uint64_t value, zigzag, run;
+    size_t used = _get_varint(data, size, &value);
+    if (used == 0 || value > UINT32_MAX) return 0;
+    values[0] = (uint32_t)value;
+    size_t filled = 1;
+    while (filled < count){
+        size_t n = _get_varint(data + used, size - used, &zigzag);
+        if (n == 0) return 0;
+        used += n;
+        n = _get_varint(data + used, size - used, &run);
+        if (n == 0 || run == 0 || run > count - filled) return 0;
+        used += n;
+        int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        int64_t current = values[filled - 1];
+        for(uint64_t i = 0; i < run; ++i){
+            current += delta;
+            values[filled++] = (uint32_t)current;
+        }
+    }
+    return used;
+}
+
+static size_t _put_varint(unsigned char* data, uint64_t value){
+    size_t used = 0;
+    while (value >= 0x80){
+        data[used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    data[used++] = (unsigned char)value;
+    return used;
+}
+
+static size_t _get_varint(const unsigned char* data, size_t size, uint64_t* value){
+    *value = 0;
+    for(size_t i = 0; i < size && i < 10; ++i){
+        *value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) return i + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_COLUMN_FORMAT_H
+#define OIL_STORAGE_MANAGE_SYSTEM_COLUMN_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * столбцовый формат выгрузки отсчетов резервуаров
+ *
+ * каждый столбец (уровень, состояния и скорости насосов) пишется в свой файл каталога выгрузки:
+ * заголовок column_file_header, затем блоки; блок - заголовок column_block_header и сжатые ряды:
+ * сначала ряд смещений тактов строк от first_tick, затем ряды значений резервуаров по порядку номеров;
+ * ряд сжимается разностями соседних значений, серии одинаковых разностей хранятся одной парой varint
+ * (разность в zigzag, длина серии), поэтому ровно меняющийся уровень и неизменные состояния занимают
+ * несколько байт на блок
+ */
+
+#define COLUMN_FILE_MAGIC           "OSCL"  //сигнатура файла столбца
+#define COLUMN_FILE_VERSION         1       //версия формата
+#define COLUMN_BLOCK_MAGIC          0x4B4C4243u //сигнатура блока ("CBLK")
+#define COLUMN_CODEC_DELTA_RLE      1       //сжатие рядов: первое значение, затем серии одинаковых разностей
+
+#define COLUMN_LEVELS               0       //уровень нефтепродуктов
+#define COLUMN_TANK_STATES          1       //состояние резервуара (STORAGE_TANK_ON, STORAGE_TANK_OFF)
+#define COLUMN_DOWNLOAD_STATES      2       //состояние насоса налива (PUMP_ON, PUMP_OFF)
+#define COLUMN_DOWNLOAD_SPEEDS      3       //скорость насоса налива
+#define COLUMN_UPLOAD_STATES        4       //состояние насоса слива
+#define COLUMN_UPLOAD_SPEEDS        5       //скорость насоса слива
+#define COLUMNS_COUNT               6       //количество столбцов
+
+/**
+ * наибольший размер сжатого ряда в байтах (каждое значение - новая серия: разность и длина в varint)
+ */
+#define COLUMN_SERIES_MAX_SIZE(count) ((count) * 6 + 5)
+
+/**
+ * заголовок файла столбца
+ */
+typedef struct _column_file_header{
+    /**
+     * сигнатура COLUMN_FILE_MAGIC
+     */
+    char magic[4];
+    /**
+     * версия формата COLUMN_FILE_VERSION
+     */
+    uint32_t version;
+    /**
+     * столбец (COLUMN_LEVELS, ...)
+     */
+    uint32_t column;
+    /**
+     * сжатие рядов (COLUMN_CODEC_DELTA_RLE)
+     */
+    uint32_t codec;
+    /**
+     * количество резервуаров (рядов значений в каждом блоке)
+     */
+    uint64_t tanks_count;
+    /**
+     * длительность такта в мс
+     */
+    uint32_t time_unit;
+    /**
+     * не используется
+     */
+    uint32_t reserved;
+} column_file_header;
+
+/**
+ * заголовок блока
+ */
+typedef struct _column_block_header{
+    /**
+     * сигнатура COLUMN_BLOCK_MAGIC
+     */
+    uint32_t magic;
+    /**
+     * количество строк (тактов) в блоке
+     */
+    uint32_t rows_count;
+    /**
+     * такт первой строки
+     */
+    uint64_t first_tick;
+    /**
+     * размер сжатых рядов после заголовка в байтах
+     */
+    uint64_t size;
+} column_block_header;
+
+/**
+ * получить имя файла столбца в каталоге выгрузки
+ * @param column столбец (COLUMN_LEVELS, ...)
+ * @return имя файла
+ */
+const char* get_file_name_column(int column);
+
+/**
+ * сжать ряд значений
+ * @param values первое значение ряда
+ * @param count количество значений
+ * @param stride расстояние между соседними значениями ряда в массиве (в элементах)
+ * @param data буфер для сжатого ряда (не меньше COLUMN_SERIES_MAX_SIZE(count))
+ * @return размер сжатого ряда в байтах
+ */
+size_t encode_column_series(const uint32_t* values, size_t count, size_t stride, unsigned char* data);
+
+/**
+ * восстановить ряд значений
+ * @param data сжатый ряд
+ * @param size размер доступных данных в байтах
+ * @param values массив для значений
+ * @param count количество значений
+ * @return размер прочитанного сжатого ряда в байтах, 0 - данные повреждены
+ */
+size_t decode_column_series(const unsigned char* data, size_t size, uint32_t* values, size_t count);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_COLUMN_FORMAT_H
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "column_format.h"
+
+#define TEST_SERIES         20000   //количество рядов
+#define TEST_MAX_COUNT      600     //наибольшая длина ряда
+#define TEST_MAX_STRIDE     4       //наибольшее расстояние между значениями ряда в массиве
+#define TEST_SHAPES         6       //количество видов рядов
+
+/**
+ * получить случайное 32-битное число
+ * @return число
+ */
+static uint32_t _random32(void);
+
+/**
+ * заполнить ряд значениями одного из видов: постоянный, ровно меняющийся, ступенчатый, случайное блуждание,
+ * крайние значения вперемешку, случайные значения
+ * @param values массив значений
+ * @param count количество значений
+ * @param stride расстояние между значениями ряда в массиве
+ * @param shape вид ряда
+ */
+static void _fill_series(uint32_t* values, size_t count, size_t stride, int shape);
+
+int main(void){
+    static uint32_t values[TEST_MAX_COUNT * TEST_MAX_STRIDE], decoded[TEST_MAX_COUNT];
+    static unsigned char data[COLUMN_SERIES_MAX_SIZE(TEST_MAX_COUNT)];
+    srand(48);
+    int failures = 0;
+    size_t total_values = 0, total_size = 0;
+    for(int s = 0; s < TEST_SERIES && failures < 10; ++s){
+        size_t count = s < 2 ? (size_t)s : (size_t)(rand() % TEST_MAX_COUNT + 1);
+        size_t stride = (size_t)(rand() % TEST_MAX_STRIDE + 1);
+        int shape = rand() % TEST_SHAPES;
+        _fill_series(values, count, stride, shape);
+        size_t size = encode_column_series(values, count, stride, data);
+        if (size > COLUMN_SERIES_MAX_SIZE(count)){
+            printf("ряд %d (вид %d, %zu значений): сжатый размер %zu больше %zu\n", s, shape, count, size, (size_t)COLUMN_SERIES_MAX_SIZE(count));
+            failures++;
+            continue;
+        }
+        memset(decoded, 0xA5, sizeof(decoded));
+        size_t used = decode_column_series(data, size, decoded, count);
+        int equal = used == size;
+        for(size_t i = 0; equal && i < count; ++i){
+            equal = decoded[i] == values[i * stride];
+        }
+        if (!equal){
+            printf("ряд %d (вид %d, %zu значений, шаг %zu): восстановлен неверно\n", s, shape, count, stride);
+            failures++;
+            continue;
+        }
+        //оборванный ряд должен распознаваться как поврежденный
+        if (size > 0 && decode_column_series(data, size - 1, decoded, count) != 0){
+            printf("ряд %d (вид %d, %zu значений): оборванный ряд не распознан\n", s, shape, count);
+            failures++;
+        }
+        total_values += count;
+        total_size += size;
+    }
+    printf("рядов %d, значений %zu, сжато в %zu байт, ошибок %d\n", TEST_SERIES, total_values, total_size, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+static uint32_t _random32(void){
+    return ((uint32_t)(rand() & 0xFFFF) << 16) ^ (uint32_t)(rand() & 0xFFFF);
+}
+
+static void _fill_series(uint32_t* values, size_t count, size_t stride, int shape){
+    uint32_t value = rand() % 2 ? _random32() : (uint32_t)(rand() % 30000);
+    int32_t step = rand() % 21 - 10;
+    for(size_t i = 0; i < count; ++i){
+        switch (shape){
+            case 0:  break;
+            case 1:  value += (uint32_t)step; break;
+            case 2:  if (rand() % 50 == 0) step = rand() % 21 - 10; value += (uint32_t)step; break;
+            case 3:  value += (uint32_t)(rand() % 2001 - 1000); break;
+            case 4:  value = rand() % 3 == 0 ? 0 : rand() % 2 ? UINT32_MAX : value; break;
+            default: value = _random32(); break;
+        }
+        values[i * stride] = value;
+        //промежуточные элементы массива принадлежат другим рядам и не должны попасть в этот
+        for(size_t k = 1; k < stride; ++k){
+            values[i * stride + k] = _random32();
+        }
+    }
+}
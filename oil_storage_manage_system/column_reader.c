@@ -0,0 +1,128 @@
+#include "column_reader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * чтение файла столбца
+ */
+struct _column_reader{
+    /**
+     * отображение файла в память
+     */
+    const unsigned char* mapping;
+    /**
+     * размер файла в байтах
+     */
+    size_t size;
+    /**
+     * позиция следующего блока в файле
+     */
+    size_t position;
+    /**
+     * заголовок файла
+     */
+    column_file_header header;
+    /**
+     * такты строк прочитанного блока
+     */
+    unsigned long long* ticks;
+    /**
+     * смещения тактов строк от первого такта
+     */
+    uint32_t* tick_offsets;
+    /**
+     * значения прочитанного блока
+     */
+    uint32_t* values;
+    /**
+     * количество строк, под которое выделены буферы
+     */
+    size_t capacity;
+};
+
+column_reader* open_column_reader(const char* path){
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(column_file_header)){
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+    const column_file_header* header = mapping;
+    if (memcmp(header->magic, COLUMN_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != COLUMN_FILE_VERSION
+        || header->codec != COLUMN_CODEC_DELTA_RLE || header->column >= COLUMNS_COUNT){
+        munmap(mapping, size);
+        return NULL;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    column_reader* cr = malloc(sizeof(column_reader));
+    cr->mapping = mapping;
+    cr->size = size;
+    cr->position = sizeof(column_file_header);
+    cr->header = *header;
+    cr->ticks = NULL;
+    cr->tick_offsets = NULL;
+    cr->values = NULL;
+    cr->capacity = 0;
+    return cr;
+}
+
+void get_info_column_reader(const column_reader* cr, int* column, size_t* tanks_count, unsigned int* time_unit){
+    *column = (int)cr->header.column;
+    *tanks_count = (size_t)cr->header.tanks_count;
+    *time_unit = cr->header.time_unit;
+}
+
+int next_block_column_reader(column_reader* cr, column_block* block){
+    if (cr->position == cr->size) return 0;
+    column_block_header header;
+    if (cr->size - cr->position < sizeof(header)) return -1;
+    memcpy(&header, cr->mapping + cr->position, sizeof(header));
+    if (header.magic != COLUMN_BLOCK_MAGIC || header.rows_count == 0
+        || header.size > cr->size - cr->position - sizeof(header)) return -1;
+    size_t rows = header.rows_count;
+    size_t tanks_count = (size_t)cr->header.tanks_count;
+    if (rows > cr->capacity){
+        cr->ticks = realloc(cr->ticks, sizeof(unsigned long long) * rows);
+        cr->tick_offsets = realloc(cr->tick_offsets, sizeof(uint32_t) * rows);
+        cr->values = realloc(cr->values, sizeof(uint32_t) * rows * (tanks_count > 0 ? tanks_count : 1));
+        cr->capacity = rows;
+    }
+    const unsigned char* data = cr->mapping + cr->position + sizeof(header);
+    size_t size = (size_t)header.size;
+    size_t used = decode_column_series(data, size, cr->tick_offsets, rows);
+    if (used == 0) return -1;
+    for(size_t r = 0; r < rows; ++r){
+        cr->ticks[r] = header.first_tick + cr->tick_offsets[r];
+    }
+    for(size_t i = 0; i < tanks_count; ++i){
+        size_t n = decode_column_series(data + used, size - used, cr->values + i * rows, rows);
+        if (n == 0) return -1;
+        used += n;
+    }
+    cr->position += sizeof(header) + size;
+    block->rows_count = rows;
+    block->ticks = cr->ticks;
+    block->values = cr->values;
+    return 1;
+}
+
+void rewind_column_reader(column_reader* cr){
+    cr->position = sizeof(column_file_header);
+}
+
+void finalize_column_reader(column_reader* cr){
+    munmap((void*)cr->mapping, cr->size);
+    free(cr->ticks);
+    free(cr->tick_offsets);
+    free(cr->values);
+    free(cr);
+}
@@ -0,0 +1,68 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_COLUMN_READER_H
+#define OIL_STORAGE_MANAGE_SYSTEM_COLUMN_READER_H
+
+#include "column_format.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * чтение файла столбца выгрузки (column_format.h): файл отображается в память и читается по блокам
+ */
+struct _column_reader;
+typedef struct _column_reader column_reader;
+
+/**
+ * блок столбца, восстановленный из сжатого вида
+ */
+typedef struct _column_block{
+    /**
+     * количество строк (тактов)
+     */
+    size_t rows_count;
+    /**
+     * такты строк
+     */
+    const unsigned long long* ticks;
+    /**
+     * значения по резервуарам: значение резервуара number в строке row - values[number * rows_count + row]
+     */
+    const uint32_t* values;
+} column_block;
+
+/**
+ * открыть файл столбца
+ * @param path путь к файлу
+ * @return указатель на чтение, NULL - файл не найден или это не файл столбца
+ */
+column_reader* open_column_reader(const char* path);
+
+/**
+ * получить описание столбца
+ * @param cr указатель на чтение
+ * @param column столбец (COLUMN_LEVELS, ...)
+ * @param tanks_count количество резервуаров
+ * @param time_unit длительность такта в мс
+ */
+void get_info_column_reader(const column_reader* cr, int* column, size_t* tanks_count, unsigned int* time_unit);
+
+/**
+ * прочитать следующий блок (данные блока действительны до следующего чтения)
+ * @param cr указатель на чтение
+ * @param block структура для блока
+ * @return 1 - блок прочитан, 0 - блоки закончились, -1 - блок поврежден или оборван
+ */
+int next_block_column_reader(column_reader* cr, column_block* block);
+
+/**
+ * вернуться к первому блоку
+ * @param cr указатель на чтение
+ */
+void rewind_column_reader(column_reader* cr);
+
+/**
+ * закрыть файл столбца
+ * @param cr указатель на чтение
+ */
+void finalize_column_reader(column_reader* cr);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_COLUMN_READER_H
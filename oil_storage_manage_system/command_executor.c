@@ -0,0 +1,190 @@
+#include "command_executor.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define COMMAND_EXECUTOR_CAPACITY 64    //начальная вместимость очереди потока
+
+/**
+ * команда в очереди
+ */
+typedef struct _executor_command{
+    /**
+     * команда
+     */
+    int command;
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+    /**
+     * значение параметра команды
+     */
+    unsigned int value;
+} executor_command;
+
+/**
+ * поток выполнения со своей очередью
+ */
+typedef struct _executor_thread{
+    /**
+     * указатель на исполнитель
+     */
+    struct _command_executor* ce;
+    /**
+     * кольцевая очередь команд
+     */
+    executor_command* commands;
+    /**
+     * вместимость очереди
+     */
+    size_t capacity;
+    /**
+     * индекс первой команды
+     */
+    size_t head;
+    /**
+     * количество команд в очереди
+     */
+    size_t count;
+    /**
+     * поток работает (0 - должен завершиться)
+     */
+    int running;
+    /**
+     * мьютекс очереди
+     */
+    pthread_mutex_t mutex;
+    /**
+     * сигнал о новой команде или остановке
+     */
+    pthread_cond_t cond;
+    /**
+     * поток
+     */
+    pthread_t thread;
+} executor_thread;
+
+/**
+ * исполнитель
+ */
+struct _command_executor{
+    /**
+     * функция выполнения команды
+     */
+    command_executor_function execute;
+    /**
+     * контекст функции
+     */
+    void* context;
+    /**
+     * потоки
+     */
+    executor_thread* threads;
+    /**
+     * количество потоков
+     */
+    size_t threads_count;
+    /**
+     * количество невыполненных команд во всех очередях
+     */
+    size_t pending;
+};
+
+/**
+ * функция потока: выполнять команды своей очереди по порядку
+ * @param et_ptr указатель на поток выполнения
+ * @return NULL
+ */
+static void* _execute_work(void* et_ptr);
+
+command_executor* create_command_executor(size_t threads_count, command_executor_function execute, void* context){
+    command_executor* ce = malloc(sizeof(command_executor));
+    ce->execute = execute;
+    ce->context = context;
+    ce->threads_count = threads_count > 0 ? threads_count : 1;
+    ce->threads = malloc(sizeof(executor_thread) * ce->threads_count);
+    ce->pending = 0;
+    for(size_t t = 0; t < ce->threads_count; ++t){
+        executor_thread* et = &ce->threads[t];
+        et->ce = ce;
+        et->capacity = COMMAND_EXECUTOR_CAPACITY;
+        et->commands = malloc(sizeof(executor_command) * et->capacity);
+        et->head = 0;
+        et->count = 0;
+        et->running = 1;
+        pthread_mutex_init(&et->mutex, NULL);
+        pthread_cond_init(&et->cond, NULL);
+        pthread_create(&et->thread, NULL, _execute_work, et);
+    }
+    return ce;
+}
+
+void submit_command_executor(command_executor* ce, int command, unsigned int number, unsigned int value){
+    executor_thread* et = &ce->threads[number % ce->threads_count];
+    pthread_mutex_lock(&et->mutex);
+    if (et->count == et->capacity){
+        //команды переносятся во вдвое больший буфер начиная с первой
+        executor_command* commands = malloc(sizeof(executor_command) * et->capacity * 2);
+        for(size_t i = 0; i < et->count; ++i){
+            commands[i] = et->commands[(et->head + i) % et->capacity];
+        }
+        free(et->commands);
+        et->commands = commands;
+        et->capacity *= 2;
+        et->head = 0;
+    }
+    executor_command* ec = &et->commands[(et->head + et->count) % et->capacity];
+    ec->command = command;
+    ec->number = number;
+    ec->value = value;
+    et->count++;
+    __atomic_add_fetch(&ce->pending, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&et->cond);
+    pthread_mutex_unlock(&et->mutex);
+}
+
+size_t get_pending_command_executor(const command_executor* ce){
+    return __atomic_load_n(&ce->pending, __ATOMIC_RELAXED);
+}
+
+void finalize_command_executor(command_executor* ce){
+    for(size_t t = 0; t < ce->threads_count; ++t){
+        executor_thread* et = &ce->threads[t];
+        pthread_mutex_lock(&et->mutex);
+        et->running = 0;
+        pthread_cond_signal(&et->cond);
+        pthread_mutex_unlock(&et->mutex);
+    }
+    for(size_t t = 0; t < ce->threads_count; ++t){
+        executor_thread* et = &ce->threads[t];
+        pthread_join(et->thread, NULL);
+        pthread_mutex_destroy(&et->mutex);
+        pthread_cond_destroy(&et->cond);
+        free(et->commands);
+    }
+    free(ce->threads);
+    free(ce);
+}
+
+static void* _execute_work(void* et_ptr){
+    executor_thread* et = et_ptr;
+    command_executor* ce = et->ce;
+    set_thread_name_trace("executor");
+    pthread_mutex_lock(&et->mutex);
+    while(1){
+        while (et->count == 0 && et->running){
+            pthread_cond_wait(&et->cond, &et->mutex);
+        }
+        if (!et->running) break;
+        executor_command ec = et->commands[et->head];
+        et->head = (et->head + 1) % et->capacity;
+        et->count--;
+        pthread_mutex_unlock(&et->mutex);
+        ce->execute(ce->context, ec.command, ec.number, ec.value);
+        __atomic_sub_fetch(&ce->pending, 1, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&et->mutex);
+    }
+    pthread_mutex_unlock(&et->mutex);
+    return NULL;
+}
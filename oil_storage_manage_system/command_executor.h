@@ -0,0 +1,55 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_COMMAND_EXECUTOR_H
+#define OIL_STORAGE_MANAGE_SYSTEM_COMMAND_EXECUTOR_H
+
+#include <stddef.h>
+
+/**
+ * выполнение команд резервуарам фоновыми потоками, чтобы поток управления не ждал ответов процессов резервуаров
+ * (команды резервуара всегда попадают в один поток и выполняются в порядке постановки; зависший резервуар
+ * задерживает только команды своего потока)
+ */
+struct _command_executor;
+typedef struct _command_executor command_executor;
+
+/**
+ * функция выполнения команды
+ * @param context контекст, переданный при создании
+ * @param command команда (COMMAND_TURN_ON_TANK, COMMAND_SET_SPEED_UPLOAD_PUMP, ...)
+ * @param number номер резервуара
+ * @param value значение параметра команды
+ * @return результат выполнения (не используется)
+ */
+typedef int (*command_executor_function)(void* context, int command, unsigned int number, unsigned int value);
+
+/**
+ * создать очереди и потоки выполнения команд
+ * @param threads_count количество потоков (не меньше 1)
+ * @param execute функция выполнения команды
+ * @param context контекст функции
+ * @return указатель на исполнитель
+ */
+command_executor* create_command_executor(size_t threads_count, command_executor_function execute, void* context);
+
+/**
+ * поставить команду в очередь потока резервуара (не ждет выполнения; очередь растет по мере надобности)
+ * @param ce указатель на исполнитель
+ * @param command команда
+ * @param number номер резервуара
+ * @param value значение параметра команды
+ */
+void submit_command_executor(command_executor* ce, int command, unsigned int number, unsigned int value);
+
+/**
+ * получить количество поставленных, но еще не выполненных команд
+ * @param ce указатель на исполнитель
+ * @return количество команд
+ */
+size_t get_pending_command_executor(const command_executor* ce);
+
+/**
+ * остановить потоки (невыполненные команды отбрасываются) и уничтожить исполнитель
+ * @param ce указатель на исполнитель
+ */
+void finalize_command_executor(command_executor* ce);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_COMMAND_EXECUTOR_H
@@ -0,0 +1,81 @@
+#define _GNU_SOURCE
+#include "command_queue.h"
+#include "futex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * очередь строк команд
+ */
+struct _command_queue{
+    /**
+     * строки команд (capacity строк по COMMAND_QUEUE_LINE_SIZE байт)
+     */
+    char* lines;
+    /**
+     * количество строк (степень двойки)
+     */
+    uint32_t capacity;
+    /**
+     * счетчик забранных строк (меняет только забирающий поток)
+     */
+    uint32_t head;
+    /**
+     * счетчик добавленных строк (меняет только добавляющий поток, на нем спит забирающий)
+     */
+    uint32_t tail;
+    /**
+     * забирающий поток собирается заснуть или спит на futex
+     */
+    uint32_t waiting;
+};
+
+command_queue* create_command_queue(size_t capacity){
+    command_queue* cq = malloc(sizeof(command_queue));
+    uint32_t size = 1;
+    while (size < capacity) size <<= 1;
+    cq->lines = malloc((size_t)size * COMMAND_QUEUE_LINE_SIZE);
+    cq->capacity = size;
+    cq->head = 0;
+    cq->tail = 0;
+    cq->waiting = 0;
+    return cq;
+}
+
+int push_command_queue(command_queue* cq, const char* line){
+    uint32_t tail = cq->tail;
+    if (tail - __atomic_load_n(&cq->head, __ATOMIC_ACQUIRE) == cq->capacity) return -1;
+    char* slot = cq->lines + (size_t)(tail & (cq->capacity - 1)) * COMMAND_QUEUE_LINE_SIZE;
+    size_t len = strlen(line);
+    if (len >= COMMAND_QUEUE_LINE_SIZE) len = COMMAND_QUEUE_LINE_SIZE - 1;
+    memcpy(slot, line, len);
+    slot[len] = '\0';
+    //запись конца и проверка флага ожидания упорядочены с записью флага и проверкой конца в pop_command_queue
+    __atomic_store_n(&cq->tail, tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&cq->waiting, __ATOMIC_SEQ_CST)) wake_futex(&cq->tail, 1, FUTEX_LOCAL);
+    return 0;
+}
+
+int pop_command_queue(command_queue* cq, char* line, int timeout){
+    uint32_t head = cq->head;
+    uint32_t tail = __atomic_load_n(&cq->tail, __ATOMIC_ACQUIRE);
+    if (tail == head){
+        __atomic_store_n(&cq->waiting, 1, __ATOMIC_SEQ_CST);
+        tail = __atomic_load_n(&cq->tail, __ATOMIC_SEQ_CST);
+        if (tail == head) wait_futex(&cq->tail, tail, timeout, FUTEX_LOCAL);
+        __atomic_store_n(&cq->waiting, 0, __ATOMIC_RELAXED);
+        tail = __atomic_load_n(&cq->tail, __ATOMIC_ACQUIRE);
+        if (tail == head) return 0;
+    }
+    strcpy(line, cq->lines + (size_t)(head & (cq->capacity - 1)) * COMMAND_QUEUE_LINE_SIZE);
+    __atomic_store_n(&cq->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void finalize_command_queue(command_queue* cq){
+    free(cq->lines);
+    free(cq);
+}
@@ -0,0 +1,46 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_COMMAND_QUEUE_H
+#define OIL_STORAGE_MANAGE_SYSTEM_COMMAND_QUEUE_H
+
+#include <stddef.h>
+
+/**
+ * очередь строк команд между двумя потоками без блокировок: один поток добавляет, другой забирает
+ * (кольцевой буфер строк, индексы начала и конца меняются атомарно; забирающий поток спит на futex,
+ * пока очередь пуста, добавляющий будит его, только если он спит)
+ */
+struct _command_queue;
+typedef struct _command_queue command_queue;
+
+#define COMMAND_QUEUE_LINE_SIZE 500 //наибольшая длина строки команды вместе с завершающим нулем
+
+/**
+ * создать очередь
+ * @param capacity наибольшее количество строк в очереди (округляется вверх до степени двойки)
+ * @return указатель на очередь
+ */
+command_queue* create_command_queue(size_t capacity);
+
+/**
+ * добавить строку в конец очереди (не ждет; длинная строка обрезается)
+ * @param cq указатель на очередь
+ * @param line строка команды
+ * @return 0 - строка добавлена, -1 - очередь заполнена
+ */
+int push_command_queue(command_queue* cq, const char* line);
+
+/**
+ * забрать строку из начала очереди
+ * @param cq указатель на очередь
+ * @param line буфер для строки (не меньше COMMAND_QUEUE_LINE_SIZE)
+ * @param timeout наибольшее время ожидания в мс, если очередь пуста
+ * @return 1 - строка получена, 0 - очередь пуста (по истечении времени ожидания или раньше)
+ */
+int pop_command_queue(command_queue* cq, char* line, int timeout);
+
+/**
+ * уничтожить очередь
+ * @param cq указатель на очередь
+ */
+void finalize_command_queue(command_queue* cq);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_COMMAND_QUEUE_H
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "oil_storage_def.h"
+#include "depot_coordinator.h"
+
+#define COORDINATOR_LINE_SIZE   256     //максимальная длина команды
+#define COORDINATOR_MAX_LIMITS  10      //количество резервуаров в next_limits по умолчанию
+
+/**
+ * команда резервуару
+ */
+typedef struct _coordinator_command{
+    /**
+     * имя команды
+     */
+    const char* name;
+    /**
+     * команда (COMMAND_TURN_ON_TANK, ...)
+     */
+    int command;
+} coordinator_command;
+
+/**
+ * команды резервуарам (как в расписании интерфейса нефтехранилища)
+ */
+static const coordinator_command _commands[] = {
+        {"turn_on_tank",            COMMAND_TURN_ON_TANK},
+        {"turn_off_tank",           COMMAND_TURN_OFF_TANK},
+        {"set_minimum_level_tank",  COMMAND_SET_MINIMUM_LEVEL_TANK},
+        {"set_maximum_level_tank",  COMMAND_SET_MAXIMUM_LEVEL_TANK},
+        {"turn_on_download_pump",   COMMAND_TURN_ON_DOWNLOAD_PUMP},
+        {"turn_off_download_pump",  COMMAND_TURN_OFF_DOWNLOAD_PUMP},
+        {"set_speed_download_pump", COMMAND_SET_SPEED_DOWNLOAD_PUMP},
+        {"turn_on_upload_pump",     COMMAND_TURN_ON_UPLOAD_PUMP},
+        {"turn_off_upload_pump",    COMMAND_TURN_OFF_UPLOAD_PUMP},
+        {"set_speed_upload_pump",   COMMAND_SET_SPEED_UPLOAD_PUMP},
+};
+
+/**
+ * разобрать номер резервуара: "депо:номер" или общий номер (нумерация с 1)
+ * @param dc указатель на координатор
+ * @param text текст номера
+ * @param tank общий номер резервуара (с 0)
+ * @return 0 - номер разобран, -1 - резервуара с таким номером нет
+ */
+static int _parse_tank(const depot_coordinator* dc, const char* text, size_t* tank);
+
+/**
+ * выполнить команду координатора и напечатать результат
+ * @param dc указатель на координатор
+ * @param line строка команды
+ * @return 0 - продолжить, 1 - выход
+ */
+static int _implement_command(depot_coordinator* dc, const char* line);
+
+/**
+ * получить текущее время
+ * @return время CLOCK_MONOTONIC в мкс
+ */
+static unsigned long long _get_time_us();
+
+int main(int argc, char* argv[]) {
+    if (argc < 2){
+        fprintf(stderr, "использование: %s <сокет депо>...\n", argv[0]);
+        return 1;
+    }
+    unsigned long long start = _get_time_us();
+    depot_coordinator* dc = create_depot_coordinator((const char* const*)argv + 1, (size_t)(argc - 1));
+    if (dc == NULL){
+        fprintf(stderr, "не удалось подключиться ко всем депо\n");
+        return 1;
+    }
+    printf("депо %zu, резервуаров %zu, подключение и первый снимок %.1f мс\n",
+           get_depots_count_coordinator(dc), get_tanks_count_coordinator(dc), (_get_time_us() - start) / 1000.0);
+    char line[COORDINATOR_LINE_SIZE];
+    while (fgets(line, sizeof(line), stdin) != NULL){
+        if (_implement_command(dc, line) == 1) break;
+        fflush(stdout);
+    }
+    finalize_depot_coordinator(dc);
+    return 0;
+}
+
+static int _parse_tank(const depot_coordinator* dc, const char* text, size_t* tank){
+    char* end;
+    unsigned long first = strtoul(text, &end, 10);
+    if (end == text || first == 0) return -1;
+    if (*end != ':'){
+        *tank = first - 1;
+        return *tank < get_tanks_count_coordinator(dc) ? 0 : -1;
+    }
+    const char* number_text = end + 1;
+    unsigned long number = strtoul(number_text, &end, 10);
+    if (end == number_text || number == 0) return -1;
+    depot_info info;
+    if (get_depot_info_coordinator((depot_coordinator*)dc, first - 1, &info) == -1 || number > info.tanks_count) return -1;
+    *tank = info.first_tank + number - 1;
+    return 0;
+}
+
+static int _implement_command(depot_coordinator* dc, const char* line){
+    char command[100] = "", argument[100] = "";
+    unsigned int value = 0;
+    int fields = sscanf(line, "%99s %99s %u", command, argument, &value);
+    if (fields < 1) return 0;
+    unsigned long long start = _get_time_us();
+    if (strcmp(command, "exit") == 0) return 1;
+    if (strcmp(command, "depots") == 0){
+        for(size_t i = 0; i < get_depots_count_coordinator(dc); ++i){
+            depot_info info;
+            get_depot_info_coordinator(dc, i, &info);
+            printf("%zu: %s, резервуаров %zu (с %zu), %s\n", i + 1, info.path, info.tanks_count, info.first_tank + 1,
+                   info.connected ? "подключено" : "отключено");
+        }
+        return 0;
+    }
+    if (strcmp(command, "summary") == 0){
+        fleet_summary fs;
+        get_fleet_summary_coordinator(dc, &fs);
+        printf("резервуаров %zu, объем %llu, вместимость %llu, свободно %llu, самый полный %zu (%.1f%%), самый пустой %zu (%.1f%%), медиана %u%%; %.2f мс\n",
+               fs.tanks_count, fs.total_level, fs.total_capacity, fs.free_capacity,
+               fs.fullest_tank + 1, fs.fullest_fill * 100.0f, fs.emptiest_tank + 1, fs.emptiest_fill * 100.0f,
+               get_fill_percentile_fleet_summary(&fs, 50), (_get_time_us() - start) / 1000.0);
+        return 0;
+    }
+    if (strcmp(command, "next_limits") == 0){
+        size_t count = fields > 1 ? strtoul(argument, NULL, 10) : COORDINATOR_MAX_LIMITS;
+        limit_eta etas[DEPOT_MAX_LIMITS];
+        count = get_next_limits_coordinator(dc, etas, count);
+        for(size_t i = 0; i < count; ++i){
+            size_t depot;
+            unsigned int number;
+            locate_tank_coordinator(dc, etas[i].number, &depot, &number);
+            printf("%u (%zu:%u): %s через %.1f с\n", etas[i].number + 1, depot + 1, number + 1,
+                   etas[i].limit == LIMIT_FORECAST_MAX ? "максимум" : "минимум", etas[i].time / 1000.0);
+        }
+        printf("%zu резервуаров; %.2f мс\n", count, (_get_time_us() - start) / 1000.0);
+        return 0;
+    }
+    if (strcmp(command, "stats") == 0){
+        coordinator_stats stats;
+        get_stats_coordinator(dc, &stats);
+        printf("подключено депо %zu из %zu, синхронизаций %llu, изменилось резервуаров %zu, устаревших %zu, синхронизация %llu мкс (наибольшая %llu мкс)\n",
+               stats.connected_depots, get_depots_count_coordinator(dc), stats.syncs, stats.changed_tanks,
+               stats.stale_tanks, stats.sync_time, stats.max_sync_time);
+        return 0;
+    }
+    size_t tank;
+    if (fields < 2 || _parse_tank(dc, argument, &tank) == -1){
+        printf(fields < 2 ? "unknown command\n" : "Unknown tank\n");
+        return 0;
+    }
+    if (strcmp(command, "tank") == 0){
+        tank_state state;
+        unsigned char stale;
+        get_tanks_states_coordinator(dc, tank, 1, &state, &stale);
+        printf("%zu: уровень %u [%u, %u], %s, налив %s %u, откачка %s %u%s\n", tank + 1,
+               state.current_level, state.minimum_level, state.maximum_level,
+               state.state == STORAGE_TANK_ON ? "включен" : "выключен",
+               state.download_state == PUMP_ON ? "вкл" : "выкл", state.download_speed,
+               state.upload_state == PUMP_ON ? "вкл" : "выкл", state.upload_speed,
+               stale ? " (депо не отвечает, данные устарели)" : "");
+        return 0;
+    }
+    for(size_t i = 0; i < sizeof(_commands) / sizeof(_commands[0]); ++i){
+        if (strcmp(command, _commands[i].name) != 0) continue;
+        int result = execute_command_coordinator(dc, tank, _commands[i].command, value);
+        printf("%s; %.2f мс\n", result == TANK_OK ? "ok" : result == TANK_ERROR_VALUE ? "error" : result == TANK_ERROR_WORKER ? "depot or tank not responding" : "Unknown tank",
+               (_get_time_us() - start) / 1000.0);
+        return 0;
+    }
+    printf("unknown command\n");
+    return 0;
+}
+
+static unsigned long long _get_time_us(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000ULL + (unsigned long long)now.tv_nsec / 1000;
+}
@@ -0,0 +1,508 @@
+#include "depot_coordinator.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * подключение к депо
+ */
+typedef struct _depot_link{
+    /**
+     * путь к сокету депо
+     */
+    char* path;
+    /**
+     * дескриптор сокета (-1 - подключения нет)
+     */
+    int fd;
+    /**
+     * количество резервуаров депо
+     */
+    size_t tanks_count;
+    /**
+     * общий номер первого резервуара депо
+     */
+    size_t first_tank;
+    /**
+     * мьютекс обмена с депо (на каждый запрос в сокете ожидается ровно один ответ)
+     */
+    pthread_mutex_t mutex;
+    /**
+     * время, раньше которого отключенное депо не переподключается, в мкс
+     */
+    unsigned long long reconnect_time;
+    /**
+     * признак получения ответа при последнем обмене со всеми депо
+     */
+    int answered;
+    /**
+     * признак устаревших состояний резервуаров депо в снимке (под мьютексом снимка)
+     */
+    int stale;
+    /**
+     * заголовок последнего ответа
+     */
+    depot_message_header header;
+    /**
+     * буфер данных ответа
+     */
+    void* answer;
+    /**
+     * размер буфера ответа
+     */
+    size_t answer_capacity;
+} depot_link;
+
+struct _depot_coordinator{
+    /**
+     * подключения к депо
+     */
+    depot_link* links;
+    /**
+     * количество депо
+     */
+    size_t depots_count;
+    /**
+     * общее количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * общий снимок состояний резервуаров
+     */
+    tank_state* states;
+    /**
+     * мьютекс снимка состояний и состояния координатора
+     */
+    pthread_mutex_t snapshot_mutex;
+    /**
+     * сокеты депо, ответы которых ждутся при обмене со всеми депо
+     */
+    struct pollfd* polls;
+    /**
+     * номера депо, ответы которых ждутся при обмене со всеми депо
+     */
+    size_t* poll_links;
+    /**
+     * состояние координатора
+     */
+    coordinator_stats stats;
+    /**
+     * поток синхронизации
+     */
+    pthread_t thread;
+    /**
+     * признак остановки синхронизации
+     */
+    volatile int stop;
+};
+
+/**
+ * подключиться к депо и узнать количество резервуаров
+ * @param link указатель на подключение
+ * @param timeout время ожидания ответа в мс
+ * @return 0 - подключение установлено, -1 - депо недоступно
+ */
+static int _connect_depot(depot_link* link, int timeout);
+
+/**
+ * закрыть подключение к депо
+ * @param link указатель на подключение
+ */
+static void _disconnect_depot(depot_link* link);
+
+/**
+ * захватить мьютексы обмена всех депо (по порядку номеров)
+ * @param dc указатель на координатор
+ */
+static void _lock_links(depot_coordinator* dc);
+
+/**
+ * освободить мьютексы обмена всех депо
+ * @param dc указатель на координатор
+ */
+static void _unlock_links(depot_coordinator* dc);
+
+/**
+ * отправить запрос всем подключенным депо и дождаться ответов (депо обрабатывают запрос одновременно,
+ * ответы читаются по мере готовности сокетов, общий срок - DEPOT_ANSWER_TIMEOUT);
+ * ответы остаются в буферах подключений, депо без ответа отключаются (вызывается под мьютексами всех депо)
+ * @param dc указатель на координатор
+ * @param type тип сообщения
+ * @param data данные запроса
+ * @param size размер данных запроса
+ * @return количество ответивших депо
+ */
+static size_t _exchange_depots(depot_coordinator* dc, uint32_t type, const void* data, size_t size);
+
+/**
+ * переподключить отключившиеся депо и обновить снимок изменившимися резервуарами
+ * @param dc указатель на координатор
+ */
+static void _sync_depots(depot_coordinator* dc);
+
+/**
+ * поток синхронизации
+ * @param dc_ptr указатель на координатор
+ * @return NULL
+ */
+static void* _sync_coordinator(void* dc_ptr);
+
+/**
+ * сравнить ожидаемые достижения границы по времени (для qsort)
+ * @param a указатель на первое достижение
+ * @param b указатель на второе достижение
+ * @return <0, 0, >0
+ */
+static int _compare_etas(const void* a, const void* b);
+
+/**
+ * получить текущее время
+ * @return время CLOCK_MONOTONIC в мкс
+ */
+static unsigned long long _get_time_us();
+
+depot_coordinator* create_depot_coordinator(const char* const* paths, size_t depots_count){
+    depot_coordinator* dc = calloc(1, sizeof(depot_coordinator));
+    dc->links = calloc(depots_count, sizeof(depot_link));
+    dc->depots_count = depots_count;
+    for(size_t i = 0; i < depots_count; ++i){
+        depot_link* link = &dc->links[i];
+        link->path = strdup(paths[i]);
+        link->fd = -1;
+        pthread_mutex_init(&link->mutex, NULL);
+        if (_connect_depot(link, DEPOT_ANSWER_TIMEOUT) == -1){
+            dc->depots_count = i + 1;
+            finalize_depot_coordinator(dc);
+            return NULL;
+        }
+        link->first_tank = dc->tanks_count;
+        dc->tanks_count += link->tanks_count;
+    }
+    dc->states = malloc(sizeof(tank_state) * (dc->tanks_count > 0 ? dc->tanks_count : 1));
+    dc->polls = malloc(sizeof(struct pollfd) * (depots_count > 0 ? depots_count : 1));
+    dc->poll_links = malloc(sizeof(size_t) * (depots_count > 0 ? depots_count : 1));
+    pthread_mutex_init(&dc->snapshot_mutex, NULL);
+    _sync_depots(dc);
+    pthread_create(&dc->thread, NULL, _sync_coordinator, dc);
+    return dc;
+}
+
+size_t get_depots_count_coordinator(const depot_coordinator* dc){
+    return dc->depots_count;
+}
+
+size_t get_tanks_count_coordinator(const depot_coordinator* dc){
+    return dc->tanks_count;
+}
+
+int get_depot_info_coordinator(depot_coordinator* dc, size_t depot, depot_info* info){
+    if (depot >= dc->depots_count) return -1;
+    depot_link* link = &dc->links[depot];
+    info->path = link->path;
+    info->tanks_count = link->tanks_count;
+    info->first_tank = link->first_tank;
+    pthread_mutex_lock(&link->mutex);
+    info->connected = link->fd != -1;
+    pthread_mutex_unlock(&link->mutex);
+    return 0;
+}
+
+int locate_tank_coordinator(const depot_coordinator* dc, size_t tank, size_t* depot, unsigned int* number){
+    if (tank >= dc->tanks_count) return -1;
+    size_t low = 0, high = dc->depots_count - 1;
+    while (low < high){
+        size_t middle = (low + high + 1) / 2;
+        if (dc->links[middle].first_tank <= tank) low = middle;
+        else high = middle - 1;
+    }
+    //у депо без резервуаров тот же первый номер, что и у следующего
+    while (dc->links[low].tanks_count == 0) ++low;
+    *depot = low;
+    *number = (unsigned int)(tank - dc->links[low].first_tank);
+    return 0;
+}
+
+size_t get_tanks_states_coordinator(depot_coordinator* dc, size_t first, size_t count, tank_state* states, unsigned char* stale){
+    if (first >= dc->tanks_count) return 0;
+    if (count > dc->tanks_count - first) count = dc->tanks_count - first;
+    pthread_mutex_lock(&dc->snapshot_mutex);
+    memcpy(states, &dc->states[first], sizeof(tank_state) * count);
+    if (stale != NULL){
+        size_t depot;
+        unsigned int number;
+        for(size_t i = 0; i < count; ++i){
+            locate_tank_coordinator(dc, first + i, &depot, &number);
+            stale[i] = (unsigned char)dc->links[depot].stale;
+        }
+    }
+    pthread_mutex_unlock(&dc->snapshot_mutex);
+    return count;
+}
+
+int execute_command_coordinator(depot_coordinator* dc, size_t tank, int command, unsigned int value){
+    size_t depot;
+    depot_command request;
+    if (locate_tank_coordinator(dc, tank, &depot, &request.number) == -1) return TANK_ERROR_NUMBER;
+    request.command = command;
+    request.value = value;
+    depot_link* link = &dc->links[depot];
+    int result = TANK_ERROR_WORKER;
+    pthread_mutex_lock(&link->mutex);
+    if (link->fd != -1){
+        if (write_depot_message(link->fd, DEPOT_MESSAGE_COMMAND, &request, sizeof(request)) == 0
+            && read_depot_message(link->fd, &link->header, &link->answer, &link->answer_capacity, DEPOT_ANSWER_TIMEOUT) == 0
+            && link->header.type == DEPOT_MESSAGE_COMMAND && link->header.size == sizeof(int32_t)){
+            result = *(const int32_t*)link->answer;
+        } else {
+            _disconnect_depot(link);
+        }
+    }
+    pthread_mutex_unlock(&link->mutex);
+    return result;
+}
+
+void get_fleet_summary_coordinator(depot_coordinator* dc, fleet_summary* fs){
+    memset(fs, 0, sizeof(fleet_summary));
+    _lock_links(dc);
+    _exchange_depots(dc, DEPOT_MESSAGE_SUMMARY, NULL, 0);
+    int first = 1;
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        const depot_link* link = &dc->links[i];
+        if (!link->answered || link->header.size != sizeof(fleet_summary)) continue;
+        const fleet_summary* depot_fs = link->answer;
+        if (depot_fs->tanks_count == 0) continue;
+        fs->tanks_count += depot_fs->tanks_count;
+        fs->total_level += depot_fs->total_level;
+        fs->total_capacity += depot_fs->total_capacity;
+        fs->free_capacity += depot_fs->free_capacity;
+        fs->total_volume += depot_fs->total_volume;
+        fs->total_standard_volume += depot_fs->total_standard_volume;
+        if (first || depot_fs->fullest_fill > fs->fullest_fill){
+            fs->fullest_fill = depot_fs->fullest_fill;
+            fs->fullest_tank = link->first_tank + depot_fs->fullest_tank;
+        }
+        if (first || depot_fs->emptiest_fill < fs->emptiest_fill){
+            fs->emptiest_fill = depot_fs->emptiest_fill;
+            fs->emptiest_tank = link->first_tank + depot_fs->emptiest_tank;
+        }
+        for(size_t j = 0; j < FLEET_HISTOGRAM_SIZE; ++j){
+            fs->histogram[j] += depot_fs->histogram[j];
+        }
+        first = 0;
+    }
+    _unlock_links(dc);
+}
+
+size_t get_next_limits_coordinator(depot_coordinator* dc, limit_eta* etas, size_t count){
+    if (count > DEPOT_MAX_LIMITS) count = DEPOT_MAX_LIMITS;
+    if (count == 0) return 0;
+    //каждое депо присылает свои первые count резервуаров, общие первые count - среди них
+    limit_eta* all = malloc(sizeof(limit_eta) * count * dc->depots_count);
+    size_t all_count = 0;
+    uint32_t request = (uint32_t)count;
+    _lock_links(dc);
+    _exchange_depots(dc, DEPOT_MESSAGE_NEXT_LIMITS, &request, sizeof(request));
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        const depot_link* link = &dc->links[i];
+        if (!link->answered || link->header.size < offsetof(depot_limits, etas)) continue;
+        const depot_limits* limits = link->answer;
+        if (limits->count > count || link->header.size != offsetof(depot_limits, etas) + sizeof(limit_eta) * limits->count) continue;
+        for(uint32_t j = 0; j < limits->count; ++j){
+            all[all_count] = limits->etas[j];
+            all[all_count].number += (unsigned int)link->first_tank;
+            ++all_count;
+        }
+    }
+    _unlock_links(dc);
+    qsort(all, all_count, sizeof(limit_eta), _compare_etas);
+    if (count > all_count) count = all_count;
+    memcpy(etas, all, sizeof(limit_eta) * count);
+    free(all);
+    return count;
+}
+
+void get_stats_coordinator(depot_coordinator* dc, coordinator_stats* stats){
+    pthread_mutex_lock(&dc->snapshot_mutex);
+    *stats = dc->stats;
+    pthread_mutex_unlock(&dc->snapshot_mutex);
+}
+
+void finalize_depot_coordinator(depot_coordinator* dc){
+    if (dc->states != NULL){
+        dc->stop = 1;
+        pthread_join(dc->thread, NULL);
+        pthread_mutex_destroy(&dc->snapshot_mutex);
+    }
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        _disconnect_depot(&dc->links[i]);
+        pthread_mutex_destroy(&dc->links[i].mutex);
+        free(dc->links[i].answer);
+        free(dc->links[i].path);
+    }
+    free(dc->links);
+    free(dc->polls);
+    free(dc->poll_links);
+    free(dc->states);
+    free(dc);
+}
+
+static int _connect_depot(depot_link* link, int timeout){
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (strlen(link->path) >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, link->path);
+    link->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (link->fd == -1) return -1;
+    if (connect(link->fd, (struct sockaddr*)&address, sizeof(address)) == -1
+        || write_depot_message(link->fd, DEPOT_MESSAGE_HELLO, NULL, 0) == -1
+        || read_depot_message(link->fd, &link->header, &link->answer, &link->answer_capacity, timeout) == -1
+        || link->header.type != DEPOT_MESSAGE_HELLO || link->header.size != sizeof(uint64_t)){
+        _disconnect_depot(link);
+        return -1;
+    }
+    uint64_t tanks_count = *(const uint64_t*)link->answer;
+    //при переподключении депо должно остаться тем же, иначе общая нумерация резервуаров нарушится
+    if (link->tanks_count != 0 && tanks_count != link->tanks_count){
+        _disconnect_depot(link);
+        return -1;
+    }
+    link->tanks_count = (size_t)tanks_count;
+    return 0;
+}
+
+static void _disconnect_depot(depot_link* link){
+    if (link->fd == -1) return;
+    close(link->fd);
+    link->fd = -1;
+}
+
+static void _lock_links(depot_coordinator* dc){
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        pthread_mutex_lock(&dc->links[i].mutex);
+    }
+}
+
+static void _unlock_links(depot_coordinator* dc){
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        pthread_mutex_unlock(&dc->links[i].mutex);
+    }
+}
+
+static size_t _exchange_depots(depot_coordinator* dc, uint32_t type, const void* data, size_t size){
+    size_t waiting = 0;
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        depot_link* link = &dc->links[i];
+        link->answered = 0;
+        if (link->fd != -1 && write_depot_message(link->fd, type, data, size) == -1) _disconnect_depot(link);
+        if (link->fd == -1) continue;
+        dc->polls[waiting].fd = link->fd;
+        dc->polls[waiting].events = POLLIN;
+        dc->poll_links[waiting++] = i;
+    }
+    size_t answered = 0;
+    unsigned long long deadline = _get_time_us() + DEPOT_ANSWER_TIMEOUT * 1000ULL;
+    while (waiting > 0){
+        unsigned long long now = _get_time_us();
+        if (now >= deadline) break;
+        int left = (int)((deadline - now + 999) / 1000);
+        int ready = poll(dc->polls, waiting, left);
+        if (ready == -1 && errno == EINTR) continue;
+        if (ready <= 0) break;
+        size_t kept = 0;
+        for(size_t j = 0; j < waiting; ++j){
+            depot_link* link = &dc->links[dc->poll_links[j]];
+            if (dc->polls[j].revents == 0){
+                dc->polls[kept] = dc->polls[j];
+                dc->poll_links[kept++] = dc->poll_links[j];
+                continue;
+            }
+            //ответ начал приходить: остаток дочитывается не дольше общего срока
+            if (read_depot_message(link->fd, &link->header, &link->answer, &link->answer_capacity, left) == -1
+                || link->header.type != type){
+                _disconnect_depot(link);
+                continue;
+            }
+            link->answered = 1;
+            ++answered;
+        }
+        waiting = kept;
+    }
+    //депо, не ответившие к сроку, отключаются: их запоздавший ответ нарушил бы очередность запросов и ответов
+    for(size_t j = 0; j < waiting; ++j){
+        _disconnect_depot(&dc->links[dc->poll_links[j]]);
+    }
+    return answered;
+}
+
+static void _sync_depots(depot_coordinator* dc){
+    unsigned long long start = _get_time_us();
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        depot_link* link = &dc->links[i];
+        pthread_mutex_lock(&link->mutex);
+        //зависшее депо принимает подключение, но не отвечает, поэтому попытки редкие и с коротким ожиданием
+        if (link->fd == -1 && start >= link->reconnect_time && _connect_depot(link, DEPOT_SYNC_PERIOD) == -1){
+            link->reconnect_time = start + DEPOT_RECONNECT_PERIOD * 1000ULL;
+        }
+        pthread_mutex_unlock(&link->mutex);
+    }
+    _lock_links(dc);
+    _exchange_depots(dc, DEPOT_MESSAGE_CHANGES, NULL, 0);
+    size_t connected = 0, changed = 0, stale = 0;
+    pthread_mutex_lock(&dc->snapshot_mutex);
+    for(size_t i = 0; i < dc->depots_count; ++i){
+        depot_link* link = &dc->links[i];
+        if (link->fd != -1) ++connected;
+        link->stale = 1;
+        uint32_t count = 0;
+        if (link->answered && link->header.size >= sizeof(uint32_t)) memcpy(&count, link->answer, sizeof(count));
+        if (!link->answered || link->header.size != sizeof(uint32_t) + sizeof(depot_tank_change) * (size_t)count){
+            stale += link->tanks_count;
+            continue;
+        }
+        const depot_tank_change* changes = (const depot_tank_change*)((const char*)link->answer + sizeof(uint32_t));
+        for(uint32_t j = 0; j < count; ++j){
+            if (changes[j].number >= link->tanks_count) continue;
+            dc->states[link->first_tank + changes[j].number] = changes[j].state;
+        }
+        link->stale = 0;
+        changed += count;
+    }
+    unsigned long long sync_time = _get_time_us() - start;
+    dc->stats.connected_depots = connected;
+    dc->stats.syncs++;
+    dc->stats.changed_tanks = changed;
+    dc->stats.stale_tanks = stale;
+    dc->stats.sync_time = sync_time;
+    if (sync_time > dc->stats.max_sync_time) dc->stats.max_sync_time = sync_time;
+    pthread_mutex_unlock(&dc->snapshot_mutex);
+    _unlock_links(dc);
+}
+
+static void* _sync_coordinator(void* dc_ptr){
+    depot_coordinator* dc = dc_ptr;
+    while (!dc->stop){
+        usleep(DEPOT_SYNC_PERIOD * 1000);
+        if (!dc->stop) _sync_depots(dc);
+    }
+    return NULL;
+}
+
+static int _compare_etas(const void* a, const void* b){
+    const limit_eta* eta_a = a;
+    const limit_eta* eta_b = b;
+    if (eta_a->time != eta_b->time) return eta_a->time < eta_b->time ? -1 : 1;
+    return eta_a->number < eta_b->number ? -1 : eta_a->number > eta_b->number;
+}
+
+static unsigned long long _get_time_us(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000ULL + (unsigned long long)now.tv_nsec / 1000;
+}
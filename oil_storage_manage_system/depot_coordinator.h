@@ -0,0 +1,170 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_DEPOT_COORDINATOR_H
+#define OIL_STORAGE_MANAGE_SYSTEM_DEPOT_COORDINATOR_H
+
+#include "depot_protocol.h"
+#include "fleet_summary.h"
+#include "limit_forecast.h"
+#include <stddef.h>
+
+/**
+ * координатор нескольких депо (нефтехранилищ в отдельных процессах) через локальные сокеты
+ *
+ * резервуары всех депо нумеруются подряд в порядке депо; поток синхронизации периодически запрашивает
+ * у всех депо сразу изменившиеся резервуары и обновляет общий снимок состояний, команды передаются
+ * депо, которому принадлежит резервуар, запросы по всему парку отправляются всем депо одновременно
+ * и объединяются; ответы всех депо ждутся одновременно с общим сроком, поэтому зависшее депо не задерживает
+ * остальные дольше DEPOT_ANSWER_TIMEOUT; депо без ответа отключается, его резервуары в снимке помечаются
+ * устаревшими, и оно переподключается при синхронизации не чаще раза в DEPOT_RECONNECT_PERIOD
+ */
+struct _depot_coordinator;
+typedef struct _depot_coordinator depot_coordinator;
+
+#define DEPOT_SYNC_PERIOD       100     //период синхронизации снимка состояний в мс
+#define DEPOT_ANSWER_TIMEOUT    1000    //время ожидания ответа депо в мс
+#define DEPOT_RECONNECT_PERIOD  1000    //наименьший промежуток между попытками переподключения к депо в мс
+
+/**
+ * описание депо
+ */
+typedef struct _depot_info{
+    /**
+     * путь к сокету депо
+     */
+    const char* path;
+    /**
+     * количество резервуаров депо
+     */
+    size_t tanks_count;
+    /**
+     * общий номер первого резервуара депо
+     */
+    size_t first_tank;
+    /**
+     * признак подключения к депо
+     */
+    int connected;
+} depot_info;
+
+/**
+ * состояние координатора
+ */
+typedef struct _coordinator_stats{
+    /**
+     * количество подключенных депо
+     */
+    size_t connected_depots;
+    /**
+     * количество синхронизаций снимка
+     */
+    unsigned long long syncs;
+    /**
+     * количество резервуаров, изменившихся при последней синхронизации
+     */
+    size_t changed_tanks;
+    /**
+     * количество резервуаров, состояния которых в снимке устарели (их депо не ответило при последней синхронизации)
+     */
+    size_t stale_tanks;
+    /**
+     * время последней синхронизации в мкс
+     */
+    unsigned long long sync_time;
+    /**
+     * наибольшее время синхронизации в мкс
+     */
+    unsigned long long max_sync_time;
+} coordinator_stats;
+
+/**
+ * подключиться к депо, получить первый снимок состояний и начать синхронизацию
+ * @param paths пути к сокетам депо
+ * @param depots_count количество депо
+ * @return указатель на координатор, NULL - одно из депо недоступно
+ */
+depot_coordinator* create_depot_coordinator(const char* const* paths, size_t depots_count);
+
+/**
+ * получить количество депо
+ * @param dc указатель на координатор
+ * @return количество депо
+ */
+size_t get_depots_count_coordinator(const depot_coordinator* dc);
+
+/**
+ * получить общее количество резервуаров всех депо
+ * @param dc указатель на координатор
+ * @return количество резервуаров
+ */
+size_t get_tanks_count_coordinator(const depot_coordinator* dc);
+
+/**
+ * получить описание депо
+ * @param dc указатель на координатор
+ * @param depot номер депо
+ * @param info структура для описания
+ * @return 0 - описание получено, -1 - депо с таким номером нет
+ */
+int get_depot_info_coordinator(depot_coordinator* dc, size_t depot, depot_info* info);
+
+/**
+ * найти депо резервуара по общему номеру
+ * @param dc указатель на координатор
+ * @param tank общий номер резервуара
+ * @param depot номер депо
+ * @param number номер резервуара в депо
+ * @return 0 - резервуар найден, -1 - резервуара с таким номером нет
+ */
+int locate_tank_coordinator(const depot_coordinator* dc, size_t tank, size_t* depot, unsigned int* number);
+
+/**
+ * получить состояния подряд идущих резервуаров из общего снимка (на момент последней синхронизации)
+ * @param dc указатель на координатор
+ * @param first общий номер первого резервуара
+ * @param count количество резервуаров
+ * @param states массив для состояний
+ * @param stale массив признаков устаревшего состояния (депо резервуара не ответило при последней синхронизации;
+ *              NULL - признаки не нужны)
+ * @return количество записанных состояний
+ */
+size_t get_tanks_states_coordinator(depot_coordinator* dc, size_t first, size_t count, tank_state* states, unsigned char* stale);
+
+/**
+ * выполнить команду резервуара в его депо
+ * @param dc указатель на координатор
+ * @param tank общий номер резервуара
+ * @param command команда (COMMAND_TURN_ON_TANK, ...)
+ * @param value значение параметра команды
+ * @return TANK_OK, TANK_ERROR_NUMBER, TANK_ERROR_VALUE, TANK_ERROR_WORKER (в том числе депо не отвечает)
+ */
+int execute_command_coordinator(depot_coordinator* dc, size_t tank, int command, unsigned int value);
+
+/**
+ * получить сводные показатели по резервуарам всех подключенных депо (номера резервуаров общие)
+ * @param dc указатель на координатор
+ * @param fs сводные показатели
+ */
+void get_fleet_summary_coordinator(depot_coordinator* dc, fleet_summary* fs);
+
+/**
+ * получить резервуары всех подключенных депо, которые раньше всех достигнут границы уровня (номера общие)
+ * @param dc указатель на координатор
+ * @param etas массив для ожидаемых достижений (по возрастанию времени)
+ * @param count максимальное количество резервуаров (не больше DEPOT_MAX_LIMITS)
+ * @return количество резервуаров в массиве
+ */
+size_t get_next_limits_coordinator(depot_coordinator* dc, limit_eta* etas, size_t count);
+
+/**
+ * получить состояние координатора
+ * @param dc указатель на координатор
+ * @param stats структура для состояния
+ */
+void get_stats_coordinator(depot_coordinator* dc, coordinator_stats* stats);
+
+/**
+ * остановить синхронизацию и отключиться от депо
+ * @param dc указатель на координатор
+ */
+void finalize_depot_coordinator(depot_coordinator* dc);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_DEPOT_COORDINATOR_H
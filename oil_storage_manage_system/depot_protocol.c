@@ -0,0 +1,71 @@
+#include "depot_protocol.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define DEPOT_MAX_MESSAGE_SIZE (64u << 20) //наибольший допустимый размер данных сообщения в байтах
+
+/**
+ * записать данные в сокет целиком
+ * @param fd дескриптор сокета
+ * @param data данные
+ * @param size размер данных в байтах
+ * @return 0 - данные записаны, -1 - ошибка
+ */
+static int _write_full(int fd, const void* data, size_t size);
+
+/**
+ * прочитать данные из сокета целиком
+ * @param fd дескриптор сокета
+ * @param data буфер
+ * @param size размер данных в байтах
+ * @param timeout время ожидания в мс (-1 - без ограничения)
+ * @return 0 - данные прочитаны, -1 - ошибка или время ожидания истекло
+ */
+static int _read_full(int fd, void* data, size_t size, int timeout);
+
+int write_depot_message(int fd, uint32_t type, const void* data, size_t size){
+    depot_message_header header = {type, (uint32_t)size};
+    if (_write_full(fd, &header, sizeof(header)) == -1) return -1;
+    return size > 0 ? _write_full(fd, data, size) : 0;
+}
+
+int read_depot_message(int fd, depot_message_header* header, void** data, size_t* capacity, int timeout){
+    if (_read_full(fd, header, sizeof(*header), timeout) == -1) return -1;
+    if (header->size > DEPOT_MAX_MESSAGE_SIZE) return -1;
+    if (header->size > *capacity){
+        void* buffer = realloc(*data, header->size);
+        if (buffer == NULL) return -1;
+        *data = buffer;
+        *capacity = header->size;
+    }
+    return _read_full(fd, *data, header->size, timeout);
+}
+
+static int _write_full(int fd, const void* data, size_t size){
+    size_t sent = 0;
+    while (sent < size){
+        ssize_t n = send(fd, (const char*)data + sent, size - sent, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        sent += (size_t)n;
+    }
+    return 0;
+}
+
+static int _read_full(int fd, void* data, size_t size, int timeout){
+    size_t received = 0;
+    while (received < size){
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, timeout);
+        if (ready == -1 && errno == EINTR) continue;
+        if (ready <= 0) return -1;
+        ssize_t n = read(fd, (char*)data + received, size - received);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        received += (size_t)n;
+    }
+    return 0;
+}
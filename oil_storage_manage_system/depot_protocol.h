@@ -0,0 +1,106 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_DEPOT_PROTOCOL_H
+#define OIL_STORAGE_MANAGE_SYSTEM_DEPOT_PROTOCOL_H
+
+#include "tanks_table.h"
+#include "limit_forecast.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * обмен сообщениями между нефтехранилищем (депо) и координатором через локальный сокет
+ *
+ * каждое сообщение - заголовок depot_message_header и данные; на каждый запрос депо отвечает
+ * сообщением того же типа; структуры передаются в двоичном виде, так как депо и координатор
+ * работают на одной машине и собраны из одних исходников
+ */
+
+#define DEPOT_SOCKET_ENV            "OIL_STORAGE_SOCKET"    //переменная окружения с путем к сокету депо
+#define DEPOT_MESSAGE_HELLO         1   //запрос количества резервуаров, ответ - uint64_t
+#define DEPOT_MESSAGE_CHANGES       2   //запрос изменившихся с прошлого запроса резервуаров, ответ - uint32_t и записи depot_tank_change
+#define DEPOT_MESSAGE_COMMAND       3   //запрос - depot_command, ответ - int32_t (TANK_OK, TANK_ERROR_...)
+#define DEPOT_MESSAGE_SUMMARY       4   //запрос сводных показателей, ответ - fleet_summary
+#define DEPOT_MESSAGE_NEXT_LIMITS   5   //запрос - uint32_t количество, ответ - depot_limits до последней записи
+#define DEPOT_MAX_LIMITS            64  //максимальное количество резервуаров в ответе DEPOT_MESSAGE_NEXT_LIMITS
+
+/**
+ * заголовок сообщения
+ */
+typedef struct _depot_message_header{
+    /**
+     * тип сообщения (DEPOT_MESSAGE_HELLO, ...)
+     */
+    uint32_t type;
+    /**
+     * размер данных после заголовка в байтах
+     */
+    uint32_t size;
+} depot_message_header;
+
+/**
+ * изменившийся резервуар
+ */
+typedef struct _depot_tank_change{
+    /**
+     * номер резервуара в депо
+     */
+    uint32_t number;
+    /**
+     * состояние резервуара
+     */
+    tank_state state;
+} depot_tank_change;
+
+/**
+ * команда резервуару депо
+ */
+typedef struct _depot_command{
+    /**
+     * команда (COMMAND_TURN_ON_TANK, COMMAND_SET_SPEED_UPLOAD_PUMP, ...)
+     */
+    int32_t command;
+    /**
+     * номер резервуара в депо
+     */
+    uint32_t number;
+    /**
+     * значение параметра команды
+     */
+    uint32_t value;
+} depot_command;
+
+/**
+ * ответ на запрос DEPOT_MESSAGE_NEXT_LIMITS (передается до последней заполненной записи)
+ */
+typedef struct _depot_limits{
+    /**
+     * количество записей
+     */
+    uint32_t count;
+    /**
+     * резервуары, которые раньше всех достигнут границы уровня (по возрастанию времени)
+     */
+    limit_eta etas[DEPOT_MAX_LIMITS];
+} depot_limits;
+
+/**
+ * отправить сообщение
+ * @param fd дескриптор сокета
+ * @param type тип сообщения
+ * @param data данные
+ * @param size размер данных в байтах
+ * @return 0 - сообщение отправлено, -1 - ошибка (соединение разорвано)
+ */
+int write_depot_message(int fd, uint32_t type, const void* data, size_t size);
+
+/**
+ * прочитать сообщение (буфер данных увеличивается под размер сообщения)
+ * @param fd дескриптор сокета
+ * @param header заголовок сообщения
+ * @param data указатель на буфер данных (может указывать на NULL)
+ * @param capacity размер буфера данных
+ * @param timeout время ожидания каждой части сообщения в мс (-1 - без ограничения)
+ * @return 0 - сообщение прочитано, -1 - ошибка, соединение разорвано или время ожидания истекло
+ */
+int read_depot_message(int fd, depot_message_header* header, void** data, size_t* capacity, int timeout);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_DEPOT_PROTOCOL_H
@@ -0,0 +1,263 @@
+#define _GNU_SOURCE
+#include "depot_server.h"
+#include "depot_protocol.h"
+#include "trace.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DEPOT_POLL_TIMEOUT      100     //период проверки признака остановки сервера в мс
+#define DEPOT_READ_TIMEOUT      1000    //время ожидания остатка сообщения в мс
+#define DEPOT_STATES_BATCH      256     //количество состояний, читаемых из таблицы за раз
+
+/**
+ * подключение координатора
+ */
+typedef struct _depot_client{
+    /**
+     * дескриптор сокета (-1 - подключения нет)
+     */
+    int fd;
+    /**
+     * последние отправленные состояния резервуаров
+     */
+    tank_state* sent_states;
+    /**
+     * буфер данных запроса
+     */
+    void* request;
+    /**
+     * размер буфера запроса
+     */
+    size_t request_capacity;
+} depot_client;
+
+struct _depot_server{
+    /**
+     * нефтехранилище
+     */
+    oil_storage* os;
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * путь к сокету
+     */
+    struct sockaddr_un address;
+    /**
+     * дескриптор слушающего сокета
+     */
+    int listen_fd;
+    /**
+     * подключения
+     */
+    depot_client clients[DEPOT_MAX_CLIENTS];
+    /**
+     * буфер ответа на запрос изменений (количество и записи depot_tank_change)
+     */
+    void* changes;
+    /**
+     * поток сервера
+     */
+    pthread_t thread;
+    /**
+     * признак остановки сервера
+     */
+    volatile int stop;
+};
+
+/**
+ * поток сервера: принимает подключения и отвечает на запросы
+ * @param ds_ptr указатель на сервер
+ * @return NULL
+ */
+static void* _serve_depot(void* ds_ptr);
+
+/**
+ * принять подключение
+ * @param ds указатель на сервер
+ */
+static void _accept_client(depot_server* ds);
+
+/**
+ * прочитать запрос подключения и ответить на него
+ * @param ds указатель на сервер
+ * @param client указатель на подключение
+ * @return 0 - запрос обработан, -1 - подключение нужно закрыть
+ */
+static int _handle_request(depot_server* ds, depot_client* client);
+
+/**
+ * ответить на запрос изменений
+ * @param ds указатель на сервер
+ * @param client указатель на подключение
+ * @return 0 - ответ отправлен, -1 - ошибка
+ */
+static int _send_changes(depot_server* ds, depot_client* client);
+
+/**
+ * закрыть подключение
+ * @param client указатель на подключение
+ */
+static void _close_client(depot_client* client);
+
+depot_server* create_depot_server(oil_storage* os, const char* path){
+    depot_server* ds = calloc(1, sizeof(depot_server));
+    ds->os = os;
+    ds->tanks_count = get_count_tanks(os);
+    ds->address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(ds->address.sun_path)){
+        free(ds);
+        return NULL;
+    }
+    strcpy(ds->address.sun_path, path);
+    ds->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (ds->listen_fd == -1){
+        free(ds);
+        return NULL;
+    }
+    unlink(path);
+    if (bind(ds->listen_fd, (struct sockaddr*)&ds->address, sizeof(ds->address)) == -1
+        || listen(ds->listen_fd, DEPOT_MAX_CLIENTS) == -1){
+        close(ds->listen_fd);
+        free(ds);
+        return NULL;
+    }
+    for(size_t i = 0; i < DEPOT_MAX_CLIENTS; ++i){
+        ds->clients[i].fd = -1;
+    }
+    ds->changes = malloc(sizeof(uint32_t) + sizeof(depot_tank_change) * ds->tanks_count);
+    pthread_create(&ds->thread, NULL, _serve_depot, ds);
+    return ds;
+}
+
+void finalize_depot_server(depot_server* ds){
+    ds->stop = 1;
+    pthread_join(ds->thread, NULL);
+    for(size_t i = 0; i < DEPOT_MAX_CLIENTS; ++i){
+        _close_client(&ds->clients[i]);
+    }
+    close(ds->listen_fd);
+    unlink(ds->address.sun_path);
+    free(ds->changes);
+    free(ds);
+}
+
+static void* _serve_depot(void* ds_ptr){
+    depot_server* ds = ds_ptr;
+    set_thread_name_trace("depot_server");
+    struct pollfd fds[DEPOT_MAX_CLIENTS + 1];
+    while (!ds->stop){
+        size_t count = 0;
+        fds[count++] = (struct pollfd){ds->listen_fd, POLLIN, 0};
+        for(size_t i = 0; i < DEPOT_MAX_CLIENTS; ++i){
+            if (ds->clients[i].fd != -1) fds[count++] = (struct pollfd){ds->clients[i].fd, POLLIN, 0};
+        }
+        if (poll(fds, count, DEPOT_POLL_TIMEOUT) <= 0) continue;
+        if (fds[0].revents & POLLIN) _accept_client(ds);
+        for(size_t i = 1; i < count; ++i){
+            if (fds[i].revents == 0) continue;
+            for(size_t j = 0; j < DEPOT_MAX_CLIENTS; ++j){
+                if (ds->clients[j].fd != fds[i].fd) continue;
+                if (_handle_request(ds, &ds->clients[j]) == -1) _close_client(&ds->clients[j]);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void _accept_client(depot_server* ds){
+    int fd = accept4(ds->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd == -1) return;
+    for(size_t i = 0; i < DEPOT_MAX_CLIENTS; ++i){
+        depot_client* client = &ds->clients[i];
+        if (client->fd != -1) continue;
+        client->fd = fd;
+        //заведомо недопустимые состояния: на первый запрос изменений уходят все резервуары
+        client->sent_states = malloc(sizeof(tank_state) * ds->tanks_count);
+        memset(client->sent_states, 0xff, sizeof(tank_state) * ds->tanks_count);
+        return;
+    }
+    close(fd);
+}
+
+static int _handle_request(depot_server* ds, depot_client* client){
+    depot_message_header header;
+    if (read_depot_message(client->fd, &header, &client->request, &client->request_capacity, DEPOT_READ_TIMEOUT) == -1) return -1;
+    unsigned long long span = begin_span_trace();
+    int result = -1;
+    switch (header.type){
+        case DEPOT_MESSAGE_HELLO:{
+            uint64_t tanks_count = ds->tanks_count;
+            result = write_depot_message(client->fd, header.type, &tanks_count, sizeof(tanks_count));
+            break;
+        }
+        case DEPOT_MESSAGE_CHANGES:
+            result = _send_changes(ds, client);
+            break;
+        case DEPOT_MESSAGE_COMMAND:{
+            if (header.size != sizeof(depot_command)) break;
+            const depot_command* command = client->request;
+            int32_t answer = execute_tank_command(ds->os, command->command, command->number, command->value);
+            result = write_depot_message(client->fd, header.type, &answer, sizeof(answer));
+            break;
+        }
+        case DEPOT_MESSAGE_SUMMARY:{
+            fleet_summary fs;
+            get_fleet_summary(ds->os, &fs);
+            result = write_depot_message(client->fd, header.type, &fs, sizeof(fs));
+            break;
+        }
+        case DEPOT_MESSAGE_NEXT_LIMITS:{
+            if (header.size != sizeof(uint32_t)) break;
+            depot_limits answer;
+            uint32_t count = *(const uint32_t*)client->request;
+            answer.count = (uint32_t)get_next_limits(ds->os, answer.etas, count < DEPOT_MAX_LIMITS ? count : DEPOT_MAX_LIMITS);
+            result = write_depot_message(client->fd, header.type, &answer,
+                                         offsetof(depot_limits, etas) + sizeof(limit_eta) * answer.count);
+            break;
+        }
+        default:
+            break;
+    }
+    end_span_trace("depot", "request", span, TRACE_NO_ARG);
+    return result;
+}
+
+static int _send_changes(depot_server* ds, depot_client* client){
+    depot_tank_change* changes = (depot_tank_change*)((char*)ds->changes + sizeof(uint32_t));
+    uint32_t count = 0;
+    tank_state states[DEPOT_STATES_BATCH];
+    for(size_t first = 0; first < ds->tanks_count; first += DEPOT_STATES_BATCH){
+        size_t batch = get_tanks_states(ds->os, (unsigned int)first, DEPOT_STATES_BATCH, states);
+        for(size_t i = 0; i < batch; ++i){
+            tank_state* sent = &client->sent_states[first + i];
+            if (memcmp(sent, &states[i], sizeof(tank_state)) == 0) continue;
+            *sent = states[i];
+            changes[count].number = (uint32_t)(first + i);
+            changes[count].state = states[i];
+            ++count;
+        }
+    }
+    memcpy(ds->changes, &count, sizeof(count));
+    return write_depot_message(client->fd, DEPOT_MESSAGE_CHANGES, ds->changes, sizeof(uint32_t) + sizeof(depot_tank_change) * count);
+}
+
+static void _close_client(depot_client* client){
+    if (client->fd == -1) return;
+    close(client->fd);
+    client->fd = -1;
+    free(client->sent_states);
+    client->sent_states = NULL;
+    free(client->request);
+    client->request = NULL;
+    client->request_capacity = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_DEPOT_SERVER_H
+#define OIL_STORAGE_MANAGE_SYSTEM_DEPOT_SERVER_H
+
+#include "oil_storage.h"
+
+/**
+ * сервер депо: поток, отвечающий координатору на запросы depot_protocol.h через локальный сокет
+ *
+ * для каждого подключения хранится копия последних отправленных состояний резервуаров, поэтому
+ * на запрос изменений уходят только резервуары, состояние которых изменилось с прошлого запроса
+ */
+struct _depot_server;
+typedef struct _depot_server depot_server;
+
+#define DEPOT_MAX_CLIENTS   8   //максимальное количество одновременных подключений
+
+/**
+ * создать сервер и начать принимать подключения
+ * @param os указатель на нефтехранилище
+ * @param path путь к локальному сокету (существующий файл сокета заменяется)
+ * @return указатель на сервер, NULL - сокет не создан
+ */
+depot_server* create_depot_server(oil_storage* os, const char* path);
+
+/**
+ * остановить сервер, закрыть подключения и удалить файл сокета
+ * @param ds указатель на сервер
+ */
+void finalize_depot_server(depot_server* ds);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_DEPOT_SERVER_H
@@ -0,0 +1,149 @@
+#include "epoch_snapshot.h"
+#include <stdlib.h>
+
+#define EPOCH_NONE -1   //снимок еще не опубликован
+
+/**
+ * снимки состояний резервуаров
+ */
+struct _epoch_snapshot{
+    /**
+     * буферы снимков
+     */
+    tanks_snapshot buffers[EPOCH_SNAPSHOT_BUFFERS];
+    /**
+     * количество читателей каждого буфера
+     */
+    int readers[EPOCH_SNAPSHOT_BUFFERS];
+    /**
+     * номер опубликованного буфера (EPOCH_NONE - публикаций не было)
+     */
+    int published;
+    /**
+     * номер последней публикации
+     */
+    unsigned long long epoch;
+    /**
+     * резервуары, которые нужно переписать в каждом буфере
+     */
+    unsigned int* marked[EPOCH_SNAPSHOT_BUFFERS];
+    /**
+     * количество отмеченных резервуаров каждого буфера
+     */
+    size_t marked_counts[EPOCH_SNAPSHOT_BUFFERS];
+    /**
+     * признаки отмеченных резервуаров каждого буфера
+     */
+    unsigned char* marks[EPOCH_SNAPSHOT_BUFFERS];
+};
+
+epoch_snapshot* create_epoch_snapshot(size_t tanks_count){
+    epoch_snapshot* es = calloc(1, sizeof(epoch_snapshot));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    for(size_t i = 0; i < EPOCH_SNAPSHOT_BUFFERS; ++i){
+        tanks_snapshot* snapshot = &es->buffers[i];
+        unsigned int* columns = calloc(TANKS_TABLE_STATE_FIELDS * count, sizeof(unsigned int));
+        snapshot->tanks_count = tanks_count;
+        snapshot->current_levels    = columns;
+        snapshot->minimum_levels    = columns + tanks_count;
+        snapshot->maximum_levels    = columns + tanks_count*2;
+        snapshot->states            = (int*)(columns + tanks_count*3);
+        snapshot->download_states   = (int*)(columns + tanks_count*4);
+        snapshot->download_speeds   = columns + tanks_count*5;
+        snapshot->upload_states     = (int*)(columns + tanks_count*6);
+        snapshot->upload_speeds     = columns + tanks_count*7;
+        snapshot->volumes           = calloc(count, sizeof(float));
+        snapshot->standard_volumes  = calloc(count, sizeof(float));
+        es->marked[i] = malloc(sizeof(unsigned int) * count);
+        es->marks[i] = malloc(sizeof(unsigned char) * count);
+        for(size_t k = 0; k < tanks_count; ++k){
+            es->marked[i][k] = (unsigned int)k;
+            es->marks[i][k] = 1;
+        }
+        es->marked_counts[i] = tanks_count;
+    }
+    es->published = EPOCH_NONE;
+    return es;
+}
+
+tanks_snapshot* begin_write_epoch_snapshot(epoch_snapshot* es){
+    for(int i = 0; i < EPOCH_SNAPSHOT_BUFFERS; ++i){
+        //опубликованный буфер меняет только писатель, поэтому его номер читается без синхронизации
+        if (i == es->published) continue;
+        //читатель, захвативший буфер после этой проверки, увидит, что буфер уже не опубликован, и отпустит его
+        if (__atomic_load_n(&es->readers[i], __ATOMIC_SEQ_CST) == 0) return &es->buffers[i];
+    }
+    return NULL;
+}
+
+void publish_epoch_snapshot(epoch_snapshot* es, tanks_snapshot* snapshot){
+    snapshot->epoch = ++es->epoch;
+    __atomic_store_n(&es->published, (int)(snapshot - es->buffers), __ATOMIC_SEQ_CST);
+}
+
+const tanks_snapshot* acquire_epoch_snapshot(epoch_snapshot* es){
+    for(;;){
+        int published = __atomic_load_n(&es->published, __ATOMIC_SEQ_CST);
+        if (published == EPOCH_NONE) return NULL;
+        __atomic_add_fetch(&es->readers[published], 1, __ATOMIC_SEQ_CST);
+        //буфер мог быть снят с публикации и отдан писателю до увеличения счетчика - тогда повторить
+        if (__atomic_load_n(&es->published, __ATOMIC_SEQ_CST) == published) return &es->buffers[published];
+        __atomic_sub_fetch(&es->readers[published], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void release_epoch_snapshot(epoch_snapshot* es, const tanks_snapshot* snapshot){
+    __atomic_sub_fetch(&es->readers[snapshot - es->buffers], 1, __ATOMIC_SEQ_CST);
+}
+
+void get_tank_state_epoch_snapshot(const tanks_snapshot* snapshot, unsigned int number, tank_state* ts){
+    ts->current_level   = snapshot->current_levels[number];
+    ts->minimum_level   = snapshot->minimum_levels[number];
+    ts->maximum_level   = snapshot->maximum_levels[number];
+    ts->state           = snapshot->states[number];
+    ts->download_state  = snapshot->download_states[number];
+    ts->download_speed  = snapshot->download_speeds[number];
+    ts->upload_state    = snapshot->upload_states[number];
+    ts->upload_speed    = snapshot->upload_speeds[number];
+}
+
+void set_tank_state_epoch_snapshot(tanks_snapshot* snapshot, unsigned int number, const tank_state* ts){
+    snapshot->current_levels[number]  = ts->current_level;
+    snapshot->minimum_levels[number]  = ts->minimum_level;
+    snapshot->maximum_levels[number]  = ts->maximum_level;
+    snapshot->states[number]          = ts->state;
+    snapshot->download_states[number] = ts->download_state;
+    snapshot->download_speeds[number] = ts->download_speed;
+    snapshot->upload_states[number]   = ts->upload_state;
+    snapshot->upload_speeds[number]   = ts->upload_speed;
+}
+
+void mark_tank_epoch_snapshot(epoch_snapshot* es, unsigned int number){
+    for(size_t i = 0; i < EPOCH_SNAPSHOT_BUFFERS; ++i){
+        if (es->marks[i][number]) continue;
+        es->marks[i][number] = 1;
+        es->marked[i][es->marked_counts[i]++] = number;
+    }
+}
+
+size_t take_marked_epoch_snapshot(epoch_snapshot* es, const tanks_snapshot* snapshot, const unsigned int** numbers){
+    size_t buffer = (size_t)(snapshot - es->buffers);
+    size_t count = es->marked_counts[buffer];
+    for(size_t i = 0; i < count; ++i){
+        es->marks[buffer][es->marked[buffer][i]] = 0;
+    }
+    es->marked_counts[buffer] = 0;
+    *numbers = es->marked[buffer];
+    return count;
+}
+
+void finalize_epoch_snapshot(epoch_snapshot* es){
+    for(size_t i = 0; i < EPOCH_SNAPSHOT_BUFFERS; ++i){
+        free(es->buffers[i].current_levels);
+        free(es->buffers[i].volumes);
+        free(es->buffers[i].standard_volumes);
+        free(es->marked[i]);
+        free(es->marks[i]);
+    }
+    free(es);
+}
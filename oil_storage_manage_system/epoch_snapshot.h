@@ -0,0 +1,139 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_EPOCH_SNAPSHOT_H
+#define OIL_STORAGE_MANAGE_SYSTEM_EPOCH_SNAPSHOT_H
+
+#include "tanks_table.h"
+#include <stddef.h>
+
+/**
+ * согласованные снимки состояний всех резервуаров, снятые в один такт
+ *
+ * снимки публикуются по эпохам в нескольких буферах: писатель заполняет буфер, который не опубликован
+ * и не читается, и публикует его одной атомарной записью; читатель захватывает опубликованный буфер
+ * счетчиком читателей и получает все резервуары на один такт без блокировок, писатель читателей не ждет
+ * (если все свободные буферы заняты читателями, публикация пропускается)
+ */
+struct _epoch_snapshot;
+typedef struct _epoch_snapshot epoch_snapshot;
+
+#define EPOCH_SNAPSHOT_BUFFERS  3   //количество буферов: опубликованный, заполняемый и захваченный медленным читателем
+
+/**
+ * снимок состояний всех резервуаров
+ */
+typedef struct _tanks_snapshot{
+    /**
+     * номер публикации (растет с каждым снимком)
+     */
+    unsigned long long epoch;
+    /**
+     * такт, в который снят снимок
+     */
+    unsigned long long tick;
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * столбцы состояния (лежат подряд одним блоком, начиная с current_levels, в порядке полей tank_state)
+     */
+    unsigned int* current_levels;
+    unsigned int* minimum_levels;
+    unsigned int* maximum_levels;
+    int* states;
+    int* download_states;
+    unsigned int* download_speeds;
+    int* upload_states;
+    unsigned int* upload_speeds;
+    /**
+     * объемы по градуировочным таблицам
+     */
+    float* volumes;
+    /**
+     * объемы, приведенные к 15 °C
+     */
+    float* standard_volumes;
+    /**
+     * суммарный объем
+     */
+    double total_volume;
+    /**
+     * суммарный приведенный объем
+     */
+    double total_standard_volume;
+} tanks_snapshot;
+
+/**
+ * создать буферы снимков (опубликованного снимка еще нет)
+ * @param tanks_count количество резервуаров
+ * @return указатель на снимки
+ */
+epoch_snapshot* create_epoch_snapshot(size_t tanks_count);
+
+/**
+ * получить буфер для следующего снимка (вызывается только писателем)
+ * @param es указатель на снимки
+ * @return буфер, NULL - все неопубликованные буферы читаются, снимок в этот такт пропускается
+ */
+tanks_snapshot* begin_write_epoch_snapshot(epoch_snapshot* es);
+
+/**
+ * опубликовать заполненный снимок (предыдущий снимок освобождается после ухода его читателей)
+ * @param es указатель на снимки
+ * @param snapshot буфер, полученный begin_write_epoch_snapshot
+ */
+void publish_epoch_snapshot(epoch_snapshot* es, tanks_snapshot* snapshot);
+
+/**
+ * захватить последний опубликованный снимок (не блокирует писателя)
+ * @param es указатель на снимки
+ * @return снимок, NULL - снимков еще не было
+ */
+const tanks_snapshot* acquire_epoch_snapshot(epoch_snapshot* es);
+
+/**
+ * освободить захваченный снимок
+ * @param es указатель на снимки
+ * @param snapshot снимок, полученный acquire_epoch_snapshot
+ */
+void release_epoch_snapshot(epoch_snapshot* es, const tanks_snapshot* snapshot);
+
+/**
+ * прочитать состояние резервуара из снимка
+ * @param snapshot снимок
+ * @param number номер резервуара
+ * @param ts состояние резервуара
+ */
+void get_tank_state_epoch_snapshot(const tanks_snapshot* snapshot, unsigned int number, tank_state* ts);
+
+/**
+ * записать состояние резервуара в заполняемый буфер
+ * @param snapshot буфер, полученный begin_write_epoch_snapshot
+ * @param number номер резервуара
+ * @param ts состояние резервуара
+ */
+void set_tank_state_epoch_snapshot(tanks_snapshot* snapshot, unsigned int number, const tank_state* ts);
+
+/**
+ * отметить резервуар, изменившийся после последней публикации: в каждом буфере он будет переписан
+ * при следующем заполнении этого буфера (для снимков, которые обновляются только по изменившимся резервуарам)
+ * @param es указатель на снимки
+ * @param number номер резервуара
+ */
+void mark_tank_epoch_snapshot(epoch_snapshot* es, unsigned int number);
+
+/**
+ * забрать резервуары, которые нужно переписать в буфере перед публикацией (вначале отмечены все резервуары)
+ * @param es указатель на снимки
+ * @param snapshot буфер, полученный begin_write_epoch_snapshot
+ * @param numbers указатель на массив номеров (действителен до следующей отметки)
+ * @return количество резервуаров
+ */
+size_t take_marked_epoch_snapshot(epoch_snapshot* es, const tanks_snapshot* snapshot, const unsigned int** numbers);
+
+/**
+ * уничтожить снимки (читателей быть не должно)
+ * @param es указатель на снимки
+ */
+void finalize_epoch_snapshot(epoch_snapshot* es);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_EPOCH_SNAPSHOT_H
@@ -0,0 +1,294 @@
+#include "fleet_config.h"
+#include "strapping_table.h"
+#include "volume_correction.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CONFIG_FIELDS_COUNT 5   //количество чисел в строке текстового формата
+#define CONFIG_DECIMAL_SIZE 32  //максимальная длина дробного числа в текстовом формате
+
+/**
+ * конфигурация парка резервуаров
+ */
+struct _fleet_config{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * описания резервуаров (в отображенном двоичном файле или в выделенной памяти)
+     */
+    const tank_config* tanks;
+    /**
+     * отображенный в память двоичный файл (NULL - описания разобраны из текста)
+     */
+    void* mapping;
+    /**
+     * размер отображения
+     */
+    size_t mapping_size;
+};
+
+/**
+ * разобрать текстовую конфигурацию прямо в отображенном файле
+ * @param fc указатель на конфигурацию
+ * @param text текст файла
+ * @param size размер текста
+ * @param error_line номер строки с ошибкой
+ * @return 0 - конфигурация разобрана, -1 - ошибка
+ */
+static int _parse_text(fleet_config* fc, const char* text, size_t size, size_t* error_line);
+
+/**
+ * разобрать строку текстовой конфигурации
+ * @param p начало строки
+ * @param end конец строки
+ * @param tc описание резервуара
+ * @return 1 - резервуар описан, 0 - пустая строка, -1 - ошибка
+ */
+static int _parse_line(const char* p, const char* end, tank_config* tc);
+
+/**
+ * разобрать число после префикса слова (table=N, capacity=V)
+ * @param word слово
+ * @param len длина слова
+ * @param prefix префикс
+ * @param value число
+ * @return 0 - число разобрано, -1 - слово не начинается с префикса или число некорректно
+ */
+static int _parse_value(const char* word, size_t len, const char* prefix, uint32_t* value);
+
+/**
+ * разобрать дробное число после префикса слова (density=D, temperature=T)
+ * @param word слово
+ * @param len длина слова
+ * @param prefix префикс
+ * @param value число
+ * @return 0 - число разобрано, -1 - слово не начинается с префикса или число некорректно
+ */
+static int _parse_decimal(const char* word, size_t len, const char* prefix, float* value);
+
+/**
+ * проверить описание резервуара
+ * @param tc описание резервуара
+ * @return 0 - описание корректно, -1 - ошибка
+ */
+static int _check_tank_config(const tank_config* tc);
+
+fleet_config* load_fleet_config(const char* path, size_t* error_line){
+    size_t line = 0;
+    if (error_line == NULL) error_line = &line;
+    *error_line = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0){
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+    fleet_config* fc = malloc(sizeof(fleet_config));
+    fc->tanks_count = 0;
+    fc->tanks = NULL;
+    fc->mapping = NULL;
+    fc->mapping_size = 0;
+    const fleet_config_header* header = mapping;
+    if (size >= sizeof(fleet_config_header) && memcmp(header->magic, FLEET_CONFIG_MAGIC, sizeof(header->magic)) == 0){
+        if (header->version != FLEET_CONFIG_VERSION
+            || header->tanks_count > (size - sizeof(fleet_config_header)) / sizeof(tank_config)){
+            munmap(mapping, size);
+            free(fc);
+            return NULL;
+        }
+        fc->tanks_count = (size_t)header->tanks_count;
+        fc->tanks = (const tank_config*)((const char*)mapping + sizeof(fleet_config_header));
+        fc->mapping = mapping;
+        fc->mapping_size = size;
+        for(size_t i = 0; i < fc->tanks_count; ++i){
+            if (_check_tank_config(&fc->tanks[i]) == -1){
+                finalize_fleet_config(fc);
+                return NULL;
+            }
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        return fc;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    int result = _parse_text(fc, mapping, size, error_line);
+    munmap(mapping, size);
+    if (result == -1){
+        finalize_fleet_config(fc);
+        return NULL;
+    }
+    return fc;
+}
+
+int save_binary_fleet_config(const fleet_config* fc, const char* path){
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) return -1;
+    fleet_config_header header;
+    memcpy(header.magic, FLEET_CONFIG_MAGIC, sizeof(header.magic));
+    header.version = FLEET_CONFIG_VERSION;
+    header.tanks_count = fc->tanks_count;
+    int result = 0;
+    const char* data[2] = {(const char*)&header, (const char*)fc->tanks};
+    size_t sizes[2] = {sizeof(header), sizeof(tank_config) * fc->tanks_count};
+    for(int part = 0; part < 2 && result == 0; ++part){
+        size_t written = 0;
+        while (written < sizes[part]){
+            ssize_t n = write(fd, data[part] + written, sizes[part] - written);
+            if (n <= 0){
+                result = -1;
+                break;
+            }
+            written += (size_t)n;
+        }
+    }
+    if (close(fd) == -1) result = -1;
+    return result;
+}
+
+size_t get_count_fleet_config(const fleet_config* fc){
+    return fc->tanks_count;
+}
+
+const tank_config* get_tanks_fleet_config(const fleet_config* fc){
+    return fc->tanks;
+}
+
+void finalize_fleet_config(fleet_config* fc){
+    if (fc->mapping != NULL){
+        munmap(fc->mapping, fc->mapping_size);
+    } else {
+        free((void*)fc->tanks);
+    }
+    free(fc);
+}
+
+static int _parse_text(fleet_config* fc, const char* text, size_t size, size_t* error_line){
+    const char* end = text + size;
+    size_t lines_count = 1;
+    for(const char* p = text; (p = memchr(p, '\n', (size_t)(end - p))) != NULL; ++p){
+        lines_count++;
+    }
+    tank_config* tanks = malloc(sizeof(tank_config) * lines_count);
+    fc->tanks = tanks;
+    size_t line = 0;
+    for(const char* p = text; p < end; ){
+        const char* line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL) line_end = end;
+        line++;
+        int result = _parse_line(p, line_end, &tanks[fc->tanks_count]);
+        if (result == -1 || (result == 1 && _check_tank_config(&tanks[fc->tanks_count]) == -1)){
+            *error_line = line;
+            return -1;
+        }
+        fc->tanks_count += (size_t)result;
+        p = line_end + 1;
+    }
+    return 0;
+}
+
+static int _parse_line(const char* p, const char* end, tank_config* tc){
+    uint32_t fields[CONFIG_FIELDS_COUNT];
+    int fields_count = 0;
+    tc->flags = 0;
+    tc->strapping_table = STRAPPING_TABLE_VERTICAL;
+    tc->capacity = 0;
+    tc->density = 0.0f;
+    tc->temperature = VOLUME_CORRECTION_BASE_TEMPERATURE;
+    int has_shape = 0;
+    for(;;){
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == end || *p == '#') break;
+        const char* word = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '#') ++p;
+        size_t len = (size_t)(p - word);
+        uint32_t value;
+        float decimal;
+        if (*word >= '0' && *word <= '9'){
+            if (fields_count == CONFIG_FIELDS_COUNT) return -1;
+            uint64_t value = 0;
+            for(size_t i = 0; i < len; ++i){
+                if (word[i] < '0' || word[i] > '9') return -1;
+                value = value * 10 + (uint64_t)(word[i] - '0');
+                if (value > UINT32_MAX) return -1;
+            }
+            fields[fields_count++] = (uint32_t)value;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && len == 2 && memcmp(word, "on", 2) == 0){
+            tc->flags |= FLEET_CONFIG_TANK_ON;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && len == 8 && memcmp(word, "download", 8) == 0){
+            tc->flags |= FLEET_CONFIG_DOWNLOAD_PUMP;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && len == 6 && memcmp(word, "upload", 6) == 0){
+            tc->flags |= FLEET_CONFIG_UPLOAD_PUMP;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && !has_shape && len == 10 && memcmp(word, "horizontal", 10) == 0){
+            tc->strapping_table = STRAPPING_TABLE_HORIZONTAL;
+            has_shape = 1;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && !has_shape && len == 9 && memcmp(word, "spherical", 9) == 0){
+            tc->strapping_table = STRAPPING_TABLE_SPHERICAL;
+            has_shape = 1;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && !has_shape && _parse_value(word, len, "table=", &value) == 0
+                   && value > 0 && value <= UINT32_MAX - STRAPPING_TABLE_BUILTIN){
+            tc->strapping_table = STRAPPING_TABLE_BUILTIN + value - 1;
+            has_shape = 1;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && _parse_value(word, len, "capacity=", &value) == 0){
+            tc->capacity = value;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && len == 7 && memcmp(word, "refined", 7) == 0){
+            tc->flags |= FLEET_CONFIG_REFINED;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && _parse_decimal(word, len, "density=", &decimal) == 0){
+            tc->density = decimal;
+        } else if (fields_count == CONFIG_FIELDS_COUNT && _parse_decimal(word, len, "temperature=", &decimal) == 0){
+            tc->temperature = decimal;
+        } else {
+            return -1;
+        }
+    }
+    if (fields_count == 0) return 0;
+    if (fields_count != CONFIG_FIELDS_COUNT) return -1;
+    tc->minimum_level = fields[0];
+    tc->maximum_level = fields[1];
+    tc->current_level = fields[2];
+    tc->download_speed = fields[3];
+    tc->upload_speed = fields[4];
+    return 1;
+}
+
+static int _parse_value(const char* word, size_t len, const char* prefix, uint32_t* value){
+    size_t prefix_len = strlen(prefix);
+    if (len <= prefix_len || memcmp(word, prefix, prefix_len) != 0) return -1;
+    uint64_t result = 0;
+    for(size_t i = prefix_len; i < len; ++i){
+        if (word[i] < '0' || word[i] > '9') return -1;
+        result = result * 10 + (uint64_t)(word[i] - '0');
+        if (result > UINT32_MAX) return -1;
+    }
+    *value = (uint32_t)result;
+    return 0;
+}
+
+static int _parse_decimal(const char* word, size_t len, const char* prefix, float* value){
+    size_t prefix_len = strlen(prefix);
+    if (len <= prefix_len || len - prefix_len >= CONFIG_DECIMAL_SIZE || memcmp(word, prefix, prefix_len) != 0) return -1;
+    char buffer[CONFIG_DECIMAL_SIZE];
+    memcpy(buffer, word + prefix_len, len - prefix_len);
+    buffer[len - prefix_len] = '\0';
+    char* end;
+    *value = strtof(buffer, &end);
+    return *end == '\0' ? 0 : -1;
+}
+
+static int _check_tank_config(const tank_config* tc){
+    if (tc->minimum_level > tc->maximum_level || tc->current_level > tc->maximum_level) return -1;
+    if (tc->download_speed > INT32_MAX || tc->upload_speed > INT32_MAX) return -1;
+    if (tc->flags & ~(uint32_t)(FLEET_CONFIG_TANK_ON | FLEET_CONFIG_DOWNLOAD_PUMP | FLEET_CONFIG_UPLOAD_PUMP | FLEET_CONFIG_REFINED)) return -1;
+    if (tc->density != 0.0f && !(tc->density >= VOLUME_CORRECTION_MIN_DENSITY && tc->density <= VOLUME_CORRECTION_MAX_DENSITY)) return -1;
+    if (!(tc->temperature >= VOLUME_CORRECTION_MIN_TEMPERATURE && tc->temperature <= VOLUME_CORRECTION_MAX_TEMPERATURE)) return -1;
+    return 0;
+}
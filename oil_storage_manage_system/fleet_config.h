@@ -0,0 +1,132 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_FLEET_CONFIG_H
+#define OIL_STORAGE_MANAGE_SYSTEM_FLEET_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * конфигурация парка резервуаров, загруженная из файла
+ *
+ * текстовый формат - одна строка на резервуар, '#' начинает комментарий:
+ *     минимум максимум уровень скорость_закачки скорость_откачки [on] [download] [upload]
+ *     [horizontal | spherical | table=N] [capacity=V] [refined] [density=D] [temperature=T]
+ * (on - резервуар включен, download/upload - включен насос закачки/откачки,
+ * horizontal/spherical - форма резервуара, table=N - N-я таблица из файла градуировочных таблиц,
+ * capacity=V - объем при максимальном уровне, refined - нефтепродукт вместо сырой нефти,
+ * density=D - плотность при 15 °C в кг/м3, temperature=T - температура продукта в °C)
+ *
+ * двоичный формат - заголовок fleet_config_header, за которым следуют записи tank_config;
+ * двоичный файл отображается в память и используется без копирования
+ */
+struct _fleet_config;
+typedef struct _fleet_config fleet_config;
+
+#define FLEET_CONFIG_MAGIC          "OSFC"  //сигнатура двоичного файла конфигурации
+#define FLEET_CONFIG_VERSION        3       //версия двоичного формата
+#define FLEET_CONFIG_TANK_ON        1       //резервуар включен
+#define FLEET_CONFIG_DOWNLOAD_PUMP  2       //насос закачки включен
+#define FLEET_CONFIG_UPLOAD_PUMP    4       //насос откачки включен
+#define FLEET_CONFIG_REFINED        8       //в резервуаре нефтепродукт (таблица 54B), иначе сырая нефть
+
+/**
+ * описание резервуара (запись двоичного файла конфигурации)
+ */
+typedef struct _tank_config{
+    /**
+     * минимальный уровень нефтепродуктов
+     */
+    uint32_t minimum_level;
+    /**
+     * максимальный уровень нефтепродуктов
+     */
+    uint32_t maximum_level;
+    /**
+     * начальный уровень нефтепродуктов
+     */
+    uint32_t current_level;
+    /**
+     * скорость закачки
+     */
+    uint32_t download_speed;
+    /**
+     * скорость откачки
+     */
+    uint32_t upload_speed;
+    /**
+     * начальное состояние (FLEET_CONFIG_TANK_ON, FLEET_CONFIG_DOWNLOAD_PUMP, FLEET_CONFIG_UPLOAD_PUMP, FLEET_CONFIG_REFINED)
+     */
+    uint32_t flags;
+    /**
+     * номер градуировочной таблицы (STRAPPING_TABLE_VERTICAL, STRAPPING_TABLE_HORIZONTAL, STRAPPING_TABLE_SPHERICAL,
+     * STRAPPING_TABLE_BUILTIN и далее - загруженные таблицы)
+     */
+    uint32_t strapping_table;
+    /**
+     * объем при максимальном уровне (0 - равен максимальному уровню)
+     */
+    uint32_t capacity;
+    /**
+     * плотность продукта при 15 °C в кг/м3 (0 - VOLUME_CORRECTION_DEFAULT_DENSITY)
+     */
+    float density;
+    /**
+     * температура продукта в °C
+     */
+    float temperature;
+} tank_config;
+
+/**
+ * заголовок двоичного файла конфигурации
+ */
+typedef struct _fleet_config_header{
+    /**
+     * сигнатура FLEET_CONFIG_MAGIC
+     */
+    char magic[4];
+    /**
+     * версия формата FLEET_CONFIG_VERSION
+     */
+    uint32_t version;
+    /**
+     * количество записей tank_config
+     */
+    uint64_t tanks_count;
+} fleet_config_header;
+
+/**
+ * загрузить конфигурацию из текстового или двоичного файла (формат определяется по сигнатуре)
+ * @param path путь к файлу
+ * @param error_line номер строки текстового файла с ошибкой (0 - ошибка чтения файла или двоичного формата), может быть NULL
+ * @return указатель на конфигурацию, NULL - ошибка
+ */
+fleet_config* load_fleet_config(const char* path, size_t* error_line);
+
+/**
+ * сохранить конфигурацию в двоичном формате
+ * @param fc указатель на конфигурацию
+ * @param path путь к файлу
+ * @return 0 - конфигурация сохранена, -1 - ошибка записи
+ */
+int save_binary_fleet_config(const fleet_config* fc, const char* path);
+
+/**
+ * получить количество резервуаров в конфигурации
+ * @param fc указатель на конфигурацию
+ * @return количество резервуаров
+ */
+size_t get_count_fleet_config(const fleet_config* fc);
+
+/**
+ * получить описания резервуаров
+ * @param fc указатель на конфигурацию
+ * @return массив описаний (действителен до уничтожения конфигурации)
+ */
+const tank_config* get_tanks_fleet_config(const fleet_config* fc);
+
+/**
+ * уничтожить конфигурацию
+ * @param fc указатель на конфигурацию
+ */
+void finalize_fleet_config(fleet_config* fc);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_FLEET_CONFIG_H
@@ -0,0 +1,155 @@
+#include "fleet_summary.h"
+#include <string.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/**
+ * количество резервуаров, обрабатываемых за один проход блочной свертки
+ */
+#define FLEET_BLOCK_SIZE 1024
+
+/**
+ * свертка блока резервуаров: суммы уровней, интервал гистограммы каждого резервуара, минимум и максимум заполненности
+ * @param current_levels уровни нефтепродуктов
+ * @param maximum_levels максимальные уровни
+ * @param count количество резервуаров в блоке
+ * @param buckets массив для интервалов гистограммы резервуаров
+ * @param total_level сумма уровней (накапливается)
+ * @param total_capacity сумма максимальных уровней (накапливается)
+ * @param min_fill минимальная заполненность в блоке
+ * @param max_fill максимальная заполненность в блоке
+ */
+static void _reduce_block(const unsigned int* current_levels, const unsigned int* maximum_levels, size_t count, int* buckets,
+                          unsigned long long* total_level, unsigned long long* total_capacity, float* min_fill, float* max_fill);
+
+/**
+ * найти первый резервуар блока с заданной заполненностью
+ * @param current_levels уровни нефтепродуктов
+ * @param maximum_levels максимальные уровни
+ * @param count количество резервуаров в блоке
+ * @param fill заполненность
+ * @return номер резервуара в блоке
+ */
+static size_t _find_fill(const unsigned int* current_levels, const unsigned int* maximum_levels, size_t count, float fill);
+
+/**
+ * заполненность резервуара
+ * @param current_level уровень нефтепродуктов
+ * @param maximum_level максимальный уровень
+ * @return доля максимального уровня
+ */
+static float _fill(unsigned int current_level, unsigned int maximum_level);
+
+void compute_fleet_summary(const unsigned int* current_levels, const unsigned int* maximum_levels, size_t count, fleet_summary* fs){
+    int buckets[FLEET_BLOCK_SIZE];
+    size_t fullest_block = 0, emptiest_block = 0;
+    memset(fs, 0, sizeof(fleet_summary));
+    fs->tanks_count = count;
+    fs->fullest_fill = -1.0f;
+    fs->emptiest_fill = 0.0f;
+    for(size_t start = 0; start < count; start += FLEET_BLOCK_SIZE){
+        size_t block_count = count - start < FLEET_BLOCK_SIZE ? count - start : FLEET_BLOCK_SIZE;
+        float min_fill, max_fill;
+        _reduce_block(current_levels + start, maximum_levels + start, block_count, buckets,
+                      &fs->total_level, &fs->total_capacity, &min_fill, &max_fill);
+        for(size_t i = 0; i < block_count; ++i){
+            fs->histogram[buckets[i]]++;
+        }
+        if (max_fill > fs->fullest_fill){
+            fs->fullest_fill = max_fill;
+            fullest_block = start;
+        }
+        if (start == 0 || min_fill < fs->emptiest_fill){
+            fs->emptiest_fill = min_fill;
+            emptiest_block = start;
+        }
+    }
+    if (count == 0){
+        fs->fullest_fill = 0.0f;
+        return;
+    }
+    fs->free_capacity = fs->total_capacity > fs->total_level ? fs->total_capacity - fs->total_level : 0;
+    size_t fullest_count = count - fullest_block < FLEET_BLOCK_SIZE ? count - fullest_block : FLEET_BLOCK_SIZE;
+    size_t emptiest_count = count - emptiest_block < FLEET_BLOCK_SIZE ? count - emptiest_block : FLEET_BLOCK_SIZE;
+    fs->fullest_tank = fullest_block + _find_fill(current_levels + fullest_block, maximum_levels + fullest_block, fullest_count, fs->fullest_fill);
+    fs->emptiest_tank = emptiest_block + _find_fill(current_levels + emptiest_block, maximum_levels + emptiest_block, emptiest_count, fs->emptiest_fill);
+}
+
+unsigned int get_fill_percentile_fleet_summary(const fleet_summary* fs, unsigned int percent){
+    size_t rank = (fs->tanks_count * percent + 99) / 100;
+    size_t accumulated = 0;
+    for(unsigned int i = 0; i < FLEET_HISTOGRAM_SIZE; ++i){
+        accumulated += fs->histogram[i];
+        if (accumulated >= rank && accumulated > 0) return i;
+    }
+    return FLEET_HISTOGRAM_SIZE;
+}
+
+static void _reduce_block(const unsigned int* current_levels, const unsigned int* maximum_levels, size_t count, int* buckets,
+                          unsigned long long* total_level, unsigned long long* total_capacity, float* min_fill, float* max_fill){
+    size_t i = 0;
+    unsigned long long sum_level = 0, sum_capacity = 0;
+    float min_value = count > 0 ? _fill(current_levels[0], maximum_levels[0]) : 0.0f;
+    float max_value = min_value;
+#if defined(__SSE2__)
+    if (count >= 4){
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi32(1);
+        __m128i level_sums = zero, capacity_sums = zero;
+        const __m128 histogram_scale = _mm_set1_ps((float)FLEET_HISTOGRAM_SIZE);
+        const __m128 last_bucket = _mm_set1_ps((float)(FLEET_HISTOGRAM_SIZE - 1));
+        __m128 min_fills = _mm_set1_ps(min_value), max_fills = _mm_set1_ps(max_value);
+        for(; i + 4 <= count; i += 4){
+            __m128i levels = _mm_loadu_si128((const __m128i*)(current_levels + i));
+            __m128i capacities = _mm_loadu_si128((const __m128i*)(maximum_levels + i));
+            level_sums = _mm_add_epi64(level_sums, _mm_unpacklo_epi32(levels, zero));
+            level_sums = _mm_add_epi64(level_sums, _mm_unpackhi_epi32(levels, zero));
+            capacity_sums = _mm_add_epi64(capacity_sums, _mm_unpacklo_epi32(capacities, zero));
+            capacity_sums = _mm_add_epi64(capacity_sums, _mm_unpackhi_epi32(capacities, zero));
+            __m128i divisors = _mm_or_si128(capacities, _mm_and_si128(_mm_cmpeq_epi32(capacities, zero), one));
+            __m128 fill = _mm_div_ps(_mm_cvtepi32_ps(levels), _mm_cvtepi32_ps(divisors));
+            __m128 bucket = _mm_min_ps(_mm_max_ps(_mm_mul_ps(fill, histogram_scale), _mm_setzero_ps()), last_bucket);
+            _mm_storeu_si128((__m128i*)(buckets + i), _mm_cvttps_epi32(bucket));
+            min_fills = _mm_min_ps(min_fills, fill);
+            max_fills = _mm_max_ps(max_fills, fill);
+        }
+        unsigned long long lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, level_sums);
+        sum_level += lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i*)lanes, capacity_sums);
+        sum_capacity += lanes[0] + lanes[1];
+        float values[4];
+        _mm_storeu_ps(values, min_fills);
+        for(int j = 0; j < 4; ++j) if (values[j] < min_value) min_value = values[j];
+        _mm_storeu_ps(values, max_fills);
+        for(int j = 0; j < 4; ++j) if (values[j] > max_value) max_value = values[j];
+    }
+#endif
+    for(; i < count; ++i){
+        sum_level += current_levels[i];
+        sum_capacity += maximum_levels[i];
+        float fill = _fill(current_levels[i], maximum_levels[i]);
+        float bucket = fill * FLEET_HISTOGRAM_SIZE;
+        if (bucket < 0.0f) bucket = 0.0f;
+        if (bucket > FLEET_HISTOGRAM_SIZE - 1) bucket = FLEET_HISTOGRAM_SIZE - 1;
+        buckets[i] = (int)bucket;
+        if (fill < min_value) min_value = fill;
+        if (fill > max_value) max_value = fill;
+    }
+    *total_level += sum_level;
+    *total_capacity += sum_capacity;
+    *min_fill = min_value;
+    *max_fill = max_value;
+}
+
+static size_t _find_fill(const unsigned int* current_levels, const unsigned int* maximum_levels, size_t count, float fill){
+    for(size_t i = 0; i < count; ++i){
+        if (_fill(current_levels[i], maximum_levels[i]) == fill) return i;
+    }
+    return 0;
+}
+
+static float _fill(unsigned int current_level, unsigned int maximum_level){
+    return (float)(int)current_level / (float)(int)(maximum_level == 0 ? 1 : maximum_level);
+}
@@ -0,0 +1,78 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_FLEET_SUMMARY_H
+#define OIL_STORAGE_MANAGE_SYSTEM_FLEET_SUMMARY_H
+
+#include <stddef.h>
+
+/**
+ * количество интервалов гистограммы заполненности (по 1%)
+ */
+#define FLEET_HISTOGRAM_SIZE 100
+
+/**
+ * сводные показатели по всем резервуарам нефтехранилища
+ */
+typedef struct _fleet_summary{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * суммарный объем нефтепродуктов
+     */
+    unsigned long long total_level;
+    /**
+     * суммарная вместимость (сумма максимальных уровней)
+     */
+    unsigned long long total_capacity;
+    /**
+     * свободная вместимость
+     */
+    unsigned long long free_capacity;
+    /**
+     * суммарный объем нефтепродуктов по градуировочным таблицам (0 - объемы не рассчитывались)
+     */
+    double total_volume;
+    /**
+     * суммарный объем нефтепродуктов, приведенный к 15 °C (в том же снимке, что и уровни)
+     */
+    double total_standard_volume;
+    /**
+     * номер самого заполненного резервуара
+     */
+    size_t fullest_tank;
+    /**
+     * заполненность самого заполненного резервуара (доля максимального уровня)
+     */
+    float fullest_fill;
+    /**
+     * номер самого пустого резервуара
+     */
+    size_t emptiest_tank;
+    /**
+     * заполненность самого пустого резервуара (доля максимального уровня)
+     */
+    float emptiest_fill;
+    /**
+     * гистограмма заполненности: количество резервуаров в каждом интервале в 1%
+     */
+    size_t histogram[FLEET_HISTOGRAM_SIZE];
+} fleet_summary;
+
+/**
+ * вычислить сводные показатели по массивам уровней
+ * @param current_levels уровни нефтепродуктов
+ * @param maximum_levels максимальные уровни
+ * @param count количество резервуаров
+ * @param fs сводные показатели
+ */
+void compute_fleet_summary(const unsigned int* current_levels, const unsigned int* maximum_levels, size_t count, fleet_summary* fs);
+
+/**
+ * получить перцентиль заполненности по гистограмме
+ * @param fs сводные показатели
+ * @param percent перцентиль (0 - 100)
+ * @return заполненность в процентах
+ */
+unsigned int get_fill_percentile_fleet_summary(const fleet_summary* fs, unsigned int percent);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_FLEET_SUMMARY_H
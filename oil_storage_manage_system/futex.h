@@ -0,0 +1,42 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_FUTEX_H
+#define OIL_STORAGE_MANAGE_SYSTEM_FUTEX_H
+
+/**
+ * ожидание на futex для кольцевых буферов и флагов в памяти процесса и в разделяемой памяти
+ * (внутренний заголовок библиотеки: обертки над системным вызовом futex)
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define FUTEX_SHARED    0   //futex в разделяемой между процессами памяти
+#define FUTEX_LOCAL     1   //futex в памяти одного процесса (ждут только его потоки)
+#define FUTEX_WAKE_ALL  INT32_MAX   //разбудить всех ожидающих
+
+/**
+ * заснуть на futex, пока значение по адресу равно ожидаемому
+ * @param address адрес
+ * @param expected ожидаемое значение
+ * @param timeout максимальное время ожидания в мс (-1 - без ограничения)
+ * @param scope FUTEX_SHARED, FUTEX_LOCAL
+ */
+static inline void wait_futex(uint32_t* address, uint32_t expected, int timeout, int scope){
+    struct timespec ts = {timeout / 1000, (long)(timeout % 1000) * 1000000};
+    syscall(SYS_futex, address, scope == FUTEX_LOCAL ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, expected,
+            timeout < 0 ? NULL : &ts, NULL, 0);
+}
+
+/**
+ * разбудить процессы и потоки, спящие на futex
+ * @param address адрес
+ * @param count наибольшее количество разбуженных (FUTEX_WAKE_ALL - все)
+ * @param scope FUTEX_SHARED, FUTEX_LOCAL
+ */
+static inline void wake_futex(uint32_t* address, int count, int scope){
+    syscall(SYS_futex, address, scope == FUTEX_LOCAL ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_FUTEX_H
@@ -0,0 +1,339 @@
+#include "inbound_dispatcher.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * резервуар, упорядочиваемый по времени заполнения
+ */
+typedef struct _dispatch_order{
+    /**
+     * время заполнения в тактах
+     */
+    unsigned long long ticks;
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+} dispatch_order;
+
+/**
+ * диспетчер приема
+ */
+struct _inbound_dispatcher{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * первый резервуар диапазона
+     */
+    unsigned int first;
+    /**
+     * последний резервуар диапазона
+     */
+    unsigned int last;
+    /**
+     * заданная скорость поступления за такт
+     */
+    unsigned int rate;
+    /**
+     * номера резервуаров, принимающих нефть
+     */
+    unsigned int* assigned;
+    /**
+     * количество резервуаров, принимающих нефть
+     */
+    size_t assigned_count;
+    /**
+     * признаки приема нефти резервуарами
+     */
+    unsigned char* is_assigned;
+    /**
+     * полные скорости насосов принимающих резервуаров
+     */
+    unsigned int* nominal_speeds;
+    /**
+     * расчеты, в которые резервуары начали прием
+     */
+    unsigned long long* start_plans;
+    /**
+     * количество расчетов
+     */
+    unsigned long long plans;
+    /**
+     * выравнивающий резервуар, скорость насоса которого уменьшена (-1 - нет)
+     */
+    long trim_tank;
+    /**
+     * уменьшенная скорость насоса выравнивающего резервуара
+     */
+    unsigned int trim_speed;
+    /**
+     * куча резервуаров, которые могут начать прием, с наибольшим временем заполнения в корне
+     */
+    dispatch_order* candidates;
+    /**
+     * принимающие резервуары, упорядоченные по времени заполнения
+     */
+    dispatch_order* order;
+    /**
+     * состояние распределения
+     */
+    dispatch_stats stats;
+};
+
+/**
+ * время заполнения резервуара до максимального уровня
+ * @param level уровень
+ * @param maximum_level максимальный уровень
+ * @param speed скорость насоса налива
+ * @return время в тактах
+ */
+static unsigned long long _remaining_ticks(unsigned int level, unsigned int maximum_level, unsigned int speed);
+
+/**
+ * прекратить прием резервуаром
+ * @param id указатель на диспетчер
+ * @param number номер резервуара
+ * @param stop 1 - выключить насос, 0 - насос уже выключен
+ * @param actions массив команд
+ * @param count количество команд
+ */
+static void _release(inbound_dispatcher* id, unsigned int number, int stop, dispatch_action* actions, size_t* count);
+
+/**
+ * собрать кучу резервуаров диапазона, которые могут начать прием
+ * @param id указатель на диспетчер
+ * @param current_levels уровни нефтепродуктов резервуаров
+ * @param maximum_levels максимальные уровни резервуаров
+ * @param download_states состояния насосов налива
+ * @param download_speeds скорости насосов налива
+ * @return количество резервуаров в куче
+ */
+static size_t _collect_candidates(inbound_dispatcher* id, const unsigned int* current_levels, const unsigned int* maximum_levels,
+                                  const int* download_states, const unsigned int* download_speeds);
+
+/**
+ * опустить элемент кучи резервуаров к листьям, пока его время заполнения меньше, чем у детей
+ * @param heap куча
+ * @param size размер кучи
+ * @param position позиция элемента
+ */
+static void _sift_down(dispatch_order* heap, size_t size, size_t position);
+
+/**
+ * сравнить резервуары по времени заполнения
+ * @param a резервуар
+ * @param b резервуар
+ * @return отрицательное - a заполнится раньше, положительное - позже
+ */
+static int _compare_order(const void* a, const void* b);
+
+inbound_dispatcher* create_inbound_dispatcher(size_t tanks_count){
+    inbound_dispatcher* id = calloc(1, sizeof(inbound_dispatcher));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    id->tanks_count = tanks_count;
+    id->assigned = malloc(sizeof(unsigned int) * count);
+    id->is_assigned = calloc(count, sizeof(unsigned char));
+    id->nominal_speeds = calloc(count, sizeof(unsigned int));
+    id->start_plans = calloc(count, sizeof(unsigned long long));
+    id->trim_tank = -1;
+    id->candidates = malloc(sizeof(dispatch_order) * count);
+    id->order = malloc(sizeof(dispatch_order) * count);
+    return id;
+}
+
+int set_inbound_dispatcher(inbound_dispatcher* id, unsigned int first, unsigned int last, unsigned int rate){
+    if (first > last || last >= id->tanks_count) return -1;
+    id->first = first;
+    id->last = last;
+    id->rate = rate;
+    return 0;
+}
+
+size_t plan_inbound_dispatcher(inbound_dispatcher* id, const unsigned int* current_levels, const unsigned int* maximum_levels,
+                               const int* download_states, const unsigned int* download_speeds, dispatch_action* actions){
+    if (id->rate == 0 && id->assigned_count == 0) return 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t count = 0, kept = 0;
+    unsigned long long assigned_rate = 0;
+    id->plans++;
+    //резервуары, насосы которых выключились или которые подошли к максимальному уровню, передают прием
+    //(команды насосам выполняются потоками выполнения команд после расчета, поэтому только что включенный
+    //насос может еще числиться выключенным)
+    for(size_t i = 0; i < id->assigned_count; ++i){
+        unsigned int number = id->assigned[i];
+        unsigned int speed = id->nominal_speeds[number];
+        unsigned long long ticks = _remaining_ticks(current_levels[number], maximum_levels[number], speed);
+        if (download_states[number] == PUMP_OFF && id->plans > id->start_plans[number] + DISPATCH_CONFIRM_TICKS){
+            _release(id, number, 0, actions, &count);
+        } else if (id->rate == 0 || number < id->first || number > id->last || speed == 0 || ticks <= DISPATCH_HANDOVER_TICKS){
+            _release(id, number, 1, actions, &count);
+        } else {
+            id->assigned[kept] = number;
+            id->order[kept].ticks = ticks;
+            id->order[kept].number = number;
+            kept++;
+            assigned_rate += speed;
+        }
+    }
+    id->assigned_count = kept;
+    //недостающая скорость добирается резервуарами, которые дольше всех будут заполняться
+    long last_started = -1;
+    size_t last_start_action = 0;
+    if (assigned_rate < id->rate){
+        size_t candidates_count = _collect_candidates(id, current_levels, maximum_levels, download_states, download_speeds);
+        while (assigned_rate < id->rate && candidates_count > 0){
+            dispatch_order best = id->candidates[0];
+            id->candidates[0] = id->candidates[--candidates_count];
+            _sift_down(id->candidates, candidates_count, 0);
+            unsigned int number = best.number;
+            id->is_assigned[number] = 1;
+            id->nominal_speeds[number] = download_speeds[number];
+            id->start_plans[number] = id->plans;
+            id->order[id->assigned_count] = best;
+            id->assigned[id->assigned_count++] = number;
+            assigned_rate += download_speeds[number];
+            last_started = number;
+            last_start_action = count;
+            actions[count++] = (dispatch_action){DISPATCH_ACTION_START, number, 0};
+            id->stats.starts++;
+        }
+    } else if (assigned_rate > id->rate && (id->trim_tank == -1 || id->nominal_speeds[id->trim_tank] <= assigned_rate - id->rate)){
+        //излишек, который не снять выравнивающим насосом, снимается выключением резервуаров, которые заполнятся раньше других
+        unsigned long long excess = assigned_rate - id->rate;
+        qsort(id->order, id->assigned_count, sizeof(dispatch_order), _compare_order);
+        kept = 0;
+        for(size_t i = 0; i < id->assigned_count; ++i){
+            unsigned int number = id->order[i].number;
+            if (id->nominal_speeds[number] <= excess){
+                excess -= id->nominal_speeds[number];
+                assigned_rate -= id->nominal_speeds[number];
+                _release(id, number, 1, actions, &count);
+            } else {
+                id->order[kept++] = id->order[i];
+            }
+        }
+        id->assigned_count = kept;
+        for(size_t i = 0; i < kept; ++i){
+            id->assigned[i] = id->order[i].number;
+        }
+    }
+    //излишек снимается уменьшением скорости одного насоса
+    unsigned long long excess = assigned_rate > id->rate ? assigned_rate - id->rate : 0;
+    long trim_tank = -1;
+    if (excess > 0){
+        if (id->trim_tank != -1 && id->nominal_speeds[id->trim_tank] > excess){
+            trim_tank = id->trim_tank;
+        } else if (last_started != -1){
+            trim_tank = last_started;
+        } else {
+            unsigned long long longest = 0;
+            for(size_t i = 0; i < id->assigned_count; ++i){
+                if (id->nominal_speeds[id->order[i].number] > excess && (trim_tank == -1 || id->order[i].ticks > longest)){
+                    trim_tank = id->order[i].number;
+                    longest = id->order[i].ticks;
+                }
+            }
+        }
+    }
+    if (id->trim_tank != -1 && id->trim_tank != trim_tank){
+        actions[count++] = (dispatch_action){DISPATCH_ACTION_SET_SPEED, (unsigned int)id->trim_tank, id->nominal_speeds[id->trim_tank]};
+    }
+    if (trim_tank != -1){
+        unsigned int speed = id->nominal_speeds[trim_tank] - (unsigned int)excess;
+        if (trim_tank != id->trim_tank || speed != id->trim_speed){
+            actions[count++] = (dispatch_action){DISPATCH_ACTION_SET_SPEED, (unsigned int)trim_tank, speed};
+            if (trim_tank == last_started){
+                //скорость задается до включения насоса, чтобы прием не превысил задание даже на такт
+                dispatch_action swap = actions[last_start_action];
+                actions[last_start_action] = actions[count - 1];
+                actions[count - 1] = swap;
+            }
+        }
+        id->trim_speed = speed;
+        assigned_rate -= excess;
+    }
+    id->trim_tank = trim_tank;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    id->stats.first = id->first;
+    id->stats.last = id->last;
+    id->stats.rate = id->rate;
+    id->stats.assigned_rate = assigned_rate;
+    id->stats.active_tanks = id->assigned_count;
+    id->stats.plan_time = (unsigned long long)(end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+    if (id->stats.plan_time > id->stats.max_plan_time) id->stats.max_plan_time = id->stats.plan_time;
+    return count;
+}
+
+void get_stats_inbound_dispatcher(const inbound_dispatcher* id, dispatch_stats* stats){
+    *stats = id->stats;
+    stats->first = id->first;
+    stats->last = id->last;
+    stats->rate = id->rate;
+}
+
+void finalize_inbound_dispatcher(inbound_dispatcher* id){
+    free(id->assigned);
+    free(id->is_assigned);
+    free(id->nominal_speeds);
+    free(id->start_plans);
+    free(id->candidates);
+    free(id->order);
+    free(id);
+}
+
+static unsigned long long _remaining_ticks(unsigned int level, unsigned int maximum_level, unsigned int speed){
+    if (level >= maximum_level) return 0;
+    if (speed == 0) return (unsigned long long)-1;
+    return (maximum_level - level) / speed;
+}
+
+static void _release(inbound_dispatcher* id, unsigned int number, int stop, dispatch_action* actions, size_t* count){
+    if (stop) actions[(*count)++] = (dispatch_action){DISPATCH_ACTION_STOP, number, 0};
+    if (number == id->trim_tank){
+        actions[(*count)++] = (dispatch_action){DISPATCH_ACTION_SET_SPEED, number, id->nominal_speeds[number]};
+        id->trim_tank = -1;
+    }
+    id->is_assigned[number] = 0;
+    id->stats.stops++;
+}
+
+static size_t _collect_candidates(inbound_dispatcher* id, const unsigned int* current_levels, const unsigned int* maximum_levels,
+                                  const int* download_states, const unsigned int* download_speeds){
+    size_t size = 0;
+    for(unsigned int i = id->first; i <= id->last; ++i){
+        if (id->is_assigned[i] || download_states[i] != PUMP_OFF || download_speeds[i] == 0) continue;
+        unsigned long long ticks = _remaining_ticks(current_levels[i], maximum_levels[i], download_speeds[i]);
+        if (ticks <= DISPATCH_HANDOVER_TICKS) continue;
+        id->candidates[size].ticks = ticks;
+        id->candidates[size].number = i;
+        size++;
+    }
+    for(size_t i = size / 2; i-- > 0; ){
+        _sift_down(id->candidates, size, i);
+    }
+    return size;
+}
+
+static void _sift_down(dispatch_order* heap, size_t size, size_t position){
+    dispatch_order element = heap[position];
+    for(;;){
+        size_t child = 2 * position + 1;
+        if (child >= size) break;
+        if (child + 1 < size && heap[child + 1].ticks > heap[child].ticks) child++;
+        if (element.ticks >= heap[child].ticks) break;
+        heap[position] = heap[child];
+        position = child;
+    }
+    heap[position] = element;
+}
+
+static int _compare_order(const void* a, const void* b){
+    const dispatch_order* first = a;
+    const dispatch_order* second = b;
+    if (first->ticks != second->ticks) return first->ticks < second->ticks ? -1 : 1;
+    return first->number < second->number ? -1 : first->number > second->number;
+}
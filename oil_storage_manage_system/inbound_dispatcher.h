@@ -0,0 +1,128 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_INBOUND_DISPATCHER_H
+#define OIL_STORAGE_MANAGE_SYSTEM_INBOUND_DISPATCHER_H
+
+#include <stddef.h>
+
+/**
+ * распределение приема нефти по резервуарам: суммарная скорость поступления раскладывается
+ * по насосам налива резервуаров диапазона
+ *
+ * включенные диспетчером насосы работают, пока резервуар не приблизится к максимальному уровню,
+ * недостающая скорость добирается резервуарами с наибольшим временем заполнения (почти полные резервуары
+ * принимают нефть, только если других нет), излишек снимается
+ * уменьшением скорости одного (выравнивающего) насоса, поэтому насосы включаются и выключаются
+ * только при заполнении резервуаров и изменении задания
+ */
+struct _inbound_dispatcher;
+typedef struct _inbound_dispatcher inbound_dispatcher;
+
+#define DISPATCH_ACTION_START       1   //включить насос налива
+#define DISPATCH_ACTION_STOP        2   //выключить насос налива
+#define DISPATCH_ACTION_SET_SPEED   3   //установить скорость насоса налива
+#define DISPATCH_HANDOVER_TICKS     2   //запас до максимального уровня в тактах, при котором резервуар передает прием другому
+#define DISPATCH_CONFIRM_TICKS      10  //время в тактах, за которое процесс резервуара должен включить насос
+
+/**
+ * команда насосу налива, рассчитанная диспетчером
+ */
+typedef struct _dispatch_action{
+    /**
+     * команда (DISPATCH_ACTION_START, DISPATCH_ACTION_STOP, DISPATCH_ACTION_SET_SPEED)
+     */
+    int action;
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+    /**
+     * скорость насоса (для DISPATCH_ACTION_SET_SPEED)
+     */
+    unsigned int speed;
+} dispatch_action;
+
+/**
+ * состояние распределения приема
+ */
+typedef struct _dispatch_stats{
+    /**
+     * первый резервуар диапазона
+     */
+    unsigned int first;
+    /**
+     * последний резервуар диапазона
+     */
+    unsigned int last;
+    /**
+     * заданная скорость поступления за такт (0 - прием не идет)
+     */
+    unsigned int rate;
+    /**
+     * скорость, распределенная по насосам
+     */
+    unsigned long long assigned_rate;
+    /**
+     * количество резервуаров, принимающих нефть
+     */
+    size_t active_tanks;
+    /**
+     * количество включений насосов диспетчером
+     */
+    unsigned long long starts;
+    /**
+     * количество выключений насосов (диспетчером и при достижении максимального уровня)
+     */
+    unsigned long long stops;
+    /**
+     * время последнего расчета в мкс
+     */
+    unsigned long long plan_time;
+    /**
+     * наибольшее время расчета в мкс
+     */
+    unsigned long long max_plan_time;
+} dispatch_stats;
+
+/**
+ * создать диспетчер приема (прием не идет)
+ * @param tanks_count количество резервуаров
+ * @return указатель на диспетчер
+ */
+inbound_dispatcher* create_inbound_dispatcher(size_t tanks_count);
+
+/**
+ * задать прием (вступает в силу при следующем расчете)
+ * @param id указатель на диспетчер
+ * @param first первый резервуар диапазона
+ * @param last последний резервуар диапазона
+ * @param rate скорость поступления за такт (0 - остановить прием и выключить насосы диспетчера)
+ * @return 0 - прием задан, -1 - неверный диапазон
+ */
+int set_inbound_dispatcher(inbound_dispatcher* id, unsigned int first, unsigned int last, unsigned int rate);
+
+/**
+ * рассчитать команды насосам на такт
+ * @param id указатель на диспетчер
+ * @param current_levels уровни нефтепродуктов резервуаров
+ * @param maximum_levels максимальные уровни резервуаров
+ * @param download_states состояния насосов налива
+ * @param download_speeds скорости насосов налива
+ * @param actions массив для команд (не меньше двух на резервуар)
+ * @return количество команд
+ */
+size_t plan_inbound_dispatcher(inbound_dispatcher* id, const unsigned int* current_levels, const unsigned int* maximum_levels,
+                               const int* download_states, const unsigned int* download_speeds, dispatch_action* actions);
+
+/**
+ * получить состояние распределения приема
+ * @param id указатель на диспетчер
+ * @param stats структура для состояния
+ */
+void get_stats_inbound_dispatcher(const inbound_dispatcher* id, dispatch_stats* stats);
+
+/**
+ * уничтожить диспетчер
+ * @param id указатель на диспетчер
+ */
+void finalize_inbound_dispatcher(inbound_dispatcher* id);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_INBOUND_DISPATCHER_H
@@ -0,0 +1,424 @@
+#include "level_history.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+/**
+ * размер области сжатых данных одного блока в байтах
+ */
+#define HISTORY_BLOCK_DATA_SIZE 4040
+/**
+ * максимальная длина одного varint в байтах
+ */
+#define MAX_VARINT_SIZE 10
+
+/**
+ * виды записей в сжатых данных блока (младшие два бита varint)
+ */
+#define RECORD_SAMPLE   0           //отсчет, аргумент - разность разностей уровня (zigzag)
+#define RECORD_RUN      1           //серия отсчетов с нулевой разностью разностей, аргумент - длина серии
+#define RECORD_STATE    2           //смена флагов состояния, аргумент - новые флаги
+#define RECORD_GAP      3           //пропуск тактов перед следующим отсчетом, аргумент - число тактов
+
+/**
+ * блок истории: первый отсчет хранится в заголовке, остальные - в сжатых данных
+ */
+typedef struct _history_block{
+    /**
+     * такт первого отсчета блока
+     */
+    unsigned long long first_tick;
+    /**
+     * такт последнего отсчета блока
+     */
+    unsigned long long last_tick;
+    /**
+     * уровень в первом отсчете блока
+     */
+    unsigned int first_level;
+    /**
+     * уровень в последнем отсчете блока
+     */
+    unsigned int last_level;
+    /**
+     * флаги состояния в первом отсчете блока
+     */
+    int first_state;
+    /**
+     * флаги состояния в последнем отсчете блока
+     */
+    int last_state;
+    /**
+     * разность уровней двух последних отсчетов блока
+     */
+    long long last_delta;
+    /**
+     * длина серии с нулевой разностью разностей, еще не записанной в данные
+     */
+    unsigned long long pending_run;
+    /**
+     * количество занятых байт сжатых данных
+     */
+    size_t used;
+    /**
+     * сжатые данные
+     */
+    unsigned char data[HISTORY_BLOCK_DATA_SIZE];
+} history_block;
+
+/**
+ * история уровня нефтепродуктов в резервуаре
+ */
+struct _level_history{
+    /**
+     * кольцо блоков (упорядочено по времени начиная с first_block)
+     */
+    history_block** blocks;
+    /**
+     * максимальное количество блоков
+     */
+    size_t max_blocks;
+    /**
+     * индекс самого старого блока
+     */
+    size_t first_block;
+    /**
+     * количество блоков в кольце
+     */
+    size_t blocks_count;
+    /**
+     * мьютекс для доступа к истории из разных потоков
+     */
+    pthread_mutex_t mutex;
+};
+
+/**
+ * состояние последовательного чтения отсчетов истории
+ */
+typedef struct _history_reader{
+    /**
+     * история
+     */
+    const level_history* lh;
+    /**
+     * порядковый номер читаемого блока (от самого старого)
+     */
+    size_t block;
+    /**
+     * позиция в сжатых данных блока
+     */
+    size_t position;
+    /**
+     * оставшаяся длина текущей серии
+     */
+    unsigned long long run_left;
+    /**
+     * первый отсчет блока (из заголовка) еще не прочитан
+     */
+    int header_pending;
+    /**
+     * незаписанная серия блока уже прочитана
+     */
+    int pending_used;
+    /**
+     * такт текущего отсчета
+     */
+    unsigned long long tick;
+    /**
+     * уровень текущего отсчета
+     */
+    long long level;
+    /**
+     * разность уровней двух последних отсчетов
+     */
+    long long delta;
+    /**
+     * флаги состояния текущего отсчета
+     */
+    int state;
+} history_reader;
+
+/**
+ * получить блок по порядковому номеру (от самого старого)
+ * @param lh указатель на историю
+ * @param index порядковый номер блока
+ * @return указатель на блок
+ */
+static history_block* _get_block(const level_history* lh, size_t index);
+
+/**
+ * начать новый блок с указанного отсчета (при заполнении кольца вытесняется самый старый блок)
+ * @param lh указатель на историю
+ * @param tick такт отсчета
+ * @param level уровень
+ * @param state флаги состояния
+ */
+static void _start_block(level_history* lh, unsigned long long tick, unsigned int level, int state);
+
+/**
+ * добавить отсчет в историю (вызывается под мьютексом истории)
+ * @param lh указатель на историю
+ * @param tick номер такта
+ * @param level уровень нефтепродуктов
+ * @param state флаги состояния
+ */
+static void _add_sample(level_history* lh, unsigned long long tick, unsigned int level, int state);
+
+/**
+ * дописать запись в сжатые данные блока
+ * @param b указатель на блок
+ * @param kind вид записи
+ * @param argument аргумент записи
+ */
+static void _put_record(history_block* b, int kind, unsigned long long argument);
+
+/**
+ * начать чтение истории с указанного блока
+ * @param r состояние чтения
+ * @param lh указатель на историю
+ * @param block порядковый номер блока
+ */
+static void _start_reader(history_reader* r, const level_history* lh, size_t block);
+
+/**
+ * прочитать следующий отсчет
+ * @param r состояние чтения
+ * @param point отсчет
+ * @return 1 - отсчет прочитан, 0 - отсчеты закончились
+ */
+static int _read_sample(history_reader* r, history_point* point);
+
+level_history* create_level_history(size_t buffer_size){
+    level_history* lh = malloc(sizeof(level_history));
+    if (lh == NULL) return NULL;
+    lh->max_blocks = buffer_size / sizeof(history_block);
+    if (lh->max_blocks < 2) lh->max_blocks = 2;
+    lh->blocks = calloc(lh->max_blocks, sizeof(history_block*));
+    lh->first_block = 0;
+    lh->blocks_count = 0;
+    pthread_mutex_init(&lh->mutex, NULL);
+    return lh;
+}
+
+void add_sample_level_history(level_history* lh, unsigned long long tick, unsigned int level, int state){
+    pthread_mutex_lock(&lh->mutex);
+    _add_sample(lh, tick, level, state);
+    pthread_mutex_unlock(&lh->mutex);
+}
+
+void add_run_level_history(level_history* lh, unsigned long long tick, long long delta){
+    pthread_mutex_lock(&lh->mutex);
+    //отсчеты пишутся по одному, пока разность последнего отсчета блока не станет равной delta
+    //(не больше двух: второй нужен, если первый начал новый блок), остаток серии - счетчиком
+    for(int samples = 0; samples <= 2 && delta != 0 && lh->blocks_count > 0; ++samples){
+        history_block* b = _get_block(lh, lh->blocks_count - 1);
+        if (tick <= b->last_tick) break;
+        if (b->last_delta == delta){
+            unsigned long long count = tick - b->last_tick;
+            b->pending_run += count;
+            b->last_level = (unsigned int)((long long)b->last_level + delta * (long long)count);
+            b->last_tick = tick;
+            break;
+        }
+        long long level = (long long)b->last_level + delta;
+        _add_sample(lh, b->last_tick + 1, level < 0 ? 0 : (unsigned int)level, b->last_state);
+    }
+    pthread_mutex_unlock(&lh->mutex);
+}
+
+size_t query_level_history(level_history* lh, unsigned long long from_tick, unsigned long long to_tick, unsigned long long step, history_point* points, size_t max_count){
+    size_t count = 0;
+    if (step == 0) step = 1;
+    pthread_mutex_lock(&lh->mutex);
+    if (lh->blocks_count == 0 || from_tick > to_tick){
+        pthread_mutex_unlock(&lh->mutex);
+        return 0;
+    }
+    size_t left = 0, right = lh->blocks_count;
+    while (right - left > 1){
+        size_t mid = (left + right) / 2;
+        if (_get_block(lh, mid)->first_tick <= from_tick) left = mid;
+        else right = mid;
+    }
+    history_reader r;
+    _start_reader(&r, lh, left);
+    history_point current = {0, 0, 0}, next;
+    int has_current = 0;
+    int has_next = _read_sample(&r, &next);
+    unsigned long long tick = from_tick;
+    while (count < max_count && tick <= to_tick){
+        while (has_next && next.tick <= tick){
+            current = next;
+            has_current = 1;
+            has_next = _read_sample(&r, &next);
+        }
+        if (has_current){
+            points[count].tick = tick;
+            points[count].level = current.level;
+            points[count].state = current.state;
+            count++;
+        } else if (has_next){
+            tick += (next.tick - tick + step - 1) / step * step;
+            continue;
+        } else {
+            break;
+        }
+        if (to_tick - tick < step) break;
+        tick += step;
+    }
+    pthread_mutex_unlock(&lh->mutex);
+    return count;
+}
+
+size_t get_memory_size_level_history(level_history* lh){
+    pthread_mutex_lock(&lh->mutex);
+    size_t size = sizeof(level_history) + lh->max_blocks * sizeof(history_block*) + lh->blocks_count * sizeof(history_block);
+    pthread_mutex_unlock(&lh->mutex);
+    return size;
+}
+
+void finalize_level_history(level_history* lh){
+    for(size_t i = 0; i < lh->max_blocks; ++i){
+        free(lh->blocks[i]);
+    }
+    free(lh->blocks);
+    pthread_mutex_destroy(&lh->mutex);
+    free(lh);
+}
+
+static void _add_sample(level_history* lh, unsigned long long tick, unsigned int level, int state){
+    if (lh->blocks_count == 0){
+        _start_block(lh, tick, level, state);
+        return;
+    }
+    history_block* b = _get_block(lh, lh->blocks_count - 1);
+    if (tick <= b->last_tick){
+        return;
+    }
+    unsigned long long gap = tick - b->last_tick - 1;
+    long long delta = (long long)level - (long long)b->last_level;
+    long long delta_of_delta = delta - b->last_delta;
+    if (gap == 0 && state == b->last_state && delta_of_delta == 0){
+        b->pending_run++;
+        b->last_tick = tick;
+        b->last_level = level;
+        return;
+    }
+    if (b->used + 4 * MAX_VARINT_SIZE > HISTORY_BLOCK_DATA_SIZE){
+        _start_block(lh, tick, level, state);
+        return;
+    }
+    if (b->pending_run > 0){
+        _put_record(b, RECORD_RUN, b->pending_run);
+        b->pending_run = 0;
+    }
+    if (state != b->last_state){
+        _put_record(b, RECORD_STATE, (unsigned long long)state);
+    }
+    if (gap > 0){
+        _put_record(b, RECORD_GAP, gap);
+    }
+    _put_record(b, RECORD_SAMPLE, ((unsigned long long)delta_of_delta << 1) ^ (unsigned long long)(delta_of_delta >> 63));
+    b->last_delta = delta;
+    b->last_tick = tick;
+    b->last_level = level;
+    b->last_state = state;
+}
+
+static history_block* _get_block(const level_history* lh, size_t index){
+    return lh->blocks[(lh->first_block + index) % lh->max_blocks];
+}
+
+static void _start_block(level_history* lh, unsigned long long tick, unsigned int level, int state){
+    size_t index;
+    if (lh->blocks_count < lh->max_blocks){
+        index = (lh->first_block + lh->blocks_count) % lh->max_blocks;
+        if (lh->blocks[index] == NULL){
+            lh->blocks[index] = malloc(sizeof(history_block));
+            if (lh->blocks[index] == NULL) return;
+        }
+        lh->blocks_count++;
+    } else {
+        index = lh->first_block;
+        lh->first_block = (lh->first_block + 1) % lh->max_blocks;
+    }
+    history_block* b = lh->blocks[index];
+    b->first_tick = b->last_tick = tick;
+    b->first_level = b->last_level = level;
+    b->first_state = b->last_state = state;
+    b->last_delta = 0;
+    b->pending_run = 0;
+    b->used = 0;
+}
+
+static void _put_record(history_block* b, int kind, unsigned long long argument){
+    unsigned long long value = (argument << 2) | (unsigned long long)kind;
+    while (value >= 0x80){
+        b->data[b->used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    b->data[b->used++] = (unsigned char)value;
+}
+
+static void _start_reader(history_reader* r, const level_history* lh, size_t block){
+    const history_block* b = _get_block(lh, block);
+    r->lh = lh;
+    r->block = block;
+    r->position = 0;
+    r->run_left = 0;
+    r->header_pending = 1;
+    r->pending_used = 0;
+    r->tick = b->first_tick;
+    r->level = b->first_level;
+    r->delta = 0;
+    r->state = b->first_state;
+}
+
+static int _read_sample(history_reader* r, history_point* point){
+    for(;;){
+        const history_block* b = _get_block(r->lh, r->block);
+        if (r->header_pending){
+            r->header_pending = 0;
+            break;
+        }
+        if (r->run_left > 0){
+            r->run_left--;
+            r->tick++;
+            r->level += r->delta;
+            break;
+        }
+        if (r->position < b->used){
+            unsigned long long value = 0;
+            int shift = 0;
+            unsigned char byte;
+            do {
+                byte = b->data[r->position++];
+                value |= (unsigned long long)(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            unsigned long long argument = value >> 2;
+            int kind = (int)(value & 3);
+            if (kind == RECORD_SAMPLE){
+                long long delta_of_delta = (long long)(argument >> 1) ^ -(long long)(argument & 1);
+                r->delta += delta_of_delta;
+                r->tick++;
+                r->level += r->delta;
+                break;
+            }
+            if (kind == RECORD_RUN) r->run_left = argument;
+            if (kind == RECORD_STATE) r->state = (int)argument;
+            if (kind == RECORD_GAP) r->tick += argument;
+            continue;
+        }
+        if (!r->pending_used){
+            r->pending_used = 1;
+            r->run_left = b->pending_run;
+            continue;
+        }
+        if (r->block + 1 >= r->lh->blocks_count) return 0;
+        _start_reader(r, r->lh, r->block + 1);
+    }
+    point->tick = r->tick;
+    point->level = (unsigned int)r->level;
+    point->state = r->state;
+    return 1;
+}
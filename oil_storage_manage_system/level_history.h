@@ -0,0 +1,89 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_LEVEL_HISTORY_H
+#define OIL_STORAGE_MANAGE_SYSTEM_LEVEL_HISTORY_H
+
+#include <stddef.h>
+
+/**
+ * история уровня нефтепродуктов в резервуаре
+ * (сжатое кольцо блоков: разность разностей уровня и длины серий в varint)
+ */
+struct _level_history;
+typedef struct _level_history level_history;
+
+/**
+ * флаги состояния резервуара, сохраняемые вместе с уровнем
+ */
+#define HISTORY_TANK_ON         1   //резервуар в рабочем состоянии
+#define HISTORY_DOWNLOAD_PUMP   2   //насос закачки включен
+#define HISTORY_UPLOAD_PUMP     4   //насос откачки включен
+
+/**
+ * точка истории уровня
+ */
+typedef struct _history_point{
+    /**
+     * номер такта (время в единицах TIME_UNIT)
+     */
+    unsigned long long tick;
+    /**
+     * уровень нефтепродуктов
+     */
+    unsigned int level;
+    /**
+     * флаги состояния (HISTORY_TANK_ON, HISTORY_DOWNLOAD_PUMP, HISTORY_UPLOAD_PUMP)
+     */
+    int state;
+} history_point;
+
+/**
+ * создать историю уровня
+ * @param buffer_size максимальный объем памяти под сжатые данные в байтах
+ * @return указатель на историю
+ */
+level_history* create_level_history(size_t buffer_size);
+
+/**
+ * добавить отсчет в историю (такты должны возрастать)
+ * @param lh указатель на историю
+ * @param tick номер такта
+ * @param level уровень нефтепродуктов
+ * @param state флаги состояния
+ */
+void add_sample_level_history(level_history* lh, unsigned long long tick, unsigned int level, int state);
+
+/**
+ * продолжить историю до такта отсчетами, уровень которых меняется на одну и ту же величину за такт
+ * (флаги состояния не меняются; серия хранится счетчиком, поэтому ее длина не влияет на объем памяти)
+ * @param lh указатель на историю
+ * @param tick такт последнего отсчета серии (если история уже дошла до него, ничего не добавляется)
+ * @param delta изменение уровня за такт (0 - уровень держится и без отсчетов)
+ */
+void add_run_level_history(level_history* lh, unsigned long long tick, long long delta);
+
+/**
+ * выбрать точки истории на отрезке времени с заданным шагом
+ * (в каждую точку попадает последний отсчет, не позже ее такта)
+ * @param lh указатель на историю
+ * @param from_tick начальный такт
+ * @param to_tick конечный такт
+ * @param step шаг в тактах
+ * @param points массив для точек
+ * @param max_count размер массива точек
+ * @return количество записанных точек
+ */
+size_t query_level_history(level_history* lh, unsigned long long from_tick, unsigned long long to_tick, unsigned long long step, history_point* points, size_t max_count);
+
+/**
+ * получить объем памяти, занятый историей
+ * @param lh указатель на историю
+ * @return объем памяти в байтах
+ */
+size_t get_memory_size_level_history(level_history* lh);
+
+/**
+ * уничтожить историю
+ * @param lh указатель на историю
+ */
+void finalize_level_history(level_history* lh);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_LEVEL_HISTORY_H
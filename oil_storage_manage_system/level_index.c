@@ -0,0 +1,469 @@
+#include "level_index.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+
+#define LEVEL_INDEX_NONE            UINT_MAX    //нет резервуара (конец списка корзины)
+#define LEVEL_INDEX_FILL_BUCKETS    1001        //корзины заполненности по 0.1%, последняя - полные и переполненные резервуары
+#define LEVEL_INDEX_MANTISSA_BITS   3           //каждое удвоение значения делится на 2^LEVEL_INDEX_MANTISSA_BITS корзин
+#define LEVEL_INDEX_LOG_BUCKETS     (1 + 34 * (1 << LEVEL_INDEX_MANTISSA_BITS)) //корзины уровня и расстояний до границ: 0 и значения до 2^34
+#define LEVEL_INDEX_STATE_BUCKETS   2           //корзины состояний: выключен, включен
+#define LEVEL_INDEX_TANK_ON         1           //признак включенного резервуара
+#define LEVEL_INDEX_DOWNLOAD_ON     2           //признак работающего насоса налива
+#define LEVEL_INDEX_UPLOAD_ON       4           //признак работающего насоса слива
+
+/**
+ * количество корзин каждой величины
+ */
+static const size_t _buckets_counts[LEVEL_QUERY_MEASURES] = {
+        LEVEL_INDEX_LOG_BUCKETS, LEVEL_INDEX_FILL_BUCKETS, LEVEL_INDEX_LOG_BUCKETS, LEVEL_INDEX_LOG_BUCKETS,
+        LEVEL_INDEX_STATE_BUCKETS, LEVEL_INDEX_STATE_BUCKETS, LEVEL_INDEX_STATE_BUCKETS
+};
+
+/**
+ * индекс (значения резервуаров и списки корзин хранятся отдельными массивами по каждой величине)
+ */
+struct _level_index{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * уровни на момент последнего обновления
+     */
+    unsigned int* levels;
+    /**
+     * минимальные уровни
+     */
+    unsigned int* minimum_levels;
+    /**
+     * максимальные уровни
+     */
+    unsigned int* maximum_levels;
+    /**
+     * признаки включенного резервуара и работающих насосов (LEVEL_INDEX_TANK_ON, ...)
+     */
+    unsigned char* flags;
+    /**
+     * корзины резервуаров по каждой величине
+     */
+    unsigned short* buckets[LEVEL_QUERY_MEASURES];
+    /**
+     * следующие резервуары в корзинах (LEVEL_INDEX_NONE - последний)
+     */
+    unsigned int* next[LEVEL_QUERY_MEASURES];
+    /**
+     * предыдущие резервуары в корзинах (LEVEL_INDEX_NONE - первый)
+     */
+    unsigned int* previous[LEVEL_QUERY_MEASURES];
+    /**
+     * первые резервуары корзин (LEVEL_INDEX_NONE - корзина пуста)
+     */
+    unsigned int* heads[LEVEL_QUERY_MEASURES];
+    /**
+     * количество резервуаров в корзинах
+     */
+    size_t* counts[LEVEL_QUERY_MEASURES];
+    /**
+     * мьютекс для обновления и запросов из разных потоков
+     */
+    pthread_mutex_t mutex;
+};
+
+/**
+ * корзина значения с логарифмическим шагом (относительная ширина корзины не больше 1/2^LEVEL_INDEX_MANTISSA_BITS)
+ * @param value значение
+ * @return номер корзины (0 - значение не больше нуля), не убывает с ростом значения
+ */
+static size_t _log_bucket(long long value);
+
+/**
+ * корзина заполненности
+ * @param level уровень
+ * @param maximum_level максимальный уровень
+ * @return номер корзины
+ */
+static size_t _fill_bucket(unsigned long long level, unsigned long long maximum_level);
+
+/**
+ * корзина, в которой должен находиться резервуар
+ * @param li указатель на индекс
+ * @param measure величина
+ * @param number номер резервуара
+ * @return номер корзины
+ */
+static size_t _tank_bucket(const level_index* li, int measure, unsigned int number);
+
+/**
+ * корзины, в которых могут находиться резервуары, удовлетворяющие условию
+ * @param condition условие
+ * @param first первая корзина
+ * @param last последняя корзина
+ */
+static void _condition_buckets(const level_condition* condition, size_t* first, size_t* last);
+
+/**
+ * проверить условие для резервуара
+ * @param li указатель на индекс
+ * @param condition условие
+ * @param number номер резервуара
+ * @return 1 - условие выполнено, 0 - не выполнено
+ */
+static int _match_condition(const level_index* li, const level_condition* condition, unsigned int number);
+
+/**
+ * добавить резервуар в корзину
+ * @param li указатель на индекс
+ * @param measure величина
+ * @param number номер резервуара
+ * @param bucket номер корзины
+ */
+static void _link_tank(level_index* li, int measure, unsigned int number, size_t bucket);
+
+/**
+ * убрать резервуар из его корзины
+ * @param li указатель на индекс
+ * @param measure величина
+ * @param number номер резервуара
+ */
+static void _unlink_tank(level_index* li, int measure, unsigned int number);
+
+/**
+ * перенести резервуар в корзины по его новому состоянию (вызывается под мьютексом)
+ * @param li указатель на индекс
+ * @param number номер резервуара
+ * @param level уровень
+ * @param minimum_level минимальный уровень
+ * @param maximum_level максимальный уровень
+ * @param state состояние резервуара
+ * @param download_state состояние насоса налива
+ * @param upload_state состояние насоса слива
+ * @return 1 - состояние изменилось, 0 - нет
+ */
+static int _update_tank(level_index* li, unsigned int number, unsigned int level, unsigned int minimum_level, unsigned int maximum_level,
+                        int state, int download_state, int upload_state);
+
+/**
+ * разобрать сравнение
+ * @param text текст сравнения (<, <=, >, >=, =)
+ * @return сравнение (LEVEL_QUERY_LESS, ...), -1 - неизвестное сравнение
+ */
+static int _parse_comparison(const char* text);
+
+/**
+ * разобрать значение уровня и привести условие к одной из величин уровня
+ * @param text текст значения (число, "90%", "min+N", "max-N")
+ * @param condition условие (сравнение уже разобрано, при сравнении с максимальным уровнем оно переворачивается)
+ * @return 0 - значение разобрано, -1 - ошибка
+ */
+static int _parse_level_value(const char* text, level_condition* condition);
+
+level_index* create_level_index(size_t tanks_count){
+    level_index* li = malloc(sizeof(level_index));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    li->tanks_count = tanks_count;
+    li->levels = calloc(count, sizeof(unsigned int));
+    li->minimum_levels = calloc(count, sizeof(unsigned int));
+    li->maximum_levels = calloc(count, sizeof(unsigned int));
+    li->flags = calloc(count, sizeof(unsigned char));
+    for(int m = 0; m < LEVEL_QUERY_MEASURES; ++m){
+        li->buckets[m] = malloc(sizeof(unsigned short) * count);
+        li->next[m] = malloc(sizeof(unsigned int) * count);
+        li->previous[m] = malloc(sizeof(unsigned int) * count);
+        li->heads[m] = malloc(sizeof(unsigned int) * _buckets_counts[m]);
+        li->counts[m] = calloc(_buckets_counts[m], sizeof(size_t));
+        for(size_t b = 0; b < _buckets_counts[m]; ++b){
+            li->heads[m][b] = LEVEL_INDEX_NONE;
+        }
+        for(unsigned int i = 0; i < tanks_count; ++i){
+            _link_tank(li, m, i, _tank_bucket(li, m, i));
+        }
+    }
+    pthread_mutex_init(&li->mutex, NULL);
+    return li;
+}
+
+int parse_level_query(const char* text, level_query* query){
+    char word[32], comparison[8], value[32];
+    int length;
+    query->conditions_count = 0;
+    if (sscanf(text, "%31s%n", word, &length) != 1) return -1;
+    while(1){
+        text += length;
+        if (query->conditions_count == LEVEL_QUERY_MAX_CONDITIONS) return -1;
+        level_condition* condition = &query->conditions[query->conditions_count++];
+        if (strcmp(word, "level") == 0){
+            if (sscanf(text, "%7s %31s%n", comparison, value, &length) != 2) return -1;
+            text += length;
+            condition->comparison = _parse_comparison(comparison);
+            if (condition->comparison == -1 || _parse_level_value(value, condition) != 0) return -1;
+        } else {
+            if (strcmp(word, "tank") == 0) condition->measure = LEVEL_QUERY_TANK;
+            else if (strcmp(word, "download_pump") == 0) condition->measure = LEVEL_QUERY_DOWNLOAD_PUMP;
+            else if (strcmp(word, "upload_pump") == 0) condition->measure = LEVEL_QUERY_UPLOAD_PUMP;
+            else return -1;
+            if (sscanf(text, "%31s%n", value, &length) != 1) return -1;
+            text += length;
+            if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0) return -1;
+            condition->comparison = LEVEL_QUERY_EQUAL;
+            condition->value = strcmp(value, "on") == 0 ? 1.0 : 0.0;
+        }
+        if (sscanf(text, "%31s%n", word, &length) != 1) return 0;
+        if (strcmp(word, "and") != 0) return -1;
+        text += length;
+        if (sscanf(text, "%31s%n", word, &length) != 1) return -1;
+    }
+}
+
+size_t update_level_index(level_index* li, const unsigned int* levels, const unsigned int* minimum_levels, const unsigned int* maximum_levels,
+                          const int* states, const int* download_states, const int* upload_states){
+    size_t changed_count = 0;
+    pthread_mutex_lock(&li->mutex);
+    for(unsigned int i = 0; i < li->tanks_count; ++i){
+        changed_count += (size_t)_update_tank(li, i, levels[i], minimum_levels[i], maximum_levels[i], states[i], download_states[i], upload_states[i]);
+    }
+    pthread_mutex_unlock(&li->mutex);
+    return changed_count;
+}
+
+int set_tank_state_level_index(level_index* li, unsigned int number, unsigned int level, unsigned int minimum_level, unsigned int maximum_level,
+                               int state, int download_state, int upload_state){
+    pthread_mutex_lock(&li->mutex);
+    int changed = _update_tank(li, number, level, minimum_level, maximum_level, state, download_state, upload_state);
+    pthread_mutex_unlock(&li->mutex);
+    return changed;
+}
+
+size_t find_level_index(level_index* li, const level_query* query, unsigned int* numbers, size_t max_count){
+    //условия на одну величину сужают один диапазон корзин; перебираются корзины величины с наименьшим количеством
+    //резервуаров-кандидатов, остальные условия проверяются по значениям резервуаров;
+    //запрос без условий перебирает все резервуары по корзинам состояния резервуара
+    size_t firsts[LEVEL_QUERY_MEASURES], lasts[LEVEL_QUERY_MEASURES];
+    for(int m = 0; m < LEVEL_QUERY_MEASURES; ++m){
+        firsts[m] = 0;
+        lasts[m] = _buckets_counts[m] - 1;
+    }
+    for(size_t c = 0; c < query->conditions_count; ++c){
+        const level_condition* condition = &query->conditions[c];
+        size_t first, last;
+        _condition_buckets(condition, &first, &last);
+        if (first > firsts[condition->measure]) firsts[condition->measure] = first;
+        if (last < lasts[condition->measure]) lasts[condition->measure] = last;
+    }
+    pthread_mutex_lock(&li->mutex);
+    int best_measure = LEVEL_QUERY_TANK;
+    size_t best_count = li->tanks_count;
+    for(size_t c = 0; c < query->conditions_count; ++c){
+        int measure = query->conditions[c].measure;
+        size_t count = 0;
+        for(size_t b = firsts[measure]; b <= lasts[measure] && firsts[measure] <= lasts[measure]; ++b){
+            count += li->counts[measure][b];
+        }
+        if (count < best_count || c == 0){
+            best_measure = measure;
+            best_count = count;
+        }
+    }
+    size_t found = 0;
+    for(size_t b = firsts[best_measure]; b <= lasts[best_measure] && firsts[best_measure] <= lasts[best_measure]; ++b){
+        for(unsigned int i = li->heads[best_measure][b]; i != LEVEL_INDEX_NONE; i = li->next[best_measure][i]){
+            size_t c = 0;
+            while (c < query->conditions_count && _match_condition(li, &query->conditions[c], i)) c++;
+            if (c < query->conditions_count) continue;
+            if (found < max_count) numbers[found] = i;
+            found++;
+        }
+    }
+    pthread_mutex_unlock(&li->mutex);
+    return found;
+}
+
+void finalize_level_index(level_index* li){
+    for(int m = 0; m < LEVEL_QUERY_MEASURES; ++m){
+        free(li->buckets[m]);
+        free(li->next[m]);
+        free(li->previous[m]);
+        free(li->heads[m]);
+        free(li->counts[m]);
+    }
+    free(li->levels);
+    free(li->minimum_levels);
+    free(li->maximum_levels);
+    free(li->flags);
+    pthread_mutex_destroy(&li->mutex);
+    free(li);
+}
+
+static size_t _log_bucket(long long value){
+    if (value <= 0) return 0;
+    int octave = 63 - __builtin_clzll((unsigned long long)value);
+    unsigned long long mantissa = octave >= LEVEL_INDEX_MANTISSA_BITS
+                                  ? (unsigned long long)value >> (octave - LEVEL_INDEX_MANTISSA_BITS)
+                                  : (unsigned long long)value << (LEVEL_INDEX_MANTISSA_BITS - octave);
+    size_t bucket = 1 + ((size_t)octave << LEVEL_INDEX_MANTISSA_BITS) + (mantissa & ((1 << LEVEL_INDEX_MANTISSA_BITS) - 1));
+    return bucket < LEVEL_INDEX_LOG_BUCKETS ? bucket : LEVEL_INDEX_LOG_BUCKETS - 1;
+}
+
+static size_t _fill_bucket(unsigned long long level, unsigned long long maximum_level){
+    size_t bucket = (size_t)(level * (LEVEL_INDEX_FILL_BUCKETS - 1) / (maximum_level == 0 ? 1 : maximum_level));
+    return bucket < LEVEL_INDEX_FILL_BUCKETS ? bucket : LEVEL_INDEX_FILL_BUCKETS - 1;
+}
+
+static size_t _tank_bucket(const level_index* li, int measure, unsigned int number){
+    switch (measure){
+        case LEVEL_QUERY_LEVEL:         return _log_bucket(li->levels[number]);
+        case LEVEL_QUERY_FILL:          return _fill_bucket(li->levels[number], li->maximum_levels[number]);
+        case LEVEL_QUERY_ABOVE_MINIMUM: return _log_bucket((long long)li->levels[number] - li->minimum_levels[number]);
+        case LEVEL_QUERY_BELOW_MAXIMUM: return _log_bucket((long long)li->maximum_levels[number] - li->levels[number]);
+        case LEVEL_QUERY_TANK:          return (li->flags[number] & LEVEL_INDEX_TANK_ON) != 0;
+        case LEVEL_QUERY_DOWNLOAD_PUMP: return (li->flags[number] & LEVEL_INDEX_DOWNLOAD_ON) != 0;
+        default:                        return (li->flags[number] & LEVEL_INDEX_UPLOAD_ON) != 0;
+    }
+}
+
+static void _condition_buckets(const level_condition* condition, size_t* first, size_t* last){
+    size_t count = _buckets_counts[condition->measure];
+    double value = condition->value;
+    size_t bucket;
+    switch (condition->measure){
+        case LEVEL_QUERY_FILL:
+            bucket = value <= 0.0 ? 0 : value >= 1.0 ? count - 1 : (size_t)(value * (double)(count - 1));
+            break;
+        case LEVEL_QUERY_TANK:
+        case LEVEL_QUERY_DOWNLOAD_PUMP:
+        case LEVEL_QUERY_UPLOAD_PUMP:
+            bucket = value > 0.0;
+            break;
+        default:
+            //целые значения величины по обе стороны от порога лежат в корзинах по обе стороны от корзины floor(порога)
+            if (value > (double)LLONG_MAX / 2) value = (double)LLONG_MAX / 2;
+            bucket = _log_bucket(value < 0.0 ? -1 : (long long)floor(value));
+            break;
+    }
+    *first = 0;
+    *last = count - 1;
+    switch (condition->comparison){
+        case LEVEL_QUERY_LESS:
+        case LEVEL_QUERY_LESS_EQUAL:    *last = bucket; break;
+        case LEVEL_QUERY_GREATER:
+        case LEVEL_QUERY_GREATER_EQUAL: *first = bucket; break;
+        default:                        *first = *last = bucket; break;
+    }
+    //доля в запросе и заполненность резервуара считаются разной арифметикой, граничная корзина может отличаться на одну
+    if (condition->measure == LEVEL_QUERY_FILL){
+        if (*first > 0) (*first)--;
+        if (*last + 1 < count) (*last)++;
+    }
+}
+
+static int _match_condition(const level_index* li, const level_condition* condition, unsigned int number){
+    double value;
+    switch (condition->measure){
+        case LEVEL_QUERY_LEVEL:         value = li->levels[number]; break;
+        case LEVEL_QUERY_FILL:          value = (double)li->levels[number] / (li->maximum_levels[number] == 0 ? 1 : li->maximum_levels[number]); break;
+        case LEVEL_QUERY_ABOVE_MINIMUM: value = (double)li->levels[number] - li->minimum_levels[number]; break;
+        case LEVEL_QUERY_BELOW_MAXIMUM: value = (double)li->maximum_levels[number] - li->levels[number]; break;
+        default:                        value = (double)_tank_bucket(li, condition->measure, number); break;
+    }
+    switch (condition->comparison){
+        case LEVEL_QUERY_LESS:          return value < condition->value;
+        case LEVEL_QUERY_LESS_EQUAL:    return value <= condition->value;
+        case LEVEL_QUERY_GREATER:       return value > condition->value;
+        case LEVEL_QUERY_GREATER_EQUAL: return value >= condition->value;
+        default:                        return value == condition->value;
+    }
+}
+
+static void _link_tank(level_index* li, int measure, unsigned int number, size_t bucket){
+    unsigned int head = li->heads[measure][bucket];
+    li->buckets[measure][number] = (unsigned short)bucket;
+    li->previous[measure][number] = LEVEL_INDEX_NONE;
+    li->next[measure][number] = head;
+    if (head != LEVEL_INDEX_NONE) li->previous[measure][head] = number;
+    li->heads[measure][bucket] = number;
+    li->counts[measure][bucket]++;
+}
+
+static void _unlink_tank(level_index* li, int measure, unsigned int number){
+    size_t bucket = li->buckets[measure][number];
+    unsigned int previous = li->previous[measure][number];
+    unsigned int next = li->next[measure][number];
+    if (previous != LEVEL_INDEX_NONE) li->next[measure][previous] = next;
+    else li->heads[measure][bucket] = next;
+    if (next != LEVEL_INDEX_NONE) li->previous[measure][next] = previous;
+    li->counts[measure][bucket]--;
+}
+
+static int _update_tank(level_index* li, unsigned int number, unsigned int level, unsigned int minimum_level, unsigned int maximum_level,
+                        int state, int download_state, int upload_state){
+    unsigned char flags = 0;
+    if (state == STORAGE_TANK_ON) flags |= LEVEL_INDEX_TANK_ON;
+    if (download_state == PUMP_ON) flags |= LEVEL_INDEX_DOWNLOAD_ON;
+    if (upload_state == PUMP_ON) flags |= LEVEL_INDEX_UPLOAD_ON;
+    int levels_changed = level != li->levels[number] || minimum_level != li->minimum_levels[number]
+                         || maximum_level != li->maximum_levels[number];
+    int flags_changed = flags != li->flags[number];
+    if (!levels_changed && !flags_changed) return 0;
+    li->levels[number] = level;
+    li->minimum_levels[number] = minimum_level;
+    li->maximum_levels[number] = maximum_level;
+    li->flags[number] = flags;
+    for(int m = 0; m < LEVEL_QUERY_MEASURES; ++m){
+        //величины до LEVEL_QUERY_TANK зависят только от уровней, остальные - только от состояний
+        if (m < LEVEL_QUERY_TANK ? !levels_changed : !flags_changed) continue;
+        size_t bucket = _tank_bucket(li, m, number);
+        if (bucket == li->buckets[m][number]) continue;
+        _unlink_tank(li, m, number);
+        _link_tank(li, m, number, bucket);
+    }
+    return 1;
+}
+
+static int _parse_comparison(const char* text){
+    if (strcmp(text, "<") == 0) return LEVEL_QUERY_LESS;
+    if (strcmp(text, "<=") == 0) return LEVEL_QUERY_LESS_EQUAL;
+    if (strcmp(text, ">") == 0) return LEVEL_QUERY_GREATER;
+    if (strcmp(text, ">=") == 0) return LEVEL_QUERY_GREATER_EQUAL;
+    if (strcmp(text, "=") == 0 || strcmp(text, "==") == 0) return LEVEL_QUERY_EQUAL;
+    return -1;
+}
+
+static int _parse_level_value(const char* text, level_condition* condition){
+    char* end;
+    if (strncmp(text, "min", 3) == 0 || strncmp(text, "max", 3) == 0){
+        double offset = text[3] == '\0' ? 0.0 : strtod(text + 3, &end);
+        if (text[3] != '\0' && (*end != '\0' || (text[3] != '+' && text[3] != '-'))) return -1;
+        if (text[1] == 'i'){
+            //уровень ? min+N  <=>  уровень - min ? N
+            condition->measure = LEVEL_QUERY_ABOVE_MINIMUM;
+            condition->value = offset;
+            return 0;
+        }
+        //уровень ? max+N  <=>  max - уровень ?' -N, сравнение переворачивается
+        condition->measure = LEVEL_QUERY_BELOW_MAXIMUM;
+        condition->value = -offset;
+        switch (condition->comparison){
+            case LEVEL_QUERY_LESS:          condition->comparison = LEVEL_QUERY_GREATER; break;
+            case LEVEL_QUERY_LESS_EQUAL:    condition->comparison = LEVEL_QUERY_GREATER_EQUAL; break;
+            case LEVEL_QUERY_GREATER:       condition->comparison = LEVEL_QUERY_LESS; break;
+            case LEVEL_QUERY_GREATER_EQUAL: condition->comparison = LEVEL_QUERY_LESS_EQUAL; break;
+            default: break;
+        }
+        return 0;
+    }
+    double value = strtod(text, &end);
+    if (end == text) return -1;
+    if (end[0] == '%' && end[1] == '\0'){
+        condition->measure = LEVEL_QUERY_FILL;
+        condition->value = value / 100.0;
+        return 0;
+    }
+    if (*end != '\0') return -1;
+    condition->measure = LEVEL_QUERY_LEVEL;
+    condition->value = value;
+    return 0;
+}
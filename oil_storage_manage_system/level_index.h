@@ -0,0 +1,128 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_LEVEL_INDEX_H
+#define OIL_STORAGE_MANAGE_SYSTEM_LEVEL_INDEX_H
+
+#include <stddef.h>
+
+/**
+ * индекс резервуаров по уровню и состоянию насосов для выборочных запросов ("уровень выше 90%")
+ *
+ * по каждой величине (уровень, заполненность, превышение над минимальным уровнем, запас до максимального,
+ * состояния резервуара и насосов) резервуары разложены по корзинам - двусвязным спискам, упорядоченным
+ * по значению величины; при изменении резервуара он переносится только между корзинами изменившихся величин;
+ * запрос перебирает корзины самого избирательного условия, поэтому его время пропорционально количеству
+ * найденных резервуаров (и резервуаров в граничных корзинах), а не количеству всех резервуаров
+ */
+struct _level_index;
+typedef struct _level_index level_index;
+
+#define LEVEL_QUERY_MAX_CONDITIONS  8   //максимальное количество условий в запросе
+
+#define LEVEL_QUERY_LEVEL           0   //уровень
+#define LEVEL_QUERY_FILL            1   //заполненность: доля максимального уровня
+#define LEVEL_QUERY_ABOVE_MINIMUM   2   //превышение уровня над минимальным
+#define LEVEL_QUERY_BELOW_MAXIMUM   3   //запас до максимального уровня
+#define LEVEL_QUERY_TANK            4   //резервуар включен (0, 1)
+#define LEVEL_QUERY_DOWNLOAD_PUMP   5   //насос налива работает (0, 1)
+#define LEVEL_QUERY_UPLOAD_PUMP     6   //насос слива работает (0, 1)
+#define LEVEL_QUERY_MEASURES        7   //количество величин
+
+#define LEVEL_QUERY_LESS            0   //величина меньше значения
+#define LEVEL_QUERY_LESS_EQUAL      1   //величина не больше значения
+#define LEVEL_QUERY_GREATER         2   //величина больше значения
+#define LEVEL_QUERY_GREATER_EQUAL   3   //величина не меньше значения
+#define LEVEL_QUERY_EQUAL           4   //величина равна значению
+
+/**
+ * условие запроса
+ */
+typedef struct _level_condition{
+    /**
+     * величина (LEVEL_QUERY_LEVEL, LEVEL_QUERY_FILL, ...)
+     */
+    int measure;
+    /**
+     * сравнение (LEVEL_QUERY_LESS, LEVEL_QUERY_GREATER, ...)
+     */
+    int comparison;
+    /**
+     * значение, с которым сравнивается величина (заполненность - доля от 0 до 1)
+     */
+    double value;
+} level_condition;
+
+/**
+ * запрос: резервуары, удовлетворяющие всем условиям
+ */
+typedef struct _level_query{
+    /**
+     * количество условий
+     */
+    size_t conditions_count;
+    /**
+     * условия
+     */
+    level_condition conditions[LEVEL_QUERY_MAX_CONDITIONS];
+} level_query;
+
+/**
+ * создать индекс (уровни всех резервуаров нулевые, насосы выключены)
+ * @param tanks_count количество резервуаров
+ * @return указатель на индекс
+ */
+level_index* create_level_index(size_t tanks_count);
+
+/**
+ * разобрать текст запроса: условия через "and", условие - "level <op> <value>", где op - <, <=, >, >=, =,
+ * value - число, процент максимального уровня ("90%"), "min+N", "max-N"; или "tank|download_pump|upload_pump on|off"
+ * @param text текст запроса
+ * @param query структура для запроса
+ * @return 0 - запрос разобран, -1 - ошибка в запросе
+ */
+int parse_level_query(const char* text, level_query* query);
+
+/**
+ * обновить индекс по состояниям резервуаров (переносятся только изменившиеся резервуары)
+ * @param li указатель на индекс
+ * @param levels уровни всех резервуаров
+ * @param minimum_levels минимальные уровни
+ * @param maximum_levels максимальные уровни
+ * @param states состояния резервуаров
+ * @param download_states состояния насосов налива
+ * @param upload_states состояния насосов слива
+ * @return количество изменившихся резервуаров
+ */
+size_t update_level_index(level_index* li, const unsigned int* levels, const unsigned int* minimum_levels, const unsigned int* maximum_levels,
+                          const int* states, const int* download_states, const int* upload_states);
+
+/**
+ * обновить индекс по состоянию одного резервуара
+ * @param li указатель на индекс
+ * @param number номер резервуара
+ * @param level уровень
+ * @param minimum_level минимальный уровень
+ * @param maximum_level максимальный уровень
+ * @param state состояние резервуара
+ * @param download_state состояние насоса налива
+ * @param upload_state состояние насоса слива
+ * @return 1 - резервуар перенесен, 0 - его состояние не изменилось
+ */
+int set_tank_state_level_index(level_index* li, unsigned int number, unsigned int level, unsigned int minimum_level, unsigned int maximum_level,
+                               int state, int download_state, int upload_state);
+
+/**
+ * найти резервуары, удовлетворяющие запросу (по состоянию на последнее обновление индекса)
+ * @param li указатель на индекс
+ * @param query запрос
+ * @param numbers массив для номеров резервуаров (в порядке корзин, не по номерам)
+ * @param max_count максимальное количество номеров в массиве
+ * @return количество всех найденных резервуаров (может быть больше max_count)
+ */
+size_t find_level_index(level_index* li, const level_query* query, unsigned int* numbers, size_t max_count);
+
+/**
+ * уничтожить индекс
+ * @param li указатель на индекс
+ */
+void finalize_level_index(level_index* li);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_LEVEL_INDEX_H
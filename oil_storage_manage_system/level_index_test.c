@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "level_index.h"
+#include "oil_storage_def.h"
+
+#define TEST_TANKS_COUNT    5000    //количество резервуаров
+#define TEST_ROUNDS         100     //количество обновлений индекса
+#define TEST_QUERIES        20      //количество запросов после каждого обновления
+#define TEST_CHANGED_TANKS  250     //количество резервуаров, меняющихся за обновление
+#define TEST_MAX_LEVEL      30000   //наибольший максимальный уровень
+
+/**
+ * состояния резервуаров, по которым обновляется индекс и проверяются запросы
+ */
+typedef struct _test_fleet{
+    unsigned int levels[TEST_TANKS_COUNT];
+    unsigned int minimum_levels[TEST_TANKS_COUNT];
+    unsigned int maximum_levels[TEST_TANKS_COUNT];
+    int states[TEST_TANKS_COUNT];
+    int download_states[TEST_TANKS_COUNT];
+    int upload_states[TEST_TANKS_COUNT];
+} test_fleet;
+
+/**
+ * задать резервуару случайное состояние (иногда уровень ниже минимального или выше максимального)
+ * @param tf состояния резервуаров
+ * @param number номер резервуара
+ */
+static void _randomize_tank(test_fleet* tf, unsigned int number);
+
+/**
+ * составить случайный текст запроса из одного-трех условий (пороги часто берутся у резервуаров,
+ * чтобы граничные корзины проверялись на равенстве величины и порога)
+ * @param tf состояния резервуаров
+ * @param text буфер для текста
+ * @param size размер буфера
+ */
+static void _random_query(const test_fleet* tf, char* text, size_t size);
+
+/**
+ * проверить, удовлетворяет ли резервуар запросу, по тексту запроса (без индекса)
+ * @param tf состояния резервуаров
+ * @param number номер резервуара
+ * @param text текст запроса
+ * @return 1 - удовлетворяет, 0 - нет
+ */
+static int _match_text(const test_fleet* tf, unsigned int number, const char* text);
+
+/**
+ * сравнить номера резервуаров для сортировки
+ */
+static int _compare_numbers(const void* a, const void* b);
+
+int main(void){
+    static test_fleet tf;
+    static unsigned int found[TEST_TANKS_COUNT], expected[TEST_TANKS_COUNT];
+    srand(47);
+    for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+        _randomize_tank(&tf, i);
+    }
+    level_index* li = create_level_index(TEST_TANKS_COUNT);
+    size_t queries = 0;
+    int failures = 0;
+    for(int round = 0; round < TEST_ROUNDS && failures == 0; ++round){
+        //первое обновление переносит все резервуары, следующие - только изменившиеся;
+        //в нечетных обновлениях резервуары переносятся по одному, как в аналитическом режиме
+        for(int k = 0; round > 0 && k < TEST_CHANGED_TANKS; ++k){
+            unsigned int number = (unsigned int)(rand() % TEST_TANKS_COUNT);
+            _randomize_tank(&tf, number);
+            if (round % 2 == 1){
+                set_tank_state_level_index(li, number, tf.levels[number], tf.minimum_levels[number], tf.maximum_levels[number],
+                                           tf.states[number], tf.download_states[number], tf.upload_states[number]);
+            }
+        }
+        if (round % 2 == 0){
+            update_level_index(li, tf.levels, tf.minimum_levels, tf.maximum_levels, tf.states, tf.download_states, tf.upload_states);
+        }
+        for(int q = 0; q < TEST_QUERIES; ++q){
+            char text[256];
+            level_query query;
+            _random_query(&tf, text, sizeof(text));
+            if (parse_level_query(text, &query) != 0){
+                printf("запрос не разобран: %s\n", text);
+                failures++;
+                continue;
+            }
+            size_t found_count = find_level_index(li, &query, found, TEST_TANKS_COUNT);
+            size_t expected_count = 0;
+            for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+                if (_match_text(&tf, i, text)) expected[expected_count++] = i;
+            }
+            qsort(found, found_count < TEST_TANKS_COUNT ? found_count : TEST_TANKS_COUNT, sizeof(unsigned int), _compare_numbers);
+            if (found_count != expected_count || memcmp(found, expected, sizeof(unsigned int) * expected_count) != 0){
+                printf("обновление %d, запрос \"%s\": найдено %zu, перебором %zu\n", round, text, found_count, expected_count);
+                failures++;
+            }
+            queries++;
+        }
+    }
+    finalize_level_index(li);
+    printf("запросов %zu, расхождений с перебором %d\n", queries, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+static void _randomize_tank(test_fleet* tf, unsigned int number){
+    unsigned int maximum_level = (unsigned int)(rand() % TEST_MAX_LEVEL + 1);
+    unsigned int minimum_level = (unsigned int)(rand() % (maximum_level / 4 + 1));
+    unsigned int level;
+    switch (rand() % 10){
+        case 0:  level = minimum_level > 0 ? (unsigned int)(rand() % minimum_level) : 0; break;
+        case 1:  level = maximum_level + (unsigned int)(rand() % 100); break;
+        case 2:  level = rand() % 2 ? minimum_level : maximum_level; break;
+        default: level = minimum_level + (unsigned int)(rand() % (maximum_level - minimum_level + 1)); break;
+    }
+    tf->levels[number] = level;
+    tf->minimum_levels[number] = minimum_level;
+    tf->maximum_levels[number] = maximum_level;
+    tf->states[number] = rand() % 4 ? STORAGE_TANK_ON : STORAGE_TANK_OFF;
+    tf->download_states[number] = tf->states[number] == STORAGE_TANK_ON && rand() % 2 ? PUMP_ON : PUMP_OFF;
+    tf->upload_states[number] = tf->states[number] == STORAGE_TANK_ON && rand() % 3 == 0 ? PUMP_ON : PUMP_OFF;
+}
+
+static void _random_query(const test_fleet* tf, char* text, size_t size){
+    static const char* comparisons[] = {"<", "<=", ">", ">=", "="};
+    static const char* pumps[] = {"tank", "download_pump", "upload_pump"};
+    int conditions = rand() % 3 + 1;
+    size_t length = 0;
+    for(int c = 0; c < conditions; ++c){
+        if (c > 0) length += (size_t)snprintf(text + length, size - length, " and ");
+        const char* comparison = comparisons[rand() % 5];
+        unsigned int tank = (unsigned int)(rand() % TEST_TANKS_COUNT);
+        int from_tank = rand() % 2;
+        long long level = tf->levels[tank];
+        switch (rand() % 5){
+            case 0:
+                length += (size_t)snprintf(text + length, size - length, "level %s %lld", comparison,
+                                           from_tank ? level : rand() % (TEST_MAX_LEVEL + 200));
+                break;
+            case 1:{
+                int permille = from_tank ? (int)(level * 1000 / tf->maximum_levels[tank]) : rand() % 1050;
+                length += (size_t)snprintf(text + length, size - length, "level %s %d.%d%%", comparison, permille / 10, permille % 10);
+                break;
+            }
+            case 2:
+                length += (size_t)snprintf(text + length, size - length, "level %s min%+lld", comparison,
+                                           from_tank ? level - tf->minimum_levels[tank] : rand() % 20000 - 100);
+                break;
+            case 3:
+                length += (size_t)snprintf(text + length, size - length, "level %s max%+lld", comparison,
+                                           from_tank ? level - tf->maximum_levels[tank] : 100 - rand() % 20000);
+                break;
+            default:
+                length += (size_t)snprintf(text + length, size - length, "%s %s", pumps[rand() % 3], rand() % 2 ? "on" : "off");
+                break;
+        }
+    }
+}
+
+static int _match_text(const test_fleet* tf, unsigned int number, const char* text){
+    char word[32], comparison[8], value[32];
+    int length;
+    while (sscanf(text, "%31s%n", word, &length) == 1){
+        text += length;
+        if (strcmp(word, "and") == 0) continue;
+        if (strcmp(word, "level") != 0){
+            sscanf(text, "%31s%n", value, &length);
+            text += length;
+            int state = strcmp(word, "tank") == 0 ? tf->states[number] == STORAGE_TANK_ON
+                        : strcmp(word, "download_pump") == 0 ? tf->download_states[number] == PUMP_ON
+                        : tf->upload_states[number] == PUMP_ON;
+            if (state != (strcmp(value, "on") == 0)) return 0;
+            continue;
+        }
+        sscanf(text, "%7s %31s%n", comparison, value, &length);
+        text += length;
+        //уровень сравнивается с порогом так, как запрос записан: доля - делением, min+N и max-N - целыми
+        double left = tf->levels[number], right;
+        if (strncmp(value, "min", 3) == 0) right = (double)tf->minimum_levels[number] + strtod(value + 3, NULL);
+        else if (strncmp(value, "max", 3) == 0) right = (double)tf->maximum_levels[number] + strtod(value + 3, NULL);
+        else if (strchr(value, '%') != NULL){
+            left = (double)tf->levels[number] / tf->maximum_levels[number];
+            right = strtod(value, NULL) / 100.0;
+        } else right = strtod(value, NULL);
+        int match = strcmp(comparison, "<") == 0 ? left < right
+                    : strcmp(comparison, "<=") == 0 ? left <= right
+                    : strcmp(comparison, ">") == 0 ? left > right
+                    : strcmp(comparison, ">=") == 0 ? left >= right
+                    : left == right;
+        if (!match) return 0;
+    }
+    return 1;
+}
+
+static int _compare_numbers(const void* a, const void* b){
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return x < y ? -1 : x > y;
+}
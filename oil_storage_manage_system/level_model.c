@@ -0,0 +1,437 @@
+#include "level_model.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TICK_NS         ((double)TIME_UNIT * 1000000.0) //длительность такта в нс
+#define EVENT_NONE      0   //граница не будет достигнута
+#define EVENT_MAXIMUM   1   //уровень дойдет до максимального, насос налива выключится
+#define EVENT_MINIMUM   2   //уровень дойдет до минимального, насос слива выключится
+
+/**
+ * модель уровня
+ */
+struct _level_model{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * уровни в моменты отсчета
+     */
+    double* base_levels;
+    /**
+     * моменты отсчета в нс
+     */
+    unsigned long long* base_times;
+    /**
+     * суммарные скорости насосов (изменение уровня за такт)
+     */
+    long long* rates;
+    /**
+     * минимальные уровни
+     */
+    unsigned int* minimum_levels;
+    /**
+     * максимальные уровни
+     */
+    unsigned int* maximum_levels;
+    /**
+     * состояния резервуаров
+     */
+    int* states;
+    /**
+     * состояния насосов налива
+     */
+    int* download_states;
+    /**
+     * скорости насосов налива
+     */
+    unsigned int* download_speeds;
+    /**
+     * состояния насосов слива
+     */
+    int* upload_states;
+    /**
+     * скорости насосов слива
+     */
+    unsigned int* upload_speeds;
+    /**
+     * ожидаемые события (EVENT_NONE, EVENT_MAXIMUM, EVENT_MINIMUM)
+     */
+    unsigned char* events;
+    /**
+     * моменты событий в нс
+     */
+    unsigned long long* event_times;
+    /**
+     * куча номеров резервуаров с событием, упорядоченная по моменту события
+     */
+    unsigned int* heap;
+    /**
+     * количество резервуаров в куче
+     */
+    size_t heap_size;
+    /**
+     * позиции резервуаров в куче (-1 - резервуара в куче нет)
+     */
+    long* positions;
+    /**
+     * номера резервуаров, уровень которых меняется
+     */
+    unsigned int* moving;
+    /**
+     * количество резервуаров, уровень которых меняется
+     */
+    size_t moving_count;
+    /**
+     * позиции резервуаров в массиве moving (-1 - уровень не меняется)
+     */
+    long* moving_positions;
+    /**
+     * номера резервуаров, состояние которых изменилось
+     */
+    unsigned int* changed;
+    /**
+     * количество резервуаров, состояние которых изменилось
+     */
+    size_t changed_count;
+    /**
+     * признаки изменения состояния резервуаров
+     */
+    unsigned char* changed_flags;
+    /**
+     * количество обработанных событий
+     */
+    unsigned long long limit_events;
+    /**
+     * количество изменений состояния командами
+     */
+    unsigned long long updates;
+};
+
+/**
+ * уровень резервуара в момент времени
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ * @param time момент времени в нс (не раньше момента отсчета)
+ * @return уровень
+ */
+static double _level_at(const level_model* lm, unsigned int number, unsigned long long time);
+
+/**
+ * пересчитать скорость резервуара и момент ближайшего события от текущего отсчета
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ */
+static void _schedule(level_model* lm, unsigned int number);
+
+/**
+ * поднять элемент кучи к корню, пока он раньше родителя
+ * @param lm указатель на модель
+ * @param position позиция элемента
+ */
+static void _sift_up(level_model* lm, size_t position);
+
+/**
+ * опустить элемент кучи к листьям, пока он позже детей
+ * @param lm указатель на модель
+ * @param position позиция элемента
+ */
+static void _sift_down(level_model* lm, size_t position);
+
+/**
+ * поместить резервуар в позицию кучи
+ * @param lm указатель на модель
+ * @param position позиция
+ * @param number номер резервуара
+ */
+static void _place(level_model* lm, size_t position, unsigned int number);
+
+/**
+ * удалить резервуар из кучи
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ */
+static void _remove(level_model* lm, unsigned int number);
+
+/**
+ * отметить изменение состояния резервуара
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ */
+static void _mark_changed(level_model* lm, unsigned int number);
+
+/**
+ * отметить, меняется ли уровень резервуара
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ * @param moving 1 - уровень меняется, 0 - не меняется
+ */
+static void _set_moving(level_model* lm, unsigned int number, int moving);
+
+level_model* create_level_model(size_t tanks_count){
+    level_model* lm = malloc(sizeof(level_model));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    lm->tanks_count = tanks_count;
+    lm->base_levels = calloc(count, sizeof(double));
+    lm->base_times = calloc(count, sizeof(unsigned long long));
+    lm->rates = calloc(count, sizeof(long long));
+    lm->minimum_levels = calloc(count, sizeof(unsigned int));
+    lm->maximum_levels = calloc(count, sizeof(unsigned int));
+    lm->states = calloc(count, sizeof(int));
+    lm->download_states = calloc(count, sizeof(int));
+    lm->download_speeds = calloc(count, sizeof(unsigned int));
+    lm->upload_states = calloc(count, sizeof(int));
+    lm->upload_speeds = calloc(count, sizeof(unsigned int));
+    lm->events = calloc(count, sizeof(unsigned char));
+    lm->event_times = calloc(count, sizeof(unsigned long long));
+    lm->heap = malloc(sizeof(unsigned int) * count);
+    lm->heap_size = 0;
+    lm->positions = malloc(sizeof(long) * count);
+    lm->moving = malloc(sizeof(unsigned int) * count);
+    lm->moving_count = 0;
+    lm->moving_positions = malloc(sizeof(long) * count);
+    lm->changed = malloc(sizeof(unsigned int) * count);
+    lm->changed_count = 0;
+    lm->changed_flags = calloc(count, sizeof(unsigned char));
+    for(size_t i = 0; i < tanks_count; ++i){
+        lm->positions[i] = -1;
+        lm->moving_positions[i] = -1;
+    }
+    lm->limit_events = 0;
+    lm->updates = 0;
+    return lm;
+}
+
+void reset_level_model(level_model* lm){
+    size_t count = lm->tanks_count;
+    //дробная часть уровня и момент отсчета прошлого прогона не должны попасть в следующий
+    memset(lm->base_levels, 0, sizeof(double) * count);
+    memset(lm->base_times, 0, sizeof(unsigned long long) * count);
+    memset(lm->rates, 0, sizeof(long long) * count);
+    memset(lm->minimum_levels, 0, sizeof(unsigned int) * count);
+    memset(lm->maximum_levels, 0, sizeof(unsigned int) * count);
+    memset(lm->states, 0, sizeof(int) * count);
+    memset(lm->download_states, 0, sizeof(int) * count);
+    memset(lm->download_speeds, 0, sizeof(unsigned int) * count);
+    memset(lm->upload_states, 0, sizeof(int) * count);
+    memset(lm->upload_speeds, 0, sizeof(unsigned int) * count);
+    memset(lm->events, 0, sizeof(unsigned char) * count);
+    memset(lm->event_times, 0, sizeof(unsigned long long) * count);
+    //позиции и отметки сбрасываются только у резервуаров, попавших в кучу и списки
+    for(size_t i = 0; i < lm->heap_size; ++i){
+        lm->positions[lm->heap[i]] = -1;
+    }
+    lm->heap_size = 0;
+    for(size_t i = 0; i < lm->moving_count; ++i){
+        lm->moving_positions[lm->moving[i]] = -1;
+    }
+    lm->moving_count = 0;
+    for(size_t i = 0; i < lm->changed_count; ++i){
+        lm->changed_flags[lm->changed[i]] = 0;
+    }
+    lm->changed_count = 0;
+    lm->limit_events = 0;
+    lm->updates = 0;
+}
+
+void set_state_level_model(level_model* lm, unsigned int number, unsigned long long time, const tank_state* ts){
+    //в состоянии уровень целый, дробная часть, накопленная моделью, сохраняется
+    double level = _level_at(lm, number, time);
+    double fraction = level > 0.0 ? level - floor(level) : 0.0;
+    lm->base_levels[number] = ts->current_level + fraction;
+    lm->base_times[number] = time;
+    lm->minimum_levels[number] = ts->minimum_level;
+    lm->maximum_levels[number] = ts->maximum_level;
+    lm->states[number] = ts->state;
+    lm->download_states[number] = ts->download_state;
+    lm->download_speeds[number] = ts->download_speed;
+    lm->upload_states[number] = ts->upload_state;
+    lm->upload_speeds[number] = ts->upload_speed;
+    lm->updates++;
+    _schedule(lm, number);
+    _mark_changed(lm, number);
+}
+
+void get_state_level_model(const level_model* lm, unsigned int number, unsigned long long time, tank_state* ts){
+    double level = _level_at(lm, number, time);
+    ts->current_level   = level > 0.0 ? (unsigned int)floor(level) : 0;
+    ts->minimum_level   = lm->minimum_levels[number];
+    ts->maximum_level   = lm->maximum_levels[number];
+    ts->state           = lm->states[number];
+    ts->download_state  = lm->download_states[number];
+    ts->download_speed  = lm->download_speeds[number];
+    ts->upload_state    = lm->upload_states[number];
+    ts->upload_speed    = lm->upload_speeds[number];
+}
+
+size_t advance_level_model(level_model* lm, unsigned long long time){
+    size_t events_count = 0;
+    while (lm->heap_size > 0 && lm->event_times[lm->heap[0]] <= time){
+        unsigned int number = lm->heap[0];
+        unsigned long long event_time = lm->event_times[number];
+        if (event_time < lm->base_times[number]) event_time = lm->base_times[number];
+        //уровень в момент достижения границы равен ей точно, от него начинается новый отсчет
+        lm->base_levels[number] = _level_at(lm, number, event_time);
+        lm->base_times[number] = event_time;
+        if (lm->events[number] == EVENT_MAXIMUM) lm->download_states[number] = PUMP_OFF;
+        else lm->upload_states[number] = PUMP_OFF;
+        lm->limit_events++;
+        _schedule(lm, number);
+        _mark_changed(lm, number);
+        events_count++;
+    }
+    return events_count;
+}
+
+size_t take_changed_level_model(level_model* lm, unsigned int* numbers){
+    size_t count = lm->changed_count;
+    for(size_t i = 0; i < count; ++i){
+        numbers[i] = lm->changed[i];
+        lm->changed_flags[lm->changed[i]] = 0;
+    }
+    lm->changed_count = 0;
+    return count;
+}
+
+size_t get_moving_level_model(const level_model* lm, const unsigned int** numbers){
+    *numbers = lm->moving;
+    return lm->moving_count;
+}
+
+void get_stats_level_model(const level_model* lm, level_model_stats* stats){
+    stats->moving_tanks = lm->moving_count;
+    stats->pending_events = lm->heap_size;
+    stats->limit_events = lm->limit_events;
+    stats->updates = lm->updates;
+}
+
+void finalize_level_model(level_model* lm){
+    free(lm->base_levels);
+    free(lm->base_times);
+    free(lm->rates);
+    free(lm->minimum_levels);
+    free(lm->maximum_levels);
+    free(lm->states);
+    free(lm->download_states);
+    free(lm->download_speeds);
+    free(lm->upload_states);
+    free(lm->upload_speeds);
+    free(lm->events);
+    free(lm->event_times);
+    free(lm->heap);
+    free(lm->positions);
+    free(lm->moving);
+    free(lm->moving_positions);
+    free(lm->changed);
+    free(lm->changed_flags);
+    free(lm);
+}
+
+static double _level_at(const level_model* lm, unsigned int number, unsigned long long time){
+    double level = lm->base_levels[number];
+    if (lm->rates[number] != 0 && time > lm->base_times[number]){
+        level += (double)lm->rates[number] * (double)(time - lm->base_times[number]) / TICK_NS;
+    }
+    //уровень не переходит границу, к которой его ведет насос, даже если событие еще не обработано
+    double base = lm->base_levels[number];
+    if (lm->events[number] == EVENT_MAXIMUM && base < lm->maximum_levels[number] && level > lm->maximum_levels[number]) level = lm->maximum_levels[number];
+    if (lm->events[number] == EVENT_MINIMUM && base > lm->minimum_levels[number] && level < lm->minimum_levels[number]) level = lm->minimum_levels[number];
+    return level;
+}
+
+static void _schedule(level_model* lm, unsigned int number){
+    int tank_on = lm->states[number] == STORAGE_TANK_ON;
+    int download = tank_on && lm->download_states[number] == PUMP_ON;
+    int upload = tank_on && lm->upload_states[number] == PUMP_ON;
+    long long rate = (download ? (long long)lm->download_speeds[number] : 0) - (upload ? (long long)lm->upload_speeds[number] : 0);
+    double level = lm->base_levels[number];
+    unsigned long long base_time = lm->base_times[number];
+    lm->rates[number] = rate;
+    lm->events[number] = EVENT_NONE;
+    //насос у границы выключается сразу, как это делает поток контроля уровня резервуара
+    if (download && level >= lm->maximum_levels[number]){
+        lm->events[number] = EVENT_MAXIMUM;
+        lm->event_times[number] = base_time;
+    } else if (upload && level <= lm->minimum_levels[number]){
+        lm->events[number] = EVENT_MINIMUM;
+        lm->event_times[number] = base_time;
+    } else if (rate > 0){
+        lm->events[number] = EVENT_MAXIMUM;
+        lm->event_times[number] = base_time + (unsigned long long)ceil((lm->maximum_levels[number] - level) * TICK_NS / (double)rate);
+    } else if (rate < 0){
+        lm->events[number] = EVENT_MINIMUM;
+        lm->event_times[number] = base_time + (unsigned long long)ceil((level - lm->minimum_levels[number]) * TICK_NS / (double)-rate);
+    }
+    _set_moving(lm, number, rate != 0);
+    if (lm->events[number] == EVENT_NONE){
+        _remove(lm, number);
+    } else if (lm->positions[number] == -1){
+        _place(lm, lm->heap_size++, number);
+        _sift_up(lm, lm->heap_size - 1);
+    } else {
+        _sift_up(lm, (size_t)lm->positions[number]);
+        _sift_down(lm, (size_t)lm->positions[number]);
+    }
+}
+
+static void _sift_up(level_model* lm, size_t position){
+    unsigned int number = lm->heap[position];
+    while (position > 0){
+        size_t parent = (position - 1) / 2;
+        if (lm->event_times[lm->heap[parent]] <= lm->event_times[number]) break;
+        _place(lm, position, lm->heap[parent]);
+        position = parent;
+    }
+    _place(lm, position, number);
+}
+
+static void _sift_down(level_model* lm, size_t position){
+    unsigned int number = lm->heap[position];
+    for(;;){
+        size_t child = 2 * position + 1;
+        if (child >= lm->heap_size) break;
+        if (child + 1 < lm->heap_size && lm->event_times[lm->heap[child + 1]] < lm->event_times[lm->heap[child]]) child++;
+        if (lm->event_times[number] <= lm->event_times[lm->heap[child]]) break;
+        _place(lm, position, lm->heap[child]);
+        position = child;
+    }
+    _place(lm, position, number);
+}
+
+static void _place(level_model* lm, size_t position, unsigned int number){
+    lm->heap[position] = number;
+    lm->positions[number] = (long)position;
+}
+
+static void _remove(level_model* lm, unsigned int number){
+    long position = lm->positions[number];
+    if (position == -1) return;
+    lm->positions[number] = -1;
+    unsigned int last = lm->heap[--lm->heap_size];
+    if ((size_t)position == lm->heap_size) return;
+    _place(lm, (size_t)position, last);
+    _sift_up(lm, (size_t)position);
+    _sift_down(lm, (size_t)lm->positions[last]);
+}
+
+static void _mark_changed(level_model* lm, unsigned int number){
+    if (lm->changed_flags[number]) return;
+    lm->changed_flags[number] = 1;
+    lm->changed[lm->changed_count++] = number;
+}
+
+static void _set_moving(level_model* lm, unsigned int number, int moving){
+    long position = lm->moving_positions[number];
+    if (moving && position == -1){
+        lm->moving_positions[number] = (long)lm->moving_count;
+        lm->moving[lm->moving_count++] = number;
+    } else if (!moving && position != -1){
+        unsigned int last = lm->moving[--lm->moving_count];
+        lm->moving[position] = last;
+        lm->moving_positions[last] = position;
+        lm->moving_positions[number] = -1;
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_LEVEL_MODEL_H
+#define OIL_STORAGE_MANAGE_SYSTEM_LEVEL_MODEL_H
+
+#include "tanks_table.h"
+#include <stddef.h>
+
+/**
+ * аналитическая модель уровня в непрерывном времени
+ *
+ * для каждого резервуара хранятся уровень в момент t0, сам момент t0 и суммарная скорость насосов,
+ * текущий уровень вычисляется при чтении; состояние резервуара меняется только по событиям - командам
+ * и достижению границ уровня, момент достижения границы вычисляется точно и хранится в индексированной куче,
+ * поэтому модель не тратит время на резервуары, с которыми ничего не происходит
+ */
+struct _level_model;
+typedef struct _level_model level_model;
+
+#define LEVEL_MODEL_ENV         "OIL_STORAGE_ENGINE"    //переменная окружения с режимом расчета уровня
+#define LEVEL_MODEL_ANALYTIC    "analytic"              //значение LEVEL_MODEL_ENV: уровень считает модель, процессы резервуаров не запускаются
+
+/**
+ * статистика модели уровня
+ */
+typedef struct _level_model_stats{
+    /**
+     * количество резервуаров, уровень которых меняется
+     */
+    size_t moving_tanks;
+    /**
+     * количество ожидаемых событий достижения границ
+     */
+    size_t pending_events;
+    /**
+     * количество обработанных событий достижения границ
+     */
+    unsigned long long limit_events;
+    /**
+     * количество изменений состояния командами
+     */
+    unsigned long long updates;
+} level_model_stats;
+
+/**
+ * создать модель (уровни всех резервуаров нулевые, насосы выключены)
+ * @param tanks_count количество резервуаров
+ * @return указатель на модель
+ */
+level_model* create_level_model(size_t tanks_count);
+
+/**
+ * вернуть модель в состояние после создания (уровни и моменты отсчета нулевые, насосы выключены,
+ * событий и изменений нет) без повторного выделения памяти
+ * @param lm указатель на модель
+ */
+void reset_level_model(level_model* lm);
+
+/**
+ * задать состояние резервуара в момент времени (уровень отсчитывается от этого момента,
+ * момент достижения границы пересчитывается)
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ * @param time момент времени в нс (CLOCK_MONOTONIC)
+ * @param ts состояние резервуара
+ */
+void set_state_level_model(level_model* lm, unsigned int number, unsigned long long time, const tank_state* ts);
+
+/**
+ * получить состояние резервуара в момент времени (события до этого момента должны быть обработаны advance_level_model)
+ * @param lm указатель на модель
+ * @param number номер резервуара
+ * @param time момент времени в нс
+ * @param ts структура для состояния резервуара
+ */
+void get_state_level_model(const level_model* lm, unsigned int number, unsigned long long time, tank_state* ts);
+
+/**
+ * обработать события достижения границ до момента времени включительно: насос, доведший уровень
+ * до границы, выключается точно в момент ее достижения
+ * @param lm указатель на модель
+ * @param time момент времени в нс
+ * @return количество обработанных событий
+ */
+size_t advance_level_model(level_model* lm, unsigned long long time);
+
+/**
+ * забрать резервуары, состояние которых изменилось командой или событием с прошлого вызова
+ * @param lm указатель на модель
+ * @param numbers массив для номеров резервуаров (не меньше количества резервуаров)
+ * @return количество резервуаров (без повторов)
+ */
+size_t take_changed_level_model(level_model* lm, unsigned int* numbers);
+
+/**
+ * получить резервуары, уровень которых меняется
+ * @param lm указатель на модель
+ * @param numbers указатель на массив номеров (действителен до следующего изменения модели)
+ * @return количество резервуаров
+ */
+size_t get_moving_level_model(const level_model* lm, const unsigned int** numbers);
+
+/**
+ * получить статистику модели
+ * @param lm указатель на модель
+ * @param stats структура для статистики
+ */
+void get_stats_level_model(const level_model* lm, level_model_stats* stats);
+
+/**
+ * уничтожить модель
+ * @param lm указатель на модель
+ */
+void finalize_level_model(level_model* lm);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_LEVEL_MODEL_H
@@ -0,0 +1,260 @@
+#include "limit_forecast.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+
+#define DRIFT_TICKS 10  //отклонение уровня от прогноза (в изменениях за такт), после которого прогноз пересчитывается
+
+/**
+ * прогноз достижения границ
+ */
+struct _limit_forecast{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * изменения уровня за такт, по которым построены прогнозы
+     */
+    long long* rates;
+    /**
+     * минимальные уровни, по которым построены прогнозы
+     */
+    unsigned int* minimum_levels;
+    /**
+     * максимальные уровни, по которым построены прогнозы
+     */
+    unsigned int* maximum_levels;
+    /**
+     * уровни в момент построения прогнозов
+     */
+    unsigned int* anchor_levels;
+    /**
+     * такты построения прогнозов
+     */
+    unsigned long long* anchor_ticks;
+    /**
+     * ожидаемые границы (LIMIT_FORECAST_NONE, LIMIT_FORECAST_MAX, LIMIT_FORECAST_MIN)
+     */
+    unsigned char* limits;
+    /**
+     * такты достижения границ
+     */
+    unsigned long long* deadlines;
+    /**
+     * куча номеров резервуаров с прогнозом, упорядоченная по такту достижения границы
+     */
+    unsigned int* heap;
+    /**
+     * количество резервуаров в куче
+     */
+    size_t heap_size;
+    /**
+     * позиции резервуаров в куче (-1 - резервуара в куче нет)
+     */
+    long* positions;
+};
+
+/**
+ * поднять элемент кучи к корню, пока он раньше родителя
+ * @param lf указатель на прогноз
+ * @param position позиция элемента
+ */
+static void _sift_up(limit_forecast* lf, size_t position);
+
+/**
+ * опустить элемент кучи к листьям, пока он позже детей
+ * @param lf указатель на прогноз
+ * @param position позиция элемента
+ */
+static void _sift_down(limit_forecast* lf, size_t position);
+
+/**
+ * поместить резервуар в позицию кучи
+ * @param lf указатель на прогноз
+ * @param position позиция
+ * @param number номер резервуара
+ */
+static void _place(limit_forecast* lf, size_t position, unsigned int number);
+
+/**
+ * удалить резервуар из кучи
+ * @param lf указатель на прогноз
+ * @param number номер резервуара
+ */
+static void _remove(limit_forecast* lf, unsigned int number);
+
+/**
+ * уровень резервуара по прогнозу
+ * @param lf указатель на прогноз
+ * @param number номер резервуара
+ * @param tick такт
+ * @return уровень
+ */
+static long long _predicted_level(const limit_forecast* lf, unsigned int number, unsigned long long tick);
+
+limit_forecast* create_limit_forecast(size_t tanks_count){
+    limit_forecast* lf = malloc(sizeof(limit_forecast));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    lf->tanks_count = tanks_count;
+    lf->rates = calloc(count, sizeof(long long));
+    lf->minimum_levels = calloc(count, sizeof(unsigned int));
+    lf->maximum_levels = calloc(count, sizeof(unsigned int));
+    lf->anchor_levels = calloc(count, sizeof(unsigned int));
+    lf->anchor_ticks = calloc(count, sizeof(unsigned long long));
+    lf->limits = calloc(count, sizeof(unsigned char));
+    lf->deadlines = calloc(count, sizeof(unsigned long long));
+    lf->heap = malloc(sizeof(unsigned int) * count);
+    lf->heap_size = 0;
+    lf->positions = malloc(sizeof(long) * count);
+    for(size_t i = 0; i < tanks_count; ++i){
+        lf->positions[i] = -1;
+    }
+    return lf;
+}
+
+int update_limit_forecast(limit_forecast* lf, unsigned int number, unsigned long long tick,
+                          unsigned int level, unsigned int minimum_level, unsigned int maximum_level, long long rate){
+    if (rate == lf->rates[number] && minimum_level == lf->minimum_levels[number] && maximum_level == lf->maximum_levels[number]){
+        if (rate == 0) return 0;
+        long long drift = _predicted_level(lf, number, tick) - (long long)level;
+        long long tolerance = (rate > 0 ? rate : -rate) * DRIFT_TICKS;
+        if (drift <= tolerance && drift >= -tolerance) return 0;
+    }
+    lf->rates[number] = rate;
+    lf->minimum_levels[number] = minimum_level;
+    lf->maximum_levels[number] = maximum_level;
+    lf->anchor_levels[number] = level;
+    lf->anchor_ticks[number] = tick;
+    if (rate == 0){
+        lf->limits[number] = LIMIT_FORECAST_NONE;
+        _remove(lf, number);
+        return 1;
+    }
+    unsigned long long ticks = 0;
+    if (rate > 0){
+        lf->limits[number] = LIMIT_FORECAST_MAX;
+        if (level < maximum_level) ticks = ((unsigned long long)(maximum_level - level) + (unsigned long long)rate - 1) / (unsigned long long)rate;
+    } else {
+        lf->limits[number] = LIMIT_FORECAST_MIN;
+        if (level > minimum_level) ticks = ((unsigned long long)(level - minimum_level) + (unsigned long long)-rate - 1) / (unsigned long long)-rate;
+    }
+    lf->deadlines[number] = tick + ticks;
+    if (lf->positions[number] == -1){
+        _place(lf, lf->heap_size++, number);
+        _sift_up(lf, lf->heap_size - 1);
+    } else {
+        _sift_up(lf, (size_t)lf->positions[number]);
+        _sift_down(lf, (size_t)lf->positions[number]);
+    }
+    return 1;
+}
+
+void get_limit_forecast(const limit_forecast* lf, unsigned int number, unsigned long long tick,
+                        unsigned long long* time_to_max, unsigned long long* time_to_min){
+    *time_to_max = LIMIT_FORECAST_NEVER;
+    *time_to_min = LIMIT_FORECAST_NEVER;
+    if (lf->limits[number] == LIMIT_FORECAST_NONE) return;
+    unsigned long long deadline = lf->deadlines[number];
+    unsigned long long time = deadline > tick ? (deadline - tick) * TIME_UNIT : 0;
+    if (lf->limits[number] == LIMIT_FORECAST_MAX) *time_to_max = time;
+    else *time_to_min = time;
+}
+
+size_t get_next_limit_forecast(const limit_forecast* lf, unsigned long long tick, limit_eta* etas, size_t count){
+    if (count == 0 || lf->heap_size == 0) return 0;
+    //обход кучи в порядке возрастания: вспомогательная куча позиций, в которую добавляются дети извлеченного элемента
+    size_t* candidates = malloc(sizeof(size_t) * (2 * count + 1));
+    size_t candidates_count = 1, found = 0;
+    candidates[0] = 0;
+    while (found < count && candidates_count > 0){
+        size_t position = candidates[0];
+        candidates[0] = candidates[--candidates_count];
+        for(size_t i = 0; 2 * i + 1 < candidates_count; ){
+            size_t child = 2 * i + 1;
+            if (child + 1 < candidates_count && lf->deadlines[lf->heap[candidates[child + 1]]] < lf->deadlines[lf->heap[candidates[child]]]) child++;
+            if (lf->deadlines[lf->heap[candidates[i]]] <= lf->deadlines[lf->heap[candidates[child]]]) break;
+            size_t swap = candidates[i];
+            candidates[i] = candidates[child];
+            candidates[child] = swap;
+            i = child;
+        }
+        unsigned int number = lf->heap[position];
+        unsigned long long deadline = lf->deadlines[number];
+        etas[found].number = number;
+        etas[found].limit = lf->limits[number];
+        etas[found].time = deadline > tick ? (deadline - tick) * TIME_UNIT : 0;
+        found++;
+        for(size_t child = 2 * position + 1; child <= 2 * position + 2 && child < lf->heap_size; ++child){
+            size_t i = candidates_count++;
+            candidates[i] = child;
+            while (i > 0 && lf->deadlines[lf->heap[candidates[(i - 1) / 2]]] > lf->deadlines[lf->heap[candidates[i]]]){
+                size_t swap = candidates[i];
+                candidates[i] = candidates[(i - 1) / 2];
+                candidates[(i - 1) / 2] = swap;
+                i = (i - 1) / 2;
+            }
+        }
+    }
+    free(candidates);
+    return found;
+}
+
+void finalize_limit_forecast(limit_forecast* lf){
+    free(lf->rates);
+    free(lf->minimum_levels);
+    free(lf->maximum_levels);
+    free(lf->anchor_levels);
+    free(lf->anchor_ticks);
+    free(lf->limits);
+    free(lf->deadlines);
+    free(lf->heap);
+    free(lf->positions);
+    free(lf);
+}
+
+static void _sift_up(limit_forecast* lf, size_t position){
+    unsigned int number = lf->heap[position];
+    while (position > 0){
+        size_t parent = (position - 1) / 2;
+        if (lf->deadlines[lf->heap[parent]] <= lf->deadlines[number]) break;
+        _place(lf, position, lf->heap[parent]);
+        position = parent;
+    }
+    _place(lf, position, number);
+}
+
+static void _sift_down(limit_forecast* lf, size_t position){
+    unsigned int number = lf->heap[position];
+    for(;;){
+        size_t child = 2 * position + 1;
+        if (child >= lf->heap_size) break;
+        if (child + 1 < lf->heap_size && lf->deadlines[lf->heap[child + 1]] < lf->deadlines[lf->heap[child]]) child++;
+        if (lf->deadlines[number] <= lf->deadlines[lf->heap[child]]) break;
+        _place(lf, position, lf->heap[child]);
+        position = child;
+    }
+    _place(lf, position, number);
+}
+
+static void _place(limit_forecast* lf, size_t position, unsigned int number){
+    lf->heap[position] = number;
+    lf->positions[number] = (long)position;
+}
+
+static void _remove(limit_forecast* lf, unsigned int number){
+    long position = lf->positions[number];
+    if (position == -1) return;
+    lf->positions[number] = -1;
+    unsigned int last = lf->heap[--lf->heap_size];
+    if ((size_t)position == lf->heap_size) return;
+    _place(lf, (size_t)position, last);
+    _sift_up(lf, (size_t)position);
+    _sift_down(lf, (size_t)lf->positions[last]);
+}
+
+static long long _predicted_level(const limit_forecast* lf, unsigned int number, unsigned long long tick){
+    long long level = (long long)lf->anchor_levels[number] + lf->rates[number] * (long long)(tick - lf->anchor_ticks[number]);
+    if (lf->limits[number] == LIMIT_FORECAST_MAX && level > (long long)lf->maximum_levels[number]) level = lf->maximum_levels[number];
+    if (lf->limits[number] == LIMIT_FORECAST_MIN && level < (long long)lf->minimum_levels[number]) level = lf->minimum_levels[number];
+    return level;
+}
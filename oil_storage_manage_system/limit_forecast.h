@@ -0,0 +1,88 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_LIMIT_FORECAST_H
+#define OIL_STORAGE_MANAGE_SYSTEM_LIMIT_FORECAST_H
+
+#include <stddef.h>
+
+/**
+ * прогноз достижения резервуарами максимального и минимального уровня
+ *
+ * для каждого резервуара хранится такт, в который уровень достигнет границы при текущей скорости изменения;
+ * такт пересчитывается только при изменении скорости, границ или заметном отклонении уровня от прогноза,
+ * резервуары с прогнозом упорядочены по такту в индексированной куче
+ */
+struct _limit_forecast;
+typedef struct _limit_forecast limit_forecast;
+
+#define LIMIT_FORECAST_NONE     0                   //уровень не меняется, граница не будет достигнута
+#define LIMIT_FORECAST_MAX      1                   //уровень растет до максимального
+#define LIMIT_FORECAST_MIN      2                   //уровень падает до минимального
+#define LIMIT_FORECAST_NEVER    ((unsigned long long)-1) //время до границы, которая не будет достигнута
+
+/**
+ * ожидаемое достижение границы резервуаром
+ */
+typedef struct _limit_eta{
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+    /**
+     * граница (LIMIT_FORECAST_MAX, LIMIT_FORECAST_MIN)
+     */
+    int limit;
+    /**
+     * время до достижения границы в мс
+     */
+    unsigned long long time;
+} limit_eta;
+
+/**
+ * создать прогноз (у всех резервуаров прогноза нет)
+ * @param tanks_count количество резервуаров
+ * @return указатель на прогноз
+ */
+limit_forecast* create_limit_forecast(size_t tanks_count);
+
+/**
+ * обновить прогноз резервуара по его текущему состоянию (пересчитывается, только если скорость или границы изменились
+ * или уровень отклонился от прогноза)
+ * @param lf указатель на прогноз
+ * @param number номер резервуара
+ * @param tick текущий такт
+ * @param level уровень
+ * @param minimum_level минимальный уровень
+ * @param maximum_level максимальный уровень
+ * @param rate изменение уровня за такт
+ * @return 1 - прогноз пересчитан, 0 - прогноз не изменился
+ */
+int update_limit_forecast(limit_forecast* lf, unsigned int number, unsigned long long tick,
+                          unsigned int level, unsigned int minimum_level, unsigned int maximum_level, long long rate);
+
+/**
+ * получить время до достижения границ резервуаром
+ * @param lf указатель на прогноз
+ * @param number номер резервуара
+ * @param tick текущий такт
+ * @param time_to_max время до максимального уровня в мс (LIMIT_FORECAST_NEVER - уровень не растет)
+ * @param time_to_min время до минимального уровня в мс (LIMIT_FORECAST_NEVER - уровень не падает)
+ */
+void get_limit_forecast(const limit_forecast* lf, unsigned int number, unsigned long long tick,
+                        unsigned long long* time_to_max, unsigned long long* time_to_min);
+
+/**
+ * получить резервуары, которые раньше всех достигнут границы (O(count * log count), не зависит от числа резервуаров)
+ * @param lf указатель на прогноз
+ * @param tick текущий такт
+ * @param etas массив для ожидаемых достижений (по возрастанию времени)
+ * @param count максимальное количество резервуаров
+ * @return количество резервуаров в массиве
+ */
+size_t get_next_limit_forecast(const limit_forecast* lf, unsigned long long tick, limit_eta* etas, size_t count);
+
+/**
+ * уничтожить прогноз
+ * @param lf указатель на прогноз
+ */
+void finalize_limit_forecast(limit_forecast* lf);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_LIMIT_FORECAST_H
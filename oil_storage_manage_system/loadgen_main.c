@@ -0,0 +1,368 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "oil_storage.h"
+
+#define LOADGEN_MIN_LEVEL       1000    //минимальный уровень резервуаров нагрузочного теста
+#define LOADGEN_MAX_LEVEL       25000   //максимальный уровень резервуаров нагрузочного теста
+#define LOADGEN_MAX_SPEED       10      //максимальная скорость насосов
+#define LOADGEN_MAX_THREADS     256     //максимальное количество потоков нагрузки
+#define LOADGEN_LATE_THRESHOLD  1000    //опоздание отправки команды в мкс, после которого команда считается отправленной с опозданием
+#define HISTOGRAM_SUB_BITS      5       //точность гистограммы: 2^5 интервалов на каждую степень двойки (погрешность ~3%)
+#define HISTOGRAM_SIZE          (64 << HISTOGRAM_SUB_BITS)
+
+/**
+ * параметры нагрузочного теста
+ */
+typedef struct _loadgen_options{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * целевая частота команд (команд в секунду на все потоки)
+     */
+    double rate;
+    /**
+     * количество потоков нагрузки
+     */
+    unsigned int threads_count;
+    /**
+     * длительность теста в секундах
+     */
+    double duration;
+    /**
+     * доли запросов состояния, изменений уставок и переключений насосов в процентах
+     */
+    unsigned int queries_percent;
+    unsigned int setpoints_percent;
+    unsigned int toggles_percent;
+} loadgen_options;
+
+/**
+ * гистограмма задержек в микросекундах (логарифмические интервалы с линейным делением внутри)
+ */
+typedef struct _latency_histogram{
+    unsigned long long counts[HISTOGRAM_SIZE];
+    unsigned long long total;
+    unsigned long long max;
+} latency_histogram;
+
+/**
+ * состояние потока нагрузки
+ */
+typedef struct _loadgen_thread{
+    /**
+     * хранилище, на которое подается нагрузка
+     */
+    oil_storage* os;
+    /**
+     * параметры теста
+     */
+    const loadgen_options* options;
+    /**
+     * номер потока
+     */
+    unsigned int index;
+    /**
+     * время начала теста в нс
+     */
+    long long start;
+    /**
+     * задержки от фактической отправки команды до ответа (время обслуживания)
+     */
+    latency_histogram service;
+    /**
+     * задержки от запланированного момента отправки до ответа (с поправкой на coordinated omission)
+     */
+    latency_histogram corrected;
+    /**
+     * количество выполненных команд
+     */
+    unsigned long long completed;
+    /**
+     * количество команд, завершившихся ошибкой
+     */
+    unsigned long long errors;
+    /**
+     * количество команд, отправленных позже запланированного момента
+     */
+    unsigned long long late;
+    /**
+     * количество запланированных команд, которые не успели отправить до конца теста
+     */
+    unsigned long long missed;
+} loadgen_thread;
+
+/**
+ * разобрать параметры командной строки
+ * @param argc количество аргументов
+ * @param argv аргументы
+ * @param options параметры теста
+ * @return 0 - параметры разобраны, -1 - ошибка
+ */
+static int _parse_options(int argc, char* argv[], loadgen_options* options);
+
+/**
+ * функция потока нагрузки: отправляет команды по расписанию, не подстраиваясь под отстающие ответы
+ * (момент отправки очередной команды не зависит от времени ответа на предыдущую;
+ * тест заканчивается по времени, даже если поток не успел отправить все запланированные команды)
+ * @param thread_ptr указатель на состояние потока
+ * @return NULL
+ */
+static void* _loadgen_work(void* thread_ptr);
+
+/**
+ * выполнить случайную команду в соответствии с заданной смесью
+ * @param os указатель на нефтехранилище
+ * @param options параметры теста
+ * @param seed состояние генератора случайных чисел потока
+ * @return 0 - команда выполнена, иначе код ошибки
+ */
+static int _execute_random_command(oil_storage* os, const loadgen_options* options, unsigned int* seed);
+
+/**
+ * получить текущее время в нс
+ * @return время в нс
+ */
+static long long _get_time_ns(void);
+
+/**
+ * добавить значение в гистограмму
+ * @param h указатель на гистограмму
+ * @param value значение в мкс
+ */
+static void _record_histogram(latency_histogram* h, unsigned long long value);
+
+/**
+ * добавить одну гистограмму к другой
+ * @param to гистограмма, к которой добавляются значения
+ * @param from добавляемая гистограмма
+ */
+static void _merge_histogram(latency_histogram* to, const latency_histogram* from);
+
+/**
+ * получить значение перцентиля
+ * @param h указатель на гистограмму
+ * @param percentile перцентиль (0..100)
+ * @return верхняя граница интервала, содержащего перцентиль, в мкс
+ */
+static unsigned long long _get_percentile_histogram(const latency_histogram* h, double percentile);
+
+/**
+ * вывести перцентили гистограммы одной строкой
+ * @param name название строки
+ * @param h указатель на гистограмму
+ */
+static void _print_histogram(const char* name, const latency_histogram* h);
+
+int main(int argc, char* argv[]) {
+    loadgen_options options;
+    if (_parse_options(argc, argv, &options) == -1){
+        fprintf(stderr, "использование: %s [--tanks N] [--rate команд/с] [--threads N] [--duration с] [--mix запросы,уставки,насосы]\n", argv[0]);
+        return 1;
+    }
+    srand((unsigned int)time(0));
+    tank_config* tanks = malloc(sizeof(tank_config) * options.tanks_count);
+    for(size_t i = 0; i < options.tanks_count; ++i){
+        tanks[i].minimum_level = LOADGEN_MIN_LEVEL;
+        tanks[i].maximum_level = LOADGEN_MAX_LEVEL;
+        tanks[i].current_level = (LOADGEN_MIN_LEVEL + LOADGEN_MAX_LEVEL) / 2;
+        tanks[i].download_speed = (unsigned int)(rand()%LOADGEN_MAX_SPEED + 1);
+        tanks[i].upload_speed = (unsigned int)(rand()%LOADGEN_MAX_SPEED + 1);
+        tanks[i].flags = FLEET_CONFIG_TANK_ON;
+    }
+    oil_storage* os = create_oil_storage_from_config(tanks, options.tanks_count);
+    free(tanks);
+    printf("резервуаров %zu, запуск %.1f мс; цель %.0f команд/с, потоков %u, %.1f с, смесь %u/%u/%u\n",
+           options.tanks_count, get_startup_time_oil_storage(os) / 1000.0, options.rate, options.threads_count,
+           options.duration, options.queries_percent, options.setpoints_percent, options.toggles_percent);
+    loadgen_thread* threads = calloc(options.threads_count, sizeof(loadgen_thread));
+    pthread_t* thread_ids = malloc(sizeof(pthread_t) * options.threads_count);
+    long long start = _get_time_ns();
+    for(unsigned int t = 0; t < options.threads_count; ++t){
+        threads[t].os = os;
+        threads[t].options = &options;
+        threads[t].index = t;
+        threads[t].start = start;
+        pthread_create(&thread_ids[t], NULL, _loadgen_work, &threads[t]);
+    }
+    latency_histogram* service = calloc(1, sizeof(latency_histogram));
+    latency_histogram* corrected = calloc(1, sizeof(latency_histogram));
+    unsigned long long completed = 0, errors = 0, late = 0, missed = 0;
+    for(unsigned int t = 0; t < options.threads_count; ++t){
+        pthread_join(thread_ids[t], NULL);
+        _merge_histogram(service, &threads[t].service);
+        _merge_histogram(corrected, &threads[t].corrected);
+        completed += threads[t].completed;
+        errors += threads[t].errors;
+        late += threads[t].late;
+        missed += threads[t].missed;
+    }
+    double elapsed = (_get_time_ns() - start) / 1e9;
+    watchdog_stats ws;
+    get_watchdog_stats(os, &ws);
+    printf("выполнено %llu команд за %.2f с: %.0f команд/с (%.1f%% от цели), ошибок %llu, с опозданием %llu, не отправлено %llu\n",
+           completed, elapsed, completed / elapsed, completed / elapsed * 100.0 / options.rate, errors, late, missed);
+    printf("задержки, мкс       p50      p90      p99    p99.9   p99.99      max\n");
+    _print_histogram("обслуживание ", service);
+    _print_histogram("с поправкой  ", corrected);
+    printf("работают %zu резервуаров, перезапусков %llu, отказов %llu\n",
+           get_active_tanks_count(os), ws.restarts, ws.failures);
+    free(service);
+    free(corrected);
+    free(thread_ids);
+    free(threads);
+    finalize_oil_storage(os);
+    return 0;
+}
+
+static int _parse_options(int argc, char* argv[], loadgen_options* options){
+    options->tanks_count = 100;
+    options->rate = 10000;
+    options->threads_count = 4;
+    options->duration = 5;
+    options->queries_percent = 80;
+    options->setpoints_percent = 10;
+    options->toggles_percent = 10;
+    for(int i = 1; i < argc; ++i){
+        if (i + 1 >= argc) return -1;
+        const char* value = argv[++i];
+        char* end;
+        if (strcmp(argv[i - 1], "--tanks") == 0){
+            options->tanks_count = (size_t)strtoul(value, &end, 10);
+        } else if (strcmp(argv[i - 1], "--rate") == 0){
+            options->rate = strtod(value, &end);
+        } else if (strcmp(argv[i - 1], "--threads") == 0){
+            options->threads_count = (unsigned int)strtoul(value, &end, 10);
+        } else if (strcmp(argv[i - 1], "--duration") == 0){
+            options->duration = strtod(value, &end);
+        } else if (strcmp(argv[i - 1], "--mix") == 0){
+            unsigned int q, s, p;
+            if (sscanf(value, "%u,%u,%u", &q, &s, &p) != 3 || q + s + p != 100) return -1;
+            options->queries_percent = q;
+            options->setpoints_percent = s;
+            options->toggles_percent = p;
+            continue;
+        } else {
+            return -1;
+        }
+        if (*end != '\0') return -1;
+    }
+    if (options->tanks_count == 0 || options->rate <= 0 || options->duration <= 0
+        || options->threads_count == 0 || options->threads_count > LOADGEN_MAX_THREADS) return -1;
+    return 0;
+}
+
+static void* _loadgen_work(void* thread_ptr){
+    loadgen_thread* lt = thread_ptr;
+    const loadgen_options* options = lt->options;
+    unsigned int seed = (unsigned int)time(0) ^ (lt->index * 2654435761u);
+    double interval = 1e9 * options->threads_count / options->rate;
+    long long first = lt->start + (long long)(interval * lt->index / options->threads_count);
+    long long finish = lt->start + (long long)(options->duration * 1e9);
+    for(unsigned long long k = 0; ; ++k){
+        long long intended = first + (long long)(interval * k);
+        if (intended >= finish) break;
+        long long now = _get_time_ns();
+        if (now >= finish){
+            lt->missed = (unsigned long long)((finish - first) / interval) + 1 - k;
+            break;
+        }
+        if (now < intended){
+            struct timespec ts = {intended / 1000000000, intended % 1000000000};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0);
+            now = _get_time_ns();
+        } else if (now - intended > LOADGEN_LATE_THRESHOLD * 1000ll){
+            lt->late++;
+        }
+        if (_execute_random_command(lt->os, options, &seed) != TANK_OK) lt->errors++;
+        long long done = _get_time_ns();
+        _record_histogram(&lt->service, (unsigned long long)(done - now) / 1000);
+        _record_histogram(&lt->corrected, (unsigned long long)(done - intended) / 1000);
+        lt->completed++;
+    }
+    return NULL;
+}
+
+static int _execute_random_command(oil_storage* os, const loadgen_options* options, unsigned int* seed){
+    unsigned int number = (unsigned int)(rand_r(seed) % options->tanks_count);
+    unsigned int kind = (unsigned int)(rand_r(seed) % 100);
+    unsigned int variant = (unsigned int)rand_r(seed);
+    if (kind < options->queries_percent){
+        switch (variant % 4){
+            case 0:  get_current_level_tank(os, number); break;
+            case 1:  get_state_tank(os, number); break;
+            case 2:  get_state_download_pump(os, number); break;
+            default: get_maximum_level_tank(os, number); break;
+        }
+        return TANK_OK;
+    }
+    if (kind < options->queries_percent + options->setpoints_percent){
+        unsigned int delta = (variant >> 2) % (LOADGEN_MAX_LEVEL / 10);
+        switch (variant % 4){
+            case 0:  return set_maximum_level_tank(os, number, LOADGEN_MAX_LEVEL - delta);
+            case 1:  return set_minimum_level_tank(os, number, LOADGEN_MIN_LEVEL + delta / 10);
+            case 2:  return set_speed_download_pump(os, number, delta % LOADGEN_MAX_SPEED + 1);
+            default: return set_speed_upload_pump(os, number, delta % LOADGEN_MAX_SPEED + 1);
+        }
+    }
+    switch (variant % 4){
+        case 0:  return turn_on_download_pump(os, number);
+        case 1:  return turn_off_download_pump(os, number);
+        case 2:  return turn_on_upload_pump(os, number);
+        default: return turn_off_upload_pump(os, number);
+    }
+}
+
+static long long _get_time_ns(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void _record_histogram(latency_histogram* h, unsigned long long value){
+    unsigned int exponent = 0;
+    if (value >= (1ull << (HISTOGRAM_SUB_BITS + 1))){
+        exponent = (unsigned int)(63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BITS;
+    }
+    size_t index = ((size_t)exponent << HISTOGRAM_SUB_BITS) + (size_t)(value >> exponent);
+    if (index >= HISTOGRAM_SIZE) index = HISTOGRAM_SIZE - 1;
+    h->counts[index]++;
+    h->total++;
+    if (value > h->max) h->max = value;
+}
+
+static void _merge_histogram(latency_histogram* to, const latency_histogram* from){
+    for(size_t i = 0; i < HISTOGRAM_SIZE; ++i){
+        to->counts[i] += from->counts[i];
+    }
+    to->total += from->total;
+    if (from->max > to->max) to->max = from->max;
+}
+
+static unsigned long long _get_percentile_histogram(const latency_histogram* h, double percentile){
+    if (h->total == 0) return 0;
+    unsigned long long rank = (unsigned long long)(percentile / 100.0 * h->total + 0.5);
+    if (rank == 0) rank = 1;
+    unsigned long long seen = 0;
+    for(size_t i = 0; i < HISTOGRAM_SIZE; ++i){
+        seen += h->counts[i];
+        if (seen >= rank){
+            unsigned int exponent = i < (2u << HISTOGRAM_SUB_BITS) ? 0 : (unsigned int)(i >> HISTOGRAM_SUB_BITS) - 1;
+            unsigned long long mantissa = i - ((size_t)exponent << HISTOGRAM_SUB_BITS);
+            unsigned long long upper = ((mantissa + 1) << exponent) - 1;
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+static void _print_histogram(const char* name, const latency_histogram* h){
+    printf("%s %8llu %8llu %8llu %8llu %8llu %8llu\n", name,
+           _get_percentile_histogram(h, 50), _get_percentile_histogram(h, 90), _get_percentile_histogram(h, 99),
+           _get_percentile_histogram(h, 99.9), _get_percentile_histogram(h, 99.99), h->max);
+}
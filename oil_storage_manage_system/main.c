@@ -1,26 +1,112 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "oil_storage.h"
 #include "oil_storage_interface.h"
+#include "depot_protocol.h"
+#include "depot_server.h"
 
 #define MIN_LEVEL_STORAGE_DEFAULT 1000
 #define MAX_LEVEL_STORAGE_DEFAULT 25000
 #define MAX_SPEED 10
 
+/**
+ * загрузить конфигурацию парка резервуаров и сообщить об ошибке
+ * @param path путь к файлу конфигурации
+ * @return указатель на конфигурацию, NULL - ошибка
+ */
+static fleet_config* _load_config(const char* path);
+
+/**
+ * работать без интерфейса до сигнала завершения (депо, управляемое координатором)
+ */
+static void _wait_termination();
+
 int main(int argc, char* argv[]) {
+    if (argc > 3 && strcmp(argv[1], "--compile") == 0){
+        fleet_config* fc = _load_config(argv[2]);
+        if (fc == NULL) return 1;
+        int result = save_binary_fleet_config(fc, argv[3]);
+        if (result == 0) printf("%s: %zu резервуаров\n", argv[3], get_count_fleet_config(fc));
+        else fprintf(stderr, "%s: ошибка записи\n", argv[3]);
+        finalize_fleet_config(fc);
+        return result == 0 ? 0 : 1;
+    }
     srand((unsigned int)time(0));
+    //без терминала сигналы завершения блокируются до создания потоков нефтехранилища, чтобы их принял _wait_termination
+    int headless = !isatty(STDIN_FILENO);
+    if (headless){
+        sigset_t termination;
+        sigemptyset(&termination);
+        sigaddset(&termination, SIGINT);
+        sigaddset(&termination, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &termination, NULL);
+    }
     size_t cnt_tanks = 5;
+    char* end = NULL;
     if (argc > 1){
-        cnt_tanks = (size_t)strtol(argv[1], NULL, 10);
+        cnt_tanks = (size_t)strtol(argv[1], &end, 10);
+    }
+    oil_storage* os;
+    if (end != NULL && *end != '\0'){
+        fleet_config* fc = _load_config(argv[1]);
+        if (fc == NULL) return 1;
+        os = create_oil_storage_from_config(get_tanks_fleet_config(fc), get_count_fleet_config(fc));
+        finalize_fleet_config(fc);
+    } else {
+        tank_config* tanks = malloc(sizeof(tank_config) * cnt_tanks);
+        for(unsigned int i = 0; i < cnt_tanks; ++i){
+            tanks[i].minimum_level = MIN_LEVEL_STORAGE_DEFAULT;
+            tanks[i].maximum_level = MAX_LEVEL_STORAGE_DEFAULT;
+            tanks[i].current_level = MIN_LEVEL_STORAGE_DEFAULT;
+            tanks[i].download_speed = (unsigned int)(rand()%MAX_SPEED + 1);
+            tanks[i].upload_speed = (unsigned int)(rand()%MAX_SPEED + 1);
+            tanks[i].flags = FLEET_CONFIG_DOWNLOAD_PUMP;
+        }
+        os = create_oil_storage_from_config(tanks, cnt_tanks);
+        free(tanks);
     }
-    oil_storage* os = create_oil_storage(cnt_tanks, MIN_LEVEL_STORAGE_DEFAULT, MAX_LEVEL_STORAGE_DEFAULT, 0, 0);
-    for(unsigned int i = 0; i < cnt_tanks; ++i){
-        turn_on_download_pump(os, i);
-        set_speed_download_pump(os, i, (unsigned int)(rand()%MAX_SPEED + 1));
-        set_speed_upload_pump(os, i, (unsigned int)(rand()%MAX_SPEED + 1));
+    if (argc > 2){
+        size_t error_line;
+        if (load_strapping_tables(os, argv[2], &error_line) == -1){
+            if (error_line > 0) fprintf(stderr, "%s:%zu: ошибка в градуировочной таблице\n", argv[2], error_line);
+            else fprintf(stderr, "%s: не удалось прочитать градуировочные таблицы\n", argv[2]);
+            finalize_oil_storage(os);
+            return 1;
+        }
     }
-    start_oil_storage_interface(os);
+    depot_server* ds = NULL;
+    const char* socket_path = getenv(DEPOT_SOCKET_ENV);
+    if (socket_path != NULL && socket_path[0] != '\0'){
+        ds = create_depot_server(os, socket_path);
+        if (ds == NULL) fprintf(stderr, "%s: не удалось создать сокет депо\n", socket_path);
+    }
+    if (headless) _wait_termination();
+    else start_oil_storage_interface(os);
+    if (ds != NULL) finalize_depot_server(ds);
     finalize_oil_storage(os);
     return 0;
-}
\ No newline at end of file
+}
+
+static void _wait_termination(){
+    sigset_t termination;
+    sigemptyset(&termination);
+    sigaddset(&termination, SIGINT);
+    sigaddset(&termination, SIGTERM);
+    int signal_number;
+    sigwait(&termination, &signal_number);
+}
+
+static fleet_config* _load_config(const char* path){
+    size_t error_line;
+    fleet_config* fc = load_fleet_config(path, &error_line);
+    if (fc == NULL){
+        if (error_line > 0) fprintf(stderr, "%s:%zu: ошибка в описании резервуара\n", path, error_line);
+        else fprintf(stderr, "%s: не удалось прочитать конфигурацию\n", path);
+    }
+    return fc;
+}
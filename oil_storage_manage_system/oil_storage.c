@@ -1,349 +1,2323 @@
+#define _GNU_SOURCE
 #include "oil_storage.h"
-#include "storage_tank.h"
+#include "tanks_table.h"
+#include "tank_worker.h"
+#include "transfer_network.h"
+#include "timer_wheel.h"
+#include "strapping_table.h"
+#include "volume_correction.h"
+#include "limit_forecast.h"
+#include "inbound_dispatcher.h"
+#include "command_executor.h"
+#include "level_model.h"
+#include "trace.h"
 #include <stdlib.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <wait.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <time.h>
+#include <string.h>
 
-#ifndef __OPERATION_NUMBER
-    #define __OPERATION_NUMBER
-    #define CREATE_STORAGE_TANK     0
-    #define TURN_ON_STORAGE_TANK    1
-    #define TURN_OFF_STORAGE_TANK   2
-    #define GET_STATE_TANK          3
-    #define SET_MINIMUM_LEVEL_TANK  4
-    #define GET_MINIMUM_LEVEL_TANK  5
-    #define SET_MAXIMUM_LEVEL_TANK  6
-    #define GET_MAXIMUM_LEVEL_TANK  7
-    #define GET_CURRENT_LEVEL_TANK  8
-    #define TURN_ON_DOWNLOAD_PUMP   9
-    #define TURN_OFF_DOWNLOAD_PUMP  10
-    #define GET_STATE_DOWNLOAD_PUMP 11
-    #define SET_SPEED_DOWNLOAD_PUMP 12
-    #define GET_SPEED_DOWNLOAD_PUMP 13
-    #define TURN_ON_UPLOAD_PUMP     14
-    #define TURN_OFF_UPLOAD_PUMP    15
-    #define GET_STATE_UPLOAD_PUMP   16
-    #define SET_SPEED_UPLOAD_PUMP   17
-    #define GET_SPEED_UPLOAD_PUMP   18
-    #define FINALIZE_STORAGE_TANK   -1
-#endif
-
-/**
- * создать процессы для каждого резевуара
+#define MAX_SPAWN_THREADS 16        //максимальное количество потоков, параллельно запускающих процессы резервуаров
+#define TANKS_PER_SPAWN_THREAD 64   //минимальное количество резервуаров на один поток запуска
+#define TRANSFER_RATE_TICKS 2       //количество тактов, в течение которых изменение уровня от перекачки учитывается в прогнозе
+#define COMMAND_EXECUTOR_THREADS 4  //количество потоков, выполняющих команды диспетчера приема и отложенные команды
+#define SCHEDULED_BATCH_SIZE 256   //количество отложенных команд, выбираемых из расписания за один раз
+#define SCHEDULED_BATCHES_PER_TICK 4    //наибольшее количество выборок отложенных команд за такт (остальные ждут следующих тактов)
+#define SNAPSHOT_ON_READ 0          //снимок модели обновляется, если он снят раньше последнего такта модели
+#define SNAPSHOT_ON_EXPORT 1        //снимок модели обновляется, только если идет выгрузка (ей нужна строка каждый такт)
+#define SNAPSHOT_FULL 2             //в снимке модели пересчитываются все резервуары
+
+extern char** environ;
+
+/**
+ * признак завершения дочернего процесса (устанавливается обработчиком SIGCHLD)
+ */
+static volatile sig_atomic_t _child_exited = 0;
+
+/**
+ * состояние сторожа процессов резервуаров
+ */
+typedef struct _watchdog{
+    /**
+     * мьютекс для доступа к статистике из разных потоков
+     */
+    pthread_mutex_t mutex;
+    /**
+     * статистика перезапусков
+     */
+    watchdog_stats stats;
+    /**
+     * статистика аварийных остановок
+     */
+    emergency_stats emergency;
+} watchdog;
+
+/**
+ * уровни и объемы всех резервуаров, снятые в один такт
+ */
+typedef struct _volume_snapshot{
+    /**
+     * мьютекс снимка, градуировочных таблиц и коэффициентов приведения
+     */
+    pthread_mutex_t mutex;
+    /**
+     * уровни нефтепродуктов
+     */
+    unsigned int* levels;
+    /**
+     * объемы по градуировочным таблицам
+     */
+    float* volumes;
+    /**
+     * объемы, приведенные к 15 °C
+     */
+    float* standard_volumes;
+    /**
+     * суммарный объем
+     */
+    double total_volume;
+    /**
+     * суммарный приведенный объем
+     */
+    double total_standard_volume;
+    /**
+     * такт, в который снят снимок
+     */
+    unsigned long long tick;
+    /**
+     * последний такт, обработанный моделью уровня (снимок модели обновляется до него при чтении)
+     */
+    unsigned long long model_tick;
+    /**
+     * момент последнего такта модели в нс
+     */
+    unsigned long long model_time;
+    /**
+     * резервуары, изменившиеся событиями модели после последнего обновления снимка
+     */
+    unsigned int* changed_tanks;
+    /**
+     * количество изменившихся резервуаров
+     */
+    size_t changed_count;
+    /**
+     * признаки изменившихся резервуаров
+     */
+    unsigned char* changed_marks;
+} volume_snapshot;
+
+/**
+ * состояние резервуара, по которому последний раз пересчитан его прогноз
+ */
+typedef struct _forecast_input{
+    /**
+     * изменение уровня за такт от насосов
+     */
+    long long pump_rate;
+    /**
+     * минимальный уровень
+     */
+    unsigned int minimum_level;
+    /**
+     * максимальный уровень
+     */
+    unsigned int maximum_level;
+} forecast_input;
+
+/**
+ * распределение приема нефти по резервуарам
+ */
+typedef struct _inbound_dispatch{
+    /**
+     * мьютекс для изменения задания и чтения состояния из других потоков
+     */
+    pthread_mutex_t mutex;
+    /**
+     * диспетчер приема
+     */
+    inbound_dispatcher* dispatcher;
+    /**
+     * команды насосам, рассчитанные на такт
+     */
+    dispatch_action* actions;
+} inbound_dispatch;
+
+/**
+ * изменения уровня от перекачек, ожидающие отправки резервуарам и подтверждения ими
+ * (используется только потоком управления; у резервуара не больше одного неподтвержденного запроса)
+ */
+typedef struct _transfer_queue{
+    /**
+     * уровни резервуаров перекачек на момент расчета такта
+     */
+    unsigned int* levels;
+    /**
+     * ожидаемые за такт поступления в резервуары перекачек (насос налива и неначисленные перекачки)
+     */
+    long long* incoming;
+    /**
+     * ожидаемые за такт расходы резервуаров перекачек (насос слива)
+     */
+    long long* outgoing;
+    /**
+     * списания, рассчитанные за такт
+     */
+    long long* debits;
+    /**
+     * начисления, ожидающие отправки
+     */
+    long long* credits;
+    /**
+     * списания, ожидающие отправки
+     */
+    long long* pending_debits;
+    /**
+     * начисления отправленных неподтвержденных запросов
+     */
+    long long* sent_credits;
+    /**
+     * фактически списанные объемы подтвержденных запросов (-1 - подтверждения нет)
+     */
+    long long* taken;
+    /**
+     * рабочий список номеров резервуаров
+     */
+    unsigned int* numbers;
+    /**
+     * резервуары с начислениями или списаниями, ожидающими отправки
+     */
+    unsigned int* waiting;
+    /**
+     * отметки резервуаров, попавших в список ожидающих отправки
+     */
+    unsigned char* waiting_marks;
+    /**
+     * количество резервуаров, ожидающих отправки
+     */
+    size_t waiting_count;
+    /**
+     * резервуары с неподтвержденными запросами
+     */
+    unsigned int* sent;
+    /**
+     * отметки резервуаров с неподтвержденными запросами
+     */
+    unsigned char* sent_marks;
+    /**
+     * количество резервуаров с неподтвержденными запросами
+     */
+    size_t sent_count;
+    /**
+     * резервуары с подтвержденными списаниями, еще не распределенными по перекачкам
+     */
+    unsigned int* settled;
+    /**
+     * количество резервуаров с подтвержденными списаниями
+     */
+    size_t settled_count;
+} transfer_queue;
+
+/**
+ * группа резервуаров, процессы которых запускает один поток
+ */
+typedef struct _spawn_range{
+    /**
+     * указатель на нефтехранилище
+     */
+    const struct _oil_storage* os;
+    /**
+     * номера резервуаров
+     */
+    const unsigned int* numbers;
+    /**
+     * количество резервуаров
+     */
+    size_t count;
+} spawn_range;
+
+
+/**
+ * выделить память нефтехранилища и создать его компоненты (без процессов резервуаров)
+ * @param tanks_count количество резервуаров
+ * @return указатель на нефтрехранилище
+ */
+static oil_storage* _init_oil_storage(size_t tanks_count);
+
+/**
+ * запустить процессы работающих резервуаров (состояния резервуаров уже записаны в таблицу),
+ * запомнить время запуска и запустить поток отсчетов
+ * @param os указатель на нефтрехранилище
+ * @param start время начала создания нефтехранилища
+ */
+static void _start_oil_storage(oil_storage* os, const struct timespec* start);
+
+/**
+ * создать процессы для работающих резервуаров (параллельно, из исполняемого файла процесса резервуара,
+ * если он найден) и дождаться их готовности; простаивающие резервуары создаются спящими;
+ * если исполняемый файл не найден, процессы всех резервуаров создаются через fork до запуска потоков
+ * нефтехранилища и больше не пересоздаются (fork в многопоточном процессе небезопасен)
  * @param os указатель на нефтрехранилище
  */
 static void _create_process_for_tanks(oil_storage* os);
 
-/**
- * функция управления резервуаром
- * @param fd_in файловый дескриптор канала для чтения команд
- * @param fd_out файловый дескриптор канала для ответа на команды
- */
-static void _manage_storage_tank(int fd_in, int fd_out);
+/**
+ * создать аналитическую модель уровня из состояний резервуаров в таблице (процессы резервуаров не запускаются)
+ * @param os указатель на нефтрехранилище
+ */
+static void _create_level_model(oil_storage* os);
+
+/**
+ * выполнить команду резервуара над аналитической моделью уровня
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param operation_number номер команды
+ * @param params параметры команды
+ * @param answer буфер для ответа
+ */
+static void _execute_model_operation(const oil_storage* os, unsigned int number, int operation_number, const void* params, void* answer);
+
+/**
+ * обработать наступившие события модели уровня: состояния резервуаров, изменившихся командами и событиями,
+ * записываются в таблицу и историю, их прогноз и снимок отмечаются для пересчета; резервуары, уровень которых
+ * просто меняется, не затрагиваются - их уровень вычисляется моделью при чтении
+ * @param os указатель на нефтрехранилище
+ * @param tick текущий такт
+ */
+static void _advance_level_model(oil_storage* os, unsigned long long tick);
+
+/**
+ * обновить снимок по модели уровня на ее последний такт: пересчитываются только резервуары, изменившиеся
+ * событиями с прошлого обновления, и резервуары, уровень которых меняется (в режиме процессов ничего не делает)
+ * @param os указатель на нефтехранилище
+ * @param mode SNAPSHOT_ON_READ, SNAPSHOT_ON_EXPORT, SNAPSHOT_FULL
+ */
+static void _refresh_model_snapshot(const oil_storage* os, int mode);
+
+/**
+ * пересчитать объемы резервуара по состоянию из модели и перенести его в группы, индекс и снимки
+ * (вызывается под мьютексом снимка)
+ * @param os указатель на нефтехранилище
+ * @param number номер резервуара
+ * @param ts состояние резервуара
+ */
+static void _update_model_tank(const oil_storage* os, unsigned int number, const tank_state* ts);
+
+/**
+ * записать в таблицу уровни резервуаров, уровень которых меняется, на последний такт модели
+ * @param os указатель на нефтехранилище
+ */
+static void _sync_moving_levels(oil_storage* os);
+
+/**
+ * добавить отсчет истории уровня резервуара
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param tick текущий такт
+ * @param ts состояние резервуара
+ */
+static void _sample_level_history(oil_storage* os, unsigned int number, unsigned long long tick, const tank_state* ts);
+
+/**
+ * запустить процессы резервуаров группы, отправить каждому состояние резервуара
+ * одной командой создания и дождаться ответов о готовности
+ * @param range_ptr указатель на группу резервуаров
+ * @return NULL
+ */
+static void* _start_tanks_range(void* range_ptr);
+
+/**
+ * запустить процесс резервуара и отправить ему состояние резервуара из таблицы
+ * (вызывается под мьютексом резервуара или до запуска потока отсчетов; без исполняемого файла
+ * процесс создается через fork только до запуска потоков нефтехранилища, потом - ошибка)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @return 0 - процесс запущен, -1 - ошибка
+ */
+static int _start_tank_worker(const oil_storage* os, unsigned int number);
+
+/**
+ * остановить процесс резервуара и закрыть его каналы
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param reaped 1 - процесс уже завершился и дождан, 0 - процесс нужно убить
+ */
+static void _stop_tank_worker(const oil_storage* os, unsigned int number, int reaped);
+
+/**
+ * перезапустить упавший или зависший процесс резервуара из теневой копии состояния в таблице
+ * (если насосы по теневой копии выключены, резервуар остается спящим)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param reaped 1 - процесс уже завершился и дождан, 0 - процесс нужно убить
+ * @return TANK_OK - резервуар восстановлен, TANK_ERROR_WORKER - процесс не запустился (насосы выключены)
+ */
+static int _restart_tank(const oil_storage* os, unsigned int number, int reaped);
+
+/**
+ * проверить процесс резервуара: завершился ли он и публикует ли он состояние, при необходимости перезапустить
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param tick текущий такт
+ * @param check_exit 1 - проверить завершение процесса (был получен SIGCHLD)
+ */
+static void _supervise_tank(oil_storage* os, unsigned int number, unsigned long long tick, int check_exit);
+
+/**
+ * прочитать ответ процесса резервуара, ожидая не дольше ANSWER_TIMEOUT
+ * @param ch канал процесса резервуара
+ * @param answer буфер для ответа
+ * @param size размер ответа в байтах
+ * @return 0 - ответ прочитан, -1 - процесс не ответил или канал закрыт
+ */
+static int _read_answer(tank_channel* ch, void* answer, size_t size);
+
+/**
+ * обработчик SIGCHLD
+ * @param signal_number номер сигнала
+ */
+static void _on_child_exit(int signal_number);
+
+/**
+ * запустить процесс резервуара из исполняемого файла
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @return идентификатор процесса, -1 - ошибка
+ */
+static pid_t _spawn_tank_worker(const oil_storage* os, unsigned int number);
+
+/**
+ * запустить процесс резервуара через fork (только пока в процессе нет других потоков)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @return идентификатор процесса
+ */
+static pid_t _fork_tank_worker(const oil_storage* os, unsigned int number);
+
+/**
+ * выполнить команду резервуара: у работающего резервуара - через его процесс, у спящего - над его
+ * состоянием в таблице (если после команды должен работать насос, резервуар просыпается);
+ * если процесс не отвечает, он перезапускается и команда повторяется
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param operation_number номер команды
+ * @param params параметры команды
+ * @param params_size размер параметров в байтах
+ * @param answer буфер для ответа
+ * @param answer_size размер ответа в байтах (0 - команда без ответа)
+ * @return TANK_OK, TANK_ERROR_NUMBER, TANK_ERROR_WORKER
+ */
+static int _execute_tank_operation(const oil_storage* os, unsigned int number, int operation_number,
+                                    const void* params, size_t params_size, void* answer, size_t answer_size);
+
+/**
+ * выполнить аварийную остановку над состоянием резервуара в таблице
+ * @param ts состояние резервуара
+ * @param flags флаги остановки
+ */
+static void _apply_emergency_to_state(tank_state* ts, int flags);
+
+/**
+ * выполнить команду над состоянием спящего резервуара (так же, как ее выполнил бы процесс резервуара)
+ * @param ts состояние резервуара
+ * @param operation_number номер команды
+ * @param params параметры команды
+ * @param answer буфер для ответа
+ */
+static void _apply_operation_to_state(tank_state* ts, int operation_number, const void* params, void* answer);
+
+/**
+ * усыпить резервуар, если его насосы выключены: процесс резервуара публикует состояние и завершается
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ */
+static void _hibernate_tank(oil_storage* os, unsigned int number);
+
+/**
+ * дождаться завершившихся процессов уснувших резервуаров
+ * @param os указатель на нефтрехранилище
+ * @param wait 1 - ждать завершения, 0 - только завершившиеся
+ */
+static void _reap_exiting_workers(oil_storage* os, int wait);
+
+/**
+ * найти исполняемый файл процесса резервуара (рядом с текущим исполняемым файлом
+ * или по пути из переменной окружения TANK_WORKER_PATH_ENV)
+ * @param path буфер для пути
+ * @param size размер буфера
+ * @return 0 - файл найден, -1 - файл не найден
+ */
+static int _find_worker_path(char* path, size_t size);
+
+/**
+ * перенести дескриптор выше дескрипторов, которые получает процесс резервуара
+ * @param fd дескриптор
+ * @return новый дескриптор
+ */
+static int _move_fd_above_worker_fds(int fd);
+
+/**
+ * рассчитать перекачки между резервуарами за такт: начислить приемникам объемы, подтвержденные
+ * источниками, рассчитать новые списания и отправить резервуарам изменения уровня
+ * @param os указатель на нефтрехранилище
+ * @param tick текущий такт
+ */
+static void _apply_transfers(oil_storage* os, unsigned long long tick);
+
+/**
+ * заполнить входные данные расчета перекачек (уровни и ожидаемые изменения уровня) для резервуаров перекачек
+ * @param os указатель на нефтрехранилище
+ * @param numbers номера резервуаров
+ * @param count количество резервуаров
+ */
+static void _prepare_transfers(oil_storage* os, const unsigned int* numbers, size_t count);
+
+/**
+ * поставить резервуар в очередь на отправку изменения уровня от перекачек
+ * @param tq очередь перекачек
+ * @param number номер резервуара
+ */
+static void _queue_transfer(transfer_queue* tq, unsigned int number);
+
+/**
+ * отправить резервуару накопленные начисление и списание: в режиме модели они выполняются сразу,
+ * иначе запрос кладется в таблицу состояний и будится процесс резервуара
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param tick текущий такт
+ */
+static void _send_transfer(oil_storage* os, unsigned int number, unsigned long long tick);
+
+/**
+ * получить результат отправленного запроса перекачки; запрос спящему резервуару выполняется над его
+ * состоянием в таблице (если мьютекс резервуара занят, выполнение откладывается до следующего такта)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param taken фактически списанный объем
+ * @return 1 - запрос выполнен, 0 - еще нет
+ */
+static int _take_transfer_result(oil_storage* os, unsigned int number, unsigned int* taken);
+
+/**
+ * выполнить запрос перекачки над состоянием резервуара (так же, как его выполнил бы процесс резервуара)
+ * @param ts состояние резервуара
+ * @param credit начисляемый объем (начисляется не выше максимального уровня)
+ * @param debit списываемый объем
+ * @return фактически списанный объем
+ */
+static unsigned int _apply_transfer_to_state(tank_state* ts, unsigned int credit, unsigned int debit);
+
+/**
+ * выполнить запрос перекачки над резервуаром модели уровней
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param credit начисляемый объем
+ * @param debit списываемый объем
+ * @return фактически списанный объем
+ */
+static unsigned int _apply_transfer_model(oil_storage* os, unsigned int number, unsigned int credit, unsigned int debit);
+
+/**
+ * снять уровни всех резервуаров, пересчитать их в объемы и приведенные объемы, обновить
+ * показатели групп резервуаров и индекс для запросов по уровню, передать строку в выгрузку
+ * @param os указатель на нефтехранилище
+ * @param tick текущий такт
+ */
+static void _update_snapshot(oil_storage* os, unsigned long long tick);
+
+/**
+ * отметить, что прогноз резервуара нужно пересчитать (вызывается только из потока отсчетов)
+ * @param os указатель на нефтехранилище
+ * @param number номер резервуара
+ */
+static void _mark_forecast(oil_storage* os, unsigned int number);
+
+/**
+ * пересчитать прогнозы достижения границ отмеченных резервуаров по снимку такта
+ * @param os указатель на нефтехранилище
+ * @param tick текущий такт
+ */
+static void _update_forecast(oil_storage* os, unsigned long long tick);
+
+/**
+ * получить изменение уровня резервуара за такт от насосов
+ * @param ts состояние резервуара
+ * @return изменение уровня
+ */
+static long long _get_pump_rate(const tank_state* ts);
+
+/**
+ * передать наступившие отложенные команды потокам выполнения команд (не больше SCHEDULED_BATCHES_PER_TICK
+ * выборок за такт и, пока потоки не разобрали переданное раньше, не больше такого же количества команд в очередях)
+ * @param os указатель на нефтрехранилище
+ * @param tick текущий такт
+ */
+static void _dispatch_scheduled_commands(oil_storage* os, unsigned long long tick);
+
+/**
+ * распределить прием нефти по насосам налива на такт (команды насосам передаются потокам выполнения команд)
+ * @param os указатель на нефтрехранилище
+ */
+static void _dispatch_inbound(oil_storage* os);
+
+/**
+ * выполнить команду в потоке выполнения команд
+ * @param os_ptr указатель на нефтрехранилище
+ * @param command команда
+ * @param number номер резервуара
+ * @param value значение параметра команды
+ * @return результат execute_tank_command
+ */
+static int _execute_command(void* os_ptr, int command, unsigned int number, unsigned int value);
+
+/**
+ * функция, в которой каждый такт снимаются отсчеты истории уровня всех резервуаров, перезапускаются
+ * упавшие и зависшие процессы резервуаров, усыпляются простаивающие резервуары,
+ * рассчитываются перекачки между резервуарами и раздаются отложенные команды
+ * @param os_ptr указатель на нефтрехранилище
+ * @return NULL
+ */
+static void* _engine_work(void* os_ptr);
+
+/**
+ * получить номер текущего такта
+ * @return номер такта (время в единицах TIME_UNIT)
+ */
+static unsigned long long _get_current_tick();
+
+/**
+ * записывает номер команды в канал процесса резервуара
+ * @param ch канал процесса резервуара
+ * @param operation_number номер команды
+ * @return 0 - команда записана, -1 - ошибка (процесс резервуара завершился)
+ */
+static int _send_operation_number(tank_channel* ch, int operation_number);
+
+/**
+ * записывает номер команды вместе с ее параметрами в канал процесса резервуара одной операцией записи
+ * (чтобы процесс резервуара получил команду целиком)
+ * @param ch канал процесса резервуара
+ * @param operation_number номер команды
+ * @param params параметры команды
+ * @param params_size размер параметров в байтах
+ * @return 0 - команда записана, -1 - ошибка (процесс резервуара завершился)
+ */
+static int _send_operation(tank_channel* ch, int operation_number, const void* params, size_t params_size);
+
+/**
+ * Хранилище нефти
+ */
+struct _oil_storage{
+    /**
+     * количество резевуаров
+     */
+    size_t tanks_count;
+    /**
+     * идентификаторы процессов, в которых осуществляется управление резервуаром (-1 - резервуар спит)
+     */
+    pid_t* pids;
+    /**
+     * каналы обмена командами и ответами с процессами резервуаров (NULL - резервуар спит)
+     */
+    tank_channel** channels;
+    /**
+     * тип каналов (TANK_CHANNEL_PIPE, TANK_CHANNEL_RING)
+     */
+    int channel_type;
+    /**
+     * таблица состояний резервуаров в разделяемой памяти
+     */
+    tanks_table* table;
+    /**
+     * истории уровня резервуаров
+     */
+    level_history** histories;
+    /**
+     * сеть перекачек между резервуарами
+     */
+    transfer_network* transfers;
+    /**
+     * изменения уровня от перекачек, ожидающие отправки резервуарам и подтверждения
+     */
+    transfer_queue* transfer_queue;
+    /**
+     * расписание отложенных команд
+     */
+    timer_wheel* scheduler;
+    /**
+     * поток, в котором каждый такт снимаются отсчеты истории, рассчитываются перекачки
+     * и раздаются отложенные команды
+     */
+    pthread_t engine_thread;
+    /**
+     * состояние работы потока отсчетов (1 - работает, 0 - остановлен)
+     */
+    int engine_state;
+    /**
+     * время от начала создания нефтехранилища до готовности всех резервуаров в мкс
+     */
+    unsigned long long startup_time;
+    /**
+     * мьютексы резервуаров (команды одному резервуару из разных потоков выполняются по очереди)
+     */
+    pthread_mutex_t* tank_mutexes;
+    /**
+     * количество тактов, в течение которых насосы работающего резервуара выключены
+     */
+    unsigned int* idle_ticks;
+    /**
+     * путь к исполняемому файлу процесса резервуара (NULL - процессы создаются через fork)
+     */
+    char* worker_path;
+    /**
+     * процессы резервуаров можно создавать через fork (1 - потоки нефтехранилища еще не запущены)
+     */
+    int fork_allowed;
+    /**
+     * дескриптор разделяемой памяти таблицы состояний для процессов резервуаров
+     */
+    int worker_table_fd;
+    /**
+     * идентификаторы завершающихся процессов уснувших резервуаров
+     */
+    pid_t* exiting_pids;
+    /**
+     * количество завершающихся процессов
+     */
+    size_t exiting_count;
+    /**
+     * последние прочитанные счетчики публикаций состояния процессов резервуаров
+     */
+    unsigned int* heartbeat_values;
+    /**
+     * такты, в которые счетчики публикаций последний раз изменились
+     */
+    unsigned long long* heartbeat_ticks;
+    /**
+     * сторож процессов резервуаров
+     */
+    watchdog* watchdog;
+    /**
+     * градуировочные таблицы резервуаров
+     */
+    strapping_table* strapping;
+    /**
+     * коэффициенты приведения объемов к 15 °C
+     */
+    volume_correction* correction;
+    /**
+     * снимок уровней и объемов (процессы резервуаров - обновляется каждый такт, модель уровня - при чтении)
+     */
+    volume_snapshot* snapshot;
+    /**
+     * согласованные снимки состояний всех резервуаров для чтения без блокировок (публикуются вместе со снимком объемов)
+     */
+    epoch_snapshot* epochs;
+    /**
+     * прогноз достижения границ уровня (пересчитывается только у резервуаров, скорость или границы которых изменились)
+     */
+    limit_forecast* forecast;
+    /**
+     * такт, на который пересчитаны прогнозы
+     */
+    unsigned long long forecast_tick;
+    /**
+     * резервуары, прогноз которых нужно пересчитать в этот такт
+     */
+    unsigned int* forecast_tanks;
+    /**
+     * количество резервуаров, прогноз которых нужно пересчитать
+     */
+    size_t forecast_count;
+    /**
+     * признаки резервуаров, отмеченных для пересчета прогноза
+     */
+    unsigned char* forecast_marks;
+    /**
+     * состояния резервуаров, по которым последний раз пересчитан прогноз (сравниваются с таблицей,
+     * когда уровень меняют процессы резервуаров)
+     */
+    forecast_input* forecast_inputs;
+    /**
+     * изменения уровня резервуаров за такт от перекачек
+     */
+    long long* transfer_rates;
+    /**
+     * такты, в которые перекачки последний раз изменили уровень резервуаров
+     */
+    unsigned long long* transfer_rate_ticks;
+    /**
+     * резервуары с ненулевым изменением уровня от перекачек (проверяются на истечение TRANSFER_RATE_TICKS)
+     */
+    unsigned int* transfer_rate_tanks;
+    /**
+     * количество резервуаров с ненулевым изменением уровня от перекачек
+     */
+    size_t transfer_rate_count;
+    /**
+     * распределение приема нефти
+     */
+    inbound_dispatch* inbound;
+    /**
+     * потоки выполнения команд, рассчитанных в потоке управления
+     */
+    command_executor* executor;
+    /**
+     * аналитическая модель уровня (NULL - уровень меняют процессы резервуаров)
+     */
+    level_model* model;
+    /**
+     * мьютекс модели уровня
+     */
+    pthread_mutex_t model_mutex;
+    /**
+     * резервуары, состояние которых изменилось в модели уровня за такт
+     */
+    unsigned int* model_tanks;
+    /**
+     * последний такт, обработанный моделью уровня (под мьютексом модели)
+     */
+    unsigned long long model_tick;
+    /**
+     * изменения уровня за такт, с которыми история продолжается от последнего отсчета до следующего события модели
+     * (под мьютексом модели)
+     */
+    long long* history_rates;
+    /**
+     * группы резервуаров со сводными показателями (обновляются вместе со снимком)
+     */
+    tank_groups* groups;
+    /**
+     * индекс резервуаров по уровню и состоянию насосов для запросов (обновляется вместе со снимком)
+     */
+    level_index* index;
+    /**
+     * выгрузка отсчетов в столбцовом формате (NULL - выгрузка не идет; указатель меняется под мьютексом снимка)
+     */
+    column_export* export;
+};
+
+oil_storage* create_oil_storage(size_t storage_tanks_count, unsigned int min_level, unsigned int max_level, unsigned int speed_download_pump, unsigned int speed_upload_pump){
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    oil_storage* os = _init_oil_storage(storage_tanks_count);
+    tank_state initial_state = {min_level, min_level, max_level, STORAGE_TANK_OFF, PUMP_OFF, speed_download_pump, PUMP_OFF, speed_upload_pump};
+    for(unsigned int i = 0; i < os->tanks_count; ++i){
+        set_tank_state_tanks_table(os->table, i, &initial_state);
+        set_tank_strapping_table(os->strapping, i, STRAPPING_TABLE_VERTICAL, max_level, max_level);
+    }
+    _start_oil_storage(os, &start);
+    return os;
+}
+
+oil_storage* create_oil_storage_from_config(const tank_config* tanks, size_t tanks_count){
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    oil_storage* os = _init_oil_storage(tanks_count);
+    for(unsigned int i = 0; i < os->tanks_count; ++i){
+        const tank_config* tc = &tanks[i];
+        int pumps_on = (tc->flags & (FLEET_CONFIG_DOWNLOAD_PUMP | FLEET_CONFIG_UPLOAD_PUMP)) != 0;
+        tank_state ts = {tc->current_level, tc->minimum_level, tc->maximum_level,
+                         (tc->flags & FLEET_CONFIG_TANK_ON) || pumps_on ? STORAGE_TANK_ON : STORAGE_TANK_OFF,
+                         (tc->flags & FLEET_CONFIG_DOWNLOAD_PUMP) && tc->current_level < tc->maximum_level ? PUMP_ON : PUMP_OFF,
+                         tc->download_speed,
+                         (tc->flags & FLEET_CONFIG_UPLOAD_PUMP) && tc->current_level > tc->minimum_level ? PUMP_ON : PUMP_OFF,
+                         tc->upload_speed};
+        set_tank_state_tanks_table(os->table, i, &ts);
+        set_tank_strapping_table(os->strapping, i, tc->strapping_table, tc->maximum_level,
+                                 tc->capacity > 0 ? tc->capacity : tc->maximum_level);
+        set_tank_volume_correction(os->correction, i, tc->flags & FLEET_CONFIG_REFINED ? VOLUME_CORRECTION_REFINED : VOLUME_CORRECTION_CRUDE,
+                                   tc->density > 0.0f ? tc->density : VOLUME_CORRECTION_DEFAULT_DENSITY, tc->temperature);
+    }
+    _start_oil_storage(os, &start);
+    return os;
+}
+
+int turn_on_tank(oil_storage* os, unsigned int number){
+    return _execute_tank_operation(os, number, TURN_ON_STORAGE_TANK, NULL, 0, NULL, 0);
+}
+
+int turn_off_tank(oil_storage* os, unsigned int number){
+    return _execute_tank_operation(os, number, TURN_OFF_STORAGE_TANK, NULL, 0, NULL, 0);
+}
+
+int get_state_tank(const oil_storage* os, unsigned int number){
+    int state_st = 0;
+    _execute_tank_operation(os, number, GET_STATE_TANK, NULL, 0, &state_st, sizeof(state_st));
+    return state_st;
+}
+
+int set_minimum_level_tank(oil_storage* os, unsigned int number, unsigned int min_level){
+    return _execute_tank_operation(os, number, SET_MINIMUM_LEVEL_TANK, &min_level, sizeof(min_level), NULL, 0);
+}
+
+unsigned int get_minimum_level_tank(const oil_storage* os, unsigned int number){
+    unsigned int min_level = 0;
+    _execute_tank_operation(os, number, GET_MINIMUM_LEVEL_TANK, NULL, 0, &min_level, sizeof(min_level));
+    return min_level;
+}
+
+int set_maximum_level_tank(oil_storage* os, unsigned int number, unsigned int max_level){
+    return _execute_tank_operation(os, number, SET_MAXIMUM_LEVEL_TANK, &max_level, sizeof(max_level), NULL, 0);
+}
+
+unsigned int get_maximum_level_tank(const oil_storage* os, unsigned int number){
+    unsigned int max_level = 0;
+    _execute_tank_operation(os, number, GET_MAXIMUM_LEVEL_TANK, NULL, 0, &max_level, sizeof(max_level));
+    return max_level;
+}
+
+unsigned int get_current_level_tank(const oil_storage* os, unsigned int number){
+    unsigned int cur_level = 0;
+    _execute_tank_operation(os, number, GET_CURRENT_LEVEL_TANK, NULL, 0, &cur_level, sizeof(cur_level));
+    return cur_level;
+}
+
+void finalize_oil_storage(oil_storage* os){
+    os->engine_state = 0;
+    pthread_join(os->engine_thread, NULL);
+    if (os->executor != NULL) finalize_command_executor(os->executor);
+    if (os->export != NULL) finalize_column_export(os->export);
+    for(int i = 0; i < os->tanks_count; ++i){
+        if (__atomic_load_n(&os->pids[i], __ATOMIC_ACQUIRE) != -1) _send_operation_number(os->channels[i], FINALIZE_STORAGE_TANK);
+    }
+    for(int i = 0; i < os->tanks_count; ++i){
+        pid_t pid = __atomic_load_n(&os->pids[i], __ATOMIC_ACQUIRE);
+        if (pid != -1){
+            waitpid(pid, NULL, 0);
+            finalize_tank_channel(os->channels[i]);
+        }
+        pthread_mutex_destroy(&os->tank_mutexes[i]);
+        finalize_level_history(os->histories[i]);
+    }
+    _reap_exiting_workers(os, 1);
+    if (os->worker_table_fd != -1) close(os->worker_table_fd);
+    free(os->worker_path);
+    free(os->exiting_pids);
+    free(os->heartbeat_values);
+    free(os->heartbeat_ticks);
+    pthread_mutex_destroy(&os->watchdog->mutex);
+    free(os->watchdog);
+    finalize_strapping_table(os->strapping);
+    finalize_volume_correction(os->correction);
+    pthread_mutex_destroy(&os->snapshot->mutex);
+    free(os->snapshot->levels);
+    free(os->snapshot->volumes);
+    free(os->snapshot->standard_volumes);
+    free(os->snapshot->changed_tanks);
+    free(os->snapshot->changed_marks);
+    free(os->snapshot);
+    finalize_epoch_snapshot(os->epochs);
+    finalize_limit_forecast(os->forecast);
+    free(os->transfer_rates);
+    free(os->transfer_rate_ticks);
+    free(os->transfer_rate_tanks);
+    free(os->forecast_tanks);
+    free(os->forecast_marks);
+    free(os->forecast_inputs);
+    pthread_mutex_destroy(&os->inbound->mutex);
+    finalize_inbound_dispatcher(os->inbound->dispatcher);
+    free(os->inbound->actions);
+    free(os->inbound);
+    if (os->model != NULL) finalize_level_model(os->model);
+    free(os->model_tanks);
+    free(os->history_rates);
+    finalize_tank_groups(os->groups);
+    finalize_level_index(os->index);
+    pthread_mutex_destroy(&os->model_mutex);
+    free(os->idle_ticks);
+    free(os->tank_mutexes);
+    free(os->histories);
+    finalize_transfer_network(os->transfers);
+    transfer_queue* tq = os->transfer_queue;
+    free(tq->levels);
+    free(tq->incoming);
+    free(tq->outgoing);
+    free(tq->debits);
+    free(tq->credits);
+    free(tq->pending_debits);
+    free(tq->sent_credits);
+    free(tq->taken);
+    free(tq->numbers);
+    free(tq->waiting);
+    free(tq->waiting_marks);
+    free(tq->sent);
+    free(tq->sent_marks);
+    free(tq->settled);
+    free(tq);
+    finalize_timer_wheel(os->scheduler);
+    finalize_tanks_table(os->table);
+    free(os->channels);
+    free(os->pids);
+    free(os);
+    finalize_trace();
+}
+
+int turn_on_download_pump(oil_storage* os, unsigned int number){
+    return _execute_tank_operation(os, number, TURN_ON_DOWNLOAD_PUMP, NULL, 0, NULL, 0);
+}
+
+int turn_off_download_pump(oil_storage* os, unsigned int number){
+    return _execute_tank_operation(os, number, TURN_OFF_DOWNLOAD_PUMP, NULL, 0, NULL, 0);
+}
+
+int get_state_download_pump(const oil_storage* os, unsigned int number){
+    int state_dp = 0;
+    _execute_tank_operation(os, number, GET_STATE_DOWNLOAD_PUMP, NULL, 0, &state_dp, sizeof(state_dp));
+    return state_dp;
+}
+
+int set_speed_download_pump(oil_storage *os, unsigned int number, unsigned int download_speed){
+    return _execute_tank_operation(os, number, SET_SPEED_DOWNLOAD_PUMP, &download_speed, sizeof(download_speed), NULL, 0);
+}
+
+unsigned int get_speed_download_pump(const oil_storage* os, unsigned int number){
+    unsigned int download_speed = 0;
+    _execute_tank_operation(os, number, GET_SPEED_DOWNLOAD_PUMP, NULL, 0, &download_speed, sizeof(download_speed));
+    return download_speed;
+}
+
+int turn_on_upload_pump(oil_storage* os, unsigned int number){
+    return _execute_tank_operation(os, number, TURN_ON_UPLOAD_PUMP, NULL, 0, NULL, 0);
+}
+
+int turn_off_upload_pump(oil_storage* os, unsigned int number){
+    return _execute_tank_operation(os, number, TURN_OFF_UPLOAD_PUMP, NULL, 0, NULL, 0);
+}
+
+int get_state_upload_pump(const oil_storage* os, unsigned int number){
+    int state_up = 0;
+    _execute_tank_operation(os, number, GET_STATE_UPLOAD_PUMP, NULL, 0, &state_up, sizeof(state_up));
+    return state_up;
+}
+
+int set_speed_upload_pump(oil_storage *os, unsigned int number, unsigned int upload_speed){
+    return _execute_tank_operation(os, number, SET_SPEED_UPLOAD_PUMP, &upload_speed, sizeof(upload_speed), NULL, 0);
+}
+
+unsigned int get_speed_upload_pump(const oil_storage* os, unsigned int number){
+    unsigned int upload_speed = 0;
+    _execute_tank_operation(os, number, GET_SPEED_UPLOAD_PUMP, NULL, 0, &upload_speed, sizeof(upload_speed));
+    return upload_speed;
+}
+
+size_t get_count_tanks(const oil_storage *os){
+    return os->tanks_count;
+}
+
+unsigned long long get_startup_time_oil_storage(const oil_storage* os){
+    return os->startup_time;
+}
+
+int is_hibernated_tank(const oil_storage* os, unsigned int number){
+    pthread_mutex_lock(&os->tank_mutexes[number]);
+    int hibernated = __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) == -1;
+    pthread_mutex_unlock(&os->tank_mutexes[number]);
+    return hibernated;
+}
+
+void get_watchdog_stats(const oil_storage* os, watchdog_stats* stats){
+    pthread_mutex_lock(&os->watchdog->mutex);
+    *stats = os->watchdog->stats;
+    pthread_mutex_unlock(&os->watchdog->mutex);
+}
+
+int emergency_stop_tank(oil_storage* os, unsigned int number, int flags){
+    if (number >= os->tanks_count) return TANK_ERROR_NUMBER;
+    if (flags == 0 || (flags & ~(EMERGENCY_STOP_TANK | EMERGENCY_STOP_DOWNLOAD_PUMP | EMERGENCY_STOP_UPLOAD_PUMP)) != 0){
+        return TANK_ERROR_VALUE;
+    }
+    unsigned long long start = get_time_trace();
+    int acknowledged = 0;
+    if (os->model != NULL){
+        if (flags & EMERGENCY_STOP_TANK) _execute_model_operation(os, number, TURN_OFF_STORAGE_TANK, NULL, NULL);
+        if (flags & EMERGENCY_STOP_DOWNLOAD_PUMP) _execute_model_operation(os, number, TURN_OFF_DOWNLOAD_PUMP, NULL, NULL);
+        if (flags & EMERGENCY_STOP_UPLOAD_PUMP) _execute_model_operation(os, number, TURN_OFF_UPLOAD_PUMP, NULL, NULL);
+        acknowledged = 1;
+    }
+    //мьютекс резервуара не берется: его может держать команда, ждущая ответа процесса
+    if (!acknowledged && __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) != -1){
+        unsigned int acks = get_emergency_acks_tanks_table(os->table, number);
+        request_emergency_tanks_table(os->table, number, (unsigned int)flags);
+        acknowledged = wait_emergency_ack_tanks_table(os->table, number, acks, EMERGENCY_TIMEOUT) == 0;
+    }
+    int failed = 0;
+    if (!acknowledged){
+        pthread_mutex_lock(&os->tank_mutexes[number]);
+        failed = __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) != -1;
+        if (failed) _stop_tank_worker(os, number, 0);
+        tank_state ts;
+        get_tank_state_tanks_table(os->table, number, &ts);
+        _apply_emergency_to_state(&ts, flags);
+        set_tank_state_tanks_table(os->table, number, &ts);
+        if (failed) _restart_tank(os, number, 1);
+        pthread_mutex_unlock(&os->tank_mutexes[number]);
+    }
+    unsigned long long latency = (get_time_trace() - start) / 1000;
+    pthread_mutex_lock(&os->watchdog->mutex);
+    emergency_stats* stats = &os->watchdog->emergency;
+    stats->stops++;
+    if (failed) stats->failures++;
+    stats->last_latency = latency;
+    stats->total_latency += latency;
+    if (latency > stats->max_latency) stats->max_latency = latency;
+    pthread_mutex_unlock(&os->watchdog->mutex);
+    end_span_trace("ipc", "emergency_stop", start, (int)number);
+    return TANK_OK;
+}
+
+void get_emergency_stats(const oil_storage* os, emergency_stats* stats){
+    pthread_mutex_lock(&os->watchdog->mutex);
+    *stats = os->watchdog->emergency;
+    pthread_mutex_unlock(&os->watchdog->mutex);
+}
+
+size_t get_active_tanks_count(const oil_storage* os){
+    if (os->model != NULL){
+        level_model_stats stats;
+        get_level_model_stats(os, &stats);
+        return stats.moving_tanks;
+    }
+    size_t count = 0;
+    for(size_t i = 0; i < os->tanks_count; ++i){
+        if (__atomic_load_n(&os->pids[i], __ATOMIC_ACQUIRE) != -1) count++;
+    }
+    return count;
+}
+
+int get_level_model_stats(const oil_storage* os, level_model_stats* stats){
+    if (os->model == NULL) return -1;
+    pthread_mutex_lock((pthread_mutex_t*)&os->model_mutex);
+    get_stats_level_model(os->model, stats);
+    pthread_mutex_unlock((pthread_mutex_t*)&os->model_mutex);
+    return 0;
+}
+
+void get_fleet_summary(const oil_storage* os, fleet_summary* fs){
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    const tanks_snapshot* cut = acquire_epoch_snapshot(os->epochs);
+    compute_fleet_summary(cut->current_levels, cut->maximum_levels, os->tanks_count, fs);
+    fs->total_volume = cut->total_volume;
+    fs->total_standard_volume = cut->total_standard_volume;
+    release_epoch_snapshot(os->epochs, cut);
+}
+
+float get_current_volume_tank(const oil_storage* os, unsigned int number){
+    if (number >= os->tanks_count) return 0.0f;
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    return os->snapshot->volumes[number];
+}
 
-/**
- * записывает номер команды в указанный файл
- * @param fd дескриптор файла для записи
- * @param operation_number номер команды
- */
-static void _send_operation_number(int fd, int operation_number);
+float get_standard_volume_tank(const oil_storage* os, unsigned int number){
+    if (number >= os->tanks_count) return 0.0f;
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    return os->snapshot->standard_volumes[number];
+}
 
-/**
- * Хранилище нефти
- */
-struct _oil_storage{
-    /**
-     * количество резевуаров
-     */
-    size_t tanks_count;
-    /**
-     * идентификаторы процессов, в которых осуществляется управление резервуаром
-     */
-    pid_t* pids;
-    /**
-     * каналы для передачи информации резевуарам
-     */
-    int** pipe_fds_in;
-    /**
-     * каналы для получения информации от резервуаров
-     */
-    int** pipe_fds_out;
-};
+size_t get_tanks_volumes(const oil_storage* os, unsigned int first, size_t count, float* volumes, float* standard_volumes){
+    if (first >= os->tanks_count) return 0;
+    if (count > os->tanks_count - first) count = os->tanks_count - first;
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    const tanks_snapshot* cut = acquire_epoch_snapshot(os->epochs);
+    if (volumes != NULL) memcpy(volumes, cut->volumes + first, sizeof(float) * count);
+    if (standard_volumes != NULL) memcpy(standard_volumes, cut->standard_volumes + first, sizeof(float) * count);
+    release_epoch_snapshot(os->epochs, cut);
+    return count;
+}
 
-oil_storage* create_oil_storage(size_t storage_tanks_count, unsigned int min_level, unsigned int max_level, unsigned int speed_download_pump, unsigned int speed_upload_pump){
+int load_strapping_tables(oil_storage* os, const char* path, size_t* error_line){
+    pthread_mutex_lock(&os->snapshot->mutex);
+    int result = load_strapping_table(os->strapping, path, error_line);
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    if (result != -1) _update_snapshot(os, _get_current_tick());
+    return result;
+}
+
+int set_product_tank(oil_storage* os, unsigned int number, int product, float density, float temperature){
+    if (number >= os->tanks_count) return TANK_ERROR_NUMBER;
+    volume_snapshot* snapshot = os->snapshot;
+    pthread_mutex_lock(&snapshot->mutex);
+    int result = set_tank_volume_correction(os->correction, number, product, density, temperature);
+    //в режиме модели приведенный объем пересчитывается только у отмеченных резервуаров
+    if (result == 0 && os->model != NULL && !snapshot->changed_marks[number]){
+        snapshot->changed_marks[number] = 1;
+        snapshot->changed_tanks[snapshot->changed_count++] = number;
+    }
+    pthread_mutex_unlock(&snapshot->mutex);
+    return result == 0 ? TANK_OK : TANK_ERROR_VALUE;
+}
+
+int get_tank_eta(const oil_storage* os, unsigned int number, unsigned long long* time_to_max, unsigned long long* time_to_min){
+    if (number >= os->tanks_count) return TANK_ERROR_NUMBER;
+    pthread_mutex_lock(&os->snapshot->mutex);
+    get_limit_forecast(os->forecast, number, os->forecast_tick, time_to_max, time_to_min);
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    return TANK_OK;
+}
+
+size_t get_next_limits(const oil_storage* os, limit_eta* etas, size_t count){
+    pthread_mutex_lock(&os->snapshot->mutex);
+    size_t found = get_next_limit_forecast(os->forecast, os->forecast_tick, etas, count);
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    return found;
+}
+
+int start_inbound_dispatch(oil_storage* os, unsigned int first, unsigned int last, unsigned int rate){
+    pthread_mutex_lock(&os->inbound->mutex);
+    int result = set_inbound_dispatcher(os->inbound->dispatcher, first, last, rate);
+    pthread_mutex_unlock(&os->inbound->mutex);
+    return result == 0 ? TANK_OK : TANK_ERROR_NUMBER;
+}
+
+void stop_inbound_dispatch(oil_storage* os){
+    dispatch_stats stats;
+    pthread_mutex_lock(&os->inbound->mutex);
+    get_stats_inbound_dispatcher(os->inbound->dispatcher, &stats);
+    set_inbound_dispatcher(os->inbound->dispatcher, stats.first, stats.last, 0);
+    pthread_mutex_unlock(&os->inbound->mutex);
+}
+
+void get_inbound_dispatch_stats(const oil_storage* os, dispatch_stats* stats){
+    pthread_mutex_lock(&os->inbound->mutex);
+    get_stats_inbound_dispatcher(os->inbound->dispatcher, stats);
+    pthread_mutex_unlock(&os->inbound->mutex);
+}
+
+int get_product_tank(const oil_storage* os, unsigned int number, int* product, float* density, float* temperature){
+    if (number >= os->tanks_count) return TANK_ERROR_NUMBER;
+    pthread_mutex_lock(&os->snapshot->mutex);
+    get_tank_volume_correction(os->correction, number, product, density, temperature);
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    return TANK_OK;
+}
+
+size_t get_tanks_states(const oil_storage* os, unsigned int first, size_t count, tank_state* states){
+    if (first >= os->tanks_count) return 0;
+    if (count > os->tanks_count - first) count = os->tanks_count - first;
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    const tanks_snapshot* cut = acquire_epoch_snapshot(os->epochs);
+    for(size_t i = 0; i < count; ++i){
+        get_tank_state_epoch_snapshot(cut, first + (unsigned int)i, &states[i]);
+    }
+    release_epoch_snapshot(os->epochs, cut);
+    return count;
+}
+
+const tanks_snapshot* acquire_tanks_snapshot(const oil_storage* os){
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    return acquire_epoch_snapshot(os->epochs);
+}
+
+void release_tanks_snapshot(const oil_storage* os, const tanks_snapshot* snapshot){
+    release_epoch_snapshot(os->epochs, snapshot);
+}
+
+int add_transfer(oil_storage* os, const char* name, unsigned int source, unsigned int destination, unsigned int rate){
+    return add_transfer_link(os->transfers, name, source, destination, rate) == -1 ? -1 : 0;
+}
+
+int start_transfer(oil_storage* os, const char* name){
+    int link = find_transfer_link(os->transfers, name);
+    if (link == -1) return -1;
+    set_state_transfer_link(os->transfers, link, TRANSFER_ON);
+    return 0;
+}
+
+int stop_transfer(oil_storage* os, const char* name){
+    int link = find_transfer_link(os->transfers, name);
+    if (link == -1) return -1;
+    set_state_transfer_link(os->transfers, link, TRANSFER_OFF);
+    return 0;
+}
+
+int get_transfer(const oil_storage* os, const char* name, unsigned int* source, unsigned int* destination, unsigned int* rate, unsigned long long* moved){
+    int link = find_transfer_link(os->transfers, name);
+    if (link == -1) return -1;
+    get_transfer_link(os->transfers, link, source, destination, rate, moved);
+    return get_state_transfer_link(os->transfers, link);
+}
+
+int add_group(oil_storage* os, const char* name, const char* parent){
+    int parent_group = TANK_GROUP_NO_PARENT;
+    if (parent != NULL){
+        parent_group = find_tank_group(os->groups, parent);
+        if (parent_group == -1) return -1;
+    }
+    return add_tank_group(os->groups, name, parent_group) == -1 ? -1 : 0;
+}
+
+int assign_group(oil_storage* os, const char* name, unsigned int number){
+    int group = find_tank_group(os->groups, name);
+    if (group == -1) return -1;
+    return assign_tank_group(os->groups, group, number);
+}
+
+int get_group_totals(const oil_storage* os, const char* name, group_totals* totals){
+    int group = find_tank_group(os->groups, name);
+    if (group == -1) return -1;
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    return get_totals_tank_group(os->groups, group, totals);
+}
+
+size_t find_tanks(const oil_storage* os, const level_query* query, unsigned int* numbers, size_t max_count){
+    _refresh_model_snapshot(os, SNAPSHOT_ON_READ);
+    return find_level_index(os->index, query, numbers, max_count);
+}
+
+int start_export(oil_storage* os, const char* directory){
+    pthread_mutex_lock(&os->snapshot->mutex);
+    int running = os->export != NULL;
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    if (running) return -1;
+    column_export* ce = create_column_export(directory, os->tanks_count, TIME_UNIT);
+    if (ce == NULL) return -1;
+    pthread_mutex_lock(&os->snapshot->mutex);
+    running = os->export != NULL;
+    if (!running) os->export = ce;
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    if (running) finalize_column_export(ce);
+    return running ? -1 : 0;
+}
+
+int stop_export(oil_storage* os){
+    pthread_mutex_lock(&os->snapshot->mutex);
+    column_export* ce = os->export;
+    os->export = NULL;
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    if (ce == NULL) return -1;
+    //запись оставшихся строк не задерживает такт: выгрузка уже отсоединена от снимка
+    finalize_column_export(ce);
+    return 0;
+}
+
+int get_export_stats(const oil_storage* os, export_stats* stats){
+    pthread_mutex_lock(&os->snapshot->mutex);
+    int running = os->export != NULL;
+    if (running) get_stats_column_export(os->export, stats);
+    pthread_mutex_unlock(&os->snapshot->mutex);
+    return running ? 0 : -1;
+}
+
+unsigned long long schedule_command(oil_storage* os, unsigned int delay, unsigned int period, int command, unsigned int number, unsigned int value){
+    if (number >= os->tanks_count || command < COMMAND_TURN_ON_TANK || command > COMMAND_SET_SPEED_UPLOAD_PUMP) return 0;
+    scheduled_command sc = {0, command, number, value};
+    unsigned long long delay_ticks = (delay + TIME_UNIT - 1) / TIME_UNIT;
+    unsigned long long period_ticks = (period + TIME_UNIT - 1) / TIME_UNIT;
+    return add_timer_wheel(os->scheduler, _get_current_tick() + delay_ticks, period_ticks, &sc);
+}
+
+int execute_tank_command(oil_storage* os, int command, unsigned int number, unsigned int value){
+    switch (command){
+        case COMMAND_TURN_ON_TANK:              return turn_on_tank(os, number);
+        case COMMAND_TURN_OFF_TANK:             return turn_off_tank(os, number);
+        case COMMAND_SET_MINIMUM_LEVEL_TANK:    return set_minimum_level_tank(os, number, value);
+        case COMMAND_SET_MAXIMUM_LEVEL_TANK:    return set_maximum_level_tank(os, number, value);
+        case COMMAND_TURN_ON_DOWNLOAD_PUMP:     return turn_on_download_pump(os, number);
+        case COMMAND_TURN_OFF_DOWNLOAD_PUMP:    return turn_off_download_pump(os, number);
+        case COMMAND_SET_SPEED_DOWNLOAD_PUMP:   return set_speed_download_pump(os, number, value);
+        case COMMAND_TURN_ON_UPLOAD_PUMP:       return turn_on_upload_pump(os, number);
+        case COMMAND_TURN_OFF_UPLOAD_PUMP:      return turn_off_upload_pump(os, number);
+        case COMMAND_SET_SPEED_UPLOAD_PUMP:     return set_speed_upload_pump(os, number, value);
+        default:                                return TANK_ERROR_VALUE;
+    }
+}
+
+int cancel_scheduled_command(oil_storage* os, unsigned long long id){
+    return cancel_timer_wheel(os->scheduler, id);
+}
+
+void get_scheduler_stats(const oil_storage* os, scheduler_stats* stats){
+    get_stats_timer_wheel(os->scheduler, stats);
+}
+
+size_t get_level_history_tank(const oil_storage* os, unsigned int number, unsigned int period, unsigned int step, history_point* points, size_t max_count){
+    unsigned long long to_tick = _get_current_tick();
+    unsigned long long period_ticks = period / TIME_UNIT;
+    unsigned long long from_tick = to_tick > period_ticks ? to_tick - period_ticks : 0;
+    if (os->model != NULL){
+        //история меняющегося резервуара дописывается до последнего такта модели при чтении
+        pthread_mutex_lock((pthread_mutex_t*)&os->model_mutex);
+        add_run_level_history(os->histories[number], os->model_tick, os->history_rates[number]);
+        pthread_mutex_unlock((pthread_mutex_t*)&os->model_mutex);
+    }
+    return query_level_history(os->histories[number], from_tick, to_tick, step / TIME_UNIT, points, max_count);
+}
+
+static oil_storage* _init_oil_storage(size_t tanks_count){
+    init_trace(TRACE_CREATE);
     oil_storage* os = malloc(sizeof(oil_storage));
-    os->tanks_count = storage_tanks_count;
+    os->tanks_count = tanks_count;
     os->pids = malloc(sizeof(pid_t)*os->tanks_count);
-    os->pipe_fds_in = malloc(sizeof(int*)*os->tanks_count);
-    os->pipe_fds_out = malloc(sizeof(int*)*os->tanks_count);
-    for(int i = 0; i < os->tanks_count; ++i){
-        os->pipe_fds_in[i] = malloc(sizeof(int)*2);
-        os->pipe_fds_out[i] = malloc(sizeof(int)*2);
-        pipe(os->pipe_fds_in[i]);
-        pipe(os->pipe_fds_out[i]);
+    os->channels = malloc(sizeof(tank_channel*)*os->tanks_count);
+    os->table = create_tanks_table(os->tanks_count);
+    os->histories = malloc(sizeof(level_history*)*os->tanks_count);
+    os->transfers = create_transfer_network(os->tanks_count);
+    size_t transfer_size = os->tanks_count > 0 ? os->tanks_count : 1;
+    transfer_queue* tq = os->transfer_queue = malloc(sizeof(transfer_queue));
+    tq->levels = calloc(transfer_size, sizeof(unsigned int));
+    tq->incoming = calloc(transfer_size, sizeof(long long));
+    tq->outgoing = calloc(transfer_size, sizeof(long long));
+    tq->debits = calloc(transfer_size, sizeof(long long));
+    tq->credits = calloc(transfer_size, sizeof(long long));
+    tq->pending_debits = calloc(transfer_size, sizeof(long long));
+    tq->sent_credits = calloc(transfer_size, sizeof(long long));
+    tq->taken = malloc(sizeof(long long) * transfer_size);
+    for(size_t i = 0; i < transfer_size; ++i){
+        tq->taken[i] = -1;
     }
-    _create_process_for_tanks(os);
+    tq->numbers = malloc(sizeof(unsigned int) * transfer_size);
+    tq->waiting = malloc(sizeof(unsigned int) * transfer_size);
+    tq->waiting_marks = calloc(transfer_size, sizeof(unsigned char));
+    tq->waiting_count = 0;
+    tq->sent = malloc(sizeof(unsigned int) * transfer_size);
+    tq->sent_marks = calloc(transfer_size, sizeof(unsigned char));
+    tq->sent_count = 0;
+    tq->settled = malloc(sizeof(unsigned int) * transfer_size);
+    tq->settled_count = 0;
+    os->scheduler = create_timer_wheel(_get_current_tick());
+    os->tank_mutexes = malloc(sizeof(pthread_mutex_t)*os->tanks_count);
+    os->idle_ticks = calloc(os->tanks_count, sizeof(unsigned int));
+    os->exiting_pids = malloc(sizeof(pid_t)*os->tanks_count);
+    os->exiting_count = 0;
+    os->heartbeat_values = calloc(os->tanks_count, sizeof(unsigned int));
+    os->heartbeat_ticks = calloc(os->tanks_count, sizeof(unsigned long long));
+    os->watchdog = calloc(1, sizeof(watchdog));
+    pthread_mutex_init(&os->watchdog->mutex, NULL);
+    os->strapping = create_strapping_table(os->tanks_count);
+    os->correction = create_volume_correction(os->tanks_count);
+    os->snapshot = calloc(1, sizeof(volume_snapshot));
+    pthread_mutex_init(&os->snapshot->mutex, NULL);
+    os->snapshot->levels = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(unsigned int));
+    os->snapshot->volumes = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(float));
+    os->snapshot->standard_volumes = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(float));
+    os->snapshot->changed_tanks = malloc(sizeof(unsigned int) * (os->tanks_count > 0 ? os->tanks_count : 1));
+    os->snapshot->changed_marks = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(unsigned char));
+    os->epochs = create_epoch_snapshot(os->tanks_count);
+    os->forecast = create_limit_forecast(os->tanks_count);
+    os->transfer_rates = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(long long));
+    os->transfer_rate_ticks = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(unsigned long long));
+    os->transfer_rate_tanks = malloc(sizeof(unsigned int) * (os->tanks_count > 0 ? os->tanks_count : 1));
+    os->transfer_rate_count = 0;
+    os->forecast_tanks = malloc(sizeof(unsigned int) * (os->tanks_count > 0 ? os->tanks_count : 1));
+    os->forecast_count = 0;
+    os->forecast_marks = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(unsigned char));
+    os->forecast_inputs = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(forecast_input));
+    os->inbound = malloc(sizeof(inbound_dispatch));
+    pthread_mutex_init(&os->inbound->mutex, NULL);
+    os->inbound->dispatcher = create_inbound_dispatcher(os->tanks_count);
+    os->inbound->actions = malloc(sizeof(dispatch_action) * (2 * os->tanks_count + 2));
+    os->executor = NULL;
+    os->model = NULL;
+    os->model_tanks = NULL;
+    os->history_rates = NULL;
+    os->model_tick = 0;
+    os->forecast_tick = 0;
+    pthread_mutex_init(&os->model_mutex, NULL);
+    os->groups = create_tank_groups(os->tanks_count);
+    os->index = create_level_index(os->tanks_count);
+    os->export = NULL;
+    os->fork_allowed = 0;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = _on_child_exit;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
     for(int i = 0; i < os->tanks_count; ++i){
-        _send_operation_number(os->pipe_fds_in[i][1], CREATE_STORAGE_TANK);
-        unsigned int params[] = {
-                min_level,
-                max_level,
-                speed_download_pump,
-                speed_upload_pump,
-        };
-        write(os->pipe_fds_in[i][1], params, sizeof(params));
+        os->channels[i] = NULL;
+        __atomic_store_n(&os->pids[i], -1, __ATOMIC_RELEASE);
+        pthread_mutex_init(&os->tank_mutexes[i], NULL);
+        os->histories[i] = create_level_history(HISTORY_BUFFER_SIZE);
+        _mark_forecast(os, i);
     }
     return os;
 }
 
-void turn_on_tank(oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], TURN_ON_STORAGE_TANK);
+static void _start_oil_storage(oil_storage* os, const struct timespec* start){
+    struct timespec ready;
+    const char* engine = getenv(LEVEL_MODEL_ENV);
+    if (engine != NULL && strcmp(engine, LEVEL_MODEL_ANALYTIC) == 0){
+        _create_level_model(os);
+    } else {
+        _create_process_for_tanks(os);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ready);
+    os->startup_time = (unsigned long long)(ready.tv_sec - start->tv_sec) * 1000000 + (ready.tv_nsec - start->tv_nsec) / 1000;
+    _update_snapshot(os, _get_current_tick());
+    os->executor = create_command_executor(COMMAND_EXECUTOR_THREADS, _execute_command, os);
+    os->engine_state = 1;
+    pthread_create(&os->engine_thread, NULL, _engine_work, os);
 }
 
-void turn_off_tank(oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], TURN_OFF_STORAGE_TANK);
+static void _create_process_for_tanks(oil_storage* os){
+    char worker_path[PATH_MAX];
+    os->worker_path = NULL;
+    os->worker_table_fd = -1;
+    const char* transport = getenv(TANK_WORKER_TRANSPORT_ENV);
+    os->channel_type = transport != NULL && strcmp(transport, "pipe") == 0 ? TANK_CHANNEL_PIPE : TANK_CHANNEL_RING;
+    if (get_fd_tanks_table(os->table) != -1 && _find_worker_path(worker_path, sizeof(worker_path)) == 0){
+        os->worker_table_fd = _move_fd_above_worker_fds(dup(get_fd_tanks_table(os->table)));
+        if (os->worker_table_fd != -1) os->worker_path = strdup(worker_path);
+    }
+    unsigned int* active_tanks = malloc(sizeof(unsigned int)*(os->tanks_count > 0 ? os->tanks_count : 1));
+    size_t active_count = 0;
+    for(unsigned int i = 0; i < os->tanks_count; ++i){
+        tank_state ts;
+        get_tank_state_tanks_table(os->table, i, &ts);
+        //без исполняемого файла процесс нельзя создать после запуска потоков, поэтому спящих резервуаров нет
+        if (os->worker_path == NULL || ts.download_state == PUMP_ON || ts.upload_state == PUMP_ON) active_tanks[active_count++] = i;
+    }
+    size_t threads_count = 1;
+    if (os->worker_path != NULL){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads_count = cpus > 0 ? (size_t)cpus : 1;
+        if (threads_count > MAX_SPAWN_THREADS) threads_count = MAX_SPAWN_THREADS;
+        if (threads_count > (active_count + TANKS_PER_SPAWN_THREAD - 1) / TANKS_PER_SPAWN_THREAD){
+            threads_count = (active_count + TANKS_PER_SPAWN_THREAD - 1) / TANKS_PER_SPAWN_THREAD;
+        }
+    }
+    if (threads_count <= 1){
+        spawn_range range = {os, active_tanks, active_count};
+        os->fork_allowed = os->worker_path == NULL;
+        _start_tanks_range(&range);
+        os->fork_allowed = 0;
+        free(active_tanks);
+        return;
+    }
+    pthread_t threads[MAX_SPAWN_THREADS];
+    spawn_range ranges[MAX_SPAWN_THREADS];
+    for(size_t t = 0; t < threads_count; ++t){
+        size_t from = active_count * t / threads_count;
+        ranges[t].os = os;
+        ranges[t].numbers = active_tanks + from;
+        ranges[t].count = active_count * (t + 1) / threads_count - from;
+        pthread_create(&threads[t], NULL, _start_tanks_range, &ranges[t]);
+    }
+    for(size_t t = 0; t < threads_count; ++t){
+        pthread_join(threads[t], NULL);
+    }
+    free(active_tanks);
 }
 
-int get_state_tank(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_STATE_TANK);
-    int state_st;
-    read(os->pipe_fds_out[number][0], &state_st, sizeof(state_st));
-    return state_st;
+static void* _start_tanks_range(void* range_ptr){
+    spawn_range* range = range_ptr;
+    const oil_storage* os = range->os;
+    //перезапуск уже прочитал ответ о готовности, повторное чтение ждало бы ANSWER_TIMEOUT и перезапускало исправный процесс
+    unsigned char* restarted = calloc(range->count > 0 ? range->count : 1, sizeof(unsigned char));
+    for(size_t i = 0; i < range->count; ++i){
+        if (_start_tank_worker(os, range->numbers[i]) == -1){
+            _restart_tank(os, range->numbers[i], 1);
+            restarted[i] = 1;
+        }
+    }
+    for(size_t i = 0; i < range->count; ++i){
+        unsigned int number = range->numbers[i];
+        int ready;
+        if (!restarted[i] && __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) != -1 && _read_answer(os->channels[number], &ready, sizeof(ready)) == -1){
+            _restart_tank(os, number, 0);
+        }
+    }
+    free(restarted);
+    return NULL;
 }
 
-void set_minimum_level_tank(oil_storage* os, unsigned int number, unsigned int min_level){
-    _send_operation_number(os->pipe_fds_in[number][1], SET_MINIMUM_LEVEL_TANK);
-    write(os->pipe_fds_in[number][1], &min_level, sizeof(min_level));
+static int _start_tank_worker(const oil_storage* os, unsigned int number){
+    clear_emergency_tanks_table(os->table, number);
+    os->channels[number] = create_tank_channel(os->channel_type, TANK_WORKER_FD_TABLE + 1);
+    if (os->channels[number] == NULL) return -1;
+    pid_t pid = -1;
+    if (os->worker_path != NULL){
+        pid = _spawn_tank_worker(os, number);
+    } else if (os->fork_allowed){
+        pid = _fork_tank_worker(os, number);
+    }
+    __atomic_store_n(&os->pids[number], pid, __ATOMIC_RELEASE);
+    close_worker_fds_tank_channel(os->channels[number]);
+    if (pid == -1){
+        _stop_tank_worker(os, number, 1);
+        return -1;
+    }
+    os->heartbeat_values[number] = get_heartbeat_tanks_table(os->table, number);
+    os->heartbeat_ticks[number] = _get_current_tick();
+    tank_state ts;
+    get_tank_state_tanks_table(os->table, number, &ts);
+    return _send_operation(os->channels[number], CREATE_STORAGE_TANK, &ts, sizeof(ts));
 }
 
-unsigned int get_minimum_level_tank(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_MINIMUM_LEVEL_TANK);
-    unsigned int min_level;
-    read(os->pipe_fds_out[number][0], &min_level, sizeof(min_level));
-    return min_level;
+static void _stop_tank_worker(const oil_storage* os, unsigned int number, int reaped){
+    pid_t pid = __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE);
+    if (!reaped && pid != -1){
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    if (os->channels[number] != NULL) finalize_tank_channel(os->channels[number]);
+    os->channels[number] = NULL;
+    __atomic_store_n(&os->pids[number], -1, __ATOMIC_RELEASE);
 }
 
-void set_maximum_level_tank(oil_storage* os, unsigned int number, unsigned int max_level){
-    _send_operation_number(os->pipe_fds_in[number][1], SET_MAXIMUM_LEVEL_TANK);
-    write(os->pipe_fds_in[number][1], &max_level, sizeof(max_level));
+static int _restart_tank(const oil_storage* os, unsigned int number, int reaped){
+    unsigned long long failed_tick = os->heartbeat_ticks[number];
+    _stop_tank_worker(os, number, reaped);
+    tank_state ts;
+    get_tank_state_tanks_table(os->table, number, &ts);
+    int result = TANK_OK;
+    if (ts.download_state == PUMP_ON || ts.upload_state == PUMP_ON){
+        int ready;
+        if (_start_tank_worker(os, number) == -1 || _read_answer(os->channels[number], &ready, sizeof(ready)) == -1){
+            _stop_tank_worker(os, number, 0);
+            ts.download_state = ts.upload_state = PUMP_OFF;
+            set_tank_state_tanks_table(os->table, number, &ts);
+            result = TANK_ERROR_WORKER;
+        }
+    }
+    unsigned long long failover_time = (_get_current_tick() - failed_tick) * TIME_UNIT;
+    pthread_mutex_lock(&os->watchdog->mutex);
+    os->watchdog->stats.restarts++;
+    if (result != TANK_OK) os->watchdog->stats.failures++;
+    os->watchdog->stats.last_failover_time = failover_time;
+    if (failover_time > os->watchdog->stats.max_failover_time) os->watchdog->stats.max_failover_time = failover_time;
+    pthread_mutex_unlock(&os->watchdog->mutex);
+    return result;
 }
 
-unsigned int get_maximum_level_tank(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_MAXIMUM_LEVEL_TANK);
-    unsigned int max_level;
-    read(os->pipe_fds_out[number][0], &max_level, sizeof(max_level));
-    return max_level;
+static void _supervise_tank(oil_storage* os, unsigned int number, unsigned long long tick, int check_exit){
+    pthread_mutex_lock(&os->tank_mutexes[number]);
+    pid_t pid = __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE);
+    if (pid != -1){
+        if (check_exit && waitpid(pid, NULL, WNOHANG) == pid){
+            _restart_tank(os, number, 1);
+        } else if (get_heartbeat_tanks_table(os->table, number) == os->heartbeat_values[number]
+                   && tick > os->heartbeat_ticks[number] + HEARTBEAT_TIMEOUT){
+            _restart_tank(os, number, 0);
+        }
+    }
+    pthread_mutex_unlock(&os->tank_mutexes[number]);
 }
 
-unsigned int get_current_level_tank(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_CURRENT_LEVEL_TANK);
-    unsigned int cur_level;
-    read(os->pipe_fds_out[number][0], &cur_level, sizeof(cur_level));
-    return cur_level;
+static int _read_answer(tank_channel* ch, void* answer, size_t size){
+    return read_tank_channel(ch, answer, size, ANSWER_TIMEOUT);
 }
 
-void finalize_oil_storage(oil_storage* os){
-    for(int i = 0; i < os->tanks_count; ++i){
-        _send_operation_number(os->pipe_fds_in[i][1], FINALIZE_STORAGE_TANK);
+static void _on_child_exit(int signal_number){
+    (void)signal_number;
+    _child_exited = 1;
+}
+
+static pid_t _spawn_tank_worker(const oil_storage* os, unsigned int number){
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    int fd_in, fd_out;
+    get_worker_fds_tank_channel(os->channels[number], &fd_in, &fd_out);
+    posix_spawn_file_actions_adddup2(&actions, fd_in, TANK_WORKER_FD_IN);
+    posix_spawn_file_actions_adddup2(&actions, fd_out, TANK_WORKER_FD_OUT);
+    posix_spawn_file_actions_adddup2(&actions, os->worker_table_fd, TANK_WORKER_FD_TABLE);
+    char number_arg[24], count_arg[24], type_arg[24];
+    sprintf(number_arg, "%u", number);
+    sprintf(count_arg, "%zu", os->tanks_count);
+    sprintf(type_arg, "%d", get_type_tank_channel(os->channels[number]));
+    char* argv[] = {os->worker_path, number_arg, count_arg, type_arg, NULL};
+    pid_t pid;
+    if (posix_spawn(&pid, os->worker_path, &actions, NULL, argv, environ) != 0){
+        pid = -1;
     }
-    for(int i = 0; i < os->tanks_count; ++i){
-        waitpid(os->pids[i], NULL, 0);
-        close(os->pipe_fds_in[i][1]);
-        close(os->pipe_fds_out[i][0]);
-        free(os->pipe_fds_out[i]);
-        free(os->pipe_fds_in[i]);
-    }
-    free(os->pipe_fds_out);
-    free(os->pipe_fds_in);
-    free(os->pids);
-    free(os);
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+static pid_t _fork_tank_worker(const oil_storage* os, unsigned int number){
+    pid_t pid = fork();
+    if (pid == 0){
+        for(unsigned int j = 0; j < os->tanks_count; ++j){
+            if (os->channels[j] != NULL) close_fds_tank_channel(os->channels[j]);
+        }
+        int fd_in, fd_out;
+        get_worker_fds_tank_channel(os->channels[number], &fd_in, &fd_out);
+        tank_channel* ch = attach_tank_channel(get_type_tank_channel(os->channels[number]), fd_in, fd_out);
+        if (ch != NULL){
+            run_tank_worker(ch, os->table, number);
+            finalize_tank_channel(ch);
+        }
+        finalize_trace();
+        _exit(0);
+    }
+    return pid;
+}
+
+static int _execute_tank_operation(const oil_storage* os, unsigned int number, int operation_number,
+                                   const void* params, size_t params_size, void* answer, size_t answer_size){
+    if (number >= os->tanks_count) return TANK_ERROR_NUMBER;
+    if (os->model != NULL){
+        _execute_model_operation(os, number, operation_number, params, answer);
+        return TANK_OK;
+    }
+    int result = TANK_OK;
+    unsigned long long span = begin_span_trace();
+    pthread_mutex_lock(&os->tank_mutexes[number]);
+    for(int attempt = 0; attempt < 2 && __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) != -1; ++attempt){
+        if (_send_operation(os->channels[number], operation_number, params, params_size) == 0
+            && (answer_size == 0 || _read_answer(os->channels[number], answer, answer_size) == 0)){
+            pthread_mutex_unlock(&os->tank_mutexes[number]);
+            end_span_trace("ipc", get_operation_name_tank_worker(operation_number), span, (int)number);
+            return result;
+        }
+        result = _restart_tank(os, number, 0);
+        if (attempt == 1) result = TANK_ERROR_WORKER;
+    }
+    if (__atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) == -1){
+        tank_state ts;
+        get_tank_state_tanks_table(os->table, number, &ts);
+        _apply_operation_to_state(&ts, operation_number, params, answer);
+        set_tank_state_tanks_table(os->table, number, &ts);
+        if (ts.download_state == PUMP_ON || ts.upload_state == PUMP_ON){
+            os->idle_ticks[number] = 0;
+            int ready;
+            if (_start_tank_worker(os, number) == -1 || _read_answer(os->channels[number], &ready, sizeof(ready)) == -1){
+                result = _restart_tank(os, number, 0);
+            }
+        }
+    }
+    pthread_mutex_unlock(&os->tank_mutexes[number]);
+    end_span_trace("ipc", get_operation_name_tank_worker(operation_number), span, (int)number);
+    return result;
 }
 
-void turn_on_download_pump(oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], TURN_ON_DOWNLOAD_PUMP);
+static void _apply_emergency_to_state(tank_state* ts, int flags){
+    if (flags & EMERGENCY_STOP_TANK) ts->state = STORAGE_TANK_OFF;
+    if (flags & (EMERGENCY_STOP_TANK | EMERGENCY_STOP_DOWNLOAD_PUMP)) ts->download_state = PUMP_OFF;
+    if (flags & (EMERGENCY_STOP_TANK | EMERGENCY_STOP_UPLOAD_PUMP)) ts->upload_state = PUMP_OFF;
 }
 
-void turn_off_download_pump(oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], TURN_OFF_DOWNLOAD_PUMP);
+static void _apply_operation_to_state(tank_state* ts, int operation_number, const void* params, void* answer){
+    switch (operation_number){
+        case TURN_ON_STORAGE_TANK:      ts->state = STORAGE_TANK_ON; break;
+        case TURN_OFF_STORAGE_TANK:     ts->state = STORAGE_TANK_OFF; ts->download_state = ts->upload_state = PUMP_OFF; break;
+        case GET_STATE_TANK:            memcpy(answer, &ts->state, sizeof(int)); break;
+        case SET_MINIMUM_LEVEL_TANK:    memcpy(&ts->minimum_level, params, sizeof(unsigned int)); break;
+        case GET_MINIMUM_LEVEL_TANK:    memcpy(answer, &ts->minimum_level, sizeof(unsigned int)); break;
+        case SET_MAXIMUM_LEVEL_TANK:    memcpy(&ts->maximum_level, params, sizeof(unsigned int)); break;
+        case GET_MAXIMUM_LEVEL_TANK:    memcpy(answer, &ts->maximum_level, sizeof(unsigned int)); break;
+        case GET_CURRENT_LEVEL_TANK:    memcpy(answer, &ts->current_level, sizeof(unsigned int)); break;
+        case TURN_ON_DOWNLOAD_PUMP:{
+            ts->state = STORAGE_TANK_ON;
+            if (ts->current_level < ts->maximum_level) ts->download_state = PUMP_ON;
+            break;
+        }
+        case TURN_OFF_DOWNLOAD_PUMP:    ts->download_state = PUMP_OFF; break;
+        case GET_STATE_DOWNLOAD_PUMP:   memcpy(answer, &ts->download_state, sizeof(int)); break;
+        case SET_SPEED_DOWNLOAD_PUMP:   memcpy(&ts->download_speed, params, sizeof(unsigned int)); break;
+        case GET_SPEED_DOWNLOAD_PUMP:   memcpy(answer, &ts->download_speed, sizeof(unsigned int)); break;
+        case TURN_ON_UPLOAD_PUMP:{
+            ts->state = STORAGE_TANK_ON;
+            if (ts->current_level > ts->minimum_level) ts->upload_state = PUMP_ON;
+            break;
+        }
+        case TURN_OFF_UPLOAD_PUMP:      ts->upload_state = PUMP_OFF; break;
+        case GET_STATE_UPLOAD_PUMP:     memcpy(answer, &ts->upload_state, sizeof(int)); break;
+        case SET_SPEED_UPLOAD_PUMP:     memcpy(&ts->upload_speed, params, sizeof(unsigned int)); break;
+        case GET_SPEED_UPLOAD_PUMP:     memcpy(answer, &ts->upload_speed, sizeof(unsigned int)); break;
+        default: break;
+    }
 }
 
-int get_state_download_pump(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_STATE_DOWNLOAD_PUMP);
-    int state_dp;
-    read(os->pipe_fds_out[number][0], &state_dp, sizeof(state_dp));
-    return state_dp;
+static void _hibernate_tank(oil_storage* os, unsigned int number){
+    pthread_mutex_lock(&os->tank_mutexes[number]);
+    pid_t pid = __atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE);
+    if (pid != -1){
+        int answer = TANK_WORKER_BUSY;
+        if (_send_operation_number(os->channels[number], HIBERNATE_STORAGE_TANK) == -1
+            || _read_answer(os->channels[number], &answer, sizeof(answer)) == -1){
+            _restart_tank(os, number, 0);
+        } else if (answer == TANK_WORKER_HIBERNATED){
+            finalize_tank_channel(os->channels[number]);
+            os->channels[number] = NULL;
+            os->exiting_pids[os->exiting_count++] = pid;
+            __atomic_store_n(&os->pids[number], -1, __ATOMIC_RELEASE);
+        }
+    }
+    os->idle_ticks[number] = 0;
+    pthread_mutex_unlock(&os->tank_mutexes[number]);
 }
 
-void set_speed_download_pump(oil_storage *os, unsigned int number, unsigned int download_speed) {
-    _send_operation_number(os->pipe_fds_in[number][1], SET_SPEED_DOWNLOAD_PUMP);
-    write(os->pipe_fds_in[number][1], &download_speed, sizeof(download_speed));
+static void _reap_exiting_workers(oil_storage* os, int wait){
+    size_t i = 0;
+    while (i < os->exiting_count){
+        if (waitpid(os->exiting_pids[i], NULL, wait ? 0 : WNOHANG) != 0){
+            os->exiting_pids[i] = os->exiting_pids[--os->exiting_count];
+        } else {
+            ++i;
+        }
+    }
 }
 
-unsigned int get_speed_download_pump(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_SPEED_DOWNLOAD_PUMP);
-    unsigned int download_speed;
-    read(os->pipe_fds_out[number][0], &download_speed, sizeof(download_speed));
-    return download_speed;
+static int _find_worker_path(char* path, size_t size){
+    const char* env_path = getenv(TANK_WORKER_PATH_ENV);
+    if (env_path != NULL){
+        if (strlen(env_path) + 1 > size) return -1;
+        strcpy(path, env_path);
+        return access(path, X_OK);
+    }
+    ssize_t len = readlink("/proc/self/exe", path, size - 1);
+    if (len <= 0) return -1;
+    path[len] = '\0';
+    char* slash = strrchr(path, '/');
+    if (slash == NULL || (size_t)(slash - path) + 1 + strlen(TANK_WORKER_NAME) + 1 > size) return -1;
+    strcpy(slash + 1, TANK_WORKER_NAME);
+    return access(path, X_OK);
 }
 
-void turn_on_upload_pump(oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], TURN_ON_UPLOAD_PUMP);
+static int _move_fd_above_worker_fds(int fd){
+    if (fd == -1 || fd > TANK_WORKER_FD_TABLE) return fd;
+    int moved_fd = fcntl(fd, F_DUPFD_CLOEXEC, TANK_WORKER_FD_TABLE + 1);
+    close(fd);
+    return moved_fd;
 }
 
-void turn_off_upload_pump(oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], TURN_OFF_UPLOAD_PUMP);
+static int _send_operation_number(tank_channel* ch, int operation_number){
+    return write_tank_channel(ch, &operation_number, sizeof(operation_number));
 }
 
-int get_state_upload_pump(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_STATE_UPLOAD_PUMP);
-    int state_up;
-    read(os->pipe_fds_out[number][0], &state_up, sizeof(state_up));
-    return state_up;
+static int _send_operation(tank_channel* ch, int operation_number, const void* params, size_t params_size){
+    char message[sizeof(int) + MAX_OPERATION_PARAMS];
+    memcpy(message, &operation_number, sizeof(operation_number));
+    memcpy(message + sizeof(operation_number), params, params_size);
+    return write_tank_channel(ch, message, sizeof(operation_number) + params_size);
 }
 
-void set_speed_upload_pump(oil_storage *os, unsigned int number, unsigned int upload_speed) {
-    _send_operation_number(os->pipe_fds_in[number][1], SET_SPEED_UPLOAD_PUMP);
-    write(os->pipe_fds_in[number][1], &upload_speed, sizeof(upload_speed));
+static void* _engine_work(void* os_ptr){
+    oil_storage* os = os_ptr;
+    set_thread_name_trace("engine");
+    while(os->engine_state){
+        unsigned long long tick = _get_current_tick();
+        unsigned long long tick_span = begin_span_trace();
+        unsigned long long span = tick_span;
+        int child_exited = _child_exited;
+        _child_exited = 0;
+        if (os->model != NULL){
+            _advance_level_model(os, tick);
+        } else {
+            for(unsigned int i = 0; i < os->tanks_count; ++i){
+                tank_state ts;
+                get_tank_state_tanks_table(os->table, i, &ts);
+                _sample_level_history(os, i, tick, &ts);
+                //насосы и границы меняют процессы резервуаров, поэтому изменения прогноза замечаются по таблице
+                forecast_input* input = &os->forecast_inputs[i];
+                long long pump_rate = _get_pump_rate(&ts);
+                if (pump_rate != input->pump_rate || ts.minimum_level != input->minimum_level || ts.maximum_level != input->maximum_level){
+                    input->pump_rate = pump_rate;
+                    input->minimum_level = ts.minimum_level;
+                    input->maximum_level = ts.maximum_level;
+                    _mark_forecast(os, i);
+                }
+                pid_t pid = __atomic_load_n(&os->pids[i], __ATOMIC_ACQUIRE);
+                if (pid != -1){
+                    unsigned int heartbeat = get_heartbeat_tanks_table(os->table, i);
+                    if (heartbeat != os->heartbeat_values[i]){
+                        os->heartbeat_values[i] = heartbeat;
+                        os->heartbeat_ticks[i] = tick;
+                    }
+                    if (child_exited || tick > os->heartbeat_ticks[i] + HEARTBEAT_TIMEOUT) _supervise_tank(os, i, tick, child_exited);
+                }
+                if (os->worker_path != NULL && __atomic_load_n(&os->pids[i], __ATOMIC_ACQUIRE) != -1 && ts.download_state == PUMP_OFF && ts.upload_state == PUMP_OFF){
+                    if (++os->idle_ticks[i] >= HIBERNATION_DELAY) _hibernate_tank(os, i);
+                } else {
+                    os->idle_ticks[i] = 0;
+                }
+            }
+        }
+        _reap_exiting_workers(os, 0);
+        end_span_trace("engine", "history_supervise", span, TRACE_NO_ARG);
+        span = begin_span_trace();
+        if (os->model != NULL) _refresh_model_snapshot(os, SNAPSHOT_ON_EXPORT);
+        else _update_snapshot(os, tick);
+        _update_forecast(os, tick);
+        end_span_trace("engine", "snapshot", span, TRACE_NO_ARG);
+        span = begin_span_trace();
+        _apply_transfers(os, tick);
+        end_span_trace("engine", "transfers", span, TRACE_NO_ARG);
+        span = begin_span_trace();
+        _dispatch_inbound(os);
+        end_span_trace("engine", "inbound_dispatch", span, TRACE_NO_ARG);
+        span = begin_span_trace();
+        _dispatch_scheduled_commands(os, tick);
+        end_span_trace("engine", "scheduled_commands", span, TRACE_NO_ARG);
+        end_span_trace("engine", "tick", tick_span, TRACE_NO_ARG);
+        unsigned long long next_ms = (tick + 1) * TIME_UNIT;
+        struct timespec next = {(time_t)(next_ms / 1000), (long)(next_ms % 1000) * 1000000};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+    }
+    return NULL;
 }
 
-unsigned int get_speed_upload_pump(const oil_storage* os, unsigned int number){
-    _send_operation_number(os->pipe_fds_in[number][1], GET_SPEED_UPLOAD_PUMP);
-    unsigned int upload_speed;
-    read(os->pipe_fds_out[number][0], &upload_speed, sizeof(upload_speed));
-    return upload_speed;
+static void _create_level_model(oil_storage* os){
+    os->worker_path = NULL;
+    os->worker_table_fd = -1;
+    os->channel_type = TANK_CHANNEL_RING;
+    os->model = create_level_model(os->tanks_count);
+    os->model_tanks = malloc(sizeof(unsigned int) * (os->tanks_count > 0 ? os->tanks_count : 1));
+    os->history_rates = calloc(os->tanks_count > 0 ? os->tanks_count : 1, sizeof(long long));
+    unsigned long long now = get_time_trace();
+    for(unsigned int i = 0; i < os->tanks_count; ++i){
+        tank_state ts;
+        get_tank_state_tanks_table(os->table, i, &ts);
+        set_state_level_model(os->model, i, now, &ts);
+    }
+    _advance_level_model(os, _get_current_tick());
 }
 
-size_t get_count_tanks(const oil_storage *os){
-    return os->tanks_count;
+static void _execute_model_operation(const oil_storage* os, unsigned int number, int operation_number, const void* params, void* answer){
+    unsigned long long span = begin_span_trace();
+    pthread_mutex_t* mutex = (pthread_mutex_t*)&os->model_mutex;
+    pthread_mutex_lock(mutex);
+    unsigned long long now = get_time_trace();
+    advance_level_model(os->model, now);
+    tank_state before, after;
+    get_state_level_model(os->model, number, now, &before);
+    after = before;
+    _apply_operation_to_state(&after, operation_number, params, answer);
+    if (memcmp(&before, &after, sizeof(tank_state)) != 0){
+        set_state_level_model(os->model, number, now, &after);
+        advance_level_model(os->model, now);
+        get_state_level_model(os->model, number, now, &after);
+        set_tank_state_tanks_table(os->table, number, &after);
+    }
+    pthread_mutex_unlock(mutex);
+    end_span_trace("model", get_operation_name_tank_worker(operation_number), span, (int)number);
 }
 
-static void _create_process_for_tanks(oil_storage* os){
-    for(int i = 0; i < os->tanks_count; ++i){
-        os->pids[i] = fork();
-        if (os->pids[i] == 0){
-            close(os->pipe_fds_in[i][1]);
-            close(os->pipe_fds_out[i][0]);
-            _manage_storage_tank(os->pipe_fds_in[i][0], os->pipe_fds_out[i][1]);
-            close(os->pipe_fds_in[i][0]);
-            close(os->pipe_fds_out[i][1]);
-            _exit(0);
+static void _advance_level_model(oil_storage* os, unsigned long long tick){
+    unsigned long long now = get_time_trace();
+    pthread_mutex_lock(&os->model_mutex);
+    advance_level_model(os->model, now);
+    size_t count = take_changed_level_model(os->model, os->model_tanks);
+    for(size_t i = 0; i < count; ++i){
+        unsigned int number = os->model_tanks[i];
+        tank_state ts;
+        get_state_level_model(os->model, number, now, &ts);
+        set_tank_state_tanks_table(os->table, number, &ts);
+        //до события уровень менялся с постоянной скоростью: история дописывается серией, затем отсчет события
+        add_run_level_history(os->histories[number], tick - 1, os->history_rates[number]);
+        _sample_level_history(os, number, tick, &ts);
+        os->history_rates[number] = _get_pump_rate(&ts);
+        _mark_forecast(os, number);
+    }
+    os->model_tick = tick;
+    pthread_mutex_unlock(&os->model_mutex);
+    volume_snapshot* snapshot = os->snapshot;
+    pthread_mutex_lock(&snapshot->mutex);
+    for(size_t i = 0; i < count; ++i){
+        unsigned int number = os->model_tanks[i];
+        if (snapshot->changed_marks[number]) continue;
+        snapshot->changed_marks[number] = 1;
+        snapshot->changed_tanks[snapshot->changed_count++] = number;
+    }
+    snapshot->model_tick = tick;
+    snapshot->model_time = now;
+    pthread_mutex_unlock(&snapshot->mutex);
+}
+
+static void _refresh_model_snapshot(const oil_storage* os, int mode){
+    if (os->model == NULL) return;
+    volume_snapshot* snapshot = os->snapshot;
+    pthread_mutex_lock(&snapshot->mutex);
+    if (mode != SNAPSHOT_FULL && (snapshot->tick == snapshot->model_tick || (mode == SNAPSHOT_ON_EXPORT && os->export == NULL))){
+        pthread_mutex_unlock(&snapshot->mutex);
+        return;
+    }
+    update_volume_correction(os->correction);
+    //изменившиеся резервуары пересчитываются всегда, меняющиеся - только если изменился целый уровень
+    pthread_mutex_t* model_mutex = (pthread_mutex_t*)&os->model_mutex;
+    pthread_mutex_lock(model_mutex);
+    const unsigned int* moving;
+    size_t moving_count = get_moving_level_model(os->model, &moving);
+    size_t changed_count = mode == SNAPSHOT_FULL ? os->tanks_count : snapshot->changed_count;
+    for(size_t i = 0; i < changed_count + moving_count; ++i){
+        unsigned int number = i >= changed_count ? moving[i - changed_count]
+                              : mode == SNAPSHOT_FULL ? (unsigned int)i : snapshot->changed_tanks[i];
+        tank_state ts;
+        get_state_level_model(os->model, number, snapshot->model_time, &ts);
+        if (i < changed_count || ts.current_level != snapshot->levels[number]) _update_model_tank(os, number, &ts);
+    }
+    pthread_mutex_unlock(model_mutex);
+    for(size_t i = 0; i < snapshot->changed_count; ++i){
+        snapshot->changed_marks[snapshot->changed_tanks[i]] = 0;
+    }
+    snapshot->changed_count = 0;
+    if (mode == SNAPSHOT_FULL){
+        //суммы, накопленные разностями, пересчитываются заново
+        snapshot->total_volume = snapshot->total_standard_volume = 0.0;
+        for(size_t i = 0; i < os->tanks_count; ++i){
+            snapshot->total_volume += snapshot->volumes[i];
+            snapshot->total_standard_volume += snapshot->standard_volumes[i];
         }
-        close(os->pipe_fds_in[i][0]);
-        close(os->pipe_fds_out[i][1]);
-    }
-}
-
-static void _manage_storage_tank(int fd_in, int fd_out){
-    storage_tank* st = NULL;
-    for(;;){
-        int operation_number;
-        read(fd_in, &operation_number, sizeof(operation_number));
-        switch (operation_number){
-            case CREATE_STORAGE_TANK:{
-                unsigned int params[4];
-                read(fd_in, params, sizeof(params));
-                st = create_storage_tank(params[0], params[1], params[2], params[3]);
-                break;
-            }
-            case TURN_ON_STORAGE_TANK:{
-                turn_on_storage_tank(st);
-                break;
-            }
-            case TURN_OFF_STORAGE_TANK:{
-                turn_off_storage_tank(st);
-                break;
-            }
-            case GET_STATE_TANK:{
-                int state_st = get_state_storage_tank(st);
-                write(fd_out, &state_st, sizeof(state_st));
-                break;
-            }
-            case SET_MINIMUM_LEVEL_TANK:{
-                unsigned int min_level;
-                read(fd_in, &min_level, sizeof(min_level));
-                set_minimum_level_storage_tank(st, min_level);
-                break;
-            }
-            case GET_MINIMUM_LEVEL_TANK:{
-                unsigned int min_level = get_minimum_level_storage_tank(st);
-                write(fd_out, &min_level, sizeof(min_level));
-                break;
-            }
-            case SET_MAXIMUM_LEVEL_TANK:{
-                unsigned int max_level;
-                read(fd_in, &max_level, sizeof(max_level));
-                set_maximum_level_storage_tank(st, max_level);
-                break;
-            }
-            case GET_MAXIMUM_LEVEL_TANK:{
-                unsigned int max_level = get_maximum_level_storage_tank(st);
-                write(fd_out, &max_level, sizeof(max_level));
-                break;
-            }
-            case GET_CURRENT_LEVEL_TANK:{
-                unsigned int cur_level = get_current_level_storage_tank(st);
-                write(fd_out, &cur_level, sizeof(cur_level));
-                break;
-            }
-            case TURN_ON_DOWNLOAD_PUMP:{
-                turn_on_injection_pump(st);
-                break;
-            }
-            case TURN_OFF_DOWNLOAD_PUMP:{
-                turn_off_injection_pump(st);
-                break;
-            }
-            case GET_STATE_DOWNLOAD_PUMP:{
-                int state_dp = get_state_injection_pump(st);
-                write(fd_out, &state_dp, sizeof(state_dp));
-                break;
-            }
-            case SET_SPEED_DOWNLOAD_PUMP:{
-                unsigned int speed_dp;
-                read(fd_in, &speed_dp, sizeof(speed_dp));
-                set_speed_injection_pump(st, speed_dp);
-                break;
-            }
-            case GET_SPEED_DOWNLOAD_PUMP:{
-                unsigned int speed_dp = get_speed_injection_pump(st);
-                write(fd_out, &speed_dp, sizeof(speed_dp));
-                break;
-            }
-            case TURN_ON_UPLOAD_PUMP:{
-                turn_on_pumping_pump(st);
-                break;
-            }
-            case TURN_OFF_UPLOAD_PUMP:{
-                turn_off_pumping_pump(st);
-                break;
-            }
-            case GET_STATE_UPLOAD_PUMP:{
-                int state_up = get_state_pumping_pump(st);
-                write(fd_out, &state_up, sizeof(state_up));
-                break;
-            }
-            case SET_SPEED_UPLOAD_PUMP:{
-                unsigned int speed_pp;
-                read(fd_in, &speed_pp, sizeof(speed_pp));
-                set_speed_pumping_pump(st, speed_pp);
-                break;
-            }
-            case GET_SPEED_UPLOAD_PUMP:{
-                unsigned int speed_pp = get_speed_pumping_pump(st);
-                write(fd_out, &speed_pp, sizeof(speed_pp));
-                break;
-            }
-            case FINALIZE_STORAGE_TANK:{
-                finalize_storage_tank(st);
-                return;
-            }
-            default:{
-                continue;
-            }
+    }
+    snapshot->tick = snapshot->model_tick;
+    //в буфер переписываются только резервуары, изменившиеся с его прошлого заполнения
+    tanks_snapshot* cut = begin_write_epoch_snapshot(os->epochs);
+    if (cut != NULL){
+        const unsigned int* numbers;
+        size_t marked_count = take_marked_epoch_snapshot(os->epochs, cut, &numbers);
+        for(size_t i = 0; i < marked_count; ++i){
+            unsigned int number = numbers[i];
+            tank_state ts;
+            get_tank_state_tanks_table(os->table, number, &ts);
+            ts.current_level = snapshot->levels[number];
+            set_tank_state_epoch_snapshot(cut, number, &ts);
+            cut->volumes[number] = snapshot->volumes[number];
+            cut->standard_volumes[number] = snapshot->standard_volumes[number];
+        }
+        cut->total_volume = snapshot->total_volume;
+        cut->total_standard_volume = snapshot->total_standard_volume;
+        cut->tick = snapshot->tick;
+        if (os->export != NULL){
+            const unsigned int* columns[COLUMNS_COUNT] = {
+                    cut->current_levels, (const unsigned int*)cut->states,
+                    (const unsigned int*)cut->download_states, cut->download_speeds,
+                    (const unsigned int*)cut->upload_states, cut->upload_speeds
+            };
+            add_row_column_export(os->export, cut->tick, columns);
+        }
+        publish_epoch_snapshot(os->epochs, cut);
+    }
+    pthread_mutex_unlock(&snapshot->mutex);
+}
+
+static void _update_model_tank(const oil_storage* os, unsigned int number, const tank_state* ts){
+    volume_snapshot* snapshot = os->snapshot;
+    float volume, standard_volume;
+    convert_strapping_table(os->strapping, number, &ts->current_level, 1, &volume);
+    apply_volume_correction(os->correction, number, &volume, 1, &standard_volume);
+    snapshot->total_volume += (double)volume - snapshot->volumes[number];
+    snapshot->total_standard_volume += (double)standard_volume - snapshot->standard_volumes[number];
+    snapshot->levels[number] = ts->current_level;
+    snapshot->volumes[number] = volume;
+    snapshot->standard_volumes[number] = standard_volume;
+    set_tank_state_tank_groups(os->groups, number, ts->current_level, ts->maximum_level, ts->download_state, ts->upload_state, volume);
+    set_tank_state_level_index(os->index, number, ts->current_level, ts->minimum_level, ts->maximum_level,
+                               ts->state, ts->download_state, ts->upload_state);
+    mark_tank_epoch_snapshot(os->epochs, number);
+}
+
+static void _sync_moving_levels(oil_storage* os){
+    pthread_mutex_lock(&os->model_mutex);
+    const unsigned int* moving;
+    size_t moving_count = get_moving_level_model(os->model, &moving);
+    for(size_t i = 0; i < moving_count; ++i){
+        tank_state ts;
+        get_state_level_model(os->model, moving[i], os->snapshot->model_time, &ts);
+        set_tank_state_tanks_table(os->table, moving[i], &ts);
+    }
+    pthread_mutex_unlock(&os->model_mutex);
+}
+
+static void _sample_level_history(oil_storage* os, unsigned int number, unsigned long long tick, const tank_state* ts){
+    int flags = 0;
+    if (ts->state == STORAGE_TANK_ON) flags |= HISTORY_TANK_ON;
+    if (ts->download_state == PUMP_ON) flags |= HISTORY_DOWNLOAD_PUMP;
+    if (ts->upload_state == PUMP_ON) flags |= HISTORY_UPLOAD_PUMP;
+    add_sample_level_history(os->histories[number], tick, ts->current_level, flags);
+}
+
+static void _apply_transfers(oil_storage* os, unsigned long long tick){
+    transfer_queue* tq = os->transfer_queue;
+    //изменение уровня от перекачки, которая больше не двигает резервуар, перестает учитываться в прогнозе
+    size_t i = 0;
+    while (i < os->transfer_rate_count){
+        unsigned int number = os->transfer_rate_tanks[i];
+        if (os->transfer_rates[number] != 0 && tick <= os->transfer_rate_ticks[number] + TRANSFER_RATE_TICKS){
+            ++i;
+            continue;
+        }
+        if (os->transfer_rates[number] != 0){
+            os->transfer_rates[number] = 0;
+            _mark_forecast(os, number);
+        }
+        os->transfer_rate_tanks[i] = os->transfer_rate_tanks[--os->transfer_rate_count];
+    }
+    //приемникам начисляется только то, что источники действительно отдали
+    i = 0;
+    while (i < tq->sent_count){
+        unsigned int number = tq->sent[i];
+        unsigned int taken;
+        if (!_take_transfer_result(os, number, &taken)){
+            ++i;
+            continue;
+        }
+        tq->taken[number] = taken;
+        tq->settled[tq->settled_count++] = number;
+        tq->sent_credits[number] = 0;
+        tq->sent_marks[number] = 0;
+        tq->sent[i] = tq->sent[--tq->sent_count];
+    }
+    if (tq->settled_count > 0){
+        size_t count = settle_transfer_network(os->transfers, tq->taken, tq->credits, tq->numbers);
+        for(i = 0; i < count; ++i){
+            _queue_transfer(tq, tq->numbers[i]);
+        }
+        for(i = 0; i < tq->settled_count; ++i){
+            tq->taken[tq->settled[i]] = -1;
+        }
+        tq->settled_count = 0;
+    }
+    size_t count = get_tanks_transfer_network(os->transfers, tq->numbers);
+    if (count > 0){
+        _prepare_transfers(os, tq->numbers, count);
+        count = solve_transfer_network(os->transfers, tq->levels,
+                                       get_minimum_levels_tanks_table(os->table),
+                                       get_maximum_levels_tanks_table(os->table),
+                                       tq->incoming, tq->outgoing, tq->debits, tq->numbers);
+        for(i = 0; i < count; ++i){
+            unsigned int number = tq->numbers[i];
+            tq->pending_debits[number] += tq->debits[number];
+            tq->debits[number] = 0;
+            _queue_transfer(tq, number);
+        }
+    }
+    //резервуар с неподтвержденным запросом получит накопленное следующим запросом
+    i = 0;
+    while (i < tq->waiting_count){
+        unsigned int number = tq->waiting[i];
+        if (tq->sent_marks[number]){
+            ++i;
+            continue;
+        }
+        _send_transfer(os, number, tick);
+        tq->waiting_marks[number] = 0;
+        tq->waiting[i] = tq->waiting[--tq->waiting_count];
+    }
+}
+
+static void _prepare_transfers(oil_storage* os, const unsigned int* numbers, size_t count){
+    transfer_queue* tq = os->transfer_queue;
+    unsigned long long now = get_time_trace();
+    if (os->model != NULL){
+        pthread_mutex_lock(&os->model_mutex);
+        advance_level_model(os->model, now);
+    }
+    for(size_t i = 0; i < count; ++i){
+        unsigned int number = numbers[i];
+        tank_state ts;
+        if (os->model != NULL) get_state_level_model(os->model, number, now, &ts);
+        else get_tank_state_tanks_table(os->table, number, &ts);
+        tq->levels[number] = ts.current_level;
+        tq->incoming[number] = (ts.download_state == PUMP_ON ? ts.download_speed : 0) + tq->credits[number] + tq->sent_credits[number];
+        tq->outgoing[number] = ts.upload_state == PUMP_ON ? ts.upload_speed : 0;
+    }
+    if (os->model != NULL) pthread_mutex_unlock(&os->model_mutex);
+}
+
+static void _queue_transfer(transfer_queue* tq, unsigned int number){
+    if (!tq->waiting_marks[number]){
+        tq->waiting_marks[number] = 1;
+        tq->waiting[tq->waiting_count++] = number;
+    }
+}
+
+static void _send_transfer(oil_storage* os, unsigned int number, unsigned long long tick){
+    transfer_queue* tq = os->transfer_queue;
+    unsigned int credit = (unsigned int)tq->credits[number];
+    unsigned int debit = (unsigned int)tq->pending_debits[number];
+    tq->credits[number] = 0;
+    tq->pending_debits[number] = 0;
+    long long delta = (long long)credit - debit;
+    if (delta != os->transfer_rates[number]){
+        if (os->transfer_rates[number] == 0) os->transfer_rate_tanks[os->transfer_rate_count++] = number;
+        os->transfer_rates[number] = delta;
+        _mark_forecast(os, number);
+    }
+    os->transfer_rate_ticks[number] = tick;
+    if (os->model != NULL){
+        tq->taken[number] = _apply_transfer_model(os, number, credit, debit);
+        tq->settled[tq->settled_count++] = number;
+        return;
+    }
+    request_transfer_tanks_table(os->table, number, credit, debit);
+    tq->sent_credits[number] = credit;
+    tq->sent_marks[number] = 1;
+    tq->sent[tq->sent_count++] = number;
+}
+
+static int _take_transfer_result(oil_storage* os, unsigned int number, unsigned int* taken){
+    if (get_transfer_result_tanks_table(os->table, number, taken)) return 1;
+    if (__atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) != -1 || pthread_mutex_trylock(&os->tank_mutexes[number]) != 0) return 0;
+    unsigned int credit, debit;
+    //процесс мог быть запущен или усыплен, пока мьютекс был свободен
+    if (__atomic_load_n(&os->pids[number], __ATOMIC_ACQUIRE) == -1 && take_transfer_tanks_table(os->table, number, &credit, &debit)){
+        tank_state ts;
+        get_tank_state_tanks_table(os->table, number, &ts);
+        unsigned int applied = _apply_transfer_to_state(&ts, credit, debit);
+        set_tank_state_tanks_table(os->table, number, &ts);
+        ack_transfer_tanks_table(os->table, number, applied);
+    }
+    pthread_mutex_unlock(&os->tank_mutexes[number]);
+    return get_transfer_result_tanks_table(os->table, number, taken);
+}
+
+static unsigned int _apply_transfer_to_state(tank_state* ts, unsigned int credit, unsigned int debit){
+    //расчет перекачек оставляет место под начисление, ограничение срабатывает, только если максимум уменьшили после расчета
+    long long room = (long long)ts->maximum_level - (long long)ts->current_level;
+    if ((long long)credit > room) credit = room > 0 ? (unsigned int)room : 0;
+    long long level = (long long)ts->current_level + credit;
+    long long available = level - (long long)ts->minimum_level;
+    unsigned int taken = available <= 0 ? 0 : available < debit ? (unsigned int)available : debit;
+    ts->current_level = (unsigned int)(level - taken);
+    return taken;
+}
+
+static unsigned int _apply_transfer_model(oil_storage* os, unsigned int number, unsigned int credit, unsigned int debit){
+    unsigned long long span = begin_span_trace();
+    pthread_mutex_lock(&os->model_mutex);
+    unsigned long long now = get_time_trace();
+    advance_level_model(os->model, now);
+    tank_state ts;
+    get_state_level_model(os->model, number, now, &ts);
+    unsigned int taken = _apply_transfer_to_state(&ts, credit, debit);
+    if (credit != 0 || taken != 0){
+        set_state_level_model(os->model, number, now, &ts);
+        advance_level_model(os->model, now);
+        get_state_level_model(os->model, number, now, &ts);
+        set_tank_state_tanks_table(os->table, number, &ts);
+    }
+    pthread_mutex_unlock(&os->model_mutex);
+    end_span_trace("model", "transfer", span, (int)number);
+    return taken;
+}
+
+static void _update_snapshot(oil_storage* os, unsigned long long tick){
+    if (os->model != NULL){
+        _refresh_model_snapshot(os, SNAPSHOT_FULL);
+        return;
+    }
+    volume_snapshot* snapshot = os->snapshot;
+    pthread_mutex_lock(&snapshot->mutex);
+    //состояния всех резервуаров снимаются одним копированием таблицы, объемы считаются по этому же снимку;
+    //если все свободные буферы заняты читателями, публикуется только снимок объемов
+    tanks_snapshot* cut = begin_write_epoch_snapshot(os->epochs);
+    if (cut != NULL){
+        copy_states_tanks_table(os->table, cut->current_levels);
+        memcpy(snapshot->levels, cut->current_levels, sizeof(unsigned int) * os->tanks_count);
+    } else {
+        memcpy(snapshot->levels, get_current_levels_tanks_table(os->table), sizeof(unsigned int) * os->tanks_count);
+    }
+    convert_strapping_table(os->strapping, 0, snapshot->levels, os->tanks_count, snapshot->volumes);
+    update_volume_correction(os->correction);
+    snapshot->total_standard_volume = apply_volume_correction(os->correction, 0, snapshot->volumes, os->tanks_count, snapshot->standard_volumes);
+    double total_volume = 0.0;
+    for(size_t i = 0; i < os->tanks_count; ++i){
+        total_volume += snapshot->volumes[i];
+    }
+    snapshot->total_volume = total_volume;
+    snapshot->tick = tick;
+    if (cut != NULL){
+        memcpy(cut->volumes, snapshot->volumes, sizeof(float) * os->tanks_count);
+        memcpy(cut->standard_volumes, snapshot->standard_volumes, sizeof(float) * os->tanks_count);
+        cut->total_volume = snapshot->total_volume;
+        cut->total_standard_volume = snapshot->total_standard_volume;
+        cut->tick = tick;
+        update_tank_groups(os->groups, cut->current_levels, cut->maximum_levels, cut->download_states, cut->upload_states, cut->volumes);
+        update_level_index(os->index, cut->current_levels, cut->minimum_levels, cut->maximum_levels,
+                           cut->states, cut->download_states, cut->upload_states);
+        if (os->export != NULL){
+            const unsigned int* columns[COLUMNS_COUNT] = {
+                    cut->current_levels, (const unsigned int*)cut->states,
+                    (const unsigned int*)cut->download_states, cut->download_speeds,
+                    (const unsigned int*)cut->upload_states, cut->upload_speeds
+            };
+            add_row_column_export(os->export, tick, columns);
+        }
+        publish_epoch_snapshot(os->epochs, cut);
+    }
+    pthread_mutex_unlock(&snapshot->mutex);
+}
+
+static void _mark_forecast(oil_storage* os, unsigned int number){
+    if (os->forecast_marks[number]) return;
+    os->forecast_marks[number] = 1;
+    os->forecast_tanks[os->forecast_count++] = number;
+}
+
+static void _update_forecast(oil_storage* os, unsigned long long tick){
+    pthread_mutex_lock(&os->snapshot->mutex);
+    if (os->model != NULL) pthread_mutex_lock(&os->model_mutex);
+    for(size_t i = 0; i < os->forecast_count; ++i){
+        unsigned int number = os->forecast_tanks[i];
+        tank_state ts;
+        if (os->model != NULL){
+            get_state_level_model(os->model, number, os->snapshot->model_time, &ts);
+        } else {
+            get_tank_state_tanks_table(os->table, number, &ts);
+            ts.current_level = os->snapshot->levels[number];
+        }
+        long long rate = os->transfer_rates[number] + _get_pump_rate(&ts);
+        update_limit_forecast(os->forecast, number, tick, ts.current_level, ts.minimum_level, ts.maximum_level, rate);
+        os->forecast_marks[number] = 0;
+    }
+    if (os->model != NULL) pthread_mutex_unlock(&os->model_mutex);
+    os->forecast_count = 0;
+    os->forecast_tick = tick;
+    pthread_mutex_unlock(&os->snapshot->mutex);
+}
+
+static long long _get_pump_rate(const tank_state* ts){
+    long long rate = 0;
+    if (ts->download_state == PUMP_ON) rate += ts->download_speed;
+    if (ts->upload_state == PUMP_ON) rate -= ts->upload_speed;
+    return rate;
+}
+
+static void _dispatch_scheduled_commands(oil_storage* os, unsigned long long tick){
+    scheduled_command batch[SCHEDULED_BATCH_SIZE];
+    for(int b = 0; b < SCHEDULED_BATCHES_PER_TICK; ++b){
+        //пока потоки выполнения не успевают, наступившие команды остаются в расписании, а не копятся в очередях
+        if (get_pending_command_executor(os->executor) >= SCHEDULED_BATCH_SIZE * SCHEDULED_BATCHES_PER_TICK) return;
+        size_t count = advance_timer_wheel(os->scheduler, tick, batch, SCHEDULED_BATCH_SIZE);
+        for(size_t i = 0; i < count; ++i){
+            submit_command_executor(os->executor, batch[i].command, batch[i].number, batch[i].value);
         }
+        if (count < SCHEDULED_BATCH_SIZE) return;
     }
 }
 
-static void _send_operation_number(int fd, int operation_number){
-    write(fd, &operation_number, sizeof(operation_number));
+static void _dispatch_inbound(oil_storage* os){
+    if (os->model != NULL){
+        //диспетчер каждый такт читает уровни из таблицы: пока идет прием, в нее пишутся уровни меняющихся резервуаров
+        dispatch_stats stats;
+        get_inbound_dispatch_stats(os, &stats);
+        if (stats.rate != 0 || stats.active_tanks != 0) _sync_moving_levels(os);
+    }
+    pthread_mutex_lock(&os->inbound->mutex);
+    size_t count = plan_inbound_dispatcher(os->inbound->dispatcher,
+                                           get_current_levels_tanks_table(os->table),
+                                           get_maximum_levels_tanks_table(os->table),
+                                           get_download_states_tanks_table(os->table),
+                                           get_download_speeds_tanks_table(os->table),
+                                           os->inbound->actions);
+    pthread_mutex_unlock(&os->inbound->mutex);
+    //команды ждут ответов процессов резервуаров (и могут их запускать), поэтому поток управления их не выполняет
+    for(size_t i = 0; i < count; ++i){
+        const dispatch_action* action = &os->inbound->actions[i];
+        switch (action->action){
+            case DISPATCH_ACTION_START:     submit_command_executor(os->executor, COMMAND_TURN_ON_DOWNLOAD_PUMP, action->number, 0); break;
+            case DISPATCH_ACTION_STOP:      submit_command_executor(os->executor, COMMAND_TURN_OFF_DOWNLOAD_PUMP, action->number, 0); break;
+            case DISPATCH_ACTION_SET_SPEED: submit_command_executor(os->executor, COMMAND_SET_SPEED_DOWNLOAD_PUMP, action->number, action->speed); break;
+            default: break;
+        }
+    }
+}
+
+static int _execute_command(void* os_ptr, int command, unsigned int number, unsigned int value){
+    return execute_tank_command(os_ptr, command, number, value);
+}
+
+
+static unsigned long long _get_current_tick(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000 + (unsigned long long)now.tv_nsec / 1000000) / TIME_UNIT;
 }
\ No newline at end of file
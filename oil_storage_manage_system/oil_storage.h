@@ -2,6 +2,19 @@
 #define OIL_STORAGE_MANAGE_SYSTEM_OIL_STORAGE_H
 
 #include "oil_storage_def.h"
+#include "level_history.h"
+#include "fleet_summary.h"
+#include "timer_wheel.h"
+#include "fleet_config.h"
+#include "tanks_table.h"
+#include "volume_correction.h"
+#include "limit_forecast.h"
+#include "inbound_dispatcher.h"
+#include "epoch_snapshot.h"
+#include "level_model.h"
+#include "tank_groups.h"
+#include "level_index.h"
+#include "column_export.h"
 #include <stddef.h>
 
 /**
@@ -21,19 +34,32 @@ typedef struct _oil_storage oil_storage;
  */
 oil_storage* create_oil_storage(size_t storage_tanks_count, unsigned int min_level, unsigned int max_level, unsigned int speed_download_pump, unsigned int speed_upload_pump);
 
+/**
+ * создать нефтехранилище по описаниям резервуаров из конфигурации (все резервуары создаются
+ * одной операцией, процессы запускаются только для резервуаров с включенными насосами)
+ * @param tanks описания резервуаров
+ * @param tanks_count количество резервуаров
+ * @return указатель на нефтрехранилище
+ */
+oil_storage* create_oil_storage_from_config(const tank_config* tanks, size_t tanks_count);
+
 /**
  * переключить резервуар в рабочее состояние
  * @param os указатель на нефтрехранилище
  * @param number номер резервуара
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void turn_on_tank(oil_storage* os, unsigned int number);
+int turn_on_tank(oil_storage* os, unsigned int number);
 
 /**
  * переключить резервуар в нерабочее состояние
  * @param os указатель на нефтрехранилище
  * @param number номер резервуара
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void turn_off_tank(oil_storage* os, unsigned int number);
+int turn_off_tank(oil_storage* os, unsigned int number);
 
 /**
  * Получить состояние работы резевуара
@@ -48,8 +74,10 @@ int get_state_tank(const oil_storage* os, unsigned int number);
  * @param os указатель на нефтехранилище
  * @param number номер резервуара
  * @param min_level минимальный уровень нефти
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void set_minimum_level_tank(oil_storage* os, unsigned int number, unsigned int min_level);
+int set_minimum_level_tank(oil_storage* os, unsigned int number, unsigned int min_level);
 
 /**
  * получить минимальный уровень нефти в резервуаре
@@ -64,8 +92,10 @@ unsigned int get_minimum_level_tank(const oil_storage* os, unsigned int number);
  * @param os указатель на нефтехранилище
  * @param number номер резервуара
  * @param max_level минимальный уровень нефти
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void set_maximum_level_tank(oil_storage* os, unsigned int number, unsigned int max_level);
+int set_maximum_level_tank(oil_storage* os, unsigned int number, unsigned int max_level);
 
 /**
  * получить максимальный уровень нефти в резервуаре
@@ -76,13 +106,96 @@ void set_maximum_level_tank(oil_storage* os, unsigned int number, unsigned int m
 unsigned int get_maximum_level_tank(const oil_storage* os, unsigned int number);
 
 /**
- * получить текущий уровень нефти в резервуаре
+ * получить текущий уровень нефти в резервуаре (если процесс резервуара не отвечает и не восстановился,
+ * возвращается последний уровень из теневой копии состояния)
  * @param os указатель на нефтрехранилище
  * @param number номер резевуара
  * @return уровень нефти
  */
 unsigned int get_current_level_tank(const oil_storage* os, unsigned int number);
 
+/**
+ * получить объем нефти в резервуаре по его градуировочной таблице (пересчитывается каждый такт)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резевуара
+ * @return объем нефти
+ */
+float get_current_volume_tank(const oil_storage* os, unsigned int number);
+
+/**
+ * получить объем нефти в резервуаре, приведенный к 15 °C (пересчитывается каждый такт)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резевуара
+ * @return приведенный объем нефти
+ */
+float get_standard_volume_tank(const oil_storage* os, unsigned int number);
+
+/**
+ * задать продукт, плотность и температуру нефти в резервуаре (коэффициент приведения пересчитывается в следующем такте)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резевуара
+ * @param product вид продукта (VOLUME_CORRECTION_CRUDE, VOLUME_CORRECTION_REFINED)
+ * @param density плотность при 15 °C в кг/м3
+ * @param temperature температура в °C
+ * @return TANK_OK, TANK_ERROR_NUMBER, TANK_ERROR_VALUE - значение вне допустимого диапазона
+ */
+int set_product_tank(oil_storage* os, unsigned int number, int product, float density, float temperature);
+
+/**
+ * получить время до достижения резервуаром максимального и минимального уровня при текущих насосах и перекачках
+ * (по снимку последнего такта)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резевуара
+ * @param time_to_max время до максимального уровня в мс (LIMIT_FORECAST_NEVER - уровень не растет)
+ * @param time_to_min время до минимального уровня в мс (LIMIT_FORECAST_NEVER - уровень не падает)
+ * @return TANK_OK, TANK_ERROR_NUMBER
+ */
+int get_tank_eta(const oil_storage* os, unsigned int number, unsigned long long* time_to_max, unsigned long long* time_to_min);
+
+/**
+ * получить резервуары, которые раньше всех достигнут границы уровня
+ * @param os указатель на нефтрехранилище
+ * @param etas массив для ожидаемых достижений (по возрастанию времени)
+ * @param count максимальное количество резервуаров
+ * @return количество резервуаров в массиве
+ */
+size_t get_next_limits(const oil_storage* os, limit_eta* etas, size_t count);
+
+/**
+ * начать прием нефти: скорость поступления распределяется по насосам налива резервуаров диапазона
+ * и перераспределяется каждый такт по мере их заполнения (повторный вызов меняет задание)
+ * @param os указатель на нефтрехранилище
+ * @param first первый резервуар диапазона
+ * @param last последний резервуар диапазона
+ * @param rate скорость поступления за такт
+ * @return TANK_OK, TANK_ERROR_NUMBER - неверный диапазон
+ */
+int start_inbound_dispatch(oil_storage* os, unsigned int first, unsigned int last, unsigned int rate);
+
+/**
+ * остановить прием нефти (насосы, включенные диспетчером, выключаются в следующем такте)
+ * @param os указатель на нефтрехранилище
+ */
+void stop_inbound_dispatch(oil_storage* os);
+
+/**
+ * получить состояние распределения приема нефти
+ * @param os указатель на нефтрехранилище
+ * @param stats структура для состояния
+ */
+void get_inbound_dispatch_stats(const oil_storage* os, dispatch_stats* stats);
+
+/**
+ * получить продукт, плотность и температуру нефти в резервуаре
+ * @param os указатель на нефтрехранилище
+ * @param number номер резевуара
+ * @param product вид продукта
+ * @param density плотность при 15 °C
+ * @param temperature температура
+ * @return TANK_OK, TANK_ERROR_NUMBER
+ */
+int get_product_tank(const oil_storage* os, unsigned int number, int* product, float* density, float* temperature);
+
 /**
  * уничтожить нефтрехранилище
  * @param os укзатель на нефтрехранилище
@@ -93,15 +206,19 @@ void finalize_oil_storage(oil_storage* os);
  * включить насос закачки в резервуаре
  * @param os указатель на нефтрехранилище
  * @param number номер резервуара
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void turn_on_download_pump(oil_storage* os, unsigned int number);
+int turn_on_download_pump(oil_storage* os, unsigned int number);
 
 /**
  * выключить насос закачки в резервуаре
  * @param os указатель на нефтрехранилище
  * @param number номер резервуара
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void turn_off_download_pump(oil_storage* os, unsigned int number);
+int turn_off_download_pump(oil_storage* os, unsigned int number);
 
 /**
  * получить состояние работы насоса загрузки в резервуаре
@@ -116,8 +233,10 @@ int get_state_download_pump(const oil_storage* os, unsigned int number);
  * @param os указатель на нефтрехранилище
  * @param number номер резевуара
  * @param download_speed скорость закачки
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void set_speed_download_pump(oil_storage* os, unsigned int number, unsigned int download_speed);
+int set_speed_download_pump(oil_storage* os, unsigned int number, unsigned int download_speed);
 
 /**
  * получить скорость закачки насоса в резевуаре
@@ -131,15 +250,19 @@ unsigned int get_speed_download_pump(const oil_storage* os, unsigned int number)
  * включить насос откачки в резервуаре
  * @param os указатель на нефтрехранилище
  * @param number номер резервуара
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void turn_on_upload_pump(oil_storage* os, unsigned int number);
+int turn_on_upload_pump(oil_storage* os, unsigned int number);
 
 /**
  * выключить насос откачки в резервуаре
  * @param os указатель на нефтрехранилище
  * @param number номер резервуара
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void turn_off_upload_pump(oil_storage* os, unsigned int number);
+int turn_off_upload_pump(oil_storage* os, unsigned int number);
 
 /**
  * получить состояние работы насоса отгрузки в резервуаре
@@ -154,8 +277,10 @@ int get_state_upload_pump(const oil_storage* os, unsigned int number);
  * @param os указатель на нефтрехранилище
  * @param number номер резевуара
  * @param upload_speed скорость откачки
+ * @return TANK_OK - команда выполнена, TANK_ERROR_NUMBER - нет резервуара с таким номером,
+ *         TANK_ERROR_WORKER - процесс резервуара не удалось восстановить
  */
-void set_speed_upload_pump(oil_storage* os, unsigned int number, unsigned int upload_speed);
+int set_speed_upload_pump(oil_storage* os, unsigned int number, unsigned int upload_speed);
 
 /**
  * получить скорость откачки насоса в резевуаре
@@ -172,4 +297,314 @@ unsigned int get_speed_upload_pump(const oil_storage* os, unsigned int number);
  */
 size_t get_count_tanks(const oil_storage *os);
 
-#endif //OIL_STORAGE_MANAGE_SYSTEM_OIL_STORAGE_H
\ No newline at end of file
+/**
+ * добавить перекачку нефти между резервуарами (перекачка создается остановленной)
+ * @param os указатель на нефтрехранилище
+ * @param name имя перекачки
+ * @param source номер резервуара, из которого перекачивается нефть
+ * @param destination номер резервуара, в который перекачивается нефть
+ * @param rate скорость перекачки
+ * @return 0 - перекачка добавлена, -1 - ошибка (имя занято или неверные номера резервуаров)
+ */
+int add_transfer(oil_storage* os, const char* name, unsigned int source, unsigned int destination, unsigned int rate);
+
+/**
+ * запустить перекачку (перекачка останавливается сама, когда источник опустится до минимального уровня
+ * или приемник заполнится до максимального уровня)
+ * @param os указатель на нефтрехранилище
+ * @param name имя перекачки
+ * @return 0 - перекачка запущена, -1 - перекачка не найдена
+ */
+int start_transfer(oil_storage* os, const char* name);
+
+/**
+ * остановить перекачку
+ * @param os указатель на нефтрехранилище
+ * @param name имя перекачки
+ * @return 0 - перекачка остановлена, -1 - перекачка не найдена
+ */
+int stop_transfer(oil_storage* os, const char* name);
+
+/**
+ * получить описание перекачки
+ * @param os указатель на нефтрехранилище
+ * @param name имя перекачки
+ * @param source номер резервуара-источника
+ * @param destination номер резервуара-приемника
+ * @param rate скорость перекачки
+ * @param moved перекачанный объем
+ * @return TRANSFER_ON - перекачка идет, TRANSFER_OFF - перекачка остановлена, -1 - перекачка не найдена
+ */
+int get_transfer(const oil_storage* os, const char* name, unsigned int* source, unsigned int* destination, unsigned int* rate, unsigned long long* moved);
+
+/**
+ * добавить группу резервуаров
+ * @param os указатель на нефтрехранилище
+ * @param name имя группы
+ * @param parent имя объемлющей группы (NULL - группа верхнего уровня)
+ * @return 0 - группа добавлена, -1 - ошибка (имя занято, нет объемлющей группы)
+ */
+int add_group(oil_storage* os, const char* name, const char* parent);
+
+/**
+ * включить резервуар в группу (резервуар учитывается и во всех объемлющих группах)
+ * @param os указатель на нефтрехранилище
+ * @param name имя группы
+ * @param number номер резервуара
+ * @return 0 - резервуар включен, -1 - ошибка (нет группы или резервуара, резервуар уже в группе той же иерархии)
+ */
+int assign_group(oil_storage* os, const char* name, unsigned int number);
+
+/**
+ * получить сводные показатели группы (поддерживаются при каждом изменении резервуаров, чтение за O(1))
+ * @param os указатель на нефтрехранилище
+ * @param name имя группы
+ * @param totals показатели группы
+ * @return 0 - показатели получены, -1 - группа не найдена
+ */
+int get_group_totals(const oil_storage* os, const char* name, group_totals* totals);
+
+/**
+ * найти резервуары по уровню и состоянию насосов (по индексу, время пропорционально количеству найденных резервуаров)
+ * @param os указатель на нефтрехранилище
+ * @param query запрос (разбирается parse_level_query)
+ * @param numbers массив для номеров резервуаров
+ * @param max_count максимальное количество номеров в массиве
+ * @return количество всех найденных резервуаров (может быть больше max_count)
+ */
+size_t find_tanks(const oil_storage* os, const level_query* query, unsigned int* numbers, size_t max_count);
+
+/**
+ * начать выгрузку уровня, состояний и скоростей насосов всех резервуаров каждый такт в столбцовом формате
+ * (файлы столбцов в каталоге, сжатие и запись в фоновом потоке, чтение - column_reader.h)
+ * @param os указатель на нефтрехранилище
+ * @param directory каталог выгрузки
+ * @return 0 - выгрузка начата, -1 - выгрузка уже идет или файлы не удалось создать
+ */
+int start_export(oil_storage* os, const char* directory);
+
+/**
+ * остановить выгрузку (оставшиеся строки дописываются)
+ * @param os указатель на нефтрехранилище
+ * @return 0 - выгрузка остановлена, -1 - выгрузка не шла
+ */
+int stop_export(oil_storage* os);
+
+/**
+ * получить статистику выгрузки
+ * @param os указатель на нефтрехранилище
+ * @param stats структура для статистики
+ * @return 0 - статистика получена, -1 - выгрузка не идет
+ */
+int get_export_stats(const oil_storage* os, export_stats* stats);
+
+/**
+ * отложить выполнение команды
+ * @param os указатель на нефтрехранилище
+ * @param delay задержка до первого выполнения в мс
+ * @param period период повторения в мс (0 - однократная команда)
+ * @param command команда (COMMAND_TURN_ON_TANK, COMMAND_SET_SPEED_UPLOAD_PUMP, ...)
+ * @param number номер резервуара
+ * @param value значение параметра команды (для команд установки уровня и скорости)
+ * @return идентификатор записи в расписании, 0 - ошибка
+ */
+unsigned long long schedule_command(oil_storage* os, unsigned int delay, unsigned int period, int command, unsigned int number, unsigned int value);
+
+/**
+ * выполнить команду по ее коду (так же выполняются отложенные команды)
+ * @param os указатель на нефтрехранилище
+ * @param command команда (COMMAND_TURN_ON_TANK, COMMAND_SET_SPEED_UPLOAD_PUMP, ...)
+ * @param number номер резервуара
+ * @param value значение параметра команды (для команд установки уровня и скорости)
+ * @return TANK_OK, TANK_ERROR_NUMBER, TANK_ERROR_WORKER, TANK_ERROR_VALUE - неизвестная команда
+ */
+int execute_tank_command(oil_storage* os, int command, unsigned int number, unsigned int value);
+
+/**
+ * отменить отложенную команду
+ * @param os указатель на нефтрехранилище
+ * @param id идентификатор записи в расписании
+ * @return 0 - команда отменена, -1 - запись не найдена
+ */
+int cancel_scheduled_command(oil_storage* os, unsigned long long id);
+
+/**
+ * получить статистику расписания (ожидающие, выполненные и опоздавшие команды)
+ * @param os указатель на нефтрехранилище
+ * @param stats статистика
+ */
+void get_scheduler_stats(const oil_storage* os, scheduler_stats* stats);
+
+/**
+ * получить время запуска нефтехранилища (от начала создания до готовности всех резервуаров)
+ * @param os указатель на нефтрехранилище
+ * @return время запуска в мкс
+ */
+unsigned long long get_startup_time_oil_storage(const oil_storage* os);
+
+/**
+ * проверить, спит ли резервуар (насосы резервуара выключены, процесс резервуара завершен,
+ * состояние хранится в таблице состояний; резервуар просыпается при включении насоса)
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @return 1 - резервуар спит, 0 - резервуар работает
+ */
+int is_hibernated_tank(const oil_storage* os, unsigned int number);
+
+/**
+ * статистика сторожа процессов резервуаров
+ */
+typedef struct _watchdog_stats{
+    /**
+     * количество перезапусков упавших и зависших процессов резервуаров
+     */
+    unsigned long long restarts;
+    /**
+     * количество перезапусков, после которых процесс не ответил (насосы резервуара выключены)
+     */
+    unsigned long long failures;
+    /**
+     * время восстановления при последнем перезапуске в мс (от последней публикации состояния до готовности)
+     */
+    unsigned long long last_failover_time;
+    /**
+     * максимальное время восстановления в мс
+     */
+    unsigned long long max_failover_time;
+} watchdog_stats;
+
+/**
+ * получить статистику сторожа процессов резервуаров
+ * @param os указатель на нефтрехранилище
+ * @param stats статистика
+ */
+void get_watchdog_stats(const oil_storage* os, watchdog_stats* stats);
+
+/**
+ * статистика аварийных остановок
+ */
+typedef struct _emergency_stats{
+    /**
+     * количество аварийных остановок
+     */
+    unsigned long long stops;
+    /**
+     * количество остановок, не подтвержденных процессом резервуара (процесс остановлен и перезапущен)
+     */
+    unsigned long long failures;
+    /**
+     * время от запроса до выполнения последней остановки в мкс
+     */
+    unsigned long long last_latency;
+    /**
+     * максимальное время выполнения остановки в мкс
+     */
+    unsigned long long max_latency;
+    /**
+     * суммарное время выполнения остановок в мкс
+     */
+    unsigned long long total_latency;
+} emergency_stats;
+
+/**
+ * аварийно остановить резервуар в обход очереди команд его процесса: запрос передается через таблицу
+ * состояний и выполняется отдельным потоком процесса, поэтому время остановки не зависит от количества
+ * ожидающих команд; команды включения, отправленные до остановки, не выполняются; у спящего резервуара
+ * остановка выполняется над состоянием в таблице, не подтвердивший остановку процесс перезапускается
+ * @param os указатель на нефтрехранилище
+ * @param number номер резервуара
+ * @param flags что выключить (EMERGENCY_STOP_TANK, EMERGENCY_STOP_DOWNLOAD_PUMP, EMERGENCY_STOP_UPLOAD_PUMP)
+ * @return TANK_OK, TANK_ERROR_NUMBER, TANK_ERROR_VALUE - неверные флаги
+ */
+int emergency_stop_tank(oil_storage* os, unsigned int number, int flags);
+
+/**
+ * получить статистику аварийных остановок
+ * @param os указатель на нефтрехранилище
+ * @param stats статистика
+ */
+void get_emergency_stats(const oil_storage* os, emergency_stats* stats);
+
+/**
+ * получить статистику аналитической модели уровня (режим задается переменной окружения LEVEL_MODEL_ENV)
+ * @param os указатель на нефтрехранилище
+ * @param stats статистика
+ * @return 0 - статистика получена, -1 - уровень меняют процессы резервуаров
+ */
+int get_level_model_stats(const oil_storage* os, level_model_stats* stats);
+
+/**
+ * получить количество работающих (не спящих) резервуаров
+ * @param os указатель на нефтрехранилище
+ * @return количество резервуаров, у которых есть процесс
+ */
+size_t get_active_tanks_count(const oil_storage* os);
+
+/**
+ * получить историю уровня нефти в резервуаре за последний период
+ * @param os указатель на нефтрехранилище
+ * @param number номер резевуара
+ * @param period длительность периода в мс
+ * @param step шаг между точками в мс
+ * @param points массив для точек истории
+ * @param max_count размер массива точек
+ * @return количество записанных точек
+ */
+size_t get_level_history_tank(const oil_storage* os, unsigned int number, unsigned int period, unsigned int step, history_point* points, size_t max_count);
+
+/**
+ * получить сводные показатели по всем резервуарам (суммарный объем, свободная вместимость,
+ * самый заполненный и самый пустой резервуары, гистограмма заполненности)
+ * @param os указатель на нефтрехранилище
+ * @param fs сводные показатели
+ */
+void get_fleet_summary(const oil_storage* os, fleet_summary* fs);
+
+/**
+ * получить состояния подряд идущих резервуаров из последнего согласованного снимка
+ * (без обмена командами с процессами резервуаров, все резервуары на один такт)
+ * @param os указатель на нефтрехранилище
+ * @param first номер первого резервуара
+ * @param count количество резервуаров
+ * @param states массив для состояний
+ * @return количество записанных состояний
+ */
+size_t get_tanks_states(const oil_storage* os, unsigned int first, size_t count, tank_state* states);
+
+/**
+ * захватить последний согласованный снимок всех резервуаров: уровни, уставки, состояния насосов
+ * и объемы сняты в один такт (для сверок и отчетов об остатках); захват не блокирует движок,
+ * снимок не меняется до освобождения
+ * @param os указатель на нефтехранилище
+ * @return снимок
+ */
+const tanks_snapshot* acquire_tanks_snapshot(const oil_storage* os);
+
+/**
+ * освободить снимок, захваченный acquire_tanks_snapshot
+ * @param os указатель на нефтехранилище
+ * @param snapshot снимок
+ */
+void release_tanks_snapshot(const oil_storage* os, const tanks_snapshot* snapshot);
+
+/**
+ * получить объемы нефти подряд идущих резервуаров из последнего согласованного снимка
+ * @param os указатель на нефтехранилище
+ * @param first номер первого резервуара
+ * @param count количество резервуаров
+ * @param volumes массив для объемов (NULL - не нужны)
+ * @param standard_volumes массив для приведенных объемов (NULL - не нужны)
+ * @return количество прочитанных объемов
+ */
+size_t get_tanks_volumes(const oil_storage* os, unsigned int first, size_t count, float* volumes, float* standard_volumes);
+
+/**
+ * загрузить градуировочные таблицы из файла (резервуары с table=N в конфигурации получают N-ю таблицу файла)
+ * @param os указатель на нефтехранилище
+ * @param path путь к файлу таблиц
+ * @param error_line номер строки с ошибкой (0 - ошибка чтения файла), может быть NULL
+ * @return количество загруженных таблиц, -1 - ошибка
+ */
+int load_strapping_tables(oil_storage* os, const char* path, size_t* error_line);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_OIL_STORAGE_H
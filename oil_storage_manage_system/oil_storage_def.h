@@ -6,5 +6,30 @@
 #define TIME_UNIT 10                //время в мс, за которое происходит одно изменение
 #define PUMP_ON 1                   //насос включен
 #define PUMP_OFF 0                  //насос выключен
+#define TRANSFER_ON 1               //перекачка между резервуарами идет
+#define TRANSFER_OFF 0              //перекачка между резервуарами остановлена
+#define COMMAND_TURN_ON_TANK            1   //команды, которые можно отложить в расписании
+#define COMMAND_TURN_OFF_TANK           2
+#define COMMAND_SET_MINIMUM_LEVEL_TANK  3
+#define COMMAND_SET_MAXIMUM_LEVEL_TANK  4
+#define COMMAND_TURN_ON_DOWNLOAD_PUMP   5
+#define COMMAND_TURN_OFF_DOWNLOAD_PUMP  6
+#define COMMAND_SET_SPEED_DOWNLOAD_PUMP 7
+#define COMMAND_TURN_ON_UPLOAD_PUMP     8
+#define COMMAND_TURN_OFF_UPLOAD_PUMP    9
+#define COMMAND_SET_SPEED_UPLOAD_PUMP   10
+#define HISTORY_BUFFER_SIZE 262144  //объем памяти в байтах под историю уровня одного резервуара
+#define HIBERNATION_DELAY 100       //время простоя резервуара в тактах, после которого его процесс завершается
+#define HEARTBEAT_PERIOD 10         //период публикации состояния простаивающим процессом резервуара в тактах
+#define HEARTBEAT_TIMEOUT 50        //время без публикации состояния в тактах, после которого процесс резервуара считается зависшим
+#define ANSWER_TIMEOUT 200          //время ожидания ответа процесса резервуара в мс
+#define EMERGENCY_STOP_TANK 1       //аварийная остановка: выключить резервуар (вместе с насосами)
+#define EMERGENCY_STOP_DOWNLOAD_PUMP 2  //аварийная остановка: выключить насос налива
+#define EMERGENCY_STOP_UPLOAD_PUMP 4    //аварийная остановка: выключить насос слива
+#define EMERGENCY_TIMEOUT 200       //время ожидания подтверждения аварийной остановки процессом резервуара в мс
+#define TANK_OK 0                   //команда резервуара выполнена
+#define TANK_ERROR_NUMBER -1        //резервуара с таким номером нет
+#define TANK_ERROR_WORKER -2        //процесс резервуара не отвечает и не может быть перезапущен
+#define TANK_ERROR_VALUE -3         //недопустимое значение параметра
 
 #endif //OIL_STORAGE_MANAGE_SYSTEM_OIL_STORAGE_DEF_H
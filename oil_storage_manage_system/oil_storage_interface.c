@@ -1,10 +1,87 @@
 #include "oil_storage_interface.h"
+#include "command_queue.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <termios.h>
+#include <sys/ioctl.h>
+
+#define VIEW_DETAILS            0   //подробный вид: резервуары с характеристиками
+#define VIEW_HEATMAP            1   //обзор: одна цветная клетка на резервуар
+#define HEATMAP_RESERVED_ROWS   30  //строки экрана под состояние системы и консоль в режиме обзора
+#define HEATMAP_DEFAULT_COLUMNS 100 //ширина обзора, если размер терминала неизвестен
+#define HEATMAP_COLOR_OFF       236 //цвет выключенного резервуара
+#define HEATMAP_COLOR_LOW       208 //цвет резервуара на минимальном уровне
+#define HEATMAP_COLOR_HIGH      196 //цвет резервуара на максимальном уровне
+#define FRAME_PERIOD            40  //период кадра и сбора данных для него в мс
+#define CONSOLE_LOG_SIZE        200 //строки журнала консоли (кольцо)
+#define CONSOLE_SHOWN_LINES     20  //строки журнала консоли на экране
+#define CONSOLE_LINE_SIZE       COMMAND_QUEUE_LINE_SIZE //наибольшая длина строки консоли
+#define COMMAND_QUEUE_CAPACITY  64  //команды, ожидающие выполнения
+#define COMMAND_WAIT_TIMEOUT    100 //ожидание команды в мс, после которого проверяется завершение интерфейса
+
+/**
+ * данные кадра: собираются потоком сбора в один буфер, пока поток отрисовки выводит другой
+ * (поток отрисовки не обращается к нефтехранилищу)
+ */
+typedef struct _interface_frame{
+    /**
+     * вид (VIEW_DETAILS, VIEW_HEATMAP)
+     */
+    int view_mode;
+    /**
+     * количество резервуаров
+     */
+    size_t count_tanks;
+    /**
+     * резервуар под курсором
+     */
+    unsigned int cursor_tank;
+    /**
+     * подробный вид: первый выведенный резервуар и количество выведенных резервуаров
+     */
+    unsigned int first_shown_tank;
+    size_t shown_tanks_count;
+    /**
+     * подробный вид: состояния, объемы и время до границ выведенных резервуаров
+     */
+    tank_state* shown_states;
+    float* shown_volumes;
+    float* shown_standard_volumes;
+    unsigned long long* shown_times_to_max;
+    unsigned long long* shown_times_to_min;
+    size_t shown_capacity;
+    /**
+     * обзор: ширина в клетках, первая выведенная строка, количество клеток и сами клетки (цвет, символ, курсор)
+     */
+    size_t heatmap_width;
+    size_t heatmap_first_row;
+    size_t heatmap_cells_count;
+    int* heatmap_cells;
+    size_t heatmap_capacity;
+    /**
+     * обзор: состояние и объем резервуара под курсором
+     */
+    tank_state cursor_state;
+    float cursor_volume;
+    /**
+     * состояние системы
+     */
+    scheduler_stats scheduler;
+    unsigned long long startup_time;
+    size_t active_count;
+    int has_level_model;
+    level_model_stats level_model;
+    watchdog_stats watchdog;
+    emergency_stats emergency;
+    int has_exports;
+    export_stats exports;
+    dispatch_stats dispatch;
+} interface_frame;
 
 static size_t width_tank                = 7;
 static size_t height_tank               = 11;
@@ -18,6 +95,36 @@ static char* upper_border_empty         = NULL;
 static char* upper_border_full          = NULL;
 static char* between_tanks              = NULL;
 
+static const unsigned char heatmap_colors[] = {17, 18, 19, 20, 21, 27, 33, 39, 45, 51};
+static int view_mode                    = -1;
+static unsigned int cursor_tank         = 0;
+static unsigned int navigation_step     = 1;
+static int interface_running            = 1;
+
+static interface_frame frames[2];
+static int frame_readers[2]             = {0, 0};
+static int published_frame              = -1;
+static unsigned int first_shown_tank    = 0;
+static size_t collected_first_row       = 0;
+
+static int rendered_view_mode           = -1;
+static int* heatmap_cells               = NULL;
+static size_t heatmap_cells_count       = 0;
+static size_t heatmap_width             = 0;
+static size_t heatmap_first_row         = 0;
+static char* heatmap_frame              = NULL;
+static size_t heatmap_frame_size        = 0;
+
+static command_queue* commands          = NULL;
+static char console_log[CONSOLE_LOG_SIZE][CONSOLE_LINE_SIZE];
+static size_t console_log_count         = 0;
+static char console_input[CONSOLE_LINE_SIZE] = ">";
+static unsigned int console_input_sequence = 0;
+
+static pthread_t collect_thread;
+static pthread_t command_thread;
+static pthread_t read_chars_thread;
+
 static struct termios stored_settings;
 
 static void  _set_keypress_mode();
@@ -25,38 +132,118 @@ static void  _reset_keypress_mode();
 
 static void _generate_pseudo_graphics_string();
 
-static void _output_tanks_labels(const oil_storage *os);
+static void _get_terminal_size(size_t* columns, size_t* rows);
+
+static void _wait_next_frame(struct timespec* next);
+
+static void* _collect_frames(void* os_ptr);
+
+static int _collect_frame(const oil_storage *os, interface_frame *frame);
+
+static void _update_shown_tanks(const oil_storage *os, interface_frame *frame, size_t columns);
+
+static void _collect_details(const oil_storage *os, const tanks_snapshot *snapshot, interface_frame *frame);
+
+static void _collect_heatmap(const tanks_snapshot *snapshot, interface_frame *frame, size_t columns, size_t rows);
+
+static void _collect_system_state(const oil_storage *os, interface_frame *frame);
+
+static interface_frame* _begin_write_frame();
+
+static void _publish_frame(interface_frame *frame);
+
+static const interface_frame* _acquire_frame();
+
+static void _release_frame(const interface_frame *frame);
+
+static void _finalize_frame(interface_frame *frame);
+
+static void _render_frame();
+
+static void _output_heatmap(const interface_frame *frame);
+
+static int _get_heatmap_cell(const tank_state* ts, int is_cursor);
+
+static void _append_heatmap_frame(size_t* len, const char* str, size_t str_len);
+
+static int _handle_navigation_key(const oil_storage *os, char c);
+
+static void _set_view_mode(int mode);
+
+static void _output_tanks_labels(const interface_frame *frame);
+
+static void _output_tanks_state(const interface_frame *frame);
+
+static void _output_format_tanks_labels(const interface_frame *frame, char* name, size_t real_size_name, char** labels);
 
-static void _output_tanks_state(const oil_storage *os);
+static void _output_characteristics_tanks(const interface_frame *frame);
 
-static void _output_format_tanks_labels(const oil_storage *os, char* name, size_t real_size_name, char** labels);
+static void _output_console();
+static void* _read_chars(void* os_ptr);
+static void* _execute_commands(void* os_ptr);
 
-static void _output_characteristics_tanks(const oil_storage *os);
+static void _append_console_log(const char* line);
 
-pthread_t _read_chars_thread;
-int continue_read_char = 1;
-int chars_buffer[10000];
-int last_write_char = 0;
-static void _output_console(oil_storage *os);
-static void* _read_chars(void* params);
+static void _publish_console_input(const char* line);
+
+static void _read_console_input(char* line);
 
 static char* _implement_command(oil_storage *os, char *command_line);
 
+static unsigned int _parse_duration(char* str, char** end);
+
+static char* _format_level_history(oil_storage *os, unsigned int number, char* args);
+
+static char* _format_fleet_summary(oil_storage *os);
+
+static char* _format_next_limits(oil_storage *os, char* args);
+
+static char* _format_found_tanks(oil_storage *os, char* args);
+
+static int _compare_numbers(const void* a, const void* b);
+
+static void _format_eta(char* str, unsigned long long time);
+
+static char* _implement_transfer_command(oil_storage *os, char *command, char *args);
+
+static char* _implement_schedule_command(oil_storage *os, char *command, char *args);
+
+static char* _implement_dispatch_command(oil_storage *os, char *command, char *args);
+
+static char* _implement_group_command(oil_storage *os, char *command, char *args);
+
+static char* _implement_export_command(oil_storage *os, char *command, char *args);
+
+static void _output_system_state(const interface_frame *frame);
+
 void start_oil_storage_interface(oil_storage *os){
     _set_keypress_mode();
     _generate_pseudo_graphics_string();
     printf("\033[2J");
-    while(continue_read_char){
-        printf("\033[0;0H");
-        _output_tanks_labels(os);
-        _output_tanks_state(os);
-        _output_characteristics_tanks(os);
-        printf("\033[K\n");
-        _output_console(os);
-        usleep(40*1000);
+    set_thread_name_trace("interface");
+    //сбор данных, отрисовка и выполнение команд идут в отдельных потоках: медленная команда не останавливает
+    //экран, а медленная отрисовка не задерживает команды
+    commands = create_command_queue(COMMAND_QUEUE_CAPACITY);
+    pthread_create(&collect_thread, NULL, _collect_frames, os);
+    pthread_create(&command_thread, NULL, _execute_commands, os);
+    pthread_create(&read_chars_thread, NULL, _read_chars, os);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(__atomic_load_n(&interface_running, __ATOMIC_ACQUIRE)){
+        _render_frame();
+        _wait_next_frame(&next);
     }
-    pthread_join(_read_chars_thread, NULL);
+    pthread_join(command_thread, NULL);
+    pthread_join(collect_thread, NULL);
+    //последний кадр выводит ответ на команду завершения
+    _render_frame();
+    pthread_join(read_chars_thread, NULL);
     _reset_keypress_mode();
+    finalize_command_queue(commands);
+    _finalize_frame(&frames[0]);
+    _finalize_frame(&frames[1]);
+    free(heatmap_cells);
+    free(heatmap_frame);
     printf("\033[2J\033[0;0H");
     fflush(stdin);
 }
@@ -65,7 +252,7 @@ static void  _set_keypress_mode(){
     struct termios new_settings;
     tcgetattr(0,&stored_settings);
     new_settings = stored_settings;
-    new_settings.c_lflag &= (~ICANON);
+    new_settings.c_lflag &= (~ICANON & ~ECHO);
     new_settings.c_cc[VTIME] = 0;
     new_settings.c_cc[VMIN] = 1;
     tcsetattr(0,TCSANOW,&new_settings);
@@ -141,15 +328,345 @@ static void _generate_pseudo_graphics_string(){
     }
 }
 
-static void _output_tanks_labels(const oil_storage *os){
+static void _get_terminal_size(size_t* columns, size_t* rows){
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0){
+        *columns = ws.ws_col;
+        *rows = ws.ws_row;
+    } else {
+        *columns = 0;
+        *rows = 0;
+    }
+}
+
+static void _wait_next_frame(struct timespec* next){
+    next->tv_nsec += FRAME_PERIOD * 1000000L;
+    if (next->tv_nsec >= 1000000000L){
+        next->tv_sec++;
+        next->tv_nsec -= 1000000000L;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    //опоздавший кадр не догоняется серией кадров подряд, следующий отсчитывается от текущего момента
+    if (now.tv_sec > next->tv_sec || (now.tv_sec == next->tv_sec && now.tv_nsec >= next->tv_nsec)){
+        *next = now;
+        return;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, next, NULL) != 0);
+}
+
+static void* _collect_frames(void* os_ptr){
+    const oil_storage* os = os_ptr;
+    set_thread_name_trace("collector");
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(__atomic_load_n(&interface_running, __ATOMIC_ACQUIRE)){
+        unsigned long long span = begin_span_trace();
+        //оба буфера заняты, только если отрисовка еще выводит предыдущий кадр - тогда сбор пропускается
+        interface_frame* frame = _begin_write_frame();
+        if (frame != NULL && _collect_frame(os, frame) == 0) _publish_frame(frame);
+        end_span_trace("interface", "collect", span, TRACE_NO_ARG);
+        _wait_next_frame(&next);
+    }
+    return NULL;
+}
+
+static int _collect_frame(const oil_storage *os, interface_frame *frame){
+    size_t columns, rows;
+    _get_terminal_size(&columns, &rows);
+    //все резервуары кадра берутся из одного согласованного снимка
+    const tanks_snapshot* snapshot = acquire_tanks_snapshot(os);
+    if (snapshot == NULL) return -1;
+    _update_shown_tanks(os, frame, columns);
+    if (frame->view_mode == VIEW_HEATMAP) _collect_heatmap(snapshot, frame, columns, rows);
+    else _collect_details(os, snapshot, frame);
+    release_tanks_snapshot(os, snapshot);
+    _collect_system_state(os, frame);
+    return 0;
+}
+
+static void _update_shown_tanks(const oil_storage *os, interface_frame *frame, size_t columns){
+    size_t count_tanks = get_count_tanks(os);
+    size_t fit = count_tanks;
+    if (columns > 2 * distance_between_tanks + width_tank){
+        fit = (columns - 2 * distance_between_tanks) / (width_tank + distance_between_tanks);
+    }
+    int mode = __atomic_load_n(&view_mode, __ATOMIC_ACQUIRE);
+    if (mode == -1){
+        int initial = fit < count_tanks ? VIEW_HEATMAP : VIEW_DETAILS;
+        //вид, выбранный командой раньше первого кадра, не перезаписывается
+        if (__atomic_compare_exchange_n(&view_mode, &mode, initial, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) mode = initial;
+    }
+    unsigned int cursor = __atomic_load_n(&cursor_tank, __ATOMIC_ACQUIRE);
+    if (count_tanks > 0 && cursor >= count_tanks){
+        cursor = (unsigned int)count_tanks - 1;
+        __atomic_store_n(&cursor_tank, cursor, __ATOMIC_RELEASE);
+    }
+    if (cursor < first_shown_tank) first_shown_tank = cursor;
+    if (fit > 0 && cursor >= first_shown_tank + fit) first_shown_tank = cursor - fit + 1;
+    if (first_shown_tank + fit > count_tanks) first_shown_tank = count_tanks > fit ? count_tanks - fit : 0;
+    frame->view_mode = mode;
+    frame->count_tanks = count_tanks;
+    frame->cursor_tank = cursor;
+    frame->first_shown_tank = first_shown_tank;
+    frame->shown_tanks_count = count_tanks - first_shown_tank < fit ? count_tanks - first_shown_tank : fit;
+}
+
+static void _collect_details(const oil_storage *os, const tanks_snapshot *snapshot, interface_frame *frame){
+    size_t count = frame->shown_tanks_count;
+    if (count > frame->shown_capacity){
+        frame->shown_states = realloc(frame->shown_states, sizeof(tank_state) * count);
+        frame->shown_volumes = realloc(frame->shown_volumes, sizeof(float) * count);
+        frame->shown_standard_volumes = realloc(frame->shown_standard_volumes, sizeof(float) * count);
+        frame->shown_times_to_max = realloc(frame->shown_times_to_max, sizeof(unsigned long long) * count);
+        frame->shown_times_to_min = realloc(frame->shown_times_to_min, sizeof(unsigned long long) * count);
+        frame->shown_capacity = count;
+    }
+    for(size_t i = 0; i < count; ++i){
+        unsigned int number = frame->first_shown_tank + (unsigned int)i;
+        get_tank_state_epoch_snapshot(snapshot, number, &frame->shown_states[i]);
+        frame->shown_volumes[i] = snapshot->volumes[number];
+        frame->shown_standard_volumes[i] = snapshot->standard_volumes[number];
+        get_tank_eta(os, number, &frame->shown_times_to_max[i], &frame->shown_times_to_min[i]);
+    }
+    __atomic_store_n(&navigation_step, count > 0 ? (unsigned int)count : 1, __ATOMIC_RELEASE);
+}
+
+static void _collect_heatmap(const tanks_snapshot *snapshot, interface_frame *frame, size_t columns, size_t rows){
+    size_t count_tanks = frame->count_tanks;
+    size_t width = columns > 0 ? columns : HEATMAP_DEFAULT_COLUMNS;
+    if (width > count_tanks) width = count_tanks > 0 ? count_tanks : 1;
+    size_t max_rows = rows > HEATMAP_RESERVED_ROWS + 1 ? rows - HEATMAP_RESERVED_ROWS : 1;
+    size_t total_rows = (count_tanks + width - 1) / width;
+    size_t shown_rows = total_rows < max_rows ? total_rows : max_rows;
+    size_t cursor_row = frame->cursor_tank / width;
+    size_t first_row = collected_first_row;
+    if (cursor_row < first_row) first_row = cursor_row;
+    if (cursor_row >= first_row + shown_rows) first_row = cursor_row - shown_rows + 1;
+    collected_first_row = first_row;
+    unsigned int first = (unsigned int)(first_row * width);
+    size_t cells_count = count_tanks - first < shown_rows * width ? count_tanks - first : shown_rows * width;
+    if (cells_count > frame->heatmap_capacity){
+        frame->heatmap_cells = realloc(frame->heatmap_cells, sizeof(int) * cells_count);
+        frame->heatmap_capacity = cells_count;
+    }
+    for(size_t i = 0; i < cells_count; ++i){
+        tank_state ts;
+        get_tank_state_epoch_snapshot(snapshot, first + (unsigned int)i, &ts);
+        frame->heatmap_cells[i] = _get_heatmap_cell(&ts, first + i == frame->cursor_tank);
+    }
+    frame->heatmap_width = width;
+    frame->heatmap_first_row = first_row;
+    frame->heatmap_cells_count = cells_count;
+    get_tank_state_epoch_snapshot(snapshot, frame->cursor_tank, &frame->cursor_state);
+    frame->cursor_volume = snapshot->volumes[frame->cursor_tank];
+    __atomic_store_n(&navigation_step, (unsigned int)width, __ATOMIC_RELEASE);
+}
+
+static void _collect_system_state(const oil_storage *os, interface_frame *frame){
+    get_scheduler_stats(os, &frame->scheduler);
+    frame->startup_time = get_startup_time_oil_storage(os);
+    frame->active_count = get_active_tanks_count(os);
+    frame->has_level_model = get_level_model_stats(os, &frame->level_model) == 0;
+    get_watchdog_stats(os, &frame->watchdog);
+    get_emergency_stats(os, &frame->emergency);
+    frame->has_exports = get_export_stats(os, &frame->exports) == 0;
+    get_inbound_dispatch_stats(os, &frame->dispatch);
+}
+
+static interface_frame* _begin_write_frame(){
+    for(int i = 0; i < 2; ++i){
+        //опубликованный буфер меняет только поток сбора, поэтому его номер читается без синхронизации
+        if (i == published_frame) continue;
+        if (__atomic_load_n(&frame_readers[i], __ATOMIC_SEQ_CST) == 0) return &frames[i];
+    }
+    return NULL;
+}
+
+static void _publish_frame(interface_frame *frame){
+    __atomic_store_n(&published_frame, (int)(frame - frames), __ATOMIC_SEQ_CST);
+}
+
+static const interface_frame* _acquire_frame(){
+    for(;;){
+        int published = __atomic_load_n(&published_frame, __ATOMIC_SEQ_CST);
+        if (published == -1) return NULL;
+        __atomic_add_fetch(&frame_readers[published], 1, __ATOMIC_SEQ_CST);
+        //буфер мог быть снят с публикации и отдан потоку сбора до увеличения счетчика - тогда повторить
+        if (__atomic_load_n(&published_frame, __ATOMIC_SEQ_CST) == published) return &frames[published];
+        __atomic_sub_fetch(&frame_readers[published], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void _release_frame(const interface_frame *frame){
+    __atomic_sub_fetch(&frame_readers[frame - frames], 1, __ATOMIC_SEQ_CST);
+}
+
+static void _finalize_frame(interface_frame *frame){
+    free(frame->shown_states);
+    free(frame->shown_volumes);
+    free(frame->shown_standard_volumes);
+    free(frame->shown_times_to_max);
+    free(frame->shown_times_to_min);
+    free(frame->heatmap_cells);
+}
+
+static void _render_frame(){
+    const interface_frame* frame = _acquire_frame();
+    if (frame == NULL) return;
+    unsigned long long frame_span = begin_span_trace();
+    unsigned long long span = frame_span;
+    if (frame->view_mode != rendered_view_mode){
+        rendered_view_mode = frame->view_mode;
+        free(heatmap_cells);
+        heatmap_cells = NULL;
+        printf("\033[2J");
+    }
+    printf("\033[0;0H");
+    if (frame->view_mode == VIEW_HEATMAP){
+        _output_heatmap(frame);
+        end_span_trace("render", "heatmap", span, TRACE_NO_ARG);
+    } else {
+        _output_tanks_labels(frame);
+        _output_tanks_state(frame);
+        _output_characteristics_tanks(frame);
+        end_span_trace("render", "tanks", span, TRACE_NO_ARG);
+    }
+    span = begin_span_trace();
+    _output_system_state(frame);
+    printf("\033[K\n");
+    _release_frame(frame);
+    end_span_trace("render", "system_state", span, TRACE_NO_ARG);
+    span = begin_span_trace();
+    _output_console();
+    end_span_trace("render", "console", span, TRACE_NO_ARG);
+    end_span_trace("render", "frame", frame_span, TRACE_NO_ARG);
+}
+
+static void _output_heatmap(const interface_frame *frame){
+    size_t width = frame->heatmap_width;
+    size_t cells_count = frame->heatmap_cells_count;
+    unsigned int first = (unsigned int)(frame->heatmap_first_row * width);
+    size_t len = 0;
+    if (heatmap_cells == NULL || width != heatmap_width || frame->heatmap_first_row != heatmap_first_row || cells_count != heatmap_cells_count){
+        free(heatmap_cells);
+        heatmap_cells = malloc(sizeof(int) * (cells_count > 0 ? cells_count : 1));
+        for(size_t i = 0; i < cells_count; ++i) heatmap_cells[i] = -1;
+        heatmap_width = width;
+        heatmap_first_row = frame->heatmap_first_row;
+        heatmap_cells_count = cells_count;
+        _append_heatmap_frame(&len, "\033[2J", 4);
+    }
+    char header[200];
+    const tank_state* cursor_state = &frame->cursor_state;
+    int header_len = sprintf(header, "\033[1;1HОбзор: №%u-%zu из %zu, курсор №%u: %u (%u-%u), объем %.0f%s%s%s\033[K",
+                             first + 1, first + cells_count, frame->count_tanks, frame->cursor_tank + 1,
+                             cursor_state->current_level, cursor_state->minimum_level, cursor_state->maximum_level,
+                             frame->cursor_volume,
+                             cursor_state->state == STORAGE_TANK_ON ? "" : " OFF",
+                             cursor_state->download_state == PUMP_ON ? " закачка" : "",
+                             cursor_state->upload_state == PUMP_ON ? " откачка" : "");
+    _append_heatmap_frame(&len, header, (size_t)header_len);
+    //перерисовываются только изменившиеся клетки; позиция курсора и цвет выводятся, только если они отличаются от текущих
+    size_t position = (size_t)-1;
+    int color = -1, reverse = 0;
+    for(size_t i = 0; i < cells_count; ++i){
+        int cell = frame->heatmap_cells[i];
+        if (cell == heatmap_cells[i]) continue;
+        heatmap_cells[i] = cell;
+        char sequence[40];
+        int sequence_len = 0;
+        if (position != i){
+            sequence_len += sprintf(sequence + sequence_len, "\033[%zu;%zuH", 2 + i / width, 1 + i % width);
+        }
+        int cell_color = cell & 0xff;
+        int cell_reverse = (cell >> 16) & 1;
+        if (cell_color != color){
+            sequence_len += sprintf(sequence + sequence_len, "\033[48;5;%dm", cell_color);
+            color = cell_color;
+        }
+        if (cell_reverse != reverse){
+            sequence_len += sprintf(sequence + sequence_len, cell_reverse ? "\033[7m" : "\033[27m");
+            reverse = cell_reverse;
+        }
+        sequence[sequence_len++] = (char)((cell >> 8) & 0xff);
+        _append_heatmap_frame(&len, sequence, (size_t)sequence_len);
+        position = (i + 1) % width == 0 ? (size_t)-1 : i + 1;
+    }
+    char tail[40];
+    int tail_len = sprintf(tail, "\033[0m\033[%zu;1H", 2 + (cells_count + width - 1) / width);
+    _append_heatmap_frame(&len, tail, (size_t)tail_len);
+    fwrite(heatmap_frame, 1, len, stdout);
+}
+
+static int _get_heatmap_cell(const tank_state* ts, int is_cursor){
+    int color;
+    if (ts->state != STORAGE_TANK_ON){
+        color = HEATMAP_COLOR_OFF;
+    } else if (ts->current_level >= ts->maximum_level){
+        color = HEATMAP_COLOR_HIGH;
+    } else if (ts->current_level <= ts->minimum_level){
+        color = HEATMAP_COLOR_LOW;
+    } else {
+        size_t colors_count = sizeof(heatmap_colors) / sizeof(heatmap_colors[0]);
+        size_t index = (size_t)((unsigned long long)ts->current_level * colors_count / ts->maximum_level);
+        color = heatmap_colors[index < colors_count ? index : colors_count - 1];
+    }
+    char glyph = ' ';
+    if (ts->download_state == PUMP_ON) glyph = '+';
+    if (ts->upload_state == PUMP_ON) glyph = ts->download_state == PUMP_ON ? '*' : '-';
+    return color | (unsigned char)glyph << 8 | (is_cursor ? 1 : 0) << 16;
+}
+
+static void _append_heatmap_frame(size_t* len, const char* str, size_t str_len){
+    if (*len + str_len > heatmap_frame_size){
+        heatmap_frame_size = (*len + str_len) * 2;
+        heatmap_frame = realloc(heatmap_frame, heatmap_frame_size);
+    }
+    memcpy(heatmap_frame + *len, str, str_len);
+    *len += str_len;
+}
+
+static int _handle_navigation_key(const oil_storage *os, char c){
+    static int escape_state = 0;
+    if (c == '\033'){
+        escape_state = 1;
+        return 1;
+    }
+    if (escape_state == 1){
+        escape_state = c == '[' ? 2 : 0;
+        return 1;
+    }
+    if (escape_state != 2) return 0;
+    escape_state = 0;
+    size_t count_tanks = get_count_tanks(os);
+    size_t step = __atomic_load_n(&navigation_step, __ATOMIC_ACQUIRE);
+    unsigned int cursor = __atomic_load_n(&cursor_tank, __ATOMIC_ACQUIRE);
+    switch (c){
+        case 'A': if (cursor >= step) cursor -= step; break;
+        case 'B': if (cursor + step < count_tanks) cursor += step; break;
+        case 'C': if (cursor + 1 < count_tanks) cursor++; break;
+        case 'D': if (cursor > 0) cursor--; break;
+        default: break;
+    }
+    __atomic_store_n(&cursor_tank, cursor, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void _set_view_mode(int mode){
+    //экран очищает поток отрисовки, когда увидит кадр в новом виде
+    __atomic_store_n(&view_mode, mode, __ATOMIC_RELEASE);
+}
+
+static void _output_tanks_labels(const interface_frame *frame){
     static char* tanks_label = "резевуар №";
     static const size_t length_tanks_label = 10;
 
-    size_t count_tanks = get_count_tanks(os);
+    size_t count_tanks = frame->shown_tanks_count;
     printf("%s%s", between_tanks, between_tanks);
     for(int i = 0; i < count_tanks; ++i){
-        char* label_with_space = malloc(strlen(tanks_label) + 3 + distance_between_tanks + width_tank);
-        int num = i + 1;
+        char* label_with_space = malloc(strlen(tanks_label) + 12 + distance_between_tanks + width_tank);
+        int num = frame->first_shown_tank + i + 1;
         sprintf(label_with_space, "%s%d", tanks_label, num);
         size_t cur_sz = length_tanks_label + 1;
         while(num /= 10) cur_sz++;
@@ -166,13 +683,13 @@ static void _output_tanks_labels(const oil_storage *os){
 }
 
 
-static void _output_tanks_state(const oil_storage *os){
-    size_t count_tanks = get_count_tanks(os);
+static void _output_tanks_state(const interface_frame *frame){
+    size_t count_tanks = frame->shown_tanks_count;
     unsigned int* cur_levels = malloc(sizeof(unsigned int)*count_tanks);
     unsigned int* max_levels = malloc(sizeof(unsigned int)*count_tanks);
     for(int i = 0; i < count_tanks; ++i){
-        cur_levels[i] = get_current_level_tank(os, i);
-        max_levels[i] = get_maximum_level_tank(os, i);
+        cur_levels[i] = frame->shown_states[i].current_level;
+        max_levels[i] = frame->shown_states[i].maximum_level;
     }
     size_t count_segments = height_tank*2 - 2;
     for(int i = 0; i < count_tanks; ++i){
@@ -214,7 +731,7 @@ static void _output_tanks_state(const oil_storage *os){
     free(max_levels);
 }
 
-static void _output_format_tanks_labels(const oil_storage *os, char* name, size_t real_size_name, char** labels){
+static void _output_format_tanks_labels(const interface_frame *frame, char* name, size_t real_size_name, char** labels){
     char* label_with_space = malloc(strlen(name) + distance_between_tanks*2);
     sprintf(label_with_space, "%s", name);
     size_t label_with_space_len = strlen(label_with_space);
@@ -224,7 +741,7 @@ static void _output_format_tanks_labels(const oil_storage *os, char* name, size_
     label_with_space[label_with_space_len] = '\0';
     printf("%s", label_with_space);
     free(label_with_space);
-    size_t count_tanks = get_count_tanks(os);
+    size_t count_tanks = frame->shown_tanks_count;
     for(int i = 0; i < count_tanks; ++i){
         char* chr_label = malloc(strlen(labels[i]) + distance_between_tanks + width_tank);
         sprintf(chr_label, "%s", labels[i]);
@@ -239,10 +756,14 @@ static void _output_format_tanks_labels(const oil_storage *os, char* name, size_
     printf("\033[K\n");
 }
 
-static void _output_characteristics_tanks(const oil_storage *os){
-    size_t count_tanks = get_count_tanks(os);
+static void _output_characteristics_tanks(const interface_frame *frame){
+    size_t count_tanks = frame->shown_tanks_count;
     int* tanks_on = malloc(sizeof(int)*count_tanks);
     unsigned int* cur_levels = malloc(sizeof(unsigned int)*count_tanks);
+    float* volumes = malloc(sizeof(float)*count_tanks);
+    float* standard_volumes = malloc(sizeof(float)*count_tanks);
+    unsigned long long* times_to_max = malloc(sizeof(unsigned long long)*count_tanks);
+    unsigned long long* times_to_min = malloc(sizeof(unsigned long long)*count_tanks);
     unsigned int* max_levels = malloc(sizeof(unsigned int)*count_tanks);
     unsigned int* min_levels = malloc(sizeof(unsigned int)*count_tanks);
     int* download_on = malloc(sizeof(int)*count_tanks);
@@ -250,14 +771,19 @@ static void _output_characteristics_tanks(const oil_storage *os){
     int* upload_on = malloc(sizeof(int)*count_tanks);
     unsigned int* upload_speed = malloc(sizeof(unsigned int)*count_tanks);
     for(int i = 0; i < count_tanks; ++i){
-        tanks_on[i]         = get_state_tank(os,i);
-        cur_levels[i]       = get_current_level_tank(os, i);
-        max_levels[i]       = get_maximum_level_tank(os, i);
-        min_levels[i]       = get_minimum_level_tank(os, i);
-        download_on[i]      = get_state_download_pump(os, i);
-        download_speed[i]   = get_speed_download_pump(os, i);
-        upload_on[i]        = get_state_upload_pump(os, i);
-        upload_speed[i]     = get_speed_upload_pump(os, i);
+        const tank_state* ts = &frame->shown_states[i];
+        tanks_on[i]         = ts->state;
+        cur_levels[i]       = ts->current_level;
+        volumes[i]          = frame->shown_volumes[i];
+        standard_volumes[i] = frame->shown_standard_volumes[i];
+        times_to_max[i]     = frame->shown_times_to_max[i];
+        times_to_min[i]     = frame->shown_times_to_min[i];
+        max_levels[i]       = ts->maximum_level;
+        min_levels[i]       = ts->minimum_level;
+        download_on[i]      = ts->download_state;
+        download_speed[i]   = ts->download_speed;
+        upload_on[i]        = ts->upload_state;
+        upload_speed[i]     = ts->upload_speed;
     }
     char** labels = malloc(sizeof(char*) * count_tanks);
     for(int i = 0; i < count_tanks; ++i) labels[i] = malloc(sizeof(char) * 20);
@@ -266,35 +792,47 @@ static void _output_characteristics_tanks(const oil_storage *os){
         if (tanks_on[i] == STORAGE_TANK_ON) sprintf(labels[i], "ON");
         if (tanks_on[i] == STORAGE_TANK_OFF) sprintf(labels[i], "OFF");
     }
-    _output_format_tanks_labels(os, "Состояние резервуара:", 21, labels);
+    _output_format_tanks_labels(frame, "Состояние резервуара:", 21, labels);
 
 
     for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%u", cur_levels[i]);
-    _output_format_tanks_labels(os, "Текущий уровень:", 16, labels);
+    _output_format_tanks_labels(frame, "Текущий уровень:", 16, labels);
+
+    for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%.0f", volumes[i]);
+    _output_format_tanks_labels(frame, "Объем:", 6, labels);
+
+    for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%.0f", standard_volumes[i]);
+    _output_format_tanks_labels(frame, "Объем при 15 °C:", 16, labels);
 
     for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%u", max_levels[i]);
-    _output_format_tanks_labels(os, "Максимальный уровень:", 21, labels);
+    _output_format_tanks_labels(frame, "Максимальный уровень:", 21, labels);
 
     for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%u", min_levels[i]);
-    _output_format_tanks_labels(os, "Минимальный уровень:", 20, labels);
+    _output_format_tanks_labels(frame, "Минимальный уровень:", 20, labels);
+
+    for(int i = 0; i < count_tanks; ++i) _format_eta(labels[i], times_to_max[i]);
+    _output_format_tanks_labels(frame, "До максимума:", 13, labels);
+
+    for(int i = 0; i < count_tanks; ++i) _format_eta(labels[i], times_to_min[i]);
+    _output_format_tanks_labels(frame, "До минимума:", 12, labels);
 
     for(int i = 0; i < count_tanks; ++i) {
         if (download_on[i] == PUMP_ON) sprintf(labels[i], "ON");
         if (download_on[i] == PUMP_OFF) sprintf(labels[i], "OFF");
     }
-    _output_format_tanks_labels(os, "Насос закачки:", 14, labels);
+    _output_format_tanks_labels(frame, "Насос закачки:", 14, labels);
 
     for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%u", download_speed[i]);
-    _output_format_tanks_labels(os, "Скорость закачки:", 17, labels);
+    _output_format_tanks_labels(frame, "Скорость закачки:", 17, labels);
 
     for(int i = 0; i < count_tanks; ++i) {
         if (upload_on[i] == PUMP_ON) sprintf(labels[i], "ON");
         if (upload_on[i] == PUMP_OFF) sprintf(labels[i], "OFF");
     }
-    _output_format_tanks_labels(os, "Насос откачки:", 14, labels);
+    _output_format_tanks_labels(frame, "Насос откачки:", 14, labels);
 
     for(int i = 0; i < count_tanks; ++i) sprintf(labels[i], "%u", upload_speed[i]);
-    _output_format_tanks_labels(os, "Скорость откачки:", 17, labels);
+    _output_format_tanks_labels(frame, "Скорость откачки:", 17, labels);
 
     for(int i = 0; i < count_tanks; ++i) free(labels[i]);
     free(labels);
@@ -303,79 +841,174 @@ static void _output_characteristics_tanks(const oil_storage *os){
     free(download_speed);
     free(download_on);
     free(min_levels);
+    free(volumes);
+    free(standard_volumes);
+    free(times_to_max);
+    free(times_to_min);
     free(max_levels);
     free(cur_levels);
     free(tanks_on);
 }
 
-static void _output_console(oil_storage *os){
-    const size_t console_log_max_size = 200;
-    static const size_t console_string_max_len = 500;
-    static char* console_log[200];
-    static size_t console_log_size = 0;
-    static int is_initial = 0;
-    static int current_ptr = 0;
-    if (!is_initial){
-        for(int i = 0; i < console_log_max_size; ++i){
-            console_log[i] = malloc(sizeof(char)*console_string_max_len);
-            memset(console_log[i], 0, sizeof(char)*console_string_max_len);
-        }
-        console_log[0][0] = '>';
-        is_initial = 1;
-        pthread_create(&_read_chars_thread, NULL, _read_chars, NULL);
-    }
-    int start_i = 0;
-    if (console_log_size > 20) start_i = console_log_size - 20;
-    for(; start_i < console_log_size; ++start_i)  printf("%s\033[K\n", console_log[start_i]);
+static void _output_console(){
+    //журнал дописывает поток команд: строки до опубликованного счетчика уже записаны
+    //(строка могла бы смениться во время вывода, только если за кадр выполнено больше CONSOLE_LOG_SIZE - CONSOLE_SHOWN_LINES команд)
+    size_t count = __atomic_load_n(&console_log_count, __ATOMIC_ACQUIRE);
+    size_t start_i = count > CONSOLE_SHOWN_LINES ? count - CONSOLE_SHOWN_LINES : 0;
+    for(; start_i < count; ++start_i)  printf("%s\033[K\n", console_log[start_i % CONSOLE_LOG_SIZE]);
     printf("\033[s\n\033[K\n\033[K\n\033[K\033[u");
-    while(current_ptr < last_write_char) {
-        char c = chars_buffer[current_ptr++];
-        if (c == '\n') {
-            char* ans = _implement_command(os, console_log[console_log_size] + 1);
-            printf("%s\033[K\n", console_log[console_log_size]);
-            console_log_size++;
-            strcpy(console_log[console_log_size], ans);
-            printf("%s\033[K\n", console_log[console_log_size]);
-            console_log_size++;
-            console_log[console_log_size][0] = '>';
-        }else{
-            size_t cl_len = strlen(console_log[console_log_size]);
-            if (c == 127){
-                if (cl_len > 1) console_log[console_log_size][cl_len - 1] = '\0';
-            }else{
-                console_log[console_log_size][cl_len] = c;
+    char line[CONSOLE_LINE_SIZE];
+    _read_console_input(line);
+    printf("%s\033[K", line);
+    fflush(stdout);
+}
+
+static void* _read_chars(void* os_ptr){
+    const oil_storage* os = os_ptr;
+    set_thread_name_trace("input");
+    char line[CONSOLE_LINE_SIZE] = ">";
+    size_t len = 1;
+    while(__atomic_load_n(&interface_running, __ATOMIC_ACQUIRE)){
+        int c = getchar();
+        if (c == EOF) break;
+        if (_handle_navigation_key(os, (char)c)) continue;
+        if (c == '\n' && len == 1){
+            _set_view_mode(__atomic_load_n(&view_mode, __ATOMIC_ACQUIRE) == VIEW_HEATMAP ? VIEW_DETAILS : VIEW_HEATMAP);
+            continue;
+        }
+        if (c == '\n'){
+            //очередь заполняется, только если команды набираются быстрее, чем выполняются; тогда ввод ждет
+            while (push_command_queue(commands, line) != 0 && __atomic_load_n(&interface_running, __ATOMIC_ACQUIRE)){
+                usleep(1000);
             }
+            len = 1;
+        } else if (c == 127){
+            if (len > 1) len--;
+        } else if (len + 1 < CONSOLE_LINE_SIZE){
+            line[len++] = (char)c;
         }
+        line[len] = '\0';
+        _publish_console_input(line);
     }
-    printf("%s\033[K", console_log[console_log_size]);
-    fflush(stdout);
+    return NULL;
 }
 
-static void* _read_chars(void* params){
-    while(continue_read_char){
-        chars_buffer[last_write_char] = getchar();
-        last_write_char++;
+static void* _execute_commands(void* os_ptr){
+    oil_storage* os = os_ptr;
+    set_thread_name_trace("commands");
+    char command_line[CONSOLE_LINE_SIZE];
+    while(__atomic_load_n(&interface_running, __ATOMIC_ACQUIRE)){
+        if (pop_command_queue(commands, command_line, COMMAND_WAIT_TIMEOUT) != 1) continue;
+        //команда появляется в журнале до выполнения, ответ - после
+        _append_console_log(command_line);
+        unsigned long long span = begin_span_trace();
+        char* ans = _implement_command(os, command_line + 1);
+        end_span_trace("interface", "command", span, TRACE_NO_ARG);
+        _append_console_log(ans);
     }
     return NULL;
 }
 
+static void _append_console_log(const char* line){
+    size_t count = console_log_count;
+    snprintf(console_log[count % CONSOLE_LOG_SIZE], CONSOLE_LINE_SIZE, "%s", line);
+    __atomic_store_n(&console_log_count, count + 1, __ATOMIC_RELEASE);
+}
+
+static void _publish_console_input(const char* line){
+    //нечетный счетчик - строка меняется, читатель повторит чтение
+    __atomic_add_fetch(&console_input_sequence, 1, __ATOMIC_SEQ_CST);
+    strcpy(console_input, line);
+    __atomic_add_fetch(&console_input_sequence, 1, __ATOMIC_SEQ_CST);
+}
+
+static void _read_console_input(char* line){
+    for(;;){
+        unsigned int sequence = __atomic_load_n(&console_input_sequence, __ATOMIC_SEQ_CST);
+        if (sequence & 1) continue;
+        memcpy(line, console_input, CONSOLE_LINE_SIZE);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&console_input_sequence, __ATOMIC_SEQ_CST) == sequence) break;
+    }
+    line[CONSOLE_LINE_SIZE - 1] = '\0';
+}
+
 
 static char* _implement_command(oil_storage *os, char *command_line){
     char command[100];
     sscanf(command_line, "%s", command);
     if (strcmp(command, "exit") == 0){
-        continue_read_char = 0;
+        __atomic_store_n(&interface_running, 0, __ATOMIC_RELEASE);
         return "ok (press any key)";
     }
+    if (strcmp(command, "fleet_summary") == 0){
+        return _format_fleet_summary(os);
+    }
+    if (strcmp(command, "next_limits") == 0){
+        return _format_next_limits(os, command_line + strlen(command));
+    }
+    if (strcmp(command, "find") == 0){
+        return _format_found_tanks(os, command_line + strlen(command));
+    }
+    if (strcmp(command, "heatmap") == 0){
+        _set_view_mode(VIEW_HEATMAP);
+        return "ok";
+    }
+    if (strcmp(command, "details") == 0){
+        unsigned int number = strtol(command_line + strlen(command), NULL, 10);
+        if (number > get_count_tanks(os)) return "Unknown tank";
+        if (number > 0) __atomic_store_n(&cursor_tank, number - 1, __ATOMIC_RELEASE);
+        _set_view_mode(VIEW_DETAILS);
+        return "ok";
+    }
+    if (strcmp(command, "at") == 0 || strcmp(command, "every") == 0 || strcmp(command, "cancel") == 0){
+        return _implement_schedule_command(os, command, command_line + strlen(command));
+    }
+    if (strstr(command, "_transfer") != NULL){
+        return _implement_transfer_command(os, command, command_line + strlen(command));
+    }
+    if (strstr(command, "_inbound_dispatch") != NULL){
+        return _implement_dispatch_command(os, command, command_line + strlen(command));
+    }
+    if (strstr(command, "_group") != NULL){
+        return _implement_group_command(os, command, command_line + strlen(command));
+    }
+    if (strstr(command, "_export") != NULL){
+        return _implement_export_command(os, command, command_line + strlen(command));
+    }
     unsigned int number = strtol(command_line + strlen(command) + 1, &command_line, 10) - 1;
     if (strcmp(command, "turn_on_tank") == 0){
         turn_on_tank(os, number);
         return "ok";
     }
+    if (strcmp(command, "set_product_tank") == 0){
+        char product[20] = "";
+        float density = 0.0f, temperature = 0.0f;
+        if (sscanf(command_line, "%19s %f %f", product, &density, &temperature) != 3
+            || (strcmp(product, "crude") != 0 && strcmp(product, "refined") != 0)){
+            return "usage: set_product_tank <number> crude|refined <density> <temperature>";
+        }
+        int result = set_product_tank(os, number, strcmp(product, "crude") == 0 ? VOLUME_CORRECTION_CRUDE : VOLUME_CORRECTION_REFINED,
+                                      density, temperature);
+        if (result == TANK_ERROR_NUMBER) return "Unknown tank";
+        if (result == TANK_ERROR_VALUE) return "error";
+        return "ok";
+    }
     if (strcmp(command, "turn_off_tank") == 0){
         turn_off_tank(os, number);
         return "ok";
     }
+    if (strcmp(command, "emergency_stop") == 0){
+        char target[20] = "tank";
+        sscanf(command_line, "%19s", target);
+        int flags = 0;
+        if (strcmp(target, "tank") == 0) flags = EMERGENCY_STOP_TANK;
+        if (strcmp(target, "download") == 0) flags = EMERGENCY_STOP_DOWNLOAD_PUMP;
+        if (strcmp(target, "upload") == 0) flags = EMERGENCY_STOP_UPLOAD_PUMP;
+        if (flags == 0) return "usage: emergency_stop <number> [tank|download|upload]";
+        if (emergency_stop_tank(os, number, flags) == TANK_ERROR_NUMBER) return "Unknown tank";
+        return "ok";
+    }
     if (strcmp(command, "set_minimum_level_tank") == 0){
         unsigned int min_level = strtol(command_line + 1, NULL, 10);
         set_minimum_level_tank(os, number, min_level);
@@ -435,6 +1068,18 @@ static char* _implement_command(oil_storage *os, char *command_line){
         sprintf(cur_level_str, "%u", cur_level);
         return cur_level_str;
     }
+    if (strcmp(command, "get_current_volume_tank") == 0){
+        float volume = get_current_volume_tank(os, number);
+        char* volume_str = malloc(sizeof(char) * 20);
+        sprintf(volume_str, "%.1f", volume);
+        return volume_str;
+    }
+    if (strcmp(command, "get_standard_volume_tank") == 0){
+        float volume = get_standard_volume_tank(os, number);
+        char* volume_str = malloc(sizeof(char) * 20);
+        sprintf(volume_str, "%.1f", volume);
+        return volume_str;
+    }
     if (strcmp(command, "get_state_download_pump") == 0){
         int state = get_state_download_pump(os, number);
         if (state == PUMP_ON) return "ON";
@@ -457,5 +1102,274 @@ static char* _implement_command(oil_storage *os, char *command_line){
         sprintf(speed_str, "%u", speed);
         return speed_str;
     }
+    if (strcmp(command, "history") == 0){
+        return _format_level_history(os, number, command_line);
+    }
+    return "Unknown command";
+}
+
+static unsigned int _parse_duration(char* str, char** end){
+    unsigned int value = strtol(str, end, 10);
+    if (strncmp(*end, "ms", 2) == 0){
+        *end += 2;
+        return value;
+    }
+    switch (**end){
+        case 's': (*end)++; return value * 1000;
+        case 'm': (*end)++; return value * 60 * 1000;
+        case 'h': (*end)++; return value * 60 * 60 * 1000;
+        default: return value;
+    }
+}
+
+static char* _format_level_history(oil_storage *os, unsigned int number, char* args){
+    static const size_t max_points = 60;
+    static const size_t history_str_max_len = 480;
+    if (number >= get_count_tanks(os)) return "Unknown tank";
+    unsigned int period = 60 * 1000;
+    unsigned int step = 0;
+    char word[100] = "";
+    sscanf(args, "%99s", word);
+    if (strcmp(word, "last") == 0){
+        args = strstr(args, "last") + 4;
+        period = _parse_duration(args, &args);
+        step = _parse_duration(args, &args);
+    }
+    if (step == 0) step = period / max_points;
+    if (step < TIME_UNIT) step = TIME_UNIT;
+    history_point points[60];
+    size_t count = get_level_history_tank(os, number, period, step, points, max_points);
+    if (count == 0) return "no data";
+    char* history_str = malloc(sizeof(char) * history_str_max_len);
+    size_t len = 0;
+    history_str[0] = '\0';
+    for(size_t i = 0; i < count && len + 12 < history_str_max_len; ++i){
+        len += sprintf(history_str + len, "%u ", points[i].level);
+    }
+    return history_str;
+}
+
+static char* _format_fleet_summary(oil_storage *os){
+    fleet_summary fs;
+    get_fleet_summary(os, &fs);
+    if (fs.tanks_count == 0) return "no tanks";
+    char* summary_str = malloc(sizeof(char) * 400);
+    sprintf(summary_str, "всего: %llu (объем %.0f, при 15 °C %.0f), свободно: %llu, полный: №%zu (%.1f%%), пустой: №%zu (%.1f%%), p10/p50/p90: %u/%u/%u%%",
+            fs.total_level, fs.total_volume, fs.total_standard_volume, fs.free_capacity,
+            fs.fullest_tank + 1, fs.fullest_fill * 100.0f,
+            fs.emptiest_tank + 1, fs.emptiest_fill * 100.0f,
+            get_fill_percentile_fleet_summary(&fs, 10),
+            get_fill_percentile_fleet_summary(&fs, 50),
+            get_fill_percentile_fleet_summary(&fs, 90));
+    return summary_str;
+}
+
+static char* _format_next_limits(oil_storage *os, char* args){
+    static const size_t limits_str_max_len = 400;
+    size_t count = strtoul(args, NULL, 10);
+    if (count == 0) count = 5;
+    if (count > 20) count = 20;
+    limit_eta etas[20];
+    count = get_next_limits(os, etas, count);
+    if (count == 0) return "no limits ahead";
+    char* limits_str = malloc(sizeof(char) * limits_str_max_len);
+    size_t len = 0;
+    limits_str[0] = '\0';
+    for(size_t i = 0; i < count && len + 40 < limits_str_max_len; ++i){
+        char eta[20];
+        _format_eta(eta, etas[i].time);
+        len += sprintf(limits_str + len, "№%u %s %s  ", etas[i].number + 1, etas[i].limit == LIMIT_FORECAST_MAX ? "max" : "min", eta);
+    }
+    return limits_str;
+}
+
+static int _compare_numbers(const void* a, const void* b){
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+static char* _format_found_tanks(oil_storage *os, char* args){
+    static const size_t found_str_max_len = 400;
+    level_query query;
+    if (parse_level_query(args, &query) != 0) return "usage: find level <|<=|>|>=|= N|N%|min+N|max-N [and tank|download_pump|upload_pump on|off ...]";
+    unsigned int numbers[30];
+    size_t found = find_tanks(os, &query, numbers, 30);
+    if (found == 0) return "not found";
+    size_t count = found < 30 ? found : 30;
+    qsort(numbers, count, sizeof(unsigned int), _compare_numbers);
+    char* found_str = malloc(sizeof(char) * found_str_max_len);
+    size_t len = sprintf(found_str, "найдено %zu: ", found);
+    for(size_t i = 0; i < count && len + 20 < found_str_max_len; ++i){
+        len += sprintf(found_str + len, "№%u ", numbers[i] + 1);
+    }
+    if (found > count) sprintf(found_str + len, "...");
+    return found_str;
+}
+
+static void _format_eta(char* str, unsigned long long time){
+    if (time == LIMIT_FORECAST_NEVER){
+        sprintf(str, "-");
+        return;
+    }
+    unsigned long long seconds = (time + 999) / 1000;
+    if (seconds >= 3600) sprintf(str, "%lluч%02llu:%02llu", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    else sprintf(str, "%llu:%02llu", seconds / 60, seconds % 60);
+}
+
+static char* _implement_transfer_command(oil_storage *os, char *command, char *args){
+    char name[100] = "";
+    unsigned int source = 0, destination = 0, rate = 0;
+    unsigned long long moved = 0;
+    sscanf(args, "%99s", name);
+    if (strcmp(command, "add_transfer") == 0){
+        if (sscanf(args, "%99s %u %u %u", name, &source, &destination, &rate) != 4) return "usage: add_transfer <name> <from> <to> <rate>";
+        if (add_transfer(os, name, source - 1, destination - 1, rate) != 0) return "error";
+        return "ok";
+    }
+    if (strcmp(command, "start_transfer") == 0){
+        if (start_transfer(os, name) != 0) return "Unknown transfer";
+        return "ok";
+    }
+    if (strcmp(command, "stop_transfer") == 0){
+        if (stop_transfer(os, name) != 0) return "Unknown transfer";
+        return "ok";
+    }
+    if (strcmp(command, "get_transfer") == 0){
+        int state = get_transfer(os, name, &source, &destination, &rate, &moved);
+        if (state == -1) return "Unknown transfer";
+        char* transfer_str = malloc(sizeof(char) * 100);
+        sprintf(transfer_str, "№%u -> №%u, скорость %u, %s, перекачано %llu",
+                source + 1, destination + 1, rate, state == TRANSFER_ON ? "ON" : "OFF", moved);
+        return transfer_str;
+    }
+    return "Unknown command";
+}
+
+static char* _implement_dispatch_command(oil_storage *os, char *command, char *args){
+    unsigned int first = 0, last = 0, rate = 0;
+    if (strcmp(command, "start_inbound_dispatch") == 0){
+        if (sscanf(args, "%u %u %u", &first, &last, &rate) != 3 || first == 0) return "usage: start_inbound_dispatch <first> <last> <rate>";
+        if (start_inbound_dispatch(os, first - 1, last - 1, rate) != TANK_OK) return "Unknown tank";
+        return "ok";
+    }
+    if (strcmp(command, "stop_inbound_dispatch") == 0){
+        stop_inbound_dispatch(os);
+        return "ok";
+    }
     return "Unknown command";
-}
\ No newline at end of file
+}
+
+static char* _implement_schedule_command(oil_storage *os, char *command, char *args){
+    static const struct {
+        const char* name;
+        int command;
+    } commands[] = {
+            {"turn_on_tank",            COMMAND_TURN_ON_TANK},
+            {"turn_off_tank",           COMMAND_TURN_OFF_TANK},
+            {"set_minimum_level_tank",  COMMAND_SET_MINIMUM_LEVEL_TANK},
+            {"set_maximum_level_tank",  COMMAND_SET_MAXIMUM_LEVEL_TANK},
+            {"turn_on_download_pump",   COMMAND_TURN_ON_DOWNLOAD_PUMP},
+            {"turn_off_download_pump",  COMMAND_TURN_OFF_DOWNLOAD_PUMP},
+            {"set_speed_download_pump", COMMAND_SET_SPEED_DOWNLOAD_PUMP},
+            {"turn_on_upload_pump",     COMMAND_TURN_ON_UPLOAD_PUMP},
+            {"turn_off_upload_pump",    COMMAND_TURN_OFF_UPLOAD_PUMP},
+            {"set_speed_upload_pump",   COMMAND_SET_SPEED_UPLOAD_PUMP},
+    };
+    if (strcmp(command, "cancel") == 0){
+        unsigned long long id = strtoull(args, NULL, 10);
+        if (cancel_scheduled_command(os, id) != 0) return "Unknown schedule id";
+        return "ok";
+    }
+    while (*args == ' ') args++;
+    if (*args == '+') args++;
+    unsigned int time = _parse_duration(args, &args);
+    char name[100] = "";
+    unsigned int number = 0, value = 0;
+    if (time == 0 || sscanf(args, "%99s %u %u", name, &number, &value) < 2) return "usage: at +<time> <command> <number> [value]";
+    int code = 0;
+    for(size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); ++i){
+        if (strcmp(commands[i].name, name) == 0) code = commands[i].command;
+    }
+    if (code == 0) return "Unknown command";
+    unsigned int period = strcmp(command, "every") == 0 ? time : 0;
+    unsigned long long id = schedule_command(os, time, period, code, number - 1, value);
+    if (id == 0) return "error";
+    char* id_str = malloc(sizeof(char) * 40);
+    sprintf(id_str, "scheduled #%llu", id);
+    return id_str;
+}
+
+static char* _implement_group_command(oil_storage *os, char *command, char *args){
+    char name[100] = "", parent[100] = "";
+    unsigned int first = 0, last = 0;
+    int count = sscanf(args, "%99s %99s", name, parent);
+    if (strcmp(command, "add_group") == 0){
+        if (count < 1) return "usage: add_group <name> [parent]";
+        if (add_group(os, name, count == 2 ? parent : NULL) != 0) return "error";
+        return "ok";
+    }
+    if (strcmp(command, "assign_group") == 0){
+        count = sscanf(args, "%99s %u %u", name, &first, &last);
+        if (count < 2 || first == 0) return "usage: assign_group <name> <first> [last]";
+        if (count == 2) last = first;
+        for(unsigned int number = first; number <= last; ++number){
+            if (assign_group(os, name, number - 1) != 0) return "error";
+        }
+        return "ok";
+    }
+    if (strcmp(command, "get_group") == 0){
+        group_totals totals;
+        if (get_group_totals(os, name, &totals) != 0) return "Unknown group";
+        char* group_str = malloc(sizeof(char) * 200);
+        sprintf(group_str, "%s: резервуаров %zu, уровень %llu, свободно %llu, объем %.1f, налив %zu, слив %zu",
+                name, totals.tanks_count, totals.total_level, totals.free_capacity, totals.total_volume,
+                totals.download_pumps, totals.upload_pumps);
+        return group_str;
+    }
+    return "Unknown command";
+}
+
+static char* _implement_export_command(oil_storage *os, char *command, char *args){
+    if (strcmp(command, "start_export") == 0){
+        char directory[256] = "";
+        if (sscanf(args, "%255s", directory) != 1) return "usage: start_export <directory>";
+        if (start_export(os, directory) != 0) return "error";
+        return "ok";
+    }
+    if (strcmp(command, "stop_export") == 0){
+        if (stop_export(os) != 0) return "export is not running";
+        return "ok";
+    }
+    return "Unknown command";
+}
+
+static void _output_system_state(const interface_frame *frame){
+    const scheduler_stats* stats = &frame->scheduler;
+    printf("Расписание: ожидает %zu, выполнено %llu, с опозданием %llu\033[K\n", stats->pending, stats->dispatched, stats->missed);
+    printf("Запуск: %zu резервуаров готовы за %.1f мс\033[K\n", frame->count_tanks, frame->startup_time / 1000.0);
+    printf("Резервуары: работают %zu, спят %zu\033[K\n", frame->active_count, frame->count_tanks - frame->active_count);
+    if (frame->has_level_model){
+        const level_model_stats* ls = &frame->level_model;
+        printf("Модель уровня: уровень меняется у %zu, ожидается событий %zu, обработано событий %llu, изменений %llu\033[K\n",
+               ls->moving_tanks, ls->pending_events, ls->limit_events, ls->updates);
+    }
+    const watchdog_stats* ws = &frame->watchdog;
+    printf("Сторож: перезапусков %llu, неудачных %llu, восстановление %llu мс (максимум %llu мс)\033[K\n",
+           ws->restarts, ws->failures, ws->last_failover_time, ws->max_failover_time);
+    const emergency_stats* es = &frame->emergency;
+    printf("Аварийные остановки: %llu, без подтверждения %llu, время %llu мкс (среднее %llu мкс, максимум %llu мкс)\033[K\n",
+           es->stops, es->failures, es->last_latency, es->stops > 0 ? es->total_latency / es->stops : 0, es->max_latency);
+    if (frame->has_exports){
+        const export_stats* xs = &frame->exports;
+        printf("Выгрузка: строк %llu, пропущено %llu, записано %.1f МБ (сжатие %.1f), запись блоков %llu мс\033[K\n",
+               xs->rows, xs->dropped_rows, xs->written_bytes / 1e6,
+               xs->written_bytes > 0 ? (double)xs->raw_bytes / xs->written_bytes : 0.0, xs->busy_time / 1000);
+    }
+    const dispatch_stats* ds = &frame->dispatch;
+    if (ds->rate > 0 || ds->active_tanks > 0){
+        printf("Прием: №%u-№%u, задано %u, распределено %llu по %zu резервуарам, включений %llu, выключений %llu, расчет %llu мкс (максимум %llu мкс)\033[K\n",
+               ds->first + 1, ds->last + 1, ds->rate, ds->assigned_rate, ds->active_tanks, ds->starts, ds->stops, ds->plan_time, ds->max_plan_time);
+    } else {
+        printf("Прием: не идет, включений %llu, выключений %llu\033[K\n", ds->starts, ds->stops);
+    }
+}
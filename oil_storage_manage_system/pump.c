@@ -1,5 +1,6 @@
 #include "pump.h"
 #include "oil_storage_def.h"
+#include "trace.h"
 #include <pthread.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -76,8 +77,11 @@ void finalize_pump(pump* p){
 
 void *_pump_work(void *p_ptr) {
     pump* p = p_ptr;
+    set_thread_name_trace("pump");
     while(p->state == PUMP_ON){
-        *p->value += p->delta;
+        unsigned long long span = begin_span_trace();
+        __atomic_add_fetch(p->value, p->delta, __ATOMIC_SEQ_CST);
+        end_span_trace("pump", "pump_tick", span, TRACE_NO_ARG);
         usleep(TIME_UNIT*1000);
     }
     return NULL;
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fleet_config.h"
+#include "scenario_runner.h"
+
+#define SCENARIO_MIN_LEVEL      1000    //минимальный уровень резервуаров, созданных без файла конфигурации
+#define SCENARIO_MAX_LEVEL      25000   //максимальный уровень резервуаров, созданных без файла конфигурации
+#define SCENARIO_MAX_SPEED      10      //максимальная скорость насосов резервуаров, созданных без файла конфигурации
+#define SCENARIO_TOP_TANKS      5       //количество резервуаров с наибольшей вероятностью переполнения в отчете
+
+/**
+ * параметры моделирования
+ */
+typedef struct _scenario_options{
+    /**
+     * файл конфигурации парка (NULL - резервуары создаются)
+     */
+    const char* config_path;
+    /**
+     * количество создаваемых резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * количество реплик
+     */
+    size_t replicas;
+    /**
+     * количество потоков (0 - по количеству процессоров)
+     */
+    unsigned int threads;
+    /**
+     * начальное значение генераторов случайных чисел
+     */
+    unsigned long long seed;
+    /**
+     * параметры сценария
+     */
+    scenario_config config;
+} scenario_options;
+
+/**
+ * разобрать параметры командной строки
+ * @param argc количество аргументов
+ * @param argv аргументы
+ * @param options параметры моделирования
+ * @return 0 - параметры разобраны, -1 - ошибка
+ */
+static int _parse_options(int argc, char* argv[], scenario_options* options);
+
+/**
+ * разобрать пару длительностей в секундах "a,b" в мс
+ * @param value строка
+ * @param first первая длительность в мс
+ * @param second вторая длительность в мс
+ * @return 0 - пара разобрана, -1 - ошибка
+ */
+static int _parse_pair(const char* value, unsigned long long* first, unsigned long long* second);
+
+int main(int argc, char* argv[]) {
+    scenario_options options;
+    if (_parse_options(argc, argv, &options) == -1){
+        fprintf(stderr, "использование: %s [--config файл | --tanks N] [--replicas N] [--threads N] [--seed N] [--period с]"
+                        " [--supply работа,перерыв] [--demand работа,перерыв] [--outage интервал,ремонт]\n", argv[0]);
+        return 1;
+    }
+    fleet_config* fc = NULL;
+    tank_config* generated = NULL;
+    const tank_config* tanks;
+    size_t tanks_count;
+    if (options.config_path != NULL){
+        size_t error_line = 0;
+        fc = load_fleet_config(options.config_path, &error_line);
+        if (fc == NULL){
+            if (error_line > 0) fprintf(stderr, "%s:%zu: ошибка в описании резервуара\n", options.config_path, error_line);
+            else fprintf(stderr, "%s: не удалось прочитать конфигурацию\n", options.config_path);
+            return 1;
+        }
+        tanks = get_tanks_fleet_config(fc);
+        tanks_count = get_count_fleet_config(fc);
+    } else {
+        srand((unsigned int)options.seed);
+        generated = calloc(options.tanks_count, sizeof(tank_config));
+        for(size_t i = 0; i < options.tanks_count; ++i){
+            generated[i].minimum_level = SCENARIO_MIN_LEVEL;
+            generated[i].maximum_level = SCENARIO_MAX_LEVEL;
+            generated[i].current_level = (SCENARIO_MIN_LEVEL + SCENARIO_MAX_LEVEL) / 2;
+            generated[i].download_speed = (unsigned int)(rand()%SCENARIO_MAX_SPEED + 1);
+            generated[i].upload_speed = (unsigned int)(rand()%SCENARIO_MAX_SPEED + 1);
+            generated[i].flags = FLEET_CONFIG_TANK_ON;
+        }
+        tanks = generated;
+        tanks_count = options.tanks_count;
+    }
+    scenario_runner* sr = create_scenario_runner(tanks, tanks_count, &options.config);
+    if (run_scenario_runner(sr, options.replicas, options.threads, options.seed) == -1){
+        fprintf(stderr, "в конфигурации нет резервуаров\n");
+        finalize_scenario_runner(sr);
+        if (fc != NULL) finalize_fleet_config(fc);
+        free(generated);
+        return 1;
+    }
+    scenario_result result;
+    get_result_scenario_runner(sr, &result);
+    printf("резервуаров %zu, реплик %zu по %.1f с модельного времени: %.2f с, потоков %u, перераспределений %llu\n",
+           tanks_count, result.replicas, options.config.duration / 1000.0, result.run_time / 1e6, result.threads, result.steals);
+    printf("переполнение: вероятность %.4f, в среднем %.2f за реплику\n", result.overflow_probability, result.overflow_events);
+    printf("опустошение:  вероятность %.4f, в среднем %.2f за реплику\n", result.underflow_probability, result.underflow_events);
+    printf("заполненность в конце периода: средняя %.1f%%\n", result.mean_fill * 100.0);
+    for(int b = 0; b < SCENARIO_FILL_BUCKETS; ++b){
+        int width = (int)(result.fill_distribution[b] * 50.0 + 0.5);
+        printf("  %3d-%3d%% %6.2f%% ", b * 100 / SCENARIO_FILL_BUCKETS, (b + 1) * 100 / SCENARIO_FILL_BUCKETS,
+               result.fill_distribution[b] * 100.0);
+        for(int k = 0; k < width; ++k){
+            putchar('#');
+        }
+        putchar('\n');
+    }
+    //резервуары с наибольшей вероятностью переполнения (частичный выбор, номера в отчете с 1)
+    unsigned int top[SCENARIO_TOP_TANKS];
+    double top_values[SCENARIO_TOP_TANKS];
+    size_t top_count = 0;
+    for(unsigned int i = 0; i < tanks_count; ++i){
+        tank_scenario_result tr;
+        get_tank_result_scenario_runner(sr, i, &tr);
+        if (tr.overflow_probability <= 0.0) continue;
+        size_t k = top_count < SCENARIO_TOP_TANKS ? top_count++ : SCENARIO_TOP_TANKS;
+        while (k > 0 && top_values[k - 1] < tr.overflow_probability){
+            if (k < SCENARIO_TOP_TANKS){
+                top[k] = top[k - 1];
+                top_values[k] = top_values[k - 1];
+            }
+            --k;
+        }
+        if (k < SCENARIO_TOP_TANKS){
+            top[k] = i;
+            top_values[k] = tr.overflow_probability;
+        }
+    }
+    for(size_t k = 0; k < top_count; ++k){
+        tank_scenario_result tr;
+        get_tank_result_scenario_runner(sr, top[k], &tr);
+        printf("резервуар №%u: переполнение %.4f, опустошение %.4f, средний уровень в конце %.0f\n",
+               top[k] + 1, tr.overflow_probability, tr.underflow_probability, tr.mean_level);
+    }
+    finalize_scenario_runner(sr);
+    if (fc != NULL) finalize_fleet_config(fc);
+    free(generated);
+    return 0;
+}
+
+static int _parse_options(int argc, char* argv[], scenario_options* options){
+    options->config_path = NULL;
+    options->tanks_count = 100;
+    options->replicas = 1000;
+    options->threads = 0;
+    options->seed = 1;
+    options->config.duration = 60000;
+    options->config.download_on_time = 5000;
+    options->config.download_off_time = 10000;
+    options->config.upload_on_time = 5000;
+    options->config.upload_off_time = 10000;
+    options->config.outage_interval = 30000;
+    options->config.repair_time = 5000;
+    for(int i = 1; i < argc; ++i){
+        if (i + 1 >= argc) return -1;
+        const char* value = argv[++i];
+        char* end = "";
+        if (strcmp(argv[i - 1], "--config") == 0){
+            options->config_path = value;
+        } else if (strcmp(argv[i - 1], "--tanks") == 0){
+            options->tanks_count = (size_t)strtoul(value, &end, 10);
+        } else if (strcmp(argv[i - 1], "--replicas") == 0){
+            options->replicas = (size_t)strtoul(value, &end, 10);
+        } else if (strcmp(argv[i - 1], "--threads") == 0){
+            options->threads = (unsigned int)strtoul(value, &end, 10);
+        } else if (strcmp(argv[i - 1], "--seed") == 0){
+            options->seed = strtoull(value, &end, 10);
+        } else if (strcmp(argv[i - 1], "--period") == 0){
+            double seconds = strtod(value, &end);
+            if (seconds <= 0) return -1;
+            options->config.duration = (unsigned long long)(seconds * 1000.0);
+        } else if (strcmp(argv[i - 1], "--supply") == 0){
+            if (_parse_pair(value, &options->config.download_on_time, &options->config.download_off_time) == -1) return -1;
+        } else if (strcmp(argv[i - 1], "--demand") == 0){
+            if (_parse_pair(value, &options->config.upload_on_time, &options->config.upload_off_time) == -1) return -1;
+        } else if (strcmp(argv[i - 1], "--outage") == 0){
+            if (_parse_pair(value, &options->config.outage_interval, &options->config.repair_time) == -1) return -1;
+        } else {
+            return -1;
+        }
+        if (*end != '\0') return -1;
+    }
+    if (options->tanks_count == 0 || options->replicas == 0 || options->config.duration == 0) return -1;
+    return 0;
+}
+
+static int _parse_pair(const char* value, unsigned long long* first, unsigned long long* second){
+    double a, b;
+    char extra;
+    if (sscanf(value, "%lf,%lf%c", &a, &b, &extra) != 2 || a < 0 || b < 0) return -1;
+    *first = (unsigned long long)(a * 1000.0);
+    *second = (unsigned long long)(b * 1000.0);
+    return 0;
+}
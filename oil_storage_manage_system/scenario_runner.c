@@ -0,0 +1,629 @@
+#include "scenario_runner.h"
+#include "level_model.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define SCENARIO_DOWNLOAD_SUPPLY    0   //событие: начало или конец поставки (насос налива)
+#define SCENARIO_UPLOAD_DEMAND      1   //событие: начало или конец спроса (насос слива)
+#define SCENARIO_DOWNLOAD_OUTAGE    2   //событие: отказ или восстановление насоса налива
+#define SCENARIO_UPLOAD_OUTAGE      3   //событие: отказ или восстановление насоса слива
+#define SCENARIO_EVENT_KINDS        4   //количество видов событий
+
+#define PUMP_DEMAND     1   //флаг насоса: есть поставка (спрос)
+#define PUMP_FAILED     2   //флаг насоса: насос неисправен
+#define PUMP_LIMITED    4   //флаг насоса: насос выключен на границе уровня до конца текущей поставки (спроса)
+#define PUMP_RUNNING    8   //флаг насоса: насос включен в модели
+
+#define REPLICA_OVERFLOW    1   //флаг резервуара в реплике: был достигнут максимальный уровень
+#define REPLICA_UNDERFLOW   2   //флаг резервуара в реплике: был достигнут минимальный уровень
+
+/**
+ * случайное событие реплики
+ */
+typedef struct _scenario_event{
+    /**
+     * момент события в нс модельного времени
+     */
+    unsigned long long time;
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+    /**
+     * вид события (SCENARIO_DOWNLOAD_SUPPLY, ...)
+     */
+    unsigned int kind;
+} scenario_event;
+
+/**
+ * поток выполнения реплик: собственный диапазон реплик, рабочие массивы и частичные результаты
+ */
+typedef struct _scenario_worker{
+    /**
+     * моделирование
+     */
+    scenario_runner* sr;
+    /**
+     * номер потока
+     */
+    unsigned int index;
+    /**
+     * идентификатор потока
+     */
+    pthread_t thread;
+    /**
+     * мьютекс диапазона реплик (его захватывают сам поток и потоки, забирающие часть диапазона)
+     */
+    pthread_mutex_t mutex;
+    /**
+     * первая невыполненная реплика диапазона
+     */
+    size_t begin;
+    /**
+     * конец диапазона
+     */
+    size_t end;
+    /**
+     * состояние генератора случайных чисел текущей реплики (xoshiro256**)
+     */
+    unsigned long long random[4];
+    /**
+     * флаги насосов налива и слива по резервуарам (PUMP_DEMAND, ...)
+     */
+    unsigned char* download_pumps;
+    unsigned char* upload_pumps;
+    /**
+     * флаги резервуаров в текущей реплике (REPLICA_OVERFLOW, REPLICA_UNDERFLOW)
+     */
+    unsigned char* replica_flags;
+    /**
+     * куча событий, упорядоченная по моменту
+     */
+    scenario_event* heap;
+    /**
+     * количество событий в куче
+     */
+    size_t heap_size;
+    /**
+     * модель уровней (создается один раз на поток и сбрасывается перед каждой репликой)
+     */
+    level_model* model;
+    /**
+     * номера резервуаров, измененных моделью
+     */
+    unsigned int* changed;
+    /**
+     * частичные результаты: реплики с переполнением и опустошением, события, распределение заполненности
+     */
+    unsigned long long overflow_replicas;
+    unsigned long long underflow_replicas;
+    unsigned long long overflow_events;
+    unsigned long long underflow_events;
+    unsigned long long fill_counts[SCENARIO_FILL_BUCKETS];
+    /**
+     * частичные результаты по резервуарам: количество реплик с переполнением и опустошением, сумма конечных уровней
+     */
+    unsigned long long* tank_overflows;
+    unsigned long long* tank_underflows;
+    unsigned long long* level_sums;
+    /**
+     * количество заимствований диапазона у других потоков
+     */
+    unsigned long long steals;
+} scenario_worker;
+
+/**
+ * моделирование
+ */
+struct _scenario_runner{
+    /**
+     * описания резервуаров
+     */
+    tank_config* tanks;
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * параметры сценария
+     */
+    scenario_config config;
+    /**
+     * начальное значение генераторов случайных чисел
+     */
+    unsigned long long seed;
+    /**
+     * потоки выполнения
+     */
+    scenario_worker** workers;
+    /**
+     * количество потоков
+     */
+    unsigned int threads;
+    /**
+     * сводные результаты
+     */
+    scenario_result result;
+    /**
+     * результаты по резервуарам (суммы по всем потокам)
+     */
+    unsigned long long* tank_overflows;
+    unsigned long long* tank_underflows;
+    unsigned long long* level_sums;
+};
+
+/**
+ * перемешать 64-битное значение (splitmix64)
+ * @param value указатель на состояние, которое продвигается
+ * @return случайное значение
+ */
+static unsigned long long _split_mix(unsigned long long* value);
+
+/**
+ * получить следующее случайное значение генератора реплики (xoshiro256**)
+ * @param sw указатель на поток
+ * @return случайное значение
+ */
+static unsigned long long _next_random(scenario_worker* sw);
+
+/**
+ * получить экспоненциально распределенную длительность
+ * @param sw указатель на поток
+ * @param mean среднее значение в мс
+ * @return длительность в нс
+ */
+static unsigned long long _exponential(scenario_worker* sw, unsigned long long mean);
+
+/**
+ * добавить событие в кучу
+ * @param sw указатель на поток
+ * @param time момент события в нс
+ * @param number номер резервуара
+ * @param kind вид события
+ */
+static void _push_event(scenario_worker* sw, unsigned long long time, unsigned int number, unsigned int kind);
+
+/**
+ * извлечь ближайшее событие из кучи
+ * @param sw указатель на поток
+ * @return событие
+ */
+static scenario_event _pop_event(scenario_worker* sw);
+
+/**
+ * запланировать окончание текущей фазы насоса (поставки, спроса, исправности или ремонта)
+ * @param sw указатель на поток
+ * @param time текущий момент в нс
+ * @param number номер резервуара
+ * @param kind вид события
+ * @param flags флаги насоса
+ */
+static void _schedule_event(scenario_worker* sw, unsigned long long time, unsigned int number, unsigned int kind, unsigned char flags);
+
+/**
+ * обработать достижения границ уровня до момента времени: насос, выключенный моделью на границе,
+ * считается переполнением (налив) или опустошением (слив)
+ * @param sw указатель на поток
+ * @param lm указатель на модель уровня реплики
+ * @param time момент времени в нс
+ */
+static void _collect_limits(scenario_worker* sw, level_model* lm, unsigned long long time);
+
+/**
+ * включить или выключить насосы резервуара в модели по флагам насосов
+ * @param sw указатель на поток
+ * @param lm указатель на модель уровня реплики
+ * @param time момент времени в нс
+ * @param number номер резервуара
+ */
+static void _apply_pumps(scenario_worker* sw, level_model* lm, unsigned long long time, unsigned int number);
+
+/**
+ * выполнить реплику и добавить ее итоги к частичным результатам потока
+ * @param sw указатель на поток
+ * @param replica номер реплики
+ */
+static void _run_replica(scenario_worker* sw, size_t replica);
+
+/**
+ * взять следующую реплику из собственного диапазона
+ * @param sw указатель на поток
+ * @param replica номер реплики
+ * @return 1 - реплика взята, 0 - диапазон пуст
+ */
+static int _take_replica(scenario_worker* sw, size_t* replica);
+
+/**
+ * забрать половину оставшегося диапазона у другого потока
+ * @param sw указатель на поток
+ * @return 1 - диапазон получен, 0 - у всех потоков диапазоны пусты
+ */
+static int _steal_replicas(scenario_worker* sw);
+
+/**
+ * функция потока: выполнять реплики своего диапазона, затем забирать реплики у других потоков
+ * @param sw_ptr указатель на поток
+ * @return NULL
+ */
+static void* _scenario_work(void* sw_ptr);
+
+/**
+ * создать поток выполнения с рабочими массивами
+ * @param sr указатель на моделирование
+ * @param index номер потока
+ * @return указатель на поток
+ */
+static scenario_worker* _create_worker(scenario_runner* sr, unsigned int index);
+
+/**
+ * уничтожить поток выполнения
+ * @param sw указатель на поток
+ */
+static void _finalize_worker(scenario_worker* sw);
+
+/**
+ * получить текущее время в мкс
+ * @return время в мкс
+ */
+static unsigned long long _get_time_us(void);
+
+scenario_runner* create_scenario_runner(const tank_config* tanks, size_t tanks_count, const scenario_config* config){
+    scenario_runner* sr = malloc(sizeof(scenario_runner));
+    sr->tanks = malloc(sizeof(tank_config) * (tanks_count > 0 ? tanks_count : 1));
+    memcpy(sr->tanks, tanks, sizeof(tank_config) * tanks_count);
+    sr->tanks_count = tanks_count;
+    sr->config = *config;
+    sr->seed = 0;
+    sr->workers = NULL;
+    sr->threads = 0;
+    memset(&sr->result, 0, sizeof(scenario_result));
+    sr->tank_overflows = calloc(tanks_count > 0 ? tanks_count : 1, sizeof(unsigned long long));
+    sr->tank_underflows = calloc(tanks_count > 0 ? tanks_count : 1, sizeof(unsigned long long));
+    sr->level_sums = calloc(tanks_count > 0 ? tanks_count : 1, sizeof(unsigned long long));
+    return sr;
+}
+
+int run_scenario_runner(scenario_runner* sr, size_t replicas, unsigned int threads, unsigned long long seed){
+    if (replicas == 0 || sr->tanks_count == 0) return -1;
+    if (threads == 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned int)cpus : 1;
+    }
+    if (threads > replicas) threads = (unsigned int)replicas;
+    unsigned long long start = _get_time_us();
+    sr->seed = seed;
+    sr->threads = threads;
+    sr->workers = malloc(sizeof(scenario_worker*) * threads);
+    for(unsigned int w = 0; w < threads; ++w){
+        sr->workers[w] = _create_worker(sr, w);
+        sr->workers[w]->begin = replicas * w / threads;
+        sr->workers[w]->end = replicas * (w + 1) / threads;
+    }
+    for(unsigned int w = 0; w < threads; ++w){
+        pthread_create(&sr->workers[w]->thread, NULL, _scenario_work, sr->workers[w]);
+    }
+    for(unsigned int w = 0; w < threads; ++w){
+        pthread_join(sr->workers[w]->thread, NULL);
+    }
+    //частичные результаты целочисленные, поэтому сумма не зависит от того, какой поток выполнил реплику
+    unsigned long long overflow_replicas = 0, underflow_replicas = 0, overflow_events = 0, underflow_events = 0;
+    unsigned long long fill_counts[SCENARIO_FILL_BUCKETS] = {0};
+    unsigned long long steals = 0;
+    memset(sr->tank_overflows, 0, sizeof(unsigned long long) * sr->tanks_count);
+    memset(sr->tank_underflows, 0, sizeof(unsigned long long) * sr->tanks_count);
+    memset(sr->level_sums, 0, sizeof(unsigned long long) * sr->tanks_count);
+    for(unsigned int w = 0; w < threads; ++w){
+        scenario_worker* sw = sr->workers[w];
+        overflow_replicas += sw->overflow_replicas;
+        underflow_replicas += sw->underflow_replicas;
+        overflow_events += sw->overflow_events;
+        underflow_events += sw->underflow_events;
+        steals += sw->steals;
+        for(int b = 0; b < SCENARIO_FILL_BUCKETS; ++b){
+            fill_counts[b] += sw->fill_counts[b];
+        }
+        for(size_t i = 0; i < sr->tanks_count; ++i){
+            sr->tank_overflows[i] += sw->tank_overflows[i];
+            sr->tank_underflows[i] += sw->tank_underflows[i];
+            sr->level_sums[i] += sw->level_sums[i];
+        }
+        _finalize_worker(sw);
+    }
+    free(sr->workers);
+    sr->workers = NULL;
+    scenario_result* result = &sr->result;
+    result->replicas = replicas;
+    result->overflow_probability = (double)overflow_replicas / (double)replicas;
+    result->underflow_probability = (double)underflow_replicas / (double)replicas;
+    result->overflow_events = (double)overflow_events / (double)replicas;
+    result->underflow_events = (double)underflow_events / (double)replicas;
+    unsigned long long samples = 0;
+    double fill_sum = 0.0;
+    for(int b = 0; b < SCENARIO_FILL_BUCKETS; ++b){
+        samples += fill_counts[b];
+    }
+    for(int b = 0; b < SCENARIO_FILL_BUCKETS; ++b){
+        result->fill_distribution[b] = samples > 0 ? (double)fill_counts[b] / (double)samples : 0.0;
+    }
+    for(size_t i = 0; i < sr->tanks_count; ++i){
+        const tank_config* tc = &sr->tanks[i];
+        if (tc->maximum_level > 0) fill_sum += (double)sr->level_sums[i] / (double)tc->maximum_level;
+    }
+    result->mean_fill = samples > 0 ? fill_sum / (double)samples : 0.0;
+    result->threads = threads;
+    result->steals = steals;
+    result->run_time = _get_time_us() - start;
+    return 0;
+}
+
+void get_result_scenario_runner(const scenario_runner* sr, scenario_result* result){
+    *result = sr->result;
+}
+
+void get_tank_result_scenario_runner(const scenario_runner* sr, unsigned int number, tank_scenario_result* result){
+    double replicas = sr->result.replicas > 0 ? (double)sr->result.replicas : 1.0;
+    result->overflow_probability = (double)sr->tank_overflows[number] / replicas;
+    result->underflow_probability = (double)sr->tank_underflows[number] / replicas;
+    result->mean_level = (double)sr->level_sums[number] / replicas;
+}
+
+void finalize_scenario_runner(scenario_runner* sr){
+    free(sr->tanks);
+    free(sr->tank_overflows);
+    free(sr->tank_underflows);
+    free(sr->level_sums);
+    free(sr);
+}
+
+static unsigned long long _split_mix(unsigned long long* value){
+    unsigned long long z = (*value += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static unsigned long long _next_random(scenario_worker* sw){
+    unsigned long long* s = sw->random;
+    unsigned long long x = s[1] * 5;
+    unsigned long long result = ((x << 7) | (x >> 57)) * 9;
+    unsigned long long t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+static unsigned long long _exponential(scenario_worker* sw, unsigned long long mean){
+    double u = (double)(_next_random(sw) >> 11) * 0x1.0p-53;
+    return (unsigned long long)ceil(-log1p(-u) * (double)mean * 1000000.0);
+}
+
+static void _push_event(scenario_worker* sw, unsigned long long time, unsigned int number, unsigned int kind){
+    size_t i = sw->heap_size++;
+    scenario_event e = {time, number, kind};
+    while (i > 0){
+        size_t parent = (i - 1) / 2;
+        if (sw->heap[parent].time <= time) break;
+        sw->heap[i] = sw->heap[parent];
+        i = parent;
+    }
+    sw->heap[i] = e;
+}
+
+static scenario_event _pop_event(scenario_worker* sw){
+    scenario_event top = sw->heap[0];
+    scenario_event last = sw->heap[--sw->heap_size];
+    size_t i = 0;
+    while (1){
+        size_t child = 2 * i + 1;
+        if (child >= sw->heap_size) break;
+        if (child + 1 < sw->heap_size && sw->heap[child + 1].time < sw->heap[child].time) ++child;
+        if (last.time <= sw->heap[child].time) break;
+        sw->heap[i] = sw->heap[child];
+        i = child;
+    }
+    if (sw->heap_size > 0) sw->heap[i] = last;
+    return top;
+}
+
+static void _schedule_event(scenario_worker* sw, unsigned long long time, unsigned int number, unsigned int kind, unsigned char flags){
+    const scenario_config* config = &sw->sr->config;
+    unsigned long long mean;
+    switch (kind){
+        case SCENARIO_DOWNLOAD_SUPPLY: mean = flags & PUMP_DEMAND ? config->download_on_time : config->download_off_time; break;
+        case SCENARIO_UPLOAD_DEMAND:   mean = flags & PUMP_DEMAND ? config->upload_on_time : config->upload_off_time; break;
+        default:                       mean = flags & PUMP_FAILED ? config->repair_time : config->outage_interval; break;
+    }
+    if (mean == 0) return;
+    _push_event(sw, time + _exponential(sw, mean), number, kind);
+}
+
+static void _collect_limits(scenario_worker* sw, level_model* lm, unsigned long long time){
+    advance_level_model(lm, time);
+    size_t count = take_changed_level_model(lm, sw->changed);
+    for(size_t k = 0; k < count; ++k){
+        unsigned int number = sw->changed[k];
+        tank_state ts;
+        get_state_level_model(lm, number, time, &ts);
+        if ((sw->download_pumps[number] & PUMP_RUNNING) && ts.download_state == PUMP_OFF){
+            sw->download_pumps[number] = (unsigned char)((sw->download_pumps[number] & ~PUMP_RUNNING) | PUMP_LIMITED);
+            sw->replica_flags[number] |= REPLICA_OVERFLOW;
+            sw->overflow_events++;
+        }
+        if ((sw->upload_pumps[number] & PUMP_RUNNING) && ts.upload_state == PUMP_OFF){
+            sw->upload_pumps[number] = (unsigned char)((sw->upload_pumps[number] & ~PUMP_RUNNING) | PUMP_LIMITED);
+            sw->replica_flags[number] |= REPLICA_UNDERFLOW;
+            sw->underflow_events++;
+        }
+    }
+}
+
+static void _apply_pumps(scenario_worker* sw, level_model* lm, unsigned long long time, unsigned int number){
+    unsigned char download = sw->download_pumps[number];
+    unsigned char upload = sw->upload_pumps[number];
+    int download_on = (download & (PUMP_DEMAND | PUMP_FAILED | PUMP_LIMITED)) == PUMP_DEMAND;
+    int upload_on = (upload & (PUMP_DEMAND | PUMP_FAILED | PUMP_LIMITED)) == PUMP_DEMAND;
+    if (download_on == ((download & PUMP_RUNNING) != 0) && upload_on == ((upload & PUMP_RUNNING) != 0)) return;
+    tank_state ts;
+    get_state_level_model(lm, number, time, &ts);
+    ts.download_state = download_on ? PUMP_ON : PUMP_OFF;
+    ts.upload_state = upload_on ? PUMP_ON : PUMP_OFF;
+    set_state_level_model(lm, number, time, &ts);
+    sw->download_pumps[number] = (unsigned char)(download_on ? download | PUMP_RUNNING : download & ~PUMP_RUNNING);
+    sw->upload_pumps[number] = (unsigned char)(upload_on ? upload | PUMP_RUNNING : upload & ~PUMP_RUNNING);
+}
+
+static void _run_replica(scenario_worker* sw, size_t replica){
+    scenario_runner* sr = sw->sr;
+    unsigned long long mix = sr->seed ^ ((unsigned long long)replica * 0xD1B54A32D192ED03ull);
+    for(int k = 0; k < 4; ++k){
+        sw->random[k] = _split_mix(&mix);
+    }
+    unsigned long long duration = sr->config.duration * 1000000ull;
+    level_model* lm = sw->model;
+    reset_level_model(lm);
+    sw->heap_size = 0;
+    memset(sw->replica_flags, 0, sr->tanks_count);
+    for(unsigned int i = 0; i < sr->tanks_count; ++i){
+        const tank_config* tc = &sr->tanks[i];
+        int pumps_on = (tc->flags & (FLEET_CONFIG_DOWNLOAD_PUMP | FLEET_CONFIG_UPLOAD_PUMP)) != 0;
+        tank_state ts = {tc->current_level, tc->minimum_level, tc->maximum_level,
+                         (tc->flags & FLEET_CONFIG_TANK_ON) || pumps_on ? STORAGE_TANK_ON : STORAGE_TANK_OFF,
+                         PUMP_OFF, tc->download_speed, PUMP_OFF, tc->upload_speed};
+        set_state_level_model(lm, i, 0, &ts);
+        sw->download_pumps[i] = tc->flags & FLEET_CONFIG_DOWNLOAD_PUMP ? PUMP_DEMAND : 0;
+        sw->upload_pumps[i] = tc->flags & FLEET_CONFIG_UPLOAD_PUMP ? PUMP_DEMAND : 0;
+        //выключенный резервуар не участвует в сценарии
+        if (ts.state != STORAGE_TANK_ON) continue;
+        _schedule_event(sw, 0, i, SCENARIO_DOWNLOAD_SUPPLY, sw->download_pumps[i]);
+        _schedule_event(sw, 0, i, SCENARIO_UPLOAD_DEMAND, sw->upload_pumps[i]);
+        _schedule_event(sw, 0, i, SCENARIO_DOWNLOAD_OUTAGE, 0);
+        _schedule_event(sw, 0, i, SCENARIO_UPLOAD_OUTAGE, 0);
+        _apply_pumps(sw, lm, 0, i);
+    }
+    take_changed_level_model(lm, sw->changed);
+    while (sw->heap_size > 0 && sw->heap[0].time <= duration){
+        scenario_event e = _pop_event(sw);
+        _collect_limits(sw, lm, e.time);
+        unsigned char* flags = e.kind == SCENARIO_DOWNLOAD_SUPPLY || e.kind == SCENARIO_DOWNLOAD_OUTAGE
+                               ? &sw->download_pumps[e.number] : &sw->upload_pumps[e.number];
+        if (e.kind == SCENARIO_DOWNLOAD_SUPPLY || e.kind == SCENARIO_UPLOAD_DEMAND){
+            //новая поставка (спрос) снова включает насос, выключенный на границе уровня
+            *flags = (unsigned char)((*flags ^ PUMP_DEMAND) & ~PUMP_LIMITED);
+        } else {
+            *flags ^= PUMP_FAILED;
+        }
+        _schedule_event(sw, e.time, e.number, e.kind, *flags);
+        _apply_pumps(sw, lm, e.time, e.number);
+    }
+    _collect_limits(sw, lm, duration);
+    int overflow = 0, underflow = 0;
+    for(unsigned int i = 0; i < sr->tanks_count; ++i){
+        const tank_config* tc = &sr->tanks[i];
+        tank_state ts;
+        get_state_level_model(lm, i, duration, &ts);
+        sw->level_sums[i] += ts.current_level;
+        size_t bucket = tc->maximum_level > 0 ? (size_t)ts.current_level * SCENARIO_FILL_BUCKETS / tc->maximum_level : 0;
+        sw->fill_counts[bucket < SCENARIO_FILL_BUCKETS ? bucket : SCENARIO_FILL_BUCKETS - 1]++;
+        if (sw->replica_flags[i] & REPLICA_OVERFLOW){
+            sw->tank_overflows[i]++;
+            overflow = 1;
+        }
+        if (sw->replica_flags[i] & REPLICA_UNDERFLOW){
+            sw->tank_underflows[i]++;
+            underflow = 1;
+        }
+    }
+    sw->overflow_replicas += (unsigned long long)overflow;
+    sw->underflow_replicas += (unsigned long long)underflow;
+}
+
+static int _take_replica(scenario_worker* sw, size_t* replica){
+    pthread_mutex_lock(&sw->mutex);
+    int taken = sw->begin < sw->end;
+    if (taken) *replica = sw->begin++;
+    pthread_mutex_unlock(&sw->mutex);
+    return taken;
+}
+
+static int _steal_replicas(scenario_worker* sw){
+    scenario_runner* sr = sw->sr;
+    for(unsigned int k = 1; k < sr->threads; ++k){
+        scenario_worker* victim = sr->workers[(sw->index + k) % sr->threads];
+        pthread_mutex_lock(&victim->mutex);
+        size_t remaining = victim->end - victim->begin;
+        if (remaining == 0){
+            pthread_mutex_unlock(&victim->mutex);
+            continue;
+        }
+        //забирается конец диапазона: владелец продолжает с начала и не сталкивается с заимствованием
+        size_t end = victim->end;
+        victim->end -= (remaining + 1) / 2;
+        size_t begin = victim->end;
+        pthread_mutex_unlock(&victim->mutex);
+        pthread_mutex_lock(&sw->mutex);
+        sw->begin = begin;
+        sw->end = end;
+        pthread_mutex_unlock(&sw->mutex);
+        sw->steals++;
+        return 1;
+    }
+    return 0;
+}
+
+static void* _scenario_work(void* sw_ptr){
+    scenario_worker* sw = sw_ptr;
+    size_t replica;
+    while (1){
+        if (_take_replica(sw, &replica)) _run_replica(sw, replica);
+        else if (!_steal_replicas(sw)) break;
+    }
+    return NULL;
+}
+
+static scenario_worker* _create_worker(scenario_runner* sr, unsigned int index){
+    //потоки выделяются отдельно, чтобы их счетчики не делили строки кэша
+    scenario_worker* sw = calloc(1, sizeof(scenario_worker));
+    size_t count = sr->tanks_count;
+    sw->sr = sr;
+    sw->index = index;
+    pthread_mutex_init(&sw->mutex, NULL);
+    sw->download_pumps = malloc(count);
+    sw->upload_pumps = malloc(count);
+    sw->replica_flags = malloc(count);
+    sw->heap = malloc(sizeof(scenario_event) * count * SCENARIO_EVENT_KINDS);
+    sw->model = create_level_model(count);
+    sw->changed = malloc(sizeof(unsigned int) * count);
+    sw->tank_overflows = calloc(count, sizeof(unsigned long long));
+    sw->tank_underflows = calloc(count, sizeof(unsigned long long));
+    sw->level_sums = calloc(count, sizeof(unsigned long long));
+    return sw;
+}
+
+static void _finalize_worker(scenario_worker* sw){
+    pthread_mutex_destroy(&sw->mutex);
+    free(sw->download_pumps);
+    free(sw->upload_pumps);
+    free(sw->replica_flags);
+    free(sw->heap);
+    finalize_level_model(sw->model);
+    free(sw->changed);
+    free(sw->tank_overflows);
+    free(sw->tank_underflows);
+    free(sw->level_sums);
+    free(sw);
+}
+
+static unsigned long long _get_time_us(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000 + (unsigned long long)now.tv_nsec / 1000;
+}
@@ -0,0 +1,161 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_SCENARIO_RUNNER_H
+#define OIL_STORAGE_MANAGE_SYSTEM_SCENARIO_RUNNER_H
+
+#include "fleet_config.h"
+#include <stddef.h>
+
+/**
+ * статистическое моделирование парка резервуаров (метод Монте-Карло)
+ *
+ * каждая реплика - независимый прогон конфигурации парка в модельном времени на аналитической модели уровня
+ * (level_model.h): насосы налива и слива включаются и выключаются случайно (поставки и спрос), насосы случайно
+ * отказывают и восстанавливаются; уровень считается только в моменты событий, поэтому реплика за часы
+ * модельного времени считается за миллисекунды; у каждой реплики свой генератор случайных чисел, зависящий
+ * только от начального значения и номера реплики, поэтому результат не зависит от количества потоков;
+ * реплики распределяются по потокам диапазонами, освободившийся поток забирает половину оставшегося
+ * диапазона у другого потока
+ */
+struct _scenario_runner;
+typedef struct _scenario_runner scenario_runner;
+
+#define SCENARIO_FILL_BUCKETS   20  //интервалы распределения заполненности (по 5%)
+
+/**
+ * параметры сценария (средние времена распределены экспоненциально, 0 - состояние не заканчивается)
+ */
+typedef struct _scenario_config{
+    /**
+     * моделируемый период в мс
+     */
+    unsigned long long duration;
+    /**
+     * среднее время работы насоса налива (поставки) в мс
+     */
+    unsigned long long download_on_time;
+    /**
+     * средний перерыв между поставками в мс
+     */
+    unsigned long long download_off_time;
+    /**
+     * среднее время работы насоса слива (спроса) в мс
+     */
+    unsigned long long upload_on_time;
+    /**
+     * средний перерыв в спросе в мс
+     */
+    unsigned long long upload_off_time;
+    /**
+     * среднее время между отказами насоса в мс (0 - насосы не отказывают)
+     */
+    unsigned long long outage_interval;
+    /**
+     * среднее время восстановления насоса в мс
+     */
+    unsigned long long repair_time;
+} scenario_config;
+
+/**
+ * сводные результаты моделирования
+ */
+typedef struct _scenario_result{
+    /**
+     * количество реплик
+     */
+    size_t replicas;
+    /**
+     * доля реплик, в которых хотя бы один резервуар дошел до максимального уровня при работающем наливе
+     */
+    double overflow_probability;
+    /**
+     * доля реплик, в которых хотя бы один резервуар дошел до минимального уровня при работающем сливе
+     */
+    double underflow_probability;
+    /**
+     * среднее количество достижений максимального уровня за реплику
+     */
+    double overflow_events;
+    /**
+     * среднее количество достижений минимального уровня за реплику
+     */
+    double underflow_events;
+    /**
+     * средняя заполненность резервуаров в конце периода
+     */
+    double mean_fill;
+    /**
+     * распределение заполненности резервуаров в конце периода (доли по интервалам 0-5%, 5-10%, ..., 95-100%)
+     */
+    double fill_distribution[SCENARIO_FILL_BUCKETS];
+    /**
+     * количество потоков
+     */
+    unsigned int threads;
+    /**
+     * количество перераспределений диапазонов реплик между потоками
+     */
+    unsigned long long steals;
+    /**
+     * время моделирования в мкс
+     */
+    unsigned long long run_time;
+} scenario_result;
+
+/**
+ * результаты моделирования по резервуару
+ */
+typedef struct _tank_scenario_result{
+    /**
+     * доля реплик, в которых резервуар дошел до максимального уровня при работающем наливе
+     */
+    double overflow_probability;
+    /**
+     * доля реплик, в которых резервуар дошел до минимального уровня при работающем сливе
+     */
+    double underflow_probability;
+    /**
+     * средний уровень в конце периода
+     */
+    double mean_level;
+} tank_scenario_result;
+
+/**
+ * создать моделирование конфигурации парка
+ * @param tanks описания резервуаров (копируются)
+ * @param tanks_count количество резервуаров
+ * @param config параметры сценария
+ * @return указатель на моделирование
+ */
+scenario_runner* create_scenario_runner(const tank_config* tanks, size_t tanks_count, const scenario_config* config);
+
+/**
+ * выполнить реплики (результаты предыдущего выполнения сбрасываются)
+ * @param sr указатель на моделирование
+ * @param replicas количество реплик
+ * @param threads количество потоков (0 - по количеству процессоров)
+ * @param seed начальное значение генераторов случайных чисел
+ * @return 0 - реплики выполнены, -1 - нет реплик или резервуаров
+ */
+int run_scenario_runner(scenario_runner* sr, size_t replicas, unsigned int threads, unsigned long long seed);
+
+/**
+ * получить сводные результаты последнего выполнения
+ * @param sr указатель на моделирование
+ * @param result структура для результатов
+ */
+void get_result_scenario_runner(const scenario_runner* sr, scenario_result* result);
+
+/**
+ * получить результаты резервуара
+ * @param sr указатель на моделирование
+ * @param number номер резервуара
+ * @param result структура для результатов
+ */
+void get_tank_result_scenario_runner(const scenario_runner* sr, unsigned int number, tank_scenario_result* result);
+
+/**
+ * уничтожить моделирование
+ * @param sr указатель на моделирование
+ */
+void finalize_scenario_runner(scenario_runner* sr);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_SCENARIO_RUNNER_H
@@ -1,5 +1,6 @@
 #include "storage_tank.h"
 #include "oil_storage_def.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
@@ -100,6 +101,21 @@ unsigned int get_current_level_storage_tank(storage_tank *st){
     return st->current_level;
 }
 
+void set_current_level_storage_tank(storage_tank* st, unsigned int level){
+    st->current_level = (int)level;
+}
+
+unsigned int transfer_level_storage_tank(storage_tank* st, unsigned int credit, unsigned int debit){
+    //уровень одновременно меняют потоки насосов, поэтому изменения атомарные
+    long long room = (long long)st->maximum_level - __atomic_load_n(&st->current_level, __ATOMIC_SEQ_CST);
+    if ((long long)credit > room) credit = room > 0 ? (unsigned int)room : 0;
+    long long level = __atomic_add_fetch(&st->current_level, (int)credit, __ATOMIC_SEQ_CST);
+    long long available = level - (long long)st->minimum_level;
+    unsigned int taken = available <= 0 ? 0 : available < debit ? (unsigned int)available : debit;
+    __atomic_sub_fetch(&st->current_level, (int)taken, __ATOMIC_SEQ_CST);
+    return taken;
+}
+
 void finalize_storage_tank(storage_tank* st){
     turn_off_storage_tank(st);
     finalize_pump(st->injection_pump);
@@ -129,7 +145,7 @@ void set_speed_injection_pump(storage_tank* st, unsigned int speed){
 }
 
 unsigned int get_speed_injection_pump(const storage_tank* st){
-    get_delta_pump(st->injection_pump);
+    return get_delta_pump(st->injection_pump);
 }
 
 void turn_on_pumping_pump(storage_tank* st){
@@ -146,7 +162,7 @@ void turn_off_pumping_pump(storage_tank* st){
 }
 
 int get_state_pumping_pump(const storage_tank* st){
-    get_state_pump(st->pumping_pump);
+    return get_state_pump(st->pumping_pump);
 }
 
 void set_speed_pumping_pump(storage_tank* st, unsigned int speed){
@@ -159,7 +175,9 @@ unsigned int get_speed_pumping_pump(const storage_tank* st){
 
 static void* _control_level(void* st_ptr){
     storage_tank* st = st_ptr;
+    set_thread_name_trace("control");
     while(st->state == STORAGE_TANK_ON){
+        unsigned long long span = begin_span_trace();
         if (st->current_level <= st->minimum_level){
             turn_off_pump(st->pumping_pump);
         }
@@ -169,6 +187,7 @@ static void* _control_level(void* st_ptr){
         if (st->current_level >= st->maximum_level){
             turn_off_pump(st->injection_pump);
         }
+        end_span_trace("control", "control_check", span, TRACE_NO_ARG);
         usleep(TIME_UNIT);
     }
     return NULL;
@@ -73,6 +73,23 @@ unsigned int get_maximum_level_storage_tank(const storage_tank* st);
  */
 unsigned int get_current_level_storage_tank(storage_tank *st);
 
+/**
+ * установить уровень нефти (восстановление сохраненного состояния резервуара)
+ * @param st указатель на резервуар
+ * @param level уровень нефти
+ */
+void set_current_level_storage_tank(storage_tank* st, unsigned int level);
+
+/**
+ * изменить уровень нефти перекачками между резервуарами: начисление выполняется не выше
+ * максимального уровня, списание - не ниже минимального уровня
+ * @param st указатель на резервуар
+ * @param credit начисляемый объем
+ * @param debit списываемый объем
+ * @return фактически списанный объем
+ */
+unsigned int transfer_level_storage_tank(storage_tank* st, unsigned int credit, unsigned int debit);
+
 /**
  * уничтожить резевуар
  * @param st указатель на резервуар
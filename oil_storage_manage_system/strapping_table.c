@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+#include "strapping_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#define BUILTIN_TABLE_POINTS (STRAPPING_TABLE_SEGMENTS + 1) //количество точек, по которым строятся встроенные таблицы
+#define TABLE_LINE_SIZE 256         //максимальная длина строки файла таблиц
+
+/**
+ * набор градуировочных таблиц
+ */
+struct _strapping_table{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * отрезки всех таблиц подряд: пары (объем в начале отрезка, приращение объема на отрезке) в долях вместимости
+     */
+    float* segments;
+    /**
+     * количество таблиц
+     */
+    size_t tables_count;
+    /**
+     * количество таблиц, под которое выделена память
+     */
+    size_t tables_capacity;
+    /**
+     * номера таблиц резервуаров
+     */
+    unsigned int* tables;
+    /**
+     * номера первых отрезков таблиц резервуаров в segments (таблица еще не загружена - вертикальная)
+     */
+    unsigned int* offsets;
+    /**
+     * количество отрезков на единицу уровня (STRAPPING_TABLE_SEGMENTS / высота)
+     */
+    float* scales;
+    /**
+     * вместимости резервуаров
+     */
+    float* capacities;
+};
+
+/**
+ * пересчитать уровень в объем по отрезкам таблицы
+ * @param segments отрезки таблицы
+ * @param scale количество отрезков на единицу уровня
+ * @param capacity вместимость
+ * @param level уровень
+ * @return объем
+ */
+static float _interpolate(const float* segments, float scale, float capacity, unsigned int level);
+
+/**
+ * обновить номера первых отрезков резервуаров после добавления таблиц
+ * @param st указатель на набор таблиц
+ */
+static void _resolve_offsets(strapping_table* st);
+
+/**
+ * добавить встроенную таблицу, заданную функцией объема от доли высоты
+ * @param st указатель на набор таблиц
+ * @param volume функция объема (доля вместимости от доли высоты)
+ */
+static void _add_builtin_table(strapping_table* st, double (*volume)(double));
+
+/**
+ * объем вертикального цилиндра
+ * @param h доля высоты
+ * @return доля вместимости
+ */
+static double _vertical_volume(double h);
+
+/**
+ * объем горизонтального цилиндра (площадь сегмента круга)
+ * @param h доля высоты
+ * @return доля вместимости
+ */
+static double _horizontal_volume(double h);
+
+/**
+ * объем шара (объем шарового сегмента)
+ * @param h доля высоты
+ * @return доля вместимости
+ */
+static double _spherical_volume(double h);
+
+strapping_table* create_strapping_table(size_t tanks_count){
+    strapping_table* st = malloc(sizeof(strapping_table));
+    st->tanks_count = tanks_count;
+    st->tables_count = 0;
+    st->tables_capacity = STRAPPING_TABLE_BUILTIN;
+    st->segments = malloc(sizeof(float) * 2 * STRAPPING_TABLE_SEGMENTS * st->tables_capacity);
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    st->tables = calloc(count, sizeof(unsigned int));
+    st->offsets = calloc(count, sizeof(unsigned int));
+    st->scales = malloc(sizeof(float) * count);
+    st->capacities = malloc(sizeof(float) * count);
+    for(size_t i = 0; i < tanks_count; ++i){
+        st->scales[i] = STRAPPING_TABLE_SEGMENTS;
+        st->capacities[i] = 1.0f;
+    }
+    _add_builtin_table(st, _vertical_volume);
+    _add_builtin_table(st, _horizontal_volume);
+    _add_builtin_table(st, _spherical_volume);
+    return st;
+}
+
+int add_strapping_table(strapping_table* st, const double* heights, const double* volumes, size_t count){
+    if (count < 2 || heights[0] != 0.0 || volumes[0] < 0.0) return -1;
+    for(size_t i = 1; i < count; ++i){
+        if (!(heights[i] > heights[i - 1]) || volumes[i] < volumes[i - 1]) return -1;
+    }
+    double height = heights[count - 1], capacity = volumes[count - 1];
+    if (!(capacity > 0.0)) return -1;
+    if (st->tables_count == st->tables_capacity){
+        st->tables_capacity *= 2;
+        st->segments = realloc(st->segments, sizeof(float) * 2 * STRAPPING_TABLE_SEGMENTS * st->tables_capacity);
+    }
+    float* segments = st->segments + 2 * STRAPPING_TABLE_SEGMENTS * st->tables_count;
+    double previous = volumes[0] / capacity;
+    size_t point = 0;
+    for(unsigned int j = 1; j <= STRAPPING_TABLE_SEGMENTS; ++j){
+        double h = height * j / STRAPPING_TABLE_SEGMENTS;
+        while (point + 2 < count && heights[point + 1] < h) point++;
+        double t = (h - heights[point]) / (heights[point + 1] - heights[point]);
+        if (t > 1.0) t = 1.0;
+        double current = (volumes[point] + t * (volumes[point + 1] - volumes[point])) / capacity;
+        segments[2 * (j - 1)] = (float)previous;
+        segments[2 * (j - 1) + 1] = (float)(current - previous);
+        previous = current;
+    }
+    st->tables_count++;
+    _resolve_offsets(st);
+    return (int)st->tables_count - 1;
+}
+
+int load_strapping_table(strapping_table* st, const char* path, size_t* error_line){
+    size_t line = 0;
+    if (error_line == NULL) error_line = &line;
+    *error_line = 0;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    size_t first_table = st->tables_count;
+    size_t points_count = 0, points_capacity = 64;
+    double* heights = malloc(sizeof(double) * points_capacity);
+    double* volumes = malloc(sizeof(double) * points_capacity);
+    int result = 0, in_table = 0;
+    char buffer[TABLE_LINE_SIZE];
+    for(;;){
+        int end_of_file = fgets(buffer, sizeof(buffer), file) == NULL;
+        if (!end_of_file) line++;
+        char* comment = end_of_file ? NULL : strchr(buffer, '#');
+        if (comment != NULL) *comment = '\0';
+        char word[TABLE_LINE_SIZE];
+        int is_header = !end_of_file && sscanf(buffer, "%255s", word) == 1 && strcmp(word, "table") == 0;
+        if ((end_of_file || is_header) && in_table){
+            if (add_strapping_table(st, heights, volumes, points_count) == -1){
+                result = -1;
+                break;
+            }
+            points_count = 0;
+        }
+        if (end_of_file) break;
+        if (is_header){
+            in_table = 1;
+            continue;
+        }
+        double h, v;
+        char extra;
+        int fields = sscanf(buffer, "%lf %lf %c", &h, &v, &extra);
+        if (fields == EOF) continue;
+        if (fields != 2 || !in_table){
+            result = -1;
+            break;
+        }
+        if (points_count == points_capacity){
+            points_capacity *= 2;
+            heights = realloc(heights, sizeof(double) * points_capacity);
+            volumes = realloc(volumes, sizeof(double) * points_capacity);
+        }
+        heights[points_count] = h;
+        volumes[points_count] = v;
+        points_count++;
+    }
+    if (result == -1){
+        *error_line = line;
+        st->tables_count = first_table;
+        _resolve_offsets(st);
+    } else {
+        result = (int)(st->tables_count - first_table);
+    }
+    free(heights);
+    free(volumes);
+    fclose(file);
+    return result;
+}
+
+size_t get_count_strapping_table(const strapping_table* st){
+    return st->tables_count;
+}
+
+void set_tank_strapping_table(strapping_table* st, unsigned int number, unsigned int table, unsigned int height, double capacity){
+    st->tables[number] = table;
+    st->offsets[number] = table < st->tables_count ? table * STRAPPING_TABLE_SEGMENTS : 0;
+    st->scales[number] = (float)STRAPPING_TABLE_SEGMENTS / (float)(height > 0 ? height : 1);
+    st->capacities[number] = (float)capacity;
+}
+
+unsigned int get_tank_table_strapping_table(const strapping_table* st, unsigned int number){
+    return st->tables[number];
+}
+
+float get_volume_strapping_table(const strapping_table* st, unsigned int number, unsigned int level){
+    return _interpolate(st->segments + 2 * st->offsets[number], st->scales[number], st->capacities[number], level);
+}
+
+void convert_strapping_table(const strapping_table* st, unsigned int first, const unsigned int* levels, size_t count, float* volumes){
+    const unsigned int* offsets = st->offsets + first;
+    const float* scales = st->scales + first;
+    const float* capacities = st->capacities + first;
+    size_t i = 0;
+#if defined(__SSE2__)
+    //доля высоты, номер отрезка и положение на отрезке считаются сразу для четырех резервуаров,
+    //пары отрезков выбираются по одной (в SSE2 нет выборки по индексам)
+    const __m128 last_point = _mm_set1_ps((float)STRAPPING_TABLE_SEGMENTS);
+    const __m128 last_segment = _mm_set1_ps((float)(STRAPPING_TABLE_SEGMENTS - 1));
+    const __m128i low_mask = _mm_set1_epi32(0xffff);
+    const __m128 high_scale = _mm_set1_ps(65536.0f);
+    for(; i + 4 <= count; i += 4){
+        __m128i raw_levels = _mm_loadu_si128((const __m128i*)(levels + i));
+        //беззнаковый уровень преобразуется по половинам, чтобы не потерять точность
+        __m128 level = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(raw_levels, 16)), high_scale),
+                                  _mm_cvtepi32_ps(_mm_and_si128(raw_levels, low_mask)));
+        __m128 x = _mm_min_ps(_mm_mul_ps(level, _mm_loadu_ps(scales + i)), last_point);
+        __m128i segment = _mm_cvttps_epi32(_mm_min_ps(x, last_segment));
+        __m128 t = _mm_sub_ps(x, _mm_cvtepi32_ps(segment));
+        unsigned int indexes[4];
+        _mm_storeu_si128((__m128i*)indexes, _mm_add_epi32(segment, _mm_loadu_si128((const __m128i*)(offsets + i))));
+        const float* s0 = st->segments + 2 * indexes[0];
+        const float* s1 = st->segments + 2 * indexes[1];
+        const float* s2 = st->segments + 2 * indexes[2];
+        const float* s3 = st->segments + 2 * indexes[3];
+        __m128 base = _mm_set_ps(s3[0], s2[0], s1[0], s0[0]);
+        __m128 slope = _mm_set_ps(s3[1], s2[1], s1[1], s0[1]);
+        __m128 volume = _mm_mul_ps(_mm_add_ps(base, _mm_mul_ps(t, slope)), _mm_loadu_ps(capacities + i));
+        _mm_storeu_ps(volumes + i, volume);
+    }
+#endif
+    for(; i < count; ++i){
+        volumes[i] = _interpolate(st->segments + 2 * offsets[i], scales[i], capacities[i], levels[i]);
+    }
+}
+
+void finalize_strapping_table(strapping_table* st){
+    free(st->segments);
+    free(st->tables);
+    free(st->offsets);
+    free(st->scales);
+    free(st->capacities);
+    free(st);
+}
+
+static float _interpolate(const float* segments, float scale, float capacity, unsigned int level){
+    float x = (float)level * scale;
+    if (x > STRAPPING_TABLE_SEGMENTS) x = STRAPPING_TABLE_SEGMENTS;
+    unsigned int segment = (unsigned int)x;
+    if (segment >= STRAPPING_TABLE_SEGMENTS) segment = STRAPPING_TABLE_SEGMENTS - 1;
+    float t = x - (float)segment;
+    return (segments[2 * segment] + t * segments[2 * segment + 1]) * capacity;
+}
+
+static void _resolve_offsets(strapping_table* st){
+    for(size_t i = 0; i < st->tanks_count; ++i){
+        st->offsets[i] = st->tables[i] < st->tables_count ? st->tables[i] * STRAPPING_TABLE_SEGMENTS : 0;
+    }
+}
+
+static void _add_builtin_table(strapping_table* st, double (*volume)(double)){
+    double heights[BUILTIN_TABLE_POINTS], volumes[BUILTIN_TABLE_POINTS];
+    for(int i = 0; i < BUILTIN_TABLE_POINTS; ++i){
+        heights[i] = (double)i / (BUILTIN_TABLE_POINTS - 1);
+        volumes[i] = volume(heights[i]);
+    }
+    add_strapping_table(st, heights, volumes, BUILTIN_TABLE_POINTS);
+}
+
+static double _vertical_volume(double h){
+    return h;
+}
+
+static double _horizontal_volume(double h){
+    double c = 1.0 - 2.0 * h;
+    return (acos(c) - c * sqrt(1.0 - c * c)) / M_PI;
+}
+
+static double _spherical_volume(double h){
+    return h * h * (3.0 - 2.0 * h);
+}
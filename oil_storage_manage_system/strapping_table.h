@@ -0,0 +1,100 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_STRAPPING_TABLE_H
+#define OIL_STORAGE_MANAGE_SYSTEM_STRAPPING_TABLE_H
+
+#include <stddef.h>
+
+/**
+ * градуировочные таблицы резервуаров (пересчет уровня в объем)
+ *
+ * каждая таблица приводится к равномерной сетке из STRAPPING_TABLE_SEGMENTS отрезков по доле высоты,
+ * объем на отрезке задается началом и наклоном в долях вместимости; резервуар ссылается на таблицу
+ * и задает свои высоту и вместимость, поэтому резервуары одной формы разделяют одну таблицу
+ */
+struct _strapping_table;
+typedef struct _strapping_table strapping_table;
+
+#define STRAPPING_TABLE_SEGMENTS    1024 //количество отрезков равномерной сетки таблицы
+#define STRAPPING_TABLE_VERTICAL    0   //вертикальный цилиндр (объем пропорционален уровню)
+#define STRAPPING_TABLE_HORIZONTAL  1   //горизонтальный цилиндр
+#define STRAPPING_TABLE_SPHERICAL   2   //шаровой резервуар
+#define STRAPPING_TABLE_BUILTIN     3   //количество встроенных таблиц (загруженные таблицы получают следующие номера)
+
+/**
+ * создать набор таблиц для резервуаров (все резервуары - вертикальные, высота и вместимость равны 1)
+ * @param tanks_count количество резервуаров
+ * @return указатель на набор таблиц
+ */
+strapping_table* create_strapping_table(size_t tanks_count);
+
+/**
+ * добавить таблицу по точкам градуировки
+ * @param st указатель на набор таблиц
+ * @param heights уровни (строго возрастают, первый - 0)
+ * @param volumes объемы при этих уровнях (не убывают)
+ * @param count количество точек (не меньше 2)
+ * @return номер таблицы, -1 - точки некорректны
+ */
+int add_strapping_table(strapping_table* st, const double* heights, const double* volumes, size_t count);
+
+/**
+ * загрузить таблицы из текстового файла: строка "table" начинает таблицу, далее строки "уровень объем",
+ * '#' начинает комментарий
+ * @param st указатель на набор таблиц
+ * @param path путь к файлу
+ * @param error_line номер строки с ошибкой (0 - ошибка чтения файла), может быть NULL
+ * @return количество загруженных таблиц, -1 - ошибка (таблицы файла не добавляются)
+ */
+int load_strapping_table(strapping_table* st, const char* path, size_t* error_line);
+
+/**
+ * получить количество таблиц (вместе со встроенными)
+ * @param st указатель на набор таблиц
+ * @return количество таблиц
+ */
+size_t get_count_strapping_table(const strapping_table* st);
+
+/**
+ * назначить резервуару таблицу
+ * (таблица может быть загружена позже, до этого резервуар пересчитывается как вертикальный)
+ * @param st указатель на набор таблиц
+ * @param number номер резервуара
+ * @param table номер таблицы
+ * @param height уровень, соответствующий верху таблицы
+ * @param capacity объем при этом уровне
+ */
+void set_tank_strapping_table(strapping_table* st, unsigned int number, unsigned int table, unsigned int height, double capacity);
+
+/**
+ * получить номер таблицы резервуара
+ * @param st указатель на набор таблиц
+ * @param number номер резервуара
+ * @return номер таблицы
+ */
+unsigned int get_tank_table_strapping_table(const strapping_table* st, unsigned int number);
+
+/**
+ * пересчитать уровень резервуара в объем
+ * @param st указатель на набор таблиц
+ * @param number номер резервуара
+ * @param level уровень
+ * @return объем
+ */
+float get_volume_strapping_table(const strapping_table* st, unsigned int number, unsigned int level);
+
+/**
+ * пересчитать уровни подряд идущих резервуаров в объемы
+ * @param st указатель на набор таблиц
+ * @param first номер первого резервуара
+ * @param levels уровни резервуаров first, first + 1, ...
+ * @param count количество резервуаров
+ * @param volumes объемы
+ */
+void convert_strapping_table(const strapping_table* st, unsigned int first, const unsigned int* levels, size_t count, float* volumes);
+
+/**
+ * уничтожить набор таблиц
+ * @param st указатель на набор таблиц
+ */
+void finalize_strapping_table(strapping_table* st);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_STRAPPING_TABLE_H
@@ -0,0 +1,407 @@
+#define _GNU_SOURCE
+#include "tank_channel.h"
+#include "oil_storage_def.h"
+#include "futex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#define RING_DATA_SIZE 4096     //размер области данных кольцевого буфера в байтах (степень двойки)
+#define RING_SPIN_COUNT 2000    //количество проверок кольцевого буфера перед засыпанием на futex
+#define CACHE_LINE_SIZE 64      //размер строки кэша
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() do {} while (0)
+#endif
+
+/**
+ * кольцевой буфер с одним писателем и одним читателем в разделяемой памяти
+ * (позиции растут неограниченно, индекс в области данных - позиция по модулю RING_DATA_SIZE)
+ */
+typedef struct _tank_ring{
+    /**
+     * позиция чтения (изменяет только читатель)
+     */
+    _Alignas(CACHE_LINE_SIZE) uint32_t head;
+    /**
+     * позиция записи (изменяет только писатель, на ней же читатель ждет futex)
+     */
+    _Alignas(CACHE_LINE_SIZE) uint32_t tail;
+    /**
+     * признак того, что читатель спит на futex и писатель должен его разбудить
+     */
+    _Alignas(CACHE_LINE_SIZE) uint32_t waiting;
+    /**
+     * область данных
+     */
+    _Alignas(CACHE_LINE_SIZE) unsigned char data[RING_DATA_SIZE];
+} tank_ring;
+
+/**
+ * разделяемая память канала: идентификатор управляющего процесса и два кольцевых буфера
+ */
+typedef struct _tank_channel_memory{
+    /**
+     * идентификатор управляющего процесса (процесс резервуара сравнивает с ним getppid(),
+     * даже если управляющий процесс завершился раньше, чем процесс резервуара подключился к каналу)
+     */
+    _Alignas(CACHE_LINE_SIZE) pid_t parent_pid;
+    /**
+     * буфер команд и буфер ответов
+     */
+    tank_ring rings[2];
+} tank_channel_memory;
+
+/**
+ * канал обмена командами и ответами
+ */
+struct _tank_channel{
+    /**
+     * тип канала (TANK_CHANNEL_PIPE, TANK_CHANNEL_RING)
+     */
+    int type;
+    /**
+     * дескриптор чтения (pipe - ответы или команды, ring - признак жизни процесса резервуара у управляющего процесса, -1 - нет)
+     */
+    int fd_read;
+    /**
+     * дескриптор записи (pipe - команды или ответы, ring - признак жизни у процесса резервуара, -1 - нет)
+     */
+    int fd_write;
+    /**
+     * дескрипторы, передаваемые процессу резервуара (-1 - уже переданы и закрыты)
+     */
+    int worker_fd_in;
+    int worker_fd_out;
+    /**
+     * отображенная разделяемая память
+     */
+    tank_channel_memory* memory;
+    /**
+     * буфер, из которого читает эта сторона канала
+     */
+    tank_ring* in;
+    /**
+     * буфер, в который пишет эта сторона канала
+     */
+    tank_ring* out;
+    /**
+     * идентификатор управляющего процесса (на стороне процесса резервуара, 0 - на стороне управляющего процесса)
+     */
+    pid_t parent_pid;
+};
+
+/**
+ * количество процессоров (ожидание в цикле имеет смысл только при нескольких процессорах)
+ */
+static long _cpus_count = 0;
+
+/**
+ * создать канал из двух неименованных каналов
+ * @param ch указатель на канал
+ * @param min_fd наименьший номер дескрипторов канала
+ * @return 0 - канал создан, -1 - ошибка
+ */
+static int _create_pipe_channel(tank_channel* ch, int min_fd);
+
+/**
+ * создать канал из кольцевых буферов в разделяемой памяти
+ * @param ch указатель на канал
+ * @param min_fd наименьший номер дескрипторов канала
+ * @return 0 - канал создан, -1 - ошибка
+ */
+static int _create_ring_channel(tank_channel* ch, int min_fd);
+
+/**
+ * перенести дескриптор на номер не меньше заданного
+ * @param fd дескриптор (закрывается)
+ * @param min_fd наименьший номер дескриптора
+ * @return новый дескриптор, -1 - ошибка
+ */
+static int _move_fd(int fd, int min_fd);
+
+/**
+ * прочитать данные из неименованного канала
+ * @param ch указатель на канал
+ * @param data буфер для данных
+ * @param size размер данных в байтах
+ * @param timeout максимальное время ожидания в мс (-1 - без ограничения)
+ * @return 0 - данные прочитаны, -1 - ошибка
+ */
+static int _read_pipe(tank_channel* ch, void* data, size_t size, int timeout);
+
+/**
+ * дождаться, пока в кольцевом буфере накопится заданное количество байт
+ * (сначала буфер проверяется в цикле, затем читатель засыпает на futex)
+ * @param ch указатель на канал
+ * @param size количество байт
+ * @param timeout максимальное время ожидания в мс (-1 - без ограничения)
+ * @return 1 - данные есть, 0 - время ожидания истекло, -1 - другая сторона завершилась
+ */
+static int _wait_ring(tank_channel* ch, size_t size, int timeout);
+
+/**
+ * проверить, что другая сторона канала жива
+ * @param ch указатель на канал
+ * @return 1 - жива, 0 - завершилась
+ */
+static int _is_peer_alive(const tank_channel* ch);
+
+/**
+ * получить текущее время в мс
+ * @return время в мс
+ */
+static long long _get_time_ms(void);
+
+tank_channel* create_tank_channel(int type, int min_fd){
+    tank_channel* ch = malloc(sizeof(tank_channel));
+    if (ch == NULL) return NULL;
+    ch->fd_read = ch->fd_write = ch->worker_fd_in = ch->worker_fd_out = -1;
+    ch->memory = NULL;
+    ch->in = ch->out = NULL;
+    ch->parent_pid = 0;
+    if (type == TANK_CHANNEL_RING && _create_ring_channel(ch, min_fd) == 0) return ch;
+    if (_create_pipe_channel(ch, min_fd) == 0) return ch;
+    free(ch);
+    return NULL;
+}
+
+tank_channel* attach_tank_channel(int type, int fd_in, int fd_out){
+    tank_channel* ch = malloc(sizeof(tank_channel));
+    if (ch == NULL) return NULL;
+    ch->type = type;
+    ch->worker_fd_in = ch->worker_fd_out = -1;
+    ch->memory = NULL;
+    ch->in = ch->out = NULL;
+    ch->parent_pid = 0;
+    ch->fd_read = fd_in;
+    ch->fd_write = fd_out;
+    if (type == TANK_CHANNEL_RING){
+        ch->memory = mmap(NULL, sizeof(tank_channel_memory), PROT_READ | PROT_WRITE, MAP_SHARED, fd_in, 0);
+        close(fd_in);
+        ch->fd_read = -1;
+        if (ch->memory == MAP_FAILED){
+            if (fd_out != -1) close(fd_out);
+            free(ch);
+            return NULL;
+        }
+        ch->parent_pid = ch->memory->parent_pid;
+        ch->in = &ch->memory->rings[0];
+        ch->out = &ch->memory->rings[1];
+    }
+    return ch;
+}
+
+int get_type_tank_channel(const tank_channel* ch){
+    return ch->type;
+}
+
+void get_worker_fds_tank_channel(const tank_channel* ch, int* fd_in, int* fd_out){
+    *fd_in = ch->worker_fd_in;
+    *fd_out = ch->worker_fd_out;
+}
+
+void close_worker_fds_tank_channel(tank_channel* ch){
+    if (ch->worker_fd_in != -1) close(ch->worker_fd_in);
+    if (ch->worker_fd_out != -1) close(ch->worker_fd_out);
+    ch->worker_fd_in = ch->worker_fd_out = -1;
+}
+
+void close_fds_tank_channel(tank_channel* ch){
+    if (ch->fd_read != -1) close(ch->fd_read);
+    if (ch->fd_write != -1) close(ch->fd_write);
+    ch->fd_read = ch->fd_write = -1;
+}
+
+int write_tank_channel(tank_channel* ch, const void* data, size_t size){
+    if (ch->type == TANK_CHANNEL_PIPE){
+        return write(ch->fd_write, data, size) == (ssize_t)size ? 0 : -1;
+    }
+    tank_ring* ring = ch->out;
+    if (size > RING_DATA_SIZE) return -1;
+    uint32_t tail = ring->tail;
+    long long deadline = _get_time_ms() + ANSWER_TIMEOUT;
+    while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > RING_DATA_SIZE - size){
+        if (_get_time_ms() > deadline || !_is_peer_alive(ch)) return -1;
+        sched_yield();
+    }
+    size_t index = tail % RING_DATA_SIZE;
+    size_t first = size < RING_DATA_SIZE - index ? size : RING_DATA_SIZE - index;
+    memcpy(ring->data + index, data, first);
+    memcpy(ring->data, (const unsigned char*)data + first, size - first);
+    __atomic_store_n(&ring->tail, tail + (uint32_t)size, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) wake_futex(&ring->tail, 1, FUTEX_SHARED);
+    return 0;
+}
+
+int read_tank_channel(tank_channel* ch, void* data, size_t size, int timeout){
+    if (ch->type == TANK_CHANNEL_PIPE) return _read_pipe(ch, data, size, timeout);
+    if (size > RING_DATA_SIZE || _wait_ring(ch, size, timeout) != 1) return -1;
+    tank_ring* ring = ch->in;
+    uint32_t head = ring->head;
+    size_t index = head % RING_DATA_SIZE;
+    size_t first = size < RING_DATA_SIZE - index ? size : RING_DATA_SIZE - index;
+    memcpy(data, ring->data + index, first);
+    memcpy((unsigned char*)data + first, ring->data, size - first);
+    __atomic_store_n(&ring->head, head + (uint32_t)size, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int wait_tank_channel(tank_channel* ch, int timeout){
+    if (ch->type == TANK_CHANNEL_RING) return _wait_ring(ch, 1, timeout);
+    struct pollfd pfd = {ch->fd_read, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeout);
+    if (ready == 0 || (ready == -1 && errno == EINTR)) return 0;
+    return ready > 0 ? 1 : -1;
+}
+
+size_t get_pending_tank_channel(const tank_channel* ch){
+    if (ch->type == TANK_CHANNEL_RING){
+        const tank_ring* ring = ch->in;
+        return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    }
+    int pending = 0;
+    if (ioctl(ch->fd_read, FIONREAD, &pending) == -1) return 0;
+    return (size_t)pending;
+}
+
+void finalize_tank_channel(tank_channel* ch){
+    close_worker_fds_tank_channel(ch);
+    close_fds_tank_channel(ch);
+    if (ch->memory != NULL) munmap(ch->memory, sizeof(tank_channel_memory));
+    free(ch);
+}
+
+static int _create_pipe_channel(tank_channel* ch, int min_fd){
+    int fds_in[2], fds_out[2];
+    if (pipe2(fds_in, O_CLOEXEC) == -1) return -1;
+    if (pipe2(fds_out, O_CLOEXEC) == -1){
+        close(fds_in[0]);
+        close(fds_in[1]);
+        return -1;
+    }
+    ch->type = TANK_CHANNEL_PIPE;
+    ch->worker_fd_in = _move_fd(fds_in[0], min_fd);
+    ch->fd_write = _move_fd(fds_in[1], min_fd);
+    ch->fd_read = _move_fd(fds_out[0], min_fd);
+    ch->worker_fd_out = _move_fd(fds_out[1], min_fd);
+    if (ch->worker_fd_in == -1 || ch->fd_write == -1 || ch->fd_read == -1 || ch->worker_fd_out == -1){
+        close_worker_fds_tank_channel(ch);
+        close_fds_tank_channel(ch);
+        return -1;
+    }
+    return 0;
+}
+
+static int _create_ring_channel(tank_channel* ch, int min_fd){
+    int fds_alive[2];
+    int fd = _move_fd(memfd_create("oil_storage_channel", MFD_CLOEXEC), min_fd);
+    if (fd == -1) return -1;
+    if (ftruncate(fd, sizeof(tank_channel_memory)) == -1 || pipe2(fds_alive, O_CLOEXEC) == -1){
+        close(fd);
+        return -1;
+    }
+    fds_alive[0] = _move_fd(fds_alive[0], min_fd);
+    fds_alive[1] = _move_fd(fds_alive[1], min_fd);
+    if (fds_alive[0] == -1 || fds_alive[1] == -1){
+        close(fd);
+        if (fds_alive[0] != -1) close(fds_alive[0]);
+        if (fds_alive[1] != -1) close(fds_alive[1]);
+        return -1;
+    }
+    ch->memory = mmap(NULL, sizeof(tank_channel_memory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ch->memory == MAP_FAILED){
+        ch->memory = NULL;
+        close(fd);
+        close(fds_alive[0]);
+        close(fds_alive[1]);
+        return -1;
+    }
+    ch->type = TANK_CHANNEL_RING;
+    ch->memory->parent_pid = getpid();
+    ch->out = &ch->memory->rings[0];
+    ch->in = &ch->memory->rings[1];
+    ch->worker_fd_in = fd;
+    //процесс резервуара держит конец записи, но ничего не пишет: при его завершении конец чтения получает POLLHUP
+    ch->fd_read = fds_alive[0];
+    ch->worker_fd_out = fds_alive[1];
+    return 0;
+}
+
+static int _move_fd(int fd, int min_fd){
+    if (fd == -1 || fd >= min_fd) return fd;
+    int moved_fd = fcntl(fd, F_DUPFD_CLOEXEC, min_fd);
+    close(fd);
+    return moved_fd;
+}
+
+static int _read_pipe(tank_channel* ch, void* data, size_t size, int timeout){
+    size_t received = 0;
+    while (received < size){
+        struct pollfd pfd = {ch->fd_read, POLLIN, 0};
+        int ready = poll(&pfd, 1, timeout);
+        if (ready == -1 && errno == EINTR) continue;
+        if (ready <= 0) return -1;
+        ssize_t n = read(ch->fd_read, (char*)data + received, size - received);
+        if (n <= 0) return -1;
+        received += (size_t)n;
+    }
+    return 0;
+}
+
+static int _wait_ring(tank_channel* ch, size_t size, int timeout){
+    tank_ring* ring = ch->in;
+    uint32_t head = ring->head;
+    if (_cpus_count == 0) _cpus_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (_cpus_count > 1){
+        for(int i = 0; i < RING_SPIN_COUNT; ++i){
+            if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head >= size) return 1;
+            CPU_RELAX();
+        }
+    }
+    long long deadline = timeout < 0 ? -1 : _get_time_ms() + timeout;
+    for(;;){
+        __atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+        if (tail - head >= size){
+            __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+            return 1;
+        }
+        //сон ограничен тактом, чтобы вовремя заметить завершение другой стороны
+        int slice = TIME_UNIT;
+        if (deadline != -1){
+            long long left = deadline - _get_time_ms();
+            if (left <= 0){
+                __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+                return 0;
+            }
+            if (left < slice) slice = (int)left;
+        }
+        wait_futex(&ring->tail, tail, slice, FUTEX_SHARED);
+        __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head >= size) return 1;
+        if (!_is_peer_alive(ch)) return -1;
+    }
+}
+
+static int _is_peer_alive(const tank_channel* ch){
+    if (ch->parent_pid != 0) return getppid() == ch->parent_pid;
+    struct pollfd pfd = {ch->fd_read, 0, 0};
+    return poll(&pfd, 1, 0) == 0;
+}
+
+static long long _get_time_ms(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
@@ -0,0 +1,102 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TANK_CHANNEL_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TANK_CHANNEL_H
+
+#include <stddef.h>
+
+/**
+ * канал обмена командами и ответами между управляющим процессом и процессом резервуара
+ * (два потока байт: команды от управляющего процесса и ответы процесса резервуара)
+ */
+struct _tank_channel;
+typedef struct _tank_channel tank_channel;
+
+#define TANK_CHANNEL_PIPE   0   //канал из двух неименованных каналов (pipe)
+#define TANK_CHANNEL_RING   1   //два кольцевых буфера в разделяемой памяти с ожиданием на futex
+
+/**
+ * создать канал на стороне управляющего процесса
+ * (если разделяемую память создать не удалось, создается канал TANK_CHANNEL_PIPE)
+ * @param type тип канала (TANK_CHANNEL_PIPE, TANK_CHANNEL_RING)
+ * @param min_fd наименьший номер дескрипторов канала (чтобы они не совпали с дескрипторами процесса резервуара)
+ * @return указатель на канал, NULL - ошибка
+ */
+tank_channel* create_tank_channel(int type, int min_fd);
+
+/**
+ * подключиться к каналу на стороне процесса резервуара
+ * @param type тип канала
+ * @param fd_in дескриптор для чтения команд (для TANK_CHANNEL_RING - дескриптор разделяемой памяти)
+ * @param fd_out дескриптор для записи ответов (для TANK_CHANNEL_RING не используется)
+ * @return указатель на канал, NULL - ошибка
+ */
+tank_channel* attach_tank_channel(int type, int fd_in, int fd_out);
+
+/**
+ * получить тип канала
+ * @param ch указатель на канал
+ * @return тип канала (TANK_CHANNEL_PIPE, TANK_CHANNEL_RING)
+ */
+int get_type_tank_channel(const tank_channel* ch);
+
+/**
+ * получить дескрипторы, которые передаются процессу резервуара
+ * @param ch указатель на канал (на стороне управляющего процесса)
+ * @param fd_in дескриптор для чтения команд
+ * @param fd_out дескриптор для записи ответов (-1 - не нужен)
+ */
+void get_worker_fds_tank_channel(const tank_channel* ch, int* fd_in, int* fd_out);
+
+/**
+ * закрыть дескрипторы, переданные процессу резервуара (после его запуска)
+ * @param ch указатель на канал (на стороне управляющего процесса)
+ */
+void close_worker_fds_tank_channel(tank_channel* ch);
+
+/**
+ * закрыть дескрипторы управляющей стороны канала, не освобождая память (в дочернем процессе после fork,
+ * чтобы процесс резервуара не держал каналы других резервуаров)
+ * @param ch указатель на канал
+ */
+void close_fds_tank_channel(tank_channel* ch);
+
+/**
+ * записать данные в канал (команду - на стороне управляющего процесса, ответ - на стороне процесса резервуара)
+ * @param ch указатель на канал
+ * @param data данные
+ * @param size размер данных в байтах
+ * @return 0 - данные записаны, -1 - ошибка (другая сторона не читает канал)
+ */
+int write_tank_channel(tank_channel* ch, const void* data, size_t size);
+
+/**
+ * прочитать данные из канала
+ * @param ch указатель на канал
+ * @param data буфер для данных
+ * @param size размер данных в байтах
+ * @param timeout максимальное время ожидания в мс (-1 - без ограничения)
+ * @return 0 - данные прочитаны, -1 - время ожидания истекло или другая сторона завершилась
+ */
+int read_tank_channel(tank_channel* ch, void* data, size_t size, int timeout);
+
+/**
+ * дождаться появления данных в канале
+ * @param ch указатель на канал
+ * @param timeout максимальное время ожидания в мс (-1 - без ограничения)
+ * @return 1 - есть данные, 0 - время ожидания истекло, -1 - другая сторона завершилась
+ */
+int wait_tank_channel(tank_channel* ch, int timeout);
+
+/**
+ * получить количество байт, записанных в канал другой стороной и еще не прочитанных
+ * @param ch указатель на канал
+ * @return количество байт
+ */
+size_t get_pending_tank_channel(const tank_channel* ch);
+
+/**
+ * уничтожить канал (закрыть дескрипторы и освободить память)
+ * @param ch указатель на канал
+ */
+void finalize_tank_channel(tank_channel* ch);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TANK_CHANNEL_H
@@ -0,0 +1,326 @@
+#include "tank_groups.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define TANK_GROUPS_VOLUME_SCALE 1000   //объемы в группах учитываются целыми тысячными долями, чтобы разности не копили ошибку округления
+
+/**
+ * вклад резервуара в показатели групп
+ */
+typedef struct _tank_contribution{
+    /**
+     * уровень
+     */
+    unsigned int level;
+    /**
+     * свободная емкость
+     */
+    unsigned int free_capacity;
+    /**
+     * объем в тысячных долях
+     */
+    long long volume;
+    /**
+     * насос налива работает (0, 1)
+     */
+    unsigned char download;
+    /**
+     * насос слива работает (0, 1)
+     */
+    unsigned char upload;
+} tank_contribution;
+
+/**
+ * набор групп (описания групп хранятся отдельными массивами)
+ */
+struct _tank_groups{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * количество групп
+     */
+    size_t groups_count;
+    /**
+     * размер выделенных массивов групп
+     */
+    size_t groups_capacity;
+    /**
+     * имена групп
+     */
+    char (*names)[TANK_GROUP_NAME_MAX_LEN];
+    /**
+     * объемлющие группы
+     */
+    int* parents;
+    /**
+     * группы верхнего уровня, к которым относятся группы (корни иерархий)
+     */
+    int* roots;
+    /**
+     * показатели групп
+     */
+    group_totals* totals;
+    /**
+     * суммарные объемы групп в тысячных долях (по ним выставляется total_volume)
+     */
+    long long* volumes;
+    /**
+     * первое членство каждого резервуара (-1 - резервуар не входит в группы)
+     */
+    long* first_memberships;
+    /**
+     * группы членств
+     */
+    int* membership_groups;
+    /**
+     * следующие членства того же резервуара (-1 - последнее)
+     */
+    long* membership_next;
+    /**
+     * количество членств
+     */
+    size_t memberships_count;
+    /**
+     * размер выделенных массивов членств
+     */
+    size_t memberships_capacity;
+    /**
+     * резервуары, входящие в группы
+     */
+    unsigned int* members;
+    /**
+     * количество резервуаров, входящих в группы
+     */
+    size_t members_count;
+    /**
+     * учтенные в группах показатели резервуаров
+     */
+    tank_contribution* contributions;
+    /**
+     * мьютекс для доступа к группам из разных потоков
+     */
+    pthread_mutex_t mutex;
+};
+
+/**
+ * найти группу по имени (вызывается под мьютексом)
+ * @param tg указатель на набор групп
+ * @param name имя группы
+ * @return номер группы, -1 - группа не найдена
+ */
+static int _find_group(tank_groups* tg, const char* name);
+
+/**
+ * перенести изменение вклада резервуара в группу и все объемлющие группы
+ * @param tg указатель на набор групп
+ * @param group номер группы
+ * @param old_value прежний вклад
+ * @param new_value новый вклад
+ * @param tanks_delta изменение количества резервуаров
+ */
+static void _apply_delta(tank_groups* tg, int group, const tank_contribution* old_value, const tank_contribution* new_value, int tanks_delta);
+
+/**
+ * заменить вклад резервуара и перенести изменение во все его группы (вызывается под мьютексом)
+ * @param tg указатель на набор групп
+ * @param number номер резервуара
+ * @param level уровень
+ * @param maximum_level максимальный уровень
+ * @param download_state состояние насоса налива
+ * @param upload_state состояние насоса слива
+ * @param volume объем
+ */
+static void _update_contribution(tank_groups* tg, unsigned int number, unsigned int level, unsigned int maximum_level,
+                                 int download_state, int upload_state, float volume);
+
+tank_groups* create_tank_groups(size_t tanks_count){
+    tank_groups* tg = malloc(sizeof(tank_groups));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    tg->tanks_count = tanks_count;
+    tg->groups_count = 0;
+    tg->groups_capacity = 0;
+    tg->names = NULL;
+    tg->parents = NULL;
+    tg->roots = NULL;
+    tg->totals = NULL;
+    tg->volumes = NULL;
+    tg->first_memberships = malloc(sizeof(long) * count);
+    for(size_t i = 0; i < tanks_count; ++i){
+        tg->first_memberships[i] = -1;
+    }
+    tg->membership_groups = NULL;
+    tg->membership_next = NULL;
+    tg->memberships_count = 0;
+    tg->memberships_capacity = 0;
+    tg->members = malloc(sizeof(unsigned int) * count);
+    tg->members_count = 0;
+    tg->contributions = calloc(count, sizeof(tank_contribution));
+    pthread_mutex_init(&tg->mutex, NULL);
+    return tg;
+}
+
+int add_tank_group(tank_groups* tg, const char* name, int parent){
+    if (strlen(name) == 0 || strlen(name) >= TANK_GROUP_NAME_MAX_LEN) return -1;
+    pthread_mutex_lock(&tg->mutex);
+    if (_find_group(tg, name) != -1 || parent < TANK_GROUP_NO_PARENT || parent >= (int)tg->groups_count){
+        pthread_mutex_unlock(&tg->mutex);
+        return -1;
+    }
+    if (tg->groups_count == tg->groups_capacity){
+        size_t capacity = tg->groups_capacity == 0 ? 16 : tg->groups_capacity * 2;
+        tg->names = realloc(tg->names, capacity * sizeof(*tg->names));
+        tg->parents = realloc(tg->parents, capacity * sizeof(int));
+        tg->roots = realloc(tg->roots, capacity * sizeof(int));
+        tg->totals = realloc(tg->totals, capacity * sizeof(group_totals));
+        tg->volumes = realloc(tg->volumes, capacity * sizeof(long long));
+        tg->groups_capacity = capacity;
+    }
+    int group = (int)tg->groups_count++;
+    strcpy(tg->names[group], name);
+    tg->parents[group] = parent;
+    tg->roots[group] = parent == TANK_GROUP_NO_PARENT ? group : tg->roots[parent];
+    memset(&tg->totals[group], 0, sizeof(group_totals));
+    tg->volumes[group] = 0;
+    pthread_mutex_unlock(&tg->mutex);
+    return group;
+}
+
+int find_tank_group(tank_groups* tg, const char* name){
+    pthread_mutex_lock(&tg->mutex);
+    int group = _find_group(tg, name);
+    pthread_mutex_unlock(&tg->mutex);
+    return group;
+}
+
+int assign_tank_group(tank_groups* tg, int group, unsigned int number){
+    if (number >= tg->tanks_count) return -1;
+    pthread_mutex_lock(&tg->mutex);
+    if (group < 0 || group >= (int)tg->groups_count){
+        pthread_mutex_unlock(&tg->mutex);
+        return -1;
+    }
+    //иначе резервуар попал бы в общую объемлющую группу дважды
+    for(long m = tg->first_memberships[number]; m != -1; m = tg->membership_next[m]){
+        if (tg->roots[tg->membership_groups[m]] == tg->roots[group]){
+            pthread_mutex_unlock(&tg->mutex);
+            return -1;
+        }
+    }
+    if (tg->memberships_count == tg->memberships_capacity){
+        size_t capacity = tg->memberships_capacity == 0 ? 64 : tg->memberships_capacity * 2;
+        tg->membership_groups = realloc(tg->membership_groups, capacity * sizeof(int));
+        tg->membership_next = realloc(tg->membership_next, capacity * sizeof(long));
+        tg->memberships_capacity = capacity;
+    }
+    if (tg->first_memberships[number] == -1){
+        tg->members[tg->members_count++] = number;
+    }
+    long m = (long)tg->memberships_count++;
+    tg->membership_groups[m] = group;
+    tg->membership_next[m] = tg->first_memberships[number];
+    tg->first_memberships[number] = m;
+    tank_contribution zero;
+    memset(&zero, 0, sizeof(zero));
+    _apply_delta(tg, group, &zero, &tg->contributions[number], 1);
+    pthread_mutex_unlock(&tg->mutex);
+    return 0;
+}
+
+void update_tank_groups(tank_groups* tg, const unsigned int* levels, const unsigned int* maximum_levels,
+                        const int* download_states, const int* upload_states, const float* volumes){
+    pthread_mutex_lock(&tg->mutex);
+    for(size_t i = 0; i < tg->members_count; ++i){
+        unsigned int number = tg->members[i];
+        _update_contribution(tg, number, levels[number], maximum_levels[number], download_states[number], upload_states[number], volumes[number]);
+    }
+    pthread_mutex_unlock(&tg->mutex);
+}
+
+void set_tank_state_tank_groups(tank_groups* tg, unsigned int number, unsigned int level, unsigned int maximum_level,
+                                int download_state, int upload_state, float volume){
+    pthread_mutex_lock(&tg->mutex);
+    _update_contribution(tg, number, level, maximum_level, download_state, upload_state, volume);
+    pthread_mutex_unlock(&tg->mutex);
+}
+
+int get_totals_tank_group(tank_groups* tg, int group, group_totals* totals){
+    pthread_mutex_lock(&tg->mutex);
+    int found = group >= 0 && group < (int)tg->groups_count;
+    if (found) *totals = tg->totals[group];
+    pthread_mutex_unlock(&tg->mutex);
+    return found ? 0 : -1;
+}
+
+int get_info_tank_group(tank_groups* tg, int group, char* name, int* parent){
+    pthread_mutex_lock(&tg->mutex);
+    int found = group >= 0 && group < (int)tg->groups_count;
+    if (found){
+        strcpy(name, tg->names[group]);
+        *parent = tg->parents[group];
+    }
+    pthread_mutex_unlock(&tg->mutex);
+    return found ? 0 : -1;
+}
+
+size_t get_count_tank_groups(tank_groups* tg){
+    pthread_mutex_lock(&tg->mutex);
+    size_t count = tg->groups_count;
+    pthread_mutex_unlock(&tg->mutex);
+    return count;
+}
+
+void finalize_tank_groups(tank_groups* tg){
+    free(tg->names);
+    free(tg->parents);
+    free(tg->roots);
+    free(tg->totals);
+    free(tg->volumes);
+    free(tg->first_memberships);
+    free(tg->membership_groups);
+    free(tg->membership_next);
+    free(tg->members);
+    free(tg->contributions);
+    pthread_mutex_destroy(&tg->mutex);
+    free(tg);
+}
+
+static int _find_group(tank_groups* tg, const char* name){
+    for(size_t i = 0; i < tg->groups_count; ++i){
+        if (strcmp(tg->names[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static void _apply_delta(tank_groups* tg, int group, const tank_contribution* old_value, const tank_contribution* new_value, int tanks_delta){
+    for(int g = group; g != TANK_GROUP_NO_PARENT; g = tg->parents[g]){
+        group_totals* totals = &tg->totals[g];
+        totals->tanks_count += tanks_delta;
+        totals->total_level += (unsigned long long)new_value->level - old_value->level;
+        totals->free_capacity += (unsigned long long)new_value->free_capacity - old_value->free_capacity;
+        tg->volumes[g] += new_value->volume - old_value->volume;
+        totals->total_volume = (double)tg->volumes[g] / TANK_GROUPS_VOLUME_SCALE;
+        totals->download_pumps += (size_t)new_value->download - old_value->download;
+        totals->upload_pumps += (size_t)new_value->upload - old_value->upload;
+    }
+}
+
+static void _update_contribution(tank_groups* tg, unsigned int number, unsigned int level, unsigned int maximum_level,
+                                 int download_state, int upload_state, float volume){
+    tank_contribution value;
+    value.level = level;
+    value.free_capacity = maximum_level > level ? maximum_level - level : 0;
+    value.volume = (long long)((double)volume * TANK_GROUPS_VOLUME_SCALE + (volume < 0 ? -0.5 : 0.5));
+    value.download = download_state == PUMP_ON;
+    value.upload = upload_state == PUMP_ON;
+    tank_contribution* old_value = &tg->contributions[number];
+    if (value.level == old_value->level && value.free_capacity == old_value->free_capacity && value.volume == old_value->volume
+        && value.download == old_value->download && value.upload == old_value->upload) return;
+    for(long m = tg->first_memberships[number]; m != -1; m = tg->membership_next[m]){
+        _apply_delta(tg, tg->membership_groups[m], old_value, &value, 0);
+    }
+    *old_value = value;
+}
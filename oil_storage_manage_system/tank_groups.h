@@ -0,0 +1,141 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TANK_GROUPS_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TANK_GROUPS_H
+
+#include <stddef.h>
+
+/**
+ * именованные вложенные группы резервуаров (по продукту, площадке, владельцу) со сводными показателями
+ *
+ * показатели групп не пересчитываются по резервуарам: изменение резервуара переносится разностью в его группы
+ * и во все объемлющие группы (O(глубина вложенности) на изменение), поэтому показатели группы читаются за O(1);
+ * резервуар может входить в несколько иерархий, но в каждую - только одной группой
+ */
+struct _tank_groups;
+typedef struct _tank_groups tank_groups;
+
+#define TANK_GROUP_NAME_MAX_LEN 32  //максимальная длина имени группы
+#define TANK_GROUP_NO_PARENT    -1  //группа верхнего уровня
+
+/**
+ * сводные показатели группы
+ */
+typedef struct _group_totals{
+    /**
+     * количество резервуаров (с вложенными группами)
+     */
+    size_t tanks_count;
+    /**
+     * суммарный уровень нефтепродуктов
+     */
+    unsigned long long total_level;
+    /**
+     * свободная емкость: сумма разностей максимального уровня и уровня
+     */
+    unsigned long long free_capacity;
+    /**
+     * суммарный объем (с точностью до тысячной; сумма ведется в целых долях и не уходит при долгой работе)
+     */
+    double total_volume;
+    /**
+     * количество работающих насосов налива
+     */
+    size_t download_pumps;
+    /**
+     * количество работающих насосов слива
+     */
+    size_t upload_pumps;
+} group_totals;
+
+/**
+ * создать пустой набор групп
+ * @param tanks_count количество резервуаров
+ * @return указатель на набор групп
+ */
+tank_groups* create_tank_groups(size_t tanks_count);
+
+/**
+ * добавить группу
+ * @param tg указатель на набор групп
+ * @param name имя группы
+ * @param parent номер объемлющей группы (TANK_GROUP_NO_PARENT - группа верхнего уровня)
+ * @return номер группы, -1 - ошибка (имя занято или пустое, нет объемлющей группы)
+ */
+int add_tank_group(tank_groups* tg, const char* name, int parent);
+
+/**
+ * найти группу по имени
+ * @param tg указатель на набор групп
+ * @param name имя группы
+ * @return номер группы, -1 - группа не найдена
+ */
+int find_tank_group(tank_groups* tg, const char* name);
+
+/**
+ * включить резервуар в группу (показатели резервуара попадут в группу при следующем обновлении)
+ * @param tg указатель на набор групп
+ * @param group номер группы
+ * @param number номер резервуара
+ * @return 0 - резервуар включен, -1 - ошибка (резервуар уже входит в группу той же иерархии)
+ */
+int assign_tank_group(tank_groups* tg, int group, unsigned int number);
+
+/**
+ * обновить показатели групп по состояниям резервуаров (просматриваются только резервуары, входящие в группы,
+ * группы обновляются только у изменившихся резервуаров)
+ * @param tg указатель на набор групп
+ * @param levels уровни всех резервуаров
+ * @param maximum_levels максимальные уровни
+ * @param download_states состояния насосов налива
+ * @param upload_states состояния насосов слива
+ * @param volumes объемы
+ */
+void update_tank_groups(tank_groups* tg, const unsigned int* levels, const unsigned int* maximum_levels,
+                        const int* download_states, const int* upload_states, const float* volumes);
+
+/**
+ * обновить показатели групп по состоянию одного резервуара (вклад запоминается и у резервуара вне групп,
+ * поэтому резервуар, позже включенный в группу, сразу вносит верный вклад)
+ * @param tg указатель на набор групп
+ * @param number номер резервуара
+ * @param level уровень
+ * @param maximum_level максимальный уровень
+ * @param download_state состояние насоса налива
+ * @param upload_state состояние насоса слива
+ * @param volume объем
+ */
+void set_tank_state_tank_groups(tank_groups* tg, unsigned int number, unsigned int level, unsigned int maximum_level,
+                                int download_state, int upload_state, float volume);
+
+/**
+ * получить сводные показатели группы
+ * @param tg указатель на набор групп
+ * @param group номер группы
+ * @param totals структура для показателей
+ * @return 0 - показатели получены, -1 - нет такой группы
+ */
+int get_totals_tank_group(tank_groups* tg, int group, group_totals* totals);
+
+/**
+ * получить имя и объемлющую группу
+ * @param tg указатель на набор групп
+ * @param group номер группы
+ * @param name буфер для имени (не меньше TANK_GROUP_NAME_MAX_LEN)
+ * @param parent номер объемлющей группы (TANK_GROUP_NO_PARENT - группа верхнего уровня)
+ * @return 0 - группа найдена, -1 - нет такой группы
+ */
+int get_info_tank_group(tank_groups* tg, int group, char* name, int* parent);
+
+/**
+ * получить количество групп
+ * @param tg указатель на набор групп
+ * @return количество групп
+ */
+size_t get_count_tank_groups(tank_groups* tg);
+
+/**
+ * уничтожить набор групп
+ * @param tg указатель на набор групп
+ */
+void finalize_tank_groups(tank_groups* tg);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TANK_GROUPS_H
@@ -0,0 +1,479 @@
+#include "tank_worker.h"
+#include "storage_tank.h"
+#include "oil_storage_def.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * названия команд процесса резервуара по номерам
+ */
+static const char* _operation_names[] = {
+    "create_storage_tank", "turn_on_storage_tank", "turn_off_storage_tank", "get_state_tank",
+    "set_minimum_level_tank", "get_minimum_level_tank", "set_maximum_level_tank", "get_maximum_level_tank",
+    "get_current_level_tank", "turn_on_download_pump", "turn_off_download_pump", "get_state_download_pump",
+    "set_speed_download_pump", "get_speed_download_pump", "turn_on_upload_pump", "turn_off_upload_pump",
+    "get_state_upload_pump", "set_speed_upload_pump", "get_speed_upload_pump", "hibernate_storage_tank"
+};
+
+/**
+ * процесс резервуара: общие данные основного, аварийного потоков и потока перекачек
+ */
+typedef struct _tank_worker{
+    /**
+     * канал команд
+     */
+    tank_channel* ch;
+    /**
+     * таблица состояний
+     */
+    tanks_table* tt;
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+    /**
+     * резервуар (NULL - еще не создан)
+     */
+    storage_tank* st;
+    /**
+     * мьютекс резервуара: команда и аварийная остановка выполняются по очереди
+     */
+    pthread_mutex_t mutex;
+    /**
+     * аварийный поток
+     */
+    pthread_t emergency_thread;
+    /**
+     * признак запущенного аварийного потока
+     */
+    int emergency_started;
+    /**
+     * поток перекачек
+     */
+    pthread_t transfer_thread;
+    /**
+     * признак запущенного потока перекачек
+     */
+    int transfer_started;
+    /**
+     * признак запроса завершения потока перекачек
+     */
+    int transfer_quit;
+    /**
+     * количество прочитанных из канала байт
+     */
+    unsigned long long consumed;
+    /**
+     * граница в потоке команд: команды включения, записанные в канал до аварийной остановки
+     * (начинающиеся раньше границы), не выполняются
+     */
+    unsigned long long fence;
+    /**
+     * признак ожидания мьютекса аварийным потоком: основной поток уступает ему очередь
+     */
+    int preempt;
+} tank_worker;
+
+/**
+ * прочитать данные команды из канала с учетом прочитанных байт
+ * @param tw указатель на процесс резервуара
+ * @param data буфер для данных
+ * @param size размер данных
+ * @return 0 - данные прочитаны, -1 - канал закрыт
+ */
+static int _read_worker(tank_worker* tw, void* data, size_t size);
+
+/**
+ * захватить мьютекс резервуара в основном потоке, пропустив вперед ожидающий аварийный поток
+ * (мьютекс не гарантирует очередности, и поток, разбирающий длинную очередь команд, мог бы захватывать его раз за разом)
+ * @param tw указатель на процесс резервуара
+ */
+static void _lock_worker(tank_worker* tw);
+
+/**
+ * функция аварийного потока: ждет запросов аварийной остановки в таблице состояний
+ * и выполняет их, не дожидаясь команд из очереди канала
+ * @param tw_ptr указатель на процесс резервуара
+ * @return NULL
+ */
+static void* _run_emergency(void* tw_ptr);
+
+/**
+ * запустить аварийный поток (с приоритетом SCHED_FIFO, если задана переменная окружения TANK_WORKER_RT_ENV)
+ * @param tw указатель на процесс резервуара
+ */
+static void _start_emergency(tank_worker* tw);
+
+/**
+ * остановить аварийный поток
+ * @param tw указатель на процесс резервуара
+ */
+static void _stop_emergency(tank_worker* tw);
+
+/**
+ * функция потока перекачек: ждет пробуждений на своем счетчике в таблице состояний и выполняет
+ * запросы перекачки (аварийный поток и его futex заняты только остановками)
+ * @param tw_ptr указатель на процесс резервуара
+ * @return NULL
+ */
+static void* _run_transfer(void* tw_ptr);
+
+/**
+ * запустить поток перекачек
+ * @param tw указатель на процесс резервуара
+ */
+static void _start_transfer(tank_worker* tw);
+
+/**
+ * остановить поток перекачек
+ * @param tw указатель на процесс резервуара
+ */
+static void _stop_transfer(tank_worker* tw);
+
+/**
+ * завершить работу процесса резервуара: остановить аварийный поток, поток перекачек и уничтожить резервуар
+ * @param tw указатель на процесс резервуара
+ */
+static void _finish_worker(tank_worker* tw);
+
+/**
+ * выполнить невыполненный запрос перекачки из таблицы состояний, опубликовать новый уровень
+ * и подтвердить запрос (вызывается под мьютексом резервуара)
+ * @param tw указатель на процесс резервуара
+ */
+static void _apply_transfer(tank_worker* tw);
+
+/**
+ * создать резервуар и привести его в заданное состояние
+ * @param ts состояние резервуара
+ * @return указатель на резервуар
+ */
+static storage_tank* _create_tank_from_state(const tank_state* ts);
+
+/**
+ * записать состояние резервуара в таблицу состояний
+ * @param tt указатель на таблицу состояний
+ * @param number номер резервуара
+ * @param st указатель на резервуар
+ */
+static void _publish_tank_state(tanks_table* tt, unsigned int number, storage_tank* st);
+
+/**
+ * получить время ожидания команды: пока работают насосы, состояние публикуется каждый такт,
+ * у простаивающего резервуара уровень не меняется и процесс просыпается только для отметки
+ * о том, что он жив (раз в HEARTBEAT_PERIOD тактов)
+ * @param st указатель на резервуар (NULL - резервуар еще не создан)
+ * @return время ожидания в мс, -1 - без ограничения
+ */
+static int _get_publish_timeout(storage_tank* st);
+
+void run_tank_worker(tank_channel* ch, tanks_table* tt, unsigned int number){
+    tank_worker tw = {.ch = ch, .tt = tt, .number = number, .st = NULL};
+    pthread_mutex_init(&tw.mutex, NULL);
+    set_thread_name_trace("worker");
+    for(;;){
+        _lock_worker(&tw);
+        storage_tank* st = tw.st;
+        if (st != NULL){
+            _publish_tank_state(tt, number, st);
+        }
+        pthread_mutex_unlock(&tw.mutex);
+        int has_command = wait_tank_channel(ch, _get_publish_timeout(st));
+        if (has_command == 0){
+            continue;
+        }
+        //команда читается и выполняется под мьютексом, поэтому аварийный поток видит ее
+        //либо прочитанной, либо еще лежащей в канале
+        _lock_worker(&tw);
+        unsigned long long offset = tw.consumed;
+        int operation_number;
+        if (has_command == -1 || _read_worker(&tw, &operation_number, sizeof(operation_number)) == -1){
+            pthread_mutex_unlock(&tw.mutex);
+            _finish_worker(&tw);
+            return;
+        }
+        int fenced = offset < tw.fence;
+        unsigned long long span = begin_span_trace();
+        switch (operation_number){
+            case CREATE_STORAGE_TANK:{
+                tank_state ts;
+                _read_worker(&tw, &ts, sizeof(ts));
+                st = tw.st = _create_tank_from_state(&ts);
+                _publish_tank_state(tt, number, st);
+                //запрос перекачки, не выполненный прошлым процессом, выполняется от опубликованного им уровня
+                _apply_transfer(&tw);
+                int ready = TANK_WORKER_READY;
+                write_tank_channel(ch, &ready, sizeof(ready));
+                if (!tw.emergency_started) _start_emergency(&tw);
+                if (!tw.transfer_started) _start_transfer(&tw);
+                break;
+            }
+            case TURN_ON_STORAGE_TANK:{
+                if (!fenced) turn_on_storage_tank(st);
+                break;
+            }
+            case TURN_OFF_STORAGE_TANK:{
+                turn_off_storage_tank(st);
+                break;
+            }
+            case GET_STATE_TANK:{
+                int state_st = get_state_storage_tank(st);
+                write_tank_channel(ch, &state_st, sizeof(state_st));
+                break;
+            }
+            case SET_MINIMUM_LEVEL_TANK:{
+                unsigned int min_level;
+                _read_worker(&tw, &min_level, sizeof(min_level));
+                set_minimum_level_storage_tank(st, min_level);
+                break;
+            }
+            case GET_MINIMUM_LEVEL_TANK:{
+                unsigned int min_level = get_minimum_level_storage_tank(st);
+                write_tank_channel(ch, &min_level, sizeof(min_level));
+                break;
+            }
+            case SET_MAXIMUM_LEVEL_TANK:{
+                unsigned int max_level;
+                _read_worker(&tw, &max_level, sizeof(max_level));
+                set_maximum_level_storage_tank(st, max_level);
+                break;
+            }
+            case GET_MAXIMUM_LEVEL_TANK:{
+                unsigned int max_level = get_maximum_level_storage_tank(st);
+                write_tank_channel(ch, &max_level, sizeof(max_level));
+                break;
+            }
+            case GET_CURRENT_LEVEL_TANK:{
+                unsigned int cur_level = get_current_level_storage_tank(st);
+                write_tank_channel(ch, &cur_level, sizeof(cur_level));
+                break;
+            }
+            case TURN_ON_DOWNLOAD_PUMP:{
+                if (!fenced) turn_on_injection_pump(st);
+                break;
+            }
+            case TURN_OFF_DOWNLOAD_PUMP:{
+                turn_off_injection_pump(st);
+                break;
+            }
+            case GET_STATE_DOWNLOAD_PUMP:{
+                int state_dp = get_state_injection_pump(st);
+                write_tank_channel(ch, &state_dp, sizeof(state_dp));
+                break;
+            }
+            case SET_SPEED_DOWNLOAD_PUMP:{
+                unsigned int speed_dp;
+                _read_worker(&tw, &speed_dp, sizeof(speed_dp));
+                set_speed_injection_pump(st, speed_dp);
+                break;
+            }
+            case GET_SPEED_DOWNLOAD_PUMP:{
+                unsigned int speed_dp = get_speed_injection_pump(st);
+                write_tank_channel(ch, &speed_dp, sizeof(speed_dp));
+                break;
+            }
+            case TURN_ON_UPLOAD_PUMP:{
+                if (!fenced) turn_on_pumping_pump(st);
+                break;
+            }
+            case TURN_OFF_UPLOAD_PUMP:{
+                turn_off_pumping_pump(st);
+                break;
+            }
+            case GET_STATE_UPLOAD_PUMP:{
+                int state_up = get_state_pumping_pump(st);
+                write_tank_channel(ch, &state_up, sizeof(state_up));
+                break;
+            }
+            case SET_SPEED_UPLOAD_PUMP:{
+                unsigned int speed_pp;
+                _read_worker(&tw, &speed_pp, sizeof(speed_pp));
+                set_speed_pumping_pump(st, speed_pp);
+                break;
+            }
+            case GET_SPEED_UPLOAD_PUMP:{
+                unsigned int speed_pp = get_speed_pumping_pump(st);
+                write_tank_channel(ch, &speed_pp, sizeof(speed_pp));
+                break;
+            }
+            case HIBERNATE_STORAGE_TANK:{
+                int answer = TANK_WORKER_BUSY;
+                if (get_state_injection_pump(st) == PUMP_OFF && get_state_pumping_pump(st) == PUMP_OFF){
+                    //после ответа запросы перекачки выполняет управляющий процесс, поэтому поток
+                    //перекачек останавливается до ответа, а его невыполненный запрос выполняется здесь
+                    pthread_mutex_unlock(&tw.mutex);
+                    _stop_transfer(&tw);
+                    _lock_worker(&tw);
+                    _apply_transfer(&tw);
+                    _publish_tank_state(tt, number, st);
+                    answer = TANK_WORKER_HIBERNATED;
+                }
+                write_tank_channel(ch, &answer, sizeof(answer));
+                if (answer == TANK_WORKER_HIBERNATED){
+                    pthread_mutex_unlock(&tw.mutex);
+                    _finish_worker(&tw);
+                    return;
+                }
+                break;
+            }
+            case FINALIZE_STORAGE_TANK:{
+                pthread_mutex_unlock(&tw.mutex);
+                _finish_worker(&tw);
+                return;
+            }
+            default:{
+                pthread_mutex_unlock(&tw.mutex);
+                continue;
+            }
+        }
+        pthread_mutex_unlock(&tw.mutex);
+        end_span_trace("worker", get_operation_name_tank_worker(operation_number), span, (int)number);
+    }
+}
+
+const char* get_operation_name_tank_worker(int operation_number){
+    if (operation_number == FINALIZE_STORAGE_TANK) return "finalize_storage_tank";
+    if (operation_number < 0 || operation_number >= (int)(sizeof(_operation_names) / sizeof(_operation_names[0]))) return "unknown";
+    return _operation_names[operation_number];
+}
+
+static int _read_worker(tank_worker* tw, void* data, size_t size){
+    if (read_tank_channel(tw->ch, data, size, -1) == -1) return -1;
+    tw->consumed += size;
+    return 0;
+}
+
+static void _lock_worker(tank_worker* tw){
+    while (__atomic_load_n(&tw->preempt, __ATOMIC_ACQUIRE)) sched_yield();
+    pthread_mutex_lock(&tw->mutex);
+}
+
+static void* _run_emergency(void* tw_ptr){
+    tank_worker* tw = tw_ptr;
+    set_thread_name_trace("emergency");
+    for(;;){
+        unsigned int flags = take_emergency_tanks_table(tw->tt, tw->number);
+        if (flags & TANK_WORKER_EMERGENCY_QUIT) return NULL;
+        unsigned long long span = begin_span_trace();
+        __atomic_store_n(&tw->preempt, 1, __ATOMIC_RELEASE);
+        pthread_mutex_lock(&tw->mutex);
+        //все, что уже лежит в канале, отправлено до запроса остановки
+        tw->fence = tw->consumed + get_pending_tank_channel(tw->ch);
+        storage_tank* st = tw->st;
+        if (flags & EMERGENCY_STOP_TANK) turn_off_storage_tank(st);
+        if (flags & EMERGENCY_STOP_DOWNLOAD_PUMP) turn_off_injection_pump(st);
+        if (flags & EMERGENCY_STOP_UPLOAD_PUMP) turn_off_pumping_pump(st);
+        _publish_tank_state(tw->tt, tw->number, st);
+        pthread_mutex_unlock(&tw->mutex);
+        __atomic_store_n(&tw->preempt, 0, __ATOMIC_RELEASE);
+        ack_emergency_tanks_table(tw->tt, tw->number);
+        end_span_trace("worker", "emergency_stop", span, (int)tw->number);
+    }
+}
+
+static void _start_emergency(tank_worker* tw){
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    const char* rt = getenv(TANK_WORKER_RT_ENV);
+    if (rt != NULL && strcmp(rt, "1") == 0){
+        struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO)};
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    tw->emergency_started = pthread_create(&tw->emergency_thread, &attr, _run_emergency, tw) == 0;
+    if (!tw->emergency_started){
+        //без прав на SCHED_FIFO поток запускается с обычным приоритетом
+        tw->emergency_started = pthread_create(&tw->emergency_thread, NULL, _run_emergency, tw) == 0;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+static void _stop_emergency(tank_worker* tw){
+    if (!tw->emergency_started) return;
+    request_emergency_tanks_table(tw->tt, tw->number, TANK_WORKER_EMERGENCY_QUIT);
+    pthread_join(tw->emergency_thread, NULL);
+    tw->emergency_started = 0;
+}
+
+static void* _run_transfer(void* tw_ptr){
+    tank_worker* tw = tw_ptr;
+    set_thread_name_trace("transfer");
+    for(;;){
+        //счетчик читается до проверки запроса: пробуждение после проверки не теряется
+        unsigned int wakes = get_transfer_wakes_tanks_table(tw->tt, tw->number);
+        if (__atomic_load_n(&tw->transfer_quit, __ATOMIC_ACQUIRE)) return NULL;
+        unsigned int credit, debit;
+        if (!take_transfer_tanks_table(tw->tt, tw->number, &credit, &debit)){
+            wait_transfer_tanks_table(tw->tt, tw->number, wakes);
+            continue;
+        }
+        unsigned long long span = begin_span_trace();
+        _lock_worker(tw);
+        _apply_transfer(tw);
+        pthread_mutex_unlock(&tw->mutex);
+        end_span_trace("worker", "transfer", span, (int)tw->number);
+    }
+}
+
+static void _start_transfer(tank_worker* tw){
+    __atomic_store_n(&tw->transfer_quit, 0, __ATOMIC_RELEASE);
+    tw->transfer_started = pthread_create(&tw->transfer_thread, NULL, _run_transfer, tw) == 0;
+}
+
+static void _stop_transfer(tank_worker* tw){
+    if (!tw->transfer_started) return;
+    __atomic_store_n(&tw->transfer_quit, 1, __ATOMIC_RELEASE);
+    wake_transfer_tanks_table(tw->tt, tw->number);
+    pthread_join(tw->transfer_thread, NULL);
+    tw->transfer_started = 0;
+}
+
+static void _finish_worker(tank_worker* tw){
+    _stop_transfer(tw);
+    _stop_emergency(tw);
+    if (tw->st != NULL) finalize_storage_tank(tw->st);
+    tw->st = NULL;
+    pthread_mutex_destroy(&tw->mutex);
+}
+
+static void _apply_transfer(tank_worker* tw){
+    unsigned int credit, debit;
+    if (tw->st == NULL || !take_transfer_tanks_table(tw->tt, tw->number, &credit, &debit)) return;
+    unsigned int taken = transfer_level_storage_tank(tw->st, credit, debit);
+    _publish_tank_state(tw->tt, tw->number, tw->st);
+    ack_transfer_tanks_table(tw->tt, tw->number, taken);
+}
+
+static storage_tank* _create_tank_from_state(const tank_state* ts){
+    storage_tank* st = create_storage_tank(ts->minimum_level, ts->maximum_level, ts->download_speed, ts->upload_speed);
+    set_current_level_storage_tank(st, ts->current_level);
+    if (ts->state == STORAGE_TANK_ON) turn_on_storage_tank(st);
+    if (ts->download_state == PUMP_ON) turn_on_injection_pump(st);
+    if (ts->upload_state == PUMP_ON) turn_on_pumping_pump(st);
+    return st;
+}
+
+static int _get_publish_timeout(storage_tank* st){
+    if (st == NULL) return -1;
+    if (get_state_storage_tank(st) == STORAGE_TANK_ON
+        && (get_state_injection_pump(st) == PUMP_ON || get_state_pumping_pump(st) == PUMP_ON)) return TIME_UNIT;
+    return HEARTBEAT_PERIOD * TIME_UNIT;
+}
+
+static void _publish_tank_state(tanks_table* tt, unsigned int number, storage_tank* st){
+    tank_state ts;
+    ts.current_level    = get_current_level_storage_tank(st);
+    ts.minimum_level    = get_minimum_level_storage_tank(st);
+    ts.maximum_level    = get_maximum_level_storage_tank(st);
+    ts.state            = get_state_storage_tank(st);
+    ts.download_state   = get_state_injection_pump(st);
+    ts.download_speed   = get_speed_injection_pump(st);
+    ts.upload_state     = get_state_pumping_pump(st);
+    ts.upload_speed     = get_speed_pumping_pump(st);
+    set_tank_state_tanks_table(tt, number, &ts);
+    beat_tanks_table(tt, number);
+}
@@ -0,0 +1,65 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TANK_WORKER_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TANK_WORKER_H
+
+#include "tanks_table.h"
+#include "tank_channel.h"
+
+#ifndef __OPERATION_NUMBER
+    #define __OPERATION_NUMBER
+    #define CREATE_STORAGE_TANK     0
+    #define TURN_ON_STORAGE_TANK    1
+    #define TURN_OFF_STORAGE_TANK   2
+    #define GET_STATE_TANK          3
+    #define SET_MINIMUM_LEVEL_TANK  4
+    #define GET_MINIMUM_LEVEL_TANK  5
+    #define SET_MAXIMUM_LEVEL_TANK  6
+    #define GET_MAXIMUM_LEVEL_TANK  7
+    #define GET_CURRENT_LEVEL_TANK  8
+    #define TURN_ON_DOWNLOAD_PUMP   9
+    #define TURN_OFF_DOWNLOAD_PUMP  10
+    #define GET_STATE_DOWNLOAD_PUMP 11
+    #define SET_SPEED_DOWNLOAD_PUMP 12
+    #define GET_SPEED_DOWNLOAD_PUMP 13
+    #define TURN_ON_UPLOAD_PUMP     14
+    #define TURN_OFF_UPLOAD_PUMP    15
+    #define GET_STATE_UPLOAD_PUMP   16
+    #define SET_SPEED_UPLOAD_PUMP   17
+    #define GET_SPEED_UPLOAD_PUMP   18
+    #define HIBERNATE_STORAGE_TANK  19
+    #define FINALIZE_STORAGE_TANK   -1
+#endif
+
+#define TANK_WORKER_NAME        "oil_storage_worker"    //имя исполняемого файла процесса резервуара
+#define TANK_WORKER_PATH_ENV    "OIL_STORAGE_WORKER"    //переменная окружения с путем к исполняемому файлу процесса резервуара
+#define TANK_WORKER_TRANSPORT_ENV "OIL_STORAGE_TRANSPORT"  //переменная окружения с типом канала: "pipe" - неименованные каналы, иначе кольцевые буферы
+#define TANK_WORKER_FD_IN       3                       //дескриптор канала команд (или разделяемой памяти кольцевых буферов) в процессе резервуара
+#define TANK_WORKER_FD_OUT      4                       //дескриптор канала ответов (или признака жизни процесса) в процессе резервуара
+#define TANK_WORKER_FD_TABLE    5                       //дескриптор разделяемой памяти таблицы состояний в процессе резервуара
+#define TANK_WORKER_READY       1                       //ответ процесса резервуара на команду создания резервуара
+#define TANK_WORKER_HIBERNATED  2                       //ответ на команду усыпления: состояние опубликовано, процесс завершается
+#define TANK_WORKER_BUSY        3                       //ответ на команду усыпления: насосы работают, процесс продолжает работу
+#define MAX_OPERATION_PARAMS    64                      //максимальный размер параметров команды в байтах
+#define TANK_WORKER_RT_ENV      "OIL_STORAGE_EMERGENCY_RT"  //переменная окружения: "1" - аварийный поток процесса резервуара работает с приоритетом SCHED_FIFO
+#define TANK_WORKER_EMERGENCY_QUIT 0x80000000u          //флаг запроса аварийной остановки: завершить аварийный поток
+
+/**
+ * функция управления резервуаром: выполняет команды из канала и публикует состояние резервуара в таблицу
+ * (первой командой должна быть CREATE_STORAGE_TANK с полным состоянием резервуара tank_state;
+ * по команде HIBERNATE_STORAGE_TANK функция завершается, если насосы резервуара выключены);
+ * запросы аварийной остановки из таблицы состояний выполняет отдельный поток в обход очереди канала,
+ * команды включения, записанные в канал до остановки, после нее не выполняются; запросы перекачки
+ * из таблицы состояний выполняет свой поток, пробуждаемый отдельным счетчиком таблицы
+ * @param ch канал для чтения команд и ответа на команды
+ * @param tt таблица состояний, в которую публикуется состояние резервуара
+ * @param number номер резервуара
+ */
+void run_tank_worker(tank_channel* ch, tanks_table* tt, unsigned int number);
+
+/**
+ * получить название команды процесса резервуара (для трассировки)
+ * @param operation_number номер команды
+ * @return название команды
+ */
+const char* get_operation_name_tank_worker(int operation_number);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TANK_WORKER_H
@@ -0,0 +1,320 @@
+#define _GNU_SOURCE
+#include "tanks_table.h"
+#include "futex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**
+ * таблица состояний резервуаров
+ * (каждое поле хранится отдельным непрерывным массивом в разделяемой памяти)
+ */
+struct _tanks_table{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * дескриптор разделяемой памяти (-1 - анонимная память)
+     */
+    int fd;
+    /**
+     * размер отображенной разделяемой памяти
+     */
+    size_t memory_size;
+    /**
+     * начало отображенной разделяемой памяти
+     */
+    void* memory;
+    /**
+     * уровни нефтепродуктов
+     */
+    unsigned int* current_levels;
+    /**
+     * минимальные уровни
+     */
+    unsigned int* minimum_levels;
+    /**
+     * максимальные уровни
+     */
+    unsigned int* maximum_levels;
+    /**
+     * состояния резервуаров
+     */
+    int* states;
+    /**
+     * состояния насосов закачки
+     */
+    int* download_states;
+    /**
+     * скорости закачки
+     */
+    unsigned int* download_speeds;
+    /**
+     * состояния насосов откачки
+     */
+    int* upload_states;
+    /**
+     * скорости откачки
+     */
+    unsigned int* upload_speeds;
+    /**
+     * счетчики публикаций состояния процессами резервуаров
+     */
+    unsigned int* heartbeats;
+    /**
+     * флаги запрошенных аварийных остановок (на них ждет аварийный поток процесса резервуара)
+     */
+    unsigned int* emergency_requests;
+    /**
+     * счетчики выполненных аварийных остановок (на них ждет управляющий процесс)
+     */
+    unsigned int* emergency_acks;
+    /**
+     * начисления последнего запроса перекачки
+     */
+    unsigned int* transfer_credits;
+    /**
+     * списания последнего запроса перекачки
+     */
+    unsigned int* transfer_debits;
+    /**
+     * счетчики запросов перекачки (пишет управляющий процесс)
+     */
+    unsigned int* transfer_requests;
+    /**
+     * счетчики выполненных запросов перекачки (пишет выполнивший запрос)
+     */
+    unsigned int* transfer_acks;
+    /**
+     * фактически списанный объем последнего выполненного запроса перекачки
+     */
+    unsigned int* transfer_taken;
+    /**
+     * счетчики пробуждений потока перекачек процесса резервуара (на них ждет поток перекачек)
+     */
+    unsigned int* transfer_wakes;
+};
+
+/**
+ * количество полей резервуара, хранимых в таблице (8 полей состояния, счетчик публикаций,
+ * запросы и подтверждения аварийных остановок, 5 полей запроса перекачки и счетчик пробуждений
+ * потока перекачек)
+ */
+#define TANKS_TABLE_FIELDS (TANKS_TABLE_STATE_FIELDS + 9)
+
+/**
+ * отобразить память таблицы и разметить в ней массивы полей
+ * @param tanks_count количество резервуаров
+ * @param fd дескриптор разделяемой памяти (-1 - анонимная память)
+ * @return указатель на таблицу, NULL - ошибка
+ */
+static tanks_table* _map_tanks_table(size_t tanks_count, int fd);
+
+tanks_table* create_tanks_table(size_t tanks_count){
+    size_t memory_size = TANKS_TABLE_FIELDS * sizeof(unsigned int) * (tanks_count > 0 ? tanks_count : 1);
+    int fd = memfd_create("oil_storage_tanks", MFD_CLOEXEC);
+    if (fd != -1 && ftruncate(fd, (off_t)memory_size) != 0){
+        close(fd);
+        fd = -1;
+    }
+    tanks_table* tt = _map_tanks_table(tanks_count, fd);
+    if (tt == NULL && fd != -1) close(fd);
+    return tt;
+}
+
+tanks_table* attach_tanks_table(int fd, size_t tanks_count){
+    return _map_tanks_table(tanks_count, fd);
+}
+
+int get_fd_tanks_table(const tanks_table* tt){
+    return tt->fd;
+}
+
+static tanks_table* _map_tanks_table(size_t tanks_count, int fd){
+    tanks_table* tt = malloc(sizeof(tanks_table));
+    if (tt == NULL) return NULL;
+    tt->tanks_count = tanks_count;
+    tt->fd = fd;
+    tt->memory_size = TANKS_TABLE_FIELDS * sizeof(unsigned int) * (tanks_count > 0 ? tanks_count : 1);
+    if (fd == -1){
+        tt->memory = mmap(NULL, tt->memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    } else {
+        tt->memory = mmap(NULL, tt->memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (tt->memory == MAP_FAILED){
+        free(tt);
+        return NULL;
+    }
+    unsigned int* column = tt->memory;
+    tt->current_levels  = column;
+    tt->minimum_levels  = column + tanks_count;
+    tt->maximum_levels  = column + tanks_count*2;
+    tt->states          = (int*)(column + tanks_count*3);
+    tt->download_states = (int*)(column + tanks_count*4);
+    tt->download_speeds = column + tanks_count*5;
+    tt->upload_states   = (int*)(column + tanks_count*6);
+    tt->upload_speeds   = column + tanks_count*7;
+    tt->heartbeats      = column + tanks_count*8;
+    tt->emergency_requests = column + tanks_count*9;
+    tt->emergency_acks  = column + tanks_count*10;
+    tt->transfer_credits = column + tanks_count*11;
+    tt->transfer_debits = column + tanks_count*12;
+    tt->transfer_requests = column + tanks_count*13;
+    tt->transfer_acks   = column + tanks_count*14;
+    tt->transfer_taken  = column + tanks_count*15;
+    tt->transfer_wakes  = column + tanks_count*16;
+    return tt;
+}
+
+void set_tank_state_tanks_table(tanks_table* tt, unsigned int number, const tank_state* ts){
+    tt->current_levels[number]  = ts->current_level;
+    tt->minimum_levels[number]  = ts->minimum_level;
+    tt->maximum_levels[number]  = ts->maximum_level;
+    tt->states[number]          = ts->state;
+    tt->download_states[number] = ts->download_state;
+    tt->download_speeds[number] = ts->download_speed;
+    tt->upload_states[number]   = ts->upload_state;
+    tt->upload_speeds[number]   = ts->upload_speed;
+}
+
+void get_tank_state_tanks_table(const tanks_table* tt, unsigned int number, tank_state* ts){
+    ts->current_level   = tt->current_levels[number];
+    ts->minimum_level   = tt->minimum_levels[number];
+    ts->maximum_level   = tt->maximum_levels[number];
+    ts->state           = tt->states[number];
+    ts->download_state  = tt->download_states[number];
+    ts->download_speed  = tt->download_speeds[number];
+    ts->upload_state    = tt->upload_states[number];
+    ts->upload_speed    = tt->upload_speeds[number];
+}
+
+void copy_states_tanks_table(const tanks_table* tt, unsigned int* columns){
+    //столбцы состояния лежат в памяти таблицы подряд, поэтому копируются за один проход
+    memcpy(columns, tt->current_levels, TANKS_TABLE_STATE_FIELDS * sizeof(unsigned int) * tt->tanks_count);
+}
+
+void beat_tanks_table(tanks_table* tt, unsigned int number){
+    __atomic_store_n(&tt->heartbeats[number], tt->heartbeats[number] + 1, __ATOMIC_RELEASE);
+}
+
+unsigned int get_heartbeat_tanks_table(const tanks_table* tt, unsigned int number){
+    return __atomic_load_n(&tt->heartbeats[number], __ATOMIC_ACQUIRE);
+}
+
+void request_emergency_tanks_table(tanks_table* tt, unsigned int number, unsigned int flags){
+    __atomic_fetch_or(&tt->emergency_requests[number], flags, __ATOMIC_SEQ_CST);
+    wake_futex(&tt->emergency_requests[number], FUTEX_WAKE_ALL, FUTEX_SHARED);
+}
+
+unsigned int take_emergency_tanks_table(tanks_table* tt, unsigned int number){
+    unsigned int flags;
+    while ((flags = __atomic_exchange_n(&tt->emergency_requests[number], 0, __ATOMIC_SEQ_CST)) == 0){
+        wait_futex(&tt->emergency_requests[number], 0, -1, FUTEX_SHARED);
+    }
+    return flags;
+}
+
+void clear_emergency_tanks_table(tanks_table* tt, unsigned int number){
+    __atomic_store_n(&tt->emergency_requests[number], 0, __ATOMIC_SEQ_CST);
+}
+
+void ack_emergency_tanks_table(tanks_table* tt, unsigned int number){
+    __atomic_add_fetch(&tt->emergency_acks[number], 1, __ATOMIC_SEQ_CST);
+    wake_futex(&tt->emergency_acks[number], FUTEX_WAKE_ALL, FUTEX_SHARED);
+}
+
+unsigned int get_emergency_acks_tanks_table(const tanks_table* tt, unsigned int number){
+    return __atomic_load_n(&tt->emergency_acks[number], __ATOMIC_SEQ_CST);
+}
+
+int wait_emergency_ack_tanks_table(tanks_table* tt, unsigned int number, unsigned int acks, int timeout){
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000){
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while (__atomic_load_n(&tt->emergency_acks[number], __ATOMIC_SEQ_CST) == acks){
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long left = (long long)(deadline.tv_sec - now.tv_sec) * 1000 + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+        if (left <= 0) return -1;
+        wait_futex(&tt->emergency_acks[number], acks, (int)left, FUTEX_SHARED);
+    }
+    return 0;
+}
+
+void request_transfer_tanks_table(tanks_table* tt, unsigned int number, unsigned int credit, unsigned int debit){
+    tt->transfer_credits[number] = credit;
+    tt->transfer_debits[number] = debit;
+    __atomic_store_n(&tt->transfer_requests[number], tt->transfer_requests[number] + 1, __ATOMIC_RELEASE);
+    wake_transfer_tanks_table(tt, number);
+}
+
+unsigned int get_transfer_wakes_tanks_table(const tanks_table* tt, unsigned int number){
+    return __atomic_load_n(&tt->transfer_wakes[number], __ATOMIC_SEQ_CST);
+}
+
+void wait_transfer_tanks_table(tanks_table* tt, unsigned int number, unsigned int wakes){
+    while (__atomic_load_n(&tt->transfer_wakes[number], __ATOMIC_SEQ_CST) == wakes){
+        wait_futex(&tt->transfer_wakes[number], wakes, -1, FUTEX_SHARED);
+    }
+}
+
+void wake_transfer_tanks_table(tanks_table* tt, unsigned int number){
+    __atomic_add_fetch(&tt->transfer_wakes[number], 1, __ATOMIC_SEQ_CST);
+    wake_futex(&tt->transfer_wakes[number], FUTEX_WAKE_ALL, FUTEX_SHARED);
+}
+
+int take_transfer_tanks_table(const tanks_table* tt, unsigned int number, unsigned int* credit, unsigned int* debit){
+    if (__atomic_load_n(&tt->transfer_requests[number], __ATOMIC_ACQUIRE) == __atomic_load_n(&tt->transfer_acks[number], __ATOMIC_ACQUIRE)) return 0;
+    *credit = tt->transfer_credits[number];
+    *debit = tt->transfer_debits[number];
+    return 1;
+}
+
+void ack_transfer_tanks_table(tanks_table* tt, unsigned int number, unsigned int taken){
+    tt->transfer_taken[number] = taken;
+    __atomic_store_n(&tt->transfer_acks[number], tt->transfer_acks[number] + 1, __ATOMIC_RELEASE);
+}
+
+int get_transfer_result_tanks_table(const tanks_table* tt, unsigned int number, unsigned int* taken){
+    if (__atomic_load_n(&tt->transfer_acks[number], __ATOMIC_ACQUIRE) != tt->transfer_requests[number]) return 0;
+    *taken = tt->transfer_taken[number];
+    return 1;
+}
+
+const unsigned int* get_current_levels_tanks_table(const tanks_table* tt){
+    return tt->current_levels;
+}
+
+const unsigned int* get_minimum_levels_tanks_table(const tanks_table* tt){
+    return tt->minimum_levels;
+}
+
+const unsigned int* get_maximum_levels_tanks_table(const tanks_table* tt){
+    return tt->maximum_levels;
+}
+
+const int* get_download_states_tanks_table(const tanks_table* tt){
+    return tt->download_states;
+}
+
+const unsigned int* get_download_speeds_tanks_table(const tanks_table* tt){
+    return tt->download_speeds;
+}
+
+size_t get_count_tanks_table(const tanks_table* tt){
+    return tt->tanks_count;
+}
+
+void finalize_tanks_table(tanks_table* tt){
+    munmap(tt->memory, tt->memory_size);
+    if (tt->fd != -1) close(tt->fd);
+    free(tt);
+}
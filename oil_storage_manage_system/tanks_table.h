@@ -0,0 +1,273 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TANKS_TABLE_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TANKS_TABLE_H
+
+#include <stddef.h>
+
+/**
+ * таблица состояний резервуаров, размещенная в разделяемой памяти
+ * (процессы резервуаров записывают в нее свое состояние, управляющий процесс читает)
+ */
+struct _tanks_table;
+typedef struct _tanks_table tanks_table;
+
+#define TANKS_TABLE_STATE_FIELDS 8  //количество полей состояния резервуара в таблице
+
+/**
+ * состояние резервуара
+ */
+typedef struct _tank_state{
+    /**
+     * уровень нефтепродуктов в резервуаре
+     */
+    unsigned int current_level;
+    /**
+     * минимальный уровень нефтепродуктов в резервуаре
+     */
+    unsigned int minimum_level;
+    /**
+     * максимальный уровень нефтепродуктов в резервуаре
+     */
+    unsigned int maximum_level;
+    /**
+     * состояние работы резервуара (STORAGE_TANK_ON, STORAGE_TANK_OFF)
+     */
+    int state;
+    /**
+     * состояние насоса закачки (PUMP_ON, PUMP_OFF)
+     */
+    int download_state;
+    /**
+     * скорость закачки
+     */
+    unsigned int download_speed;
+    /**
+     * состояние насоса откачки (PUMP_ON, PUMP_OFF)
+     */
+    int upload_state;
+    /**
+     * скорость откачки
+     */
+    unsigned int upload_speed;
+} tank_state;
+
+/**
+ * создать таблицу состояний (память таблицы наследуется дочерними процессами
+ * и может быть подключена другими процессами по дескриптору)
+ * @param tanks_count количество резервуаров
+ * @return указатель на таблицу
+ */
+tanks_table* create_tanks_table(size_t tanks_count);
+
+/**
+ * подключиться к таблице состояний, созданной другим процессом
+ * @param fd дескриптор разделяемой памяти таблицы
+ * @param tanks_count количество резервуаров
+ * @return указатель на таблицу, NULL - ошибка
+ */
+tanks_table* attach_tanks_table(int fd, size_t tanks_count);
+
+/**
+ * получить дескриптор разделяемой памяти таблицы (для передачи процессам резервуаров)
+ * @param tt указатель на таблицу
+ * @return дескриптор, -1 - таблица доступна только процессам, порожденным через fork
+ */
+int get_fd_tanks_table(const tanks_table* tt);
+
+/**
+ * записать состояние резервуара в таблицу
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param ts состояние резервуара
+ */
+void set_tank_state_tanks_table(tanks_table* tt, unsigned int number, const tank_state* ts);
+
+/**
+ * прочитать состояние резервуара из таблицы
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param ts состояние резервуара
+ */
+void get_tank_state_tanks_table(const tanks_table* tt, unsigned int number, tank_state* ts);
+
+/**
+ * скопировать поля состояния всех резервуаров одним блоком: TANKS_TABLE_STATE_FIELDS столбцов
+ * по количеству резервуаров в порядке полей tank_state (уровни, минимальные уровни, ..., скорости откачки)
+ * @param tt указатель на таблицу
+ * @param columns память под столбцы
+ */
+void copy_states_tanks_table(const tanks_table* tt, unsigned int* columns);
+
+/**
+ * отметить, что процесс резервуара жив (увеличить счетчик публикаций состояния)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ */
+void beat_tanks_table(tanks_table* tt, unsigned int number);
+
+/**
+ * получить счетчик публикаций состояния резервуара
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @return значение счетчика
+ */
+unsigned int get_heartbeat_tanks_table(const tanks_table* tt, unsigned int number);
+
+/**
+ * запросить аварийную остановку у процесса резервуара в обход очереди команд канала
+ * (флаги запросов накапливаются до их выполнения, аварийный поток процесса просыпается сразу)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param flags флаги остановки
+ */
+void request_emergency_tanks_table(tanks_table* tt, unsigned int number, unsigned int flags);
+
+/**
+ * дождаться запроса аварийной остановки и забрать его флаги (в процессе резервуара)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @return накопленные флаги остановки
+ */
+unsigned int take_emergency_tanks_table(tanks_table* tt, unsigned int number);
+
+/**
+ * сбросить невыполненные запросы аварийной остановки (перед запуском нового процесса резервуара)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ */
+void clear_emergency_tanks_table(tanks_table* tt, unsigned int number);
+
+/**
+ * подтвердить выполнение аварийной остановки (увеличить счетчик подтверждений)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ */
+void ack_emergency_tanks_table(tanks_table* tt, unsigned int number);
+
+/**
+ * получить счетчик подтверждений аварийных остановок
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @return значение счетчика
+ */
+unsigned int get_emergency_acks_tanks_table(const tanks_table* tt, unsigned int number);
+
+/**
+ * дождаться подтверждения аварийной остановки
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param acks значение счетчика подтверждений до запроса
+ * @param timeout максимальное время ожидания в мс
+ * @return 0 - остановка подтверждена, -1 - время ожидания истекло
+ */
+int wait_emergency_ack_tanks_table(tanks_table* tt, unsigned int number, unsigned int acks, int timeout);
+
+/**
+ * передать процессу резервуара изменение уровня от перекачек в обход очереди команд канала
+ * (у резервуара должен быть не больше одного невыполненного запроса; поток перекачек процесса
+ * будится своим счетчиком пробуждений, канал аварийных остановок не используется)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param credit начисляемый объем (начисляется не выше максимального уровня)
+ * @param debit списываемый объем (списывается не ниже минимального уровня)
+ */
+void request_transfer_tanks_table(tanks_table* tt, unsigned int number, unsigned int credit, unsigned int debit);
+
+/**
+ * получить счетчик пробуждений потока перекачек (читается до проверки запроса, чтобы не пропустить пробуждение)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @return значение счетчика
+ */
+unsigned int get_transfer_wakes_tanks_table(const tanks_table* tt, unsigned int number);
+
+/**
+ * дождаться пробуждения потока перекачек (в процессе резервуара)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param wakes значение счетчика пробуждений до проверки запроса
+ */
+void wait_transfer_tanks_table(tanks_table* tt, unsigned int number, unsigned int wakes);
+
+/**
+ * разбудить поток перекачек процесса резервуара (при новом запросе и при остановке потока)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ */
+void wake_transfer_tanks_table(tanks_table* tt, unsigned int number);
+
+/**
+ * прочитать невыполненный запрос перекачки (в процессе резервуара или, если процесса нет, в управляющем процессе)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param credit начисляемый объем
+ * @param debit списываемый объем
+ * @return 1 - запрос есть, 0 - невыполненных запросов нет
+ */
+int take_transfer_tanks_table(const tanks_table* tt, unsigned int number, unsigned int* credit, unsigned int* debit);
+
+/**
+ * подтвердить выполнение запроса перекачки (после публикации нового уровня)
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param taken фактически списанный объем
+ */
+void ack_transfer_tanks_table(tanks_table* tt, unsigned int number, unsigned int taken);
+
+/**
+ * получить результат последнего запроса перекачки
+ * @param tt указатель на таблицу
+ * @param number номер резервуара
+ * @param taken фактически списанный объем
+ * @return 1 - запрос выполнен, 0 - еще нет
+ */
+int get_transfer_result_tanks_table(const tanks_table* tt, unsigned int number, unsigned int* taken);
+
+/**
+ * получить непрерывный массив уровней нефтепродуктов всех резервуаров
+ * @param tt указатель на таблицу
+ * @return массив уровней
+ */
+const unsigned int* get_current_levels_tanks_table(const tanks_table* tt);
+
+/**
+ * получить непрерывный массив минимальных уровней всех резервуаров
+ * @param tt указатель на таблицу
+ * @return массив минимальных уровней
+ */
+const unsigned int* get_minimum_levels_tanks_table(const tanks_table* tt);
+
+/**
+ * получить непрерывный массив максимальных уровней всех резервуаров
+ * @param tt указатель на таблицу
+ * @return массив максимальных уровней
+ */
+const unsigned int* get_maximum_levels_tanks_table(const tanks_table* tt);
+
+/**
+ * получить непрерывный массив состояний насосов налива всех резервуаров
+ * @param tt указатель на таблицу
+ * @return массив состояний насосов налива
+ */
+const int* get_download_states_tanks_table(const tanks_table* tt);
+
+/**
+ * получить непрерывный массив скоростей насосов налива всех резервуаров
+ * @param tt указатель на таблицу
+ * @return массив скоростей насосов налива
+ */
+const unsigned int* get_download_speeds_tanks_table(const tanks_table* tt);
+
+/**
+ * получить количество резервуаров в таблице
+ * @param tt указатель на таблицу
+ * @return количество резервуаров
+ */
+size_t get_count_tanks_table(const tanks_table* tt);
+
+/**
+ * уничтожить таблицу
+ * @param tt указатель на таблицу
+ */
+void finalize_tanks_table(tanks_table* tt);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TANKS_TABLE_H
@@ -0,0 +1,277 @@
+#include "timer_wheel.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define WHEEL_LEVELS        4           //количество уровней колеса
+#define WHEEL_SLOT_BITS     8           //разрядность номера ячейки уровня
+#define WHEEL_SLOTS         256         //количество ячеек на уровне
+#define WHEEL_SLOT_MASK     255         //маска номера ячейки
+#define NIL                 0xFFFFFFFFu //пустая ссылка на запись
+#define FREE_SLOT           0xFFFFFFFFu //запись не находится в колесе
+#define MISSED_TOLERANCE    1           //допустимое опоздание выполнения команды в тактах
+
+/**
+ * запись расписания
+ */
+typedef struct _timer_entry{
+    /**
+     * такт выполнения
+     */
+    unsigned long long expire;
+    /**
+     * период повторения в тактах (0 - однократная команда)
+     */
+    unsigned long long period;
+    /**
+     * команда
+     */
+    scheduled_command command;
+    /**
+     * следующая запись в ячейке (или в списке свободных записей)
+     */
+    unsigned int next;
+    /**
+     * предыдущая запись в ячейке
+     */
+    unsigned int prev;
+    /**
+     * ячейка колеса (уровень * WHEEL_SLOTS + номер ячейки), FREE_SLOT - запись свободна
+     */
+    unsigned int slot;
+    /**
+     * поколение записи (увеличивается при освобождении, входит в идентификатор)
+     */
+    unsigned int generation;
+} timer_entry;
+
+/**
+ * иерархическое колесо таймеров
+ */
+struct _timer_wheel{
+    /**
+     * ячейки колеса: номера первых записей списков
+     */
+    unsigned int slots[WHEEL_LEVELS * WHEEL_SLOTS];
+    /**
+     * пул записей
+     */
+    timer_entry* entries;
+    /**
+     * размер пула записей
+     */
+    unsigned int entries_capacity;
+    /**
+     * первая свободная запись пула
+     */
+    unsigned int free_entry;
+    /**
+     * такт, который будет обработан следующим
+     */
+    unsigned long long now;
+    /**
+     * каскадный перенос для такта now уже выполнен
+     */
+    int cascaded;
+    /**
+     * статистика
+     */
+    scheduler_stats stats;
+    /**
+     * мьютекс для доступа к колесу из разных потоков
+     */
+    pthread_mutex_t mutex;
+};
+
+/**
+ * поместить запись в ячейку, соответствующую ее такту выполнения
+ * @param tw указатель на колесо таймеров
+ * @param index номер записи
+ */
+static void _insert_entry(timer_wheel* tw, unsigned int index);
+
+/**
+ * убрать запись из ее ячейки
+ * @param tw указатель на колесо таймеров
+ * @param index номер записи
+ */
+static void _unlink_entry(timer_wheel* tw, unsigned int index);
+
+/**
+ * освободить запись
+ * @param tw указатель на колесо таймеров
+ * @param index номер записи
+ */
+static void _release_entry(timer_wheel* tw, unsigned int index);
+
+/**
+ * перенести записи ячейки уровня level на нижние уровни
+ * @param tw указатель на колесо таймеров
+ * @param level уровень
+ * @param slot номер ячейки
+ */
+static void _cascade(timer_wheel* tw, int level, unsigned int slot);
+
+timer_wheel* create_timer_wheel(unsigned long long current_tick){
+    timer_wheel* tw = malloc(sizeof(timer_wheel));
+    if (tw == NULL) return NULL;
+    for(int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; ++i){
+        tw->slots[i] = NIL;
+    }
+    tw->entries = NULL;
+    tw->entries_capacity = 0;
+    tw->free_entry = NIL;
+    tw->now = current_tick;
+    tw->cascaded = 0;
+    tw->stats.pending = 0;
+    tw->stats.dispatched = 0;
+    tw->stats.missed = 0;
+    pthread_mutex_init(&tw->mutex, NULL);
+    return tw;
+}
+
+unsigned long long add_timer_wheel(timer_wheel* tw, unsigned long long expire_tick, unsigned long long period, const scheduled_command* command){
+    pthread_mutex_lock(&tw->mutex);
+    if (tw->free_entry == NIL){
+        unsigned int capacity = tw->entries_capacity == 0 ? 1024 : tw->entries_capacity * 2;
+        timer_entry* entries = realloc(tw->entries, sizeof(timer_entry) * capacity);
+        if (entries == NULL || capacity <= tw->entries_capacity){
+            pthread_mutex_unlock(&tw->mutex);
+            return 0;
+        }
+        tw->entries = entries;
+        for(unsigned int i = capacity; i > tw->entries_capacity; --i){
+            tw->entries[i - 1].slot = FREE_SLOT;
+            tw->entries[i - 1].generation = 1;
+            tw->entries[i - 1].next = tw->free_entry;
+            tw->free_entry = i - 1;
+        }
+        tw->entries_capacity = capacity;
+    }
+    unsigned int index = tw->free_entry;
+    timer_entry* e = &tw->entries[index];
+    tw->free_entry = e->next;
+    e->expire = expire_tick;
+    e->period = period;
+    e->command = *command;
+    e->command.id = ((unsigned long long)e->generation << 32) | index;
+    _insert_entry(tw, index);
+    tw->stats.pending++;
+    unsigned long long id = e->command.id;
+    pthread_mutex_unlock(&tw->mutex);
+    return id;
+}
+
+int cancel_timer_wheel(timer_wheel* tw, unsigned long long id){
+    unsigned int index = (unsigned int)(id & 0xFFFFFFFFu);
+    unsigned int generation = (unsigned int)(id >> 32);
+    pthread_mutex_lock(&tw->mutex);
+    if (index >= tw->entries_capacity || tw->entries[index].slot == FREE_SLOT || tw->entries[index].generation != generation){
+        pthread_mutex_unlock(&tw->mutex);
+        return -1;
+    }
+    _unlink_entry(tw, index);
+    _release_entry(tw, index);
+    tw->stats.pending--;
+    pthread_mutex_unlock(&tw->mutex);
+    return 0;
+}
+
+size_t advance_timer_wheel(timer_wheel* tw, unsigned long long tick, scheduled_command* due, size_t max_due){
+    size_t count = 0;
+    pthread_mutex_lock(&tw->mutex);
+    while (tw->now <= tick){
+        if (!tw->cascaded){
+            for(int level = 1; level < WHEEL_LEVELS; ++level){
+                if ((tw->now >> (WHEEL_SLOT_BITS * (level - 1))) & WHEEL_SLOT_MASK) break;
+                _cascade(tw, level, (unsigned int)((tw->now >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK));
+            }
+            tw->cascaded = 1;
+        }
+        unsigned int* slot = &tw->slots[tw->now & WHEEL_SLOT_MASK];
+        while (*slot != NIL){
+            if (count == max_due){
+                pthread_mutex_unlock(&tw->mutex);
+                return count;
+            }
+            unsigned int index = *slot;
+            timer_entry* e = &tw->entries[index];
+            _unlink_entry(tw, index);
+            due[count++] = e->command;
+            tw->stats.dispatched++;
+            if (tick - tw->now > MISSED_TOLERANCE || e->expire + MISSED_TOLERANCE < tw->now) tw->stats.missed++;
+            if (e->period > 0){
+                e->expire += e->period;
+                if (e->expire <= tick){
+                    unsigned long long skipped = (tick - e->expire) / e->period + 1;
+                    tw->stats.missed += skipped;
+                    e->expire += skipped * e->period;
+                }
+                _insert_entry(tw, index);
+            } else {
+                _release_entry(tw, index);
+                tw->stats.pending--;
+            }
+        }
+        tw->now++;
+        tw->cascaded = 0;
+    }
+    pthread_mutex_unlock(&tw->mutex);
+    return count;
+}
+
+void get_stats_timer_wheel(timer_wheel* tw, scheduler_stats* stats){
+    pthread_mutex_lock(&tw->mutex);
+    *stats = tw->stats;
+    pthread_mutex_unlock(&tw->mutex);
+}
+
+void finalize_timer_wheel(timer_wheel* tw){
+    free(tw->entries);
+    pthread_mutex_destroy(&tw->mutex);
+    free(tw);
+}
+
+static void _insert_entry(timer_wheel* tw, unsigned int index){
+    timer_entry* e = &tw->entries[index];
+    unsigned long long expire = e->expire < tw->now ? tw->now : e->expire;
+    unsigned long long diff = expire - tw->now;
+    int level = 0;
+    while (level + 1 < WHEEL_LEVELS && diff >= (1ULL << (WHEEL_SLOT_BITS * (level + 1)))){
+        level++;
+    }
+    if (diff >= (1ULL << (WHEEL_SLOT_BITS * WHEEL_LEVELS))){
+        expire = tw->now + (1ULL << (WHEEL_SLOT_BITS * WHEEL_LEVELS)) - 1;
+    }
+    unsigned int slot = (unsigned int)(level * WHEEL_SLOTS + ((expire >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK));
+    e->slot = slot;
+    e->prev = NIL;
+    e->next = tw->slots[slot];
+    if (e->next != NIL) tw->entries[e->next].prev = index;
+    tw->slots[slot] = index;
+}
+
+static void _unlink_entry(timer_wheel* tw, unsigned int index){
+    timer_entry* e = &tw->entries[index];
+    if (e->prev != NIL) tw->entries[e->prev].next = e->next;
+    else tw->slots[e->slot] = e->next;
+    if (e->next != NIL) tw->entries[e->next].prev = e->prev;
+    e->next = e->prev = NIL;
+}
+
+static void _release_entry(timer_wheel* tw, unsigned int index){
+    timer_entry* e = &tw->entries[index];
+    e->slot = FREE_SLOT;
+    e->generation++;
+    e->next = tw->free_entry;
+    tw->free_entry = index;
+}
+
+static void _cascade(timer_wheel* tw, int level, unsigned int slot){
+    unsigned int index = tw->slots[level * WHEEL_SLOTS + slot];
+    tw->slots[level * WHEEL_SLOTS + slot] = NIL;
+    while (index != NIL){
+        unsigned int next = tw->entries[index].next;
+        _insert_entry(tw, index);
+        index = next;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TIMER_WHEEL_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TIMER_WHEEL_H
+
+#include <stddef.h>
+
+/**
+ * иерархическое колесо таймеров для отложенных команд
+ * (4 уровня по 256 ячеек, один шаг колеса - один такт TIME_UNIT)
+ */
+struct _timer_wheel;
+typedef struct _timer_wheel timer_wheel;
+
+/**
+ * отложенная команда
+ */
+typedef struct _scheduled_command{
+    /**
+     * идентификатор записи в расписании
+     */
+    unsigned long long id;
+    /**
+     * команда (COMMAND_TURN_ON_TANK, COMMAND_SET_SPEED_UPLOAD_PUMP, ...)
+     */
+    int command;
+    /**
+     * номер резервуара
+     */
+    unsigned int number;
+    /**
+     * значение параметра команды (уровень, скорость)
+     */
+    unsigned int value;
+} scheduled_command;
+
+/**
+ * статистика расписания
+ */
+typedef struct _scheduler_stats{
+    /**
+     * количество ожидающих записей
+     */
+    size_t pending;
+    /**
+     * количество выполненных команд
+     */
+    unsigned long long dispatched;
+    /**
+     * количество команд, выполненных позже срока (и пропущенных повторов периодических команд)
+     */
+    unsigned long long missed;
+} scheduler_stats;
+
+/**
+ * создать колесо таймеров
+ * @param current_tick текущий такт
+ * @return указатель на колесо таймеров
+ */
+timer_wheel* create_timer_wheel(unsigned long long current_tick);
+
+/**
+ * добавить команду в расписание
+ * @param tw указатель на колесо таймеров
+ * @param expire_tick такт, в который команда должна быть выполнена
+ * @param period период повторения в тактах (0 - однократная команда)
+ * @param command команда (поле id заполняется колесом)
+ * @return идентификатор записи, 0 - ошибка
+ */
+unsigned long long add_timer_wheel(timer_wheel* tw, unsigned long long expire_tick, unsigned long long period, const scheduled_command* command);
+
+/**
+ * отменить команду
+ * @param tw указатель на колесо таймеров
+ * @param id идентификатор записи
+ * @return 0 - команда отменена, -1 - запись не найдена
+ */
+int cancel_timer_wheel(timer_wheel* tw, unsigned long long id);
+
+/**
+ * продвинуть колесо до указанного такта и выбрать наступившие команды
+ * (если массив заполнен, продвижение продолжится при следующем вызове)
+ * @param tw указатель на колесо таймеров
+ * @param tick текущий такт
+ * @param due массив для наступивших команд
+ * @param max_due размер массива
+ * @return количество наступивших команд
+ */
+size_t advance_timer_wheel(timer_wheel* tw, unsigned long long tick, scheduled_command* due, size_t max_due);
+
+/**
+ * получить статистику расписания
+ * @param tw указатель на колесо таймеров
+ * @param stats статистика
+ */
+void get_stats_timer_wheel(timer_wheel* tw, scheduler_stats* stats);
+
+/**
+ * уничтожить колесо таймеров
+ * @param tw указатель на колесо таймеров
+ */
+void finalize_timer_wheel(timer_wheel* tw);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TIMER_WHEEL_H
@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#define TRACE_CHUNK_SIZE    65536   //размер текста, записываемого в файл за один вызов write
+#define TRACE_EVENT_MAX_LEN 256     //максимальная длина текста одного события
+
+int trace_enabled = 0;
+
+/**
+ * участок работы потока
+ */
+typedef struct _trace_event{
+    /**
+     * категория
+     */
+    const char* category;
+    /**
+     * название
+     */
+    const char* name;
+    /**
+     * время начала в нс
+     */
+    unsigned long long start;
+    /**
+     * длительность в нс
+     */
+    unsigned long long duration;
+    /**
+     * номер резервуара
+     */
+    int arg;
+} trace_event;
+
+/**
+ * буфер участков одного потока
+ */
+typedef struct _trace_buffer{
+    /**
+     * следующий буфер в списке буферов процесса
+     */
+    struct _trace_buffer* next;
+    /**
+     * признак использования буфера потоком (буфер завершившегося потока достается следующему)
+     */
+    int in_use;
+    /**
+     * идентификатор процесса
+     */
+    pid_t pid;
+    /**
+     * идентификатор потока
+     */
+    pid_t tid;
+    /**
+     * имя потока (NULL - не задано)
+     */
+    const char* thread_name;
+    /**
+     * признак того, что имя потока уже записано в файл
+     */
+    int name_written;
+    /**
+     * количество участков в буфере
+     */
+    size_t count;
+    /**
+     * участки
+     */
+    trace_event events[TRACE_BUFFER_EVENTS];
+} trace_buffer;
+
+/**
+ * список буферов всех потоков процесса
+ */
+static trace_buffer* _buffers = NULL;
+
+/**
+ * буфер текущего потока
+ */
+static __thread trace_buffer* _thread_buffer = NULL;
+
+/**
+ * ключ, по которому буфер сбрасывается при завершении потока
+ */
+static pthread_key_t _buffer_key;
+
+/**
+ * дескриптор файла трассировки
+ */
+static int _trace_fd = -1;
+
+/**
+ * получить буфер текущего потока (свободный буфер из списка или новый)
+ * @return указатель на буфер
+ */
+static trace_buffer* _get_buffer();
+
+/**
+ * дописать участки буфера в файл и очистить буфер
+ * @param buffer указатель на буфер
+ */
+static void _flush_buffer(trace_buffer* buffer);
+
+/**
+ * дописать текст событий в файл одним вызовом write (с O_APPEND события разных процессов не перемешиваются)
+ * @param chunk текст
+ * @param len длина текста
+ * @return 0 - текст записан, -1 - ошибка записи
+ */
+static int _write_chunk(const char* chunk, size_t len);
+
+/**
+ * сбросить буфер завершающегося потока и освободить его для других потоков
+ * @param buffer_ptr указатель на буфер
+ */
+static void _release_buffer(void* buffer_ptr);
+
+/**
+ * забыть буферы родителя в процессе, созданном fork (их участки запишет родитель)
+ */
+static void _reset_after_fork();
+
+int init_trace(int mode){
+    if (trace_enabled) return 1;
+    const char* path = getenv(TRACE_PATH_ENV);
+    if (path == NULL || path[0] == '\0') return 0;
+    int flags = O_WRONLY | O_APPEND | O_CLOEXEC;
+    if (mode == TRACE_CREATE) flags |= O_CREAT | O_TRUNC;
+    _trace_fd = open(path, flags, 0644);
+    if (_trace_fd == -1) return 0;
+    //закрывающая скобка массива событий в формате trace event необязательна, поэтому процессы
+    //могут дописывать события в файл независимо друг от друга
+    if (mode == TRACE_CREATE && write(_trace_fd, "[\n", 2) != 2){
+        close(_trace_fd);
+        _trace_fd = -1;
+        return 0;
+    }
+    pthread_key_create(&_buffer_key, _release_buffer);
+    pthread_atfork(NULL, NULL, _reset_after_fork);
+    trace_enabled = 1;
+    return 1;
+}
+
+unsigned long long get_time_trace(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+void add_span_trace(const char* category, const char* name, unsigned long long start, int arg){
+    unsigned long long end = get_time_trace();
+    trace_buffer* buffer = _get_buffer();
+    trace_event* event = &buffer->events[buffer->count++];
+    event->category = category;
+    event->name = name;
+    event->start = start;
+    event->duration = end > start ? end - start : 0;
+    event->arg = arg;
+    if (buffer->count == TRACE_BUFFER_EVENTS) _flush_buffer(buffer);
+}
+
+void set_thread_name_trace(const char* name){
+    if (!trace_enabled) return;
+    trace_buffer* buffer = _get_buffer();
+    buffer->thread_name = name;
+    buffer->name_written = 0;
+}
+
+void finalize_trace(void){
+    if (!trace_enabled) return;
+    trace_enabled = 0;
+    for(trace_buffer* buffer = __atomic_load_n(&_buffers, __ATOMIC_ACQUIRE); buffer != NULL; buffer = buffer->next){
+        _flush_buffer(buffer);
+    }
+    close(_trace_fd);
+    _trace_fd = -1;
+}
+
+static trace_buffer* _get_buffer(){
+    if (_thread_buffer != NULL) return _thread_buffer;
+    trace_buffer* buffer;
+    for(buffer = __atomic_load_n(&_buffers, __ATOMIC_ACQUIRE); buffer != NULL; buffer = buffer->next){
+        int free_flag = 0;
+        if (__atomic_compare_exchange_n(&buffer->in_use, &free_flag, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) break;
+    }
+    if (buffer == NULL){
+        buffer = calloc(1, sizeof(trace_buffer));
+        buffer->in_use = 1;
+        buffer->next = __atomic_load_n(&_buffers, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(&_buffers, &buffer->next, buffer, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    }
+    buffer->pid = getpid();
+    buffer->tid = (pid_t)syscall(SYS_gettid);
+    buffer->thread_name = NULL;
+    buffer->name_written = 0;
+    _thread_buffer = buffer;
+    pthread_setspecific(_buffer_key, buffer);
+    return buffer;
+}
+
+static void _flush_buffer(trace_buffer* buffer){
+    char chunk[TRACE_CHUNK_SIZE];
+    size_t len = 0;
+    if (buffer->thread_name != NULL && !buffer->name_written){
+        len += sprintf(chunk + len, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                       (int)buffer->pid, (int)buffer->tid, buffer->thread_name);
+        buffer->name_written = 1;
+    }
+    for(size_t i = 0; i < buffer->count; ++i){
+        const trace_event* event = &buffer->events[i];
+        len += sprintf(chunk + len, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,\"pid\":%d,\"tid\":%d",
+                       event->name, event->category, event->start / 1000, event->start % 1000,
+                       event->duration / 1000, event->duration % 1000, (int)buffer->pid, (int)buffer->tid);
+        if (event->arg != TRACE_NO_ARG) len += sprintf(chunk + len, ",\"args\":{\"tank\":%d}", event->arg + 1);
+        len += sprintf(chunk + len, "},\n");
+        if (len + TRACE_EVENT_MAX_LEN > TRACE_CHUNK_SIZE){
+            _write_chunk(chunk, len);
+            len = 0;
+        }
+    }
+    if (len > 0) _write_chunk(chunk, len);
+    buffer->count = 0;
+}
+
+static int _write_chunk(const char* chunk, size_t len){
+    return write(_trace_fd, chunk, len) == (ssize_t)len ? 0 : -1;
+}
+
+static void _release_buffer(void* buffer_ptr){
+    trace_buffer* buffer = buffer_ptr;
+    if (trace_enabled) _flush_buffer(buffer);
+    _thread_buffer = NULL;
+    __atomic_store_n(&buffer->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void _reset_after_fork(){
+    _buffers = NULL;
+    _thread_buffer = NULL;
+}
@@ -0,0 +1,76 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TRACE_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TRACE_H
+
+/**
+ * трассировка работы системы в формате Chrome trace event (открывается в Perfetto и chrome://tracing)
+ *
+ * включается переменной окружения TRACE_PATH_ENV с путем к файлу трассировки; участки работы каждого
+ * потока копятся в его собственном буфере без блокировок и дописываются в общий файл при заполнении
+ * буфера, завершении потока и завершении трассировки, процессы резервуаров пишут в тот же файл;
+ * при выключенной трассировке отметка участка стоит одной проверки флага
+ */
+
+#define TRACE_PATH_ENV          "OIL_STORAGE_TRACE" //переменная окружения с путем к файлу трассировки
+#define TRACE_CREATE            1                   //создать файл трассировки (основной процесс)
+#define TRACE_ATTACH            0                   //дописывать в созданный файл (процессы резервуаров)
+#define TRACE_BUFFER_EVENTS     8192                //количество участков в буфере потока
+#define TRACE_NO_ARG            -1                  //участок без номера резервуара
+
+/**
+ * признак включенной трассировки (устанавливается init_trace)
+ */
+extern int trace_enabled;
+
+/**
+ * включить трассировку, если задана переменная окружения TRACE_PATH_ENV
+ * @param mode TRACE_CREATE - создать файл заново, TRACE_ATTACH - дописывать в существующий
+ * @return 1 - трассировка включена, 0 - трассировка не задана или файл не открыт
+ */
+int init_trace(int mode);
+
+/**
+ * получить время для отметки участка
+ * @return время CLOCK_MONOTONIC в нс
+ */
+unsigned long long get_time_trace(void);
+
+/**
+ * записать участок работы потока в его буфер
+ * @param category категория (строковая константа)
+ * @param name название участка (строковая константа)
+ * @param start время начала участка (get_time_trace)
+ * @param arg номер резервуара (TRACE_NO_ARG - нет)
+ */
+void add_span_trace(const char* category, const char* name, unsigned long long start, int arg);
+
+/**
+ * задать имя текущего потока на временной шкале
+ * @param name имя потока (строковая константа)
+ */
+void set_thread_name_trace(const char* name);
+
+/**
+ * начать участок
+ * @return время начала участка, 0 - трассировка выключена
+ */
+static inline unsigned long long begin_span_trace(void){
+    return __builtin_expect(trace_enabled, 0) ? get_time_trace() : 0;
+}
+
+/**
+ * закончить участок
+ * @param category категория (строковая константа)
+ * @param name название участка (строковая константа)
+ * @param start время начала участка (begin_span_trace)
+ * @param arg номер резервуара (TRACE_NO_ARG - нет)
+ */
+static inline void end_span_trace(const char* category, const char* name, unsigned long long start, int arg){
+    if (__builtin_expect(trace_enabled, 0)) add_span_trace(category, name, start, arg);
+}
+
+/**
+ * дописать буферы всех потоков процесса в файл и закрыть его
+ */
+void finalize_trace(void);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TRACE_H
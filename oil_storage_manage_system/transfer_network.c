@@ -0,0 +1,272 @@
+#include "transfer_network.h"
+#include "oil_storage_def.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * сеть перекачек (описания перекачек хранятся отдельными массивами)
+ */
+struct _transfer_network{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * количество перекачек
+     */
+    size_t links_count;
+    /**
+     * размер выделенных массивов перекачек
+     */
+    size_t links_capacity;
+    /**
+     * имена перекачек
+     */
+    char (*names)[TRANSFER_NAME_MAX_LEN];
+    /**
+     * резервуары-источники
+     */
+    unsigned int* sources;
+    /**
+     * резервуары-приемники
+     */
+    unsigned int* destinations;
+    /**
+     * скорости перекачек
+     */
+    unsigned int* rates;
+    /**
+     * состояния перекачек (TRANSFER_ON, TRANSFER_OFF)
+     */
+    int* states;
+    /**
+     * перекачанные объемы
+     */
+    unsigned long long* moved;
+    /**
+     * объемы, рассчитанные для перекачек, но еще не подтвержденные резервуарами-источниками
+     */
+    long long* flights;
+    /**
+     * количество перекачек из резервуара с неподтвержденным объемом (пока оно не нулевое,
+     * перекачки из резервуара не рассчитываются)
+     */
+    unsigned int* source_flights;
+    /**
+     * неподтвержденные объемы, идущие в резервуар (место под них в приемнике уже занято)
+     */
+    long long* destination_flights;
+    /**
+     * отметки резервуаров, уже попавших в список измененных за такт
+     */
+    unsigned char* changed_marks;
+    /**
+     * мьютекс для доступа к сети из разных потоков
+     */
+    pthread_mutex_t mutex;
+};
+
+/**
+ * найти перекачку по имени (вызывается под мьютексом сети)
+ * @param tn указатель на сеть перекачек
+ * @param name имя перекачки
+ * @return номер перекачки, -1 - перекачка не найдена
+ */
+static int _find_link(transfer_network* tn, const char* name);
+
+/**
+ * отметить резервуар как измененный за такт
+ * @param tn указатель на сеть перекачек
+ * @param number номер резервуара
+ * @param changed_tanks массив номеров измененных резервуаров
+ * @param changed_count количество измененных резервуаров
+ */
+static void _mark_changed(transfer_network* tn, unsigned int number, unsigned int* changed_tanks, size_t* changed_count);
+
+transfer_network* create_transfer_network(size_t tanks_count){
+    transfer_network* tn = malloc(sizeof(transfer_network));
+    if (tn == NULL) return NULL;
+    tn->tanks_count = tanks_count;
+    tn->links_count = 0;
+    tn->links_capacity = 0;
+    tn->names = NULL;
+    tn->sources = NULL;
+    tn->destinations = NULL;
+    tn->rates = NULL;
+    tn->states = NULL;
+    tn->moved = NULL;
+    tn->flights = NULL;
+    tn->source_flights = calloc(tanks_count > 0 ? tanks_count : 1, sizeof(unsigned int));
+    tn->destination_flights = calloc(tanks_count > 0 ? tanks_count : 1, sizeof(long long));
+    tn->changed_marks = calloc(tanks_count > 0 ? tanks_count : 1, sizeof(unsigned char));
+    pthread_mutex_init(&tn->mutex, NULL);
+    return tn;
+}
+
+int add_transfer_link(transfer_network* tn, const char* name, unsigned int source, unsigned int destination, unsigned int rate){
+    if (source >= tn->tanks_count || destination >= tn->tanks_count || source == destination) return -1;
+    if (strlen(name) == 0 || strlen(name) >= TRANSFER_NAME_MAX_LEN) return -1;
+    pthread_mutex_lock(&tn->mutex);
+    if (_find_link(tn, name) != -1){
+        pthread_mutex_unlock(&tn->mutex);
+        return -1;
+    }
+    if (tn->links_count == tn->links_capacity){
+        size_t capacity = tn->links_capacity == 0 ? 16 : tn->links_capacity * 2;
+        tn->names = realloc(tn->names, capacity * sizeof(*tn->names));
+        tn->sources = realloc(tn->sources, capacity * sizeof(unsigned int));
+        tn->destinations = realloc(tn->destinations, capacity * sizeof(unsigned int));
+        tn->rates = realloc(tn->rates, capacity * sizeof(unsigned int));
+        tn->states = realloc(tn->states, capacity * sizeof(int));
+        tn->moved = realloc(tn->moved, capacity * sizeof(unsigned long long));
+        tn->flights = realloc(tn->flights, capacity * sizeof(long long));
+        tn->links_capacity = capacity;
+    }
+    int link = (int)tn->links_count++;
+    strcpy(tn->names[link], name);
+    tn->sources[link] = source;
+    tn->destinations[link] = destination;
+    tn->rates[link] = rate;
+    tn->states[link] = TRANSFER_OFF;
+    tn->moved[link] = 0;
+    tn->flights[link] = 0;
+    pthread_mutex_unlock(&tn->mutex);
+    return link;
+}
+
+int find_transfer_link(transfer_network* tn, const char* name){
+    pthread_mutex_lock(&tn->mutex);
+    int link = _find_link(tn, name);
+    pthread_mutex_unlock(&tn->mutex);
+    return link;
+}
+
+void set_state_transfer_link(transfer_network* tn, int link, int state){
+    pthread_mutex_lock(&tn->mutex);
+    tn->states[link] = state;
+    pthread_mutex_unlock(&tn->mutex);
+}
+
+int get_state_transfer_link(transfer_network* tn, int link){
+    pthread_mutex_lock(&tn->mutex);
+    int state = tn->states[link];
+    pthread_mutex_unlock(&tn->mutex);
+    return state;
+}
+
+void set_rate_transfer_link(transfer_network* tn, int link, unsigned int rate){
+    pthread_mutex_lock(&tn->mutex);
+    tn->rates[link] = rate;
+    pthread_mutex_unlock(&tn->mutex);
+}
+
+void get_transfer_link(transfer_network* tn, int link, unsigned int* source, unsigned int* destination, unsigned int* rate, unsigned long long* moved){
+    pthread_mutex_lock(&tn->mutex);
+    *source = tn->sources[link];
+    *destination = tn->destinations[link];
+    *rate = tn->rates[link];
+    *moved = tn->moved[link];
+    pthread_mutex_unlock(&tn->mutex);
+}
+
+size_t get_tanks_transfer_network(transfer_network* tn, unsigned int* numbers){
+    size_t count = 0;
+    pthread_mutex_lock(&tn->mutex);
+    for(size_t i = 0; i < tn->links_count; ++i){
+        if (tn->states[i] != TRANSFER_ON) continue;
+        _mark_changed(tn, tn->sources[i], numbers, &count);
+        _mark_changed(tn, tn->destinations[i], numbers, &count);
+    }
+    for(size_t i = 0; i < count; ++i){
+        tn->changed_marks[numbers[i]] = 0;
+    }
+    pthread_mutex_unlock(&tn->mutex);
+    return count;
+}
+
+size_t solve_transfer_network(transfer_network* tn, const unsigned int* current_levels, const unsigned int* minimum_levels,
+                              const unsigned int* maximum_levels, const long long* incoming, const long long* outgoing,
+                              long long* debits, unsigned int* sources){
+    size_t sources_count = 0;
+    pthread_mutex_lock(&tn->mutex);
+    for(size_t i = 0; i < tn->links_count; ++i){
+        if (tn->states[i] != TRANSFER_ON) continue;
+        unsigned int source = tn->sources[i];
+        unsigned int destination = tn->destinations[i];
+        //пока источник не подтвердил прошлое списание, его перекачки ждут: одно списание
+        //делится только между перекачками, рассчитанными в одном такте
+        if (tn->source_flights[source] > 0 && !tn->changed_marks[source]) continue;
+        long long available = (long long)current_levels[source] - debits[source] - outgoing[source] - (long long)minimum_levels[source];
+        //место приемника уменьшают и перекачки в него, рассчитанные раньше (в этом такте или еще не подтвержденные)
+        long long room = (long long)maximum_levels[destination] - (long long)current_levels[destination] - incoming[destination]
+                         - tn->destination_flights[destination];
+        long long flow = tn->rates[i];
+        if (flow > available) flow = available;
+        if (flow > room) flow = room;
+        if (flow < tn->rates[i]) tn->states[i] = TRANSFER_OFF;
+        if (flow <= 0) continue;
+        debits[source] += flow;
+        tn->flights[i] = flow;
+        tn->source_flights[source]++;
+        tn->destination_flights[destination] += flow;
+        _mark_changed(tn, source, sources, &sources_count);
+    }
+    for(size_t i = 0; i < sources_count; ++i){
+        tn->changed_marks[sources[i]] = 0;
+    }
+    pthread_mutex_unlock(&tn->mutex);
+    return sources_count;
+}
+
+size_t settle_transfer_network(transfer_network* tn, long long* taken, long long* credits, unsigned int* destinations){
+    size_t destinations_count = 0;
+    pthread_mutex_lock(&tn->mutex);
+    for(size_t i = 0; i < tn->links_count; ++i){
+        unsigned int source = tn->sources[i];
+        if (tn->flights[i] == 0 || taken[source] < 0) continue;
+        unsigned int destination = tn->destinations[i];
+        long long part = tn->flights[i] < taken[source] ? tn->flights[i] : taken[source];
+        //источник отдал меньше рассчитанного только у минимального уровня: перекачка останавливается
+        if (part < tn->flights[i]) tn->states[i] = TRANSFER_OFF;
+        taken[source] -= part;
+        tn->destination_flights[destination] -= tn->flights[i];
+        tn->flights[i] = 0;
+        tn->source_flights[source]--;
+        if (part == 0) continue;
+        tn->moved[i] += (unsigned long long)part;
+        if (credits[destination] == 0) destinations[destinations_count++] = destination;
+        credits[destination] += part;
+    }
+    pthread_mutex_unlock(&tn->mutex);
+    return destinations_count;
+}
+
+void finalize_transfer_network(transfer_network* tn){
+    free(tn->names);
+    free(tn->sources);
+    free(tn->destinations);
+    free(tn->rates);
+    free(tn->states);
+    free(tn->moved);
+    free(tn->flights);
+    free(tn->source_flights);
+    free(tn->destination_flights);
+    free(tn->changed_marks);
+    pthread_mutex_destroy(&tn->mutex);
+    free(tn);
+}
+
+static int _find_link(transfer_network* tn, const char* name){
+    for(size_t i = 0; i < tn->links_count; ++i){
+        if (strcmp(tn->names[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static void _mark_changed(transfer_network* tn, unsigned int number, unsigned int* changed_tanks, size_t* changed_count){
+    if (!tn->changed_marks[number]){
+        tn->changed_marks[number] = 1;
+        changed_tanks[(*changed_count)++] = number;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_TRANSFER_NETWORK_H
+#define OIL_STORAGE_MANAGE_SYSTEM_TRANSFER_NETWORK_H
+
+#include <stddef.h>
+
+/**
+ * сеть перекачек нефтепродуктов между резервуарами
+ */
+struct _transfer_network;
+typedef struct _transfer_network transfer_network;
+
+/**
+ * максимальная длина имени перекачки
+ */
+#define TRANSFER_NAME_MAX_LEN 32
+
+/**
+ * создать сеть перекачек
+ * @param tanks_count количество резервуаров
+ * @return указатель на сеть перекачек
+ */
+transfer_network* create_transfer_network(size_t tanks_count);
+
+/**
+ * добавить перекачку между резервуарами (перекачка создается в нерабочем состоянии)
+ * @param tn указатель на сеть перекачек
+ * @param name имя перекачки
+ * @param source номер резервуара, из которого перекачивается нефть
+ * @param destination номер резервуара, в который перекачивается нефть
+ * @param rate скорость перекачки
+ * @return номер перекачки, -1 - ошибка (имя занято или неверные номера резервуаров)
+ */
+int add_transfer_link(transfer_network* tn, const char* name, unsigned int source, unsigned int destination, unsigned int rate);
+
+/**
+ * найти перекачку по имени
+ * @param tn указатель на сеть перекачек
+ * @param name имя перекачки
+ * @return номер перекачки, -1 - перекачка не найдена
+ */
+int find_transfer_link(transfer_network* tn, const char* name);
+
+/**
+ * включить или выключить перекачку
+ * @param tn указатель на сеть перекачек
+ * @param link номер перекачки
+ * @param state TRANSFER_ON - включить, TRANSFER_OFF - выключить
+ */
+void set_state_transfer_link(transfer_network* tn, int link, int state);
+
+/**
+ * получить состояние перекачки
+ * @param tn указатель на сеть перекачек
+ * @param link номер перекачки
+ * @return TRANSFER_ON - перекачка идет, TRANSFER_OFF - перекачка остановлена
+ */
+int get_state_transfer_link(transfer_network* tn, int link);
+
+/**
+ * установить скорость перекачки
+ * @param tn указатель на сеть перекачек
+ * @param link номер перекачки
+ * @param rate скорость перекачки
+ */
+void set_rate_transfer_link(transfer_network* tn, int link, unsigned int rate);
+
+/**
+ * получить описание перекачки
+ * @param tn указатель на сеть перекачек
+ * @param link номер перекачки
+ * @param source номер резервуара-источника
+ * @param destination номер резервуара-приемника
+ * @param rate скорость перекачки
+ * @param moved перекачанный объем
+ */
+void get_transfer_link(transfer_network* tn, int link, unsigned int* source, unsigned int* destination, unsigned int* rate, unsigned long long* moved);
+
+/**
+ * получить резервуары, участвующие в работающих перекачках
+ * @param tn указатель на сеть перекачек
+ * @param numbers массив для номеров резервуаров
+ * @return количество резервуаров
+ */
+size_t get_tanks_transfer_network(transfer_network* tn, unsigned int* numbers);
+
+/**
+ * рассчитать перекачки за один такт: объем каждой работающей перекачки ограничивается
+ * минимальным уровнем источника и максимальным уровнем приемника с учетом насосов и еще
+ * не выполненных изменений уровня, перекачка, упершаяся в ограничение, останавливается;
+ * рассчитанный объем только списывается с источника, приемнику он начисляется после
+ * подтверждения списания (settle_transfer_network), перекачки из источника с неподтвержденным
+ * списанием пропускаются
+ * @param tn указатель на сеть перекачек
+ * @param current_levels уровни нефтепродуктов резервуаров
+ * @param minimum_levels минимальные уровни резервуаров
+ * @param maximum_levels максимальные уровни резервуаров
+ * @param incoming ожидаемые за такт поступления в резервуары (насос налива и неначисленные перекачки)
+ * @param outgoing ожидаемые за такт расходы резервуаров (насос слива)
+ * @param debits массив списаний с резервуаров (должен быть заполнен нулями, заполняется расчетом)
+ * @param sources массив для номеров резервуаров с ненулевым списанием
+ * @return количество резервуаров с ненулевым списанием
+ */
+size_t solve_transfer_network(transfer_network* tn, const unsigned int* current_levels, const unsigned int* minimum_levels,
+                              const unsigned int* maximum_levels, const long long* incoming, const long long* outgoing,
+                              long long* debits, unsigned int* sources);
+
+/**
+ * начислить приемникам объем, фактически списанный с источников: списание источника делится между
+ * его перекачками в порядке их добавления, перекачка, получившая меньше рассчитанного, останавливается;
+ * суммарный объем сохраняется
+ * @param tn указатель на сеть перекачек
+ * @param taken фактически списанные объемы (-1 - списание резервуара еще не подтверждено;
+ *              подтвержденные объемы расходуются до нуля)
+ * @param credits массив начислений резервуарам (дополняется)
+ * @param destinations массив для номеров резервуаров, начисление которым стало ненулевым
+ * @return количество таких резервуаров
+ */
+size_t settle_transfer_network(transfer_network* tn, long long* taken, long long* credits, unsigned int* destinations);
+
+/**
+ * уничтожить сеть перекачек
+ * @param tn указатель на сеть перекачек
+ */
+void finalize_transfer_network(transfer_network* tn);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_TRANSFER_NETWORK_H
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "transfer_network.h"
+#include "oil_storage_def.h"
+
+#define TEST_TANKS_COUNT    60      //количество резервуаров
+#define TEST_LINKS_COUNT    150     //количество перекачек
+#define TEST_TICKS          5000    //количество тактов
+#define TEST_MAX_RATE       120     //наибольшая скорость перекачки
+#define TEST_MAX_LEVEL      5000    //наибольший максимальный уровень
+
+/**
+ * резервуары, над которыми моделируются перекачки: списание выполняется в такте после расчета
+ * (как процессом резервуара), начисление - еще через такт
+ */
+typedef struct _test_fleet{
+    unsigned int levels[TEST_TANKS_COUNT];
+    unsigned int minimum_levels[TEST_TANKS_COUNT];
+    unsigned int maximum_levels[TEST_TANKS_COUNT];
+    long long incoming[TEST_TANKS_COUNT];
+    long long outgoing[TEST_TANKS_COUNT];
+    long long debits[TEST_TANKS_COUNT];
+    long long pending_debits[TEST_TANKS_COUNT];
+    long long credits[TEST_TANKS_COUNT];
+    long long taken[TEST_TANKS_COUNT];
+    unsigned int numbers[TEST_TANKS_COUNT];
+} test_fleet;
+
+/**
+ * проверить, что две перекачки в почти полный резервуар вместе не переполняют его
+ * @return количество ошибок
+ */
+static int _check_nearly_full(void);
+
+/**
+ * выполнить такт: начислить объемы прошлого такта, списать рассчитанное в прошлом такте,
+ * распределить списанное по перекачкам и рассчитать новые списания
+ * @param tn указатель на сеть перекачек
+ * @param tf резервуары
+ * @param tick номер такта
+ * @return количество ошибок (уровень вышел за границы)
+ */
+static int _run_tick(transfer_network* tn, test_fleet* tf, int tick);
+
+/**
+ * получить суммарный объем в резервуарах и еще не начисленный
+ * @param tf резервуары
+ * @return объем
+ */
+static long long _get_total(const test_fleet* tf);
+
+int main(void){
+    static test_fleet tf;
+    srand(28);
+    int failures = _check_nearly_full();
+    transfer_network* tn = create_transfer_network(TEST_TANKS_COUNT);
+    for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+        tf.maximum_levels[i] = (unsigned int)(rand() % TEST_MAX_LEVEL + 100);
+        tf.minimum_levels[i] = (unsigned int)(rand() % (tf.maximum_levels[i] / 4));
+        tf.levels[i] = tf.minimum_levels[i] + (unsigned int)(rand() % (tf.maximum_levels[i] - tf.minimum_levels[i] + 1));
+        tf.taken[i] = -1;
+    }
+    for(int i = 0; i < TEST_LINKS_COUNT; ++i){
+        char name[TRANSFER_NAME_MAX_LEN];
+        snprintf(name, sizeof(name), "link%d", i);
+        unsigned int source = (unsigned int)(rand() % TEST_TANKS_COUNT);
+        unsigned int destination = (unsigned int)((source + 1 + (unsigned int)(rand() % (TEST_TANKS_COUNT - 1))) % TEST_TANKS_COUNT);
+        add_transfer_link(tn, name, source, destination, (unsigned int)(rand() % TEST_MAX_RATE + 1));
+    }
+    long long total = _get_total(&tf);
+    unsigned long long moved = 0;
+    for(int tick = 0; tick < TEST_TICKS && failures < 10; ++tick){
+        //остановленные на границах перекачки время от времени запускаются снова
+        for(int k = 0; k < 5; ++k){
+            set_state_transfer_link(tn, rand() % TEST_LINKS_COUNT, TRANSFER_ON);
+        }
+        failures += _run_tick(tn, &tf, tick);
+        if (_get_total(&tf) != total){
+            printf("такт %d: объем %lld вместо %lld\n", tick, _get_total(&tf), total);
+            failures++;
+        }
+    }
+    for(int i = 0; i < TEST_LINKS_COUNT; ++i){
+        unsigned int source, destination, rate;
+        unsigned long long link_moved;
+        get_transfer_link(tn, i, &source, &destination, &rate, &link_moved);
+        moved += link_moved;
+    }
+    finalize_transfer_network(tn);
+    printf("тактов %d, перекачано %llu, ошибок %d\n", TEST_TICKS, moved, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+static int _check_nearly_full(void){
+    static test_fleet tf;
+    transfer_network* tn = create_transfer_network(3);
+    unsigned int levels[3] = {500, 500, 990};
+    for(unsigned int i = 0; i < 3; ++i){
+        tf.levels[i] = levels[i];
+        tf.minimum_levels[i] = 0;
+        tf.maximum_levels[i] = 1000;
+        tf.taken[i] = -1;
+    }
+    set_state_transfer_link(tn, add_transfer_link(tn, "first", 0, 2, 50), TRANSFER_ON);
+    set_state_transfer_link(tn, add_transfer_link(tn, "second", 1, 2, 50), TRANSFER_ON);
+    int failures = 0;
+    for(int tick = 0; tick < 5; ++tick){
+        failures += _run_tick(tn, &tf, tick);
+    }
+    if (tf.levels[2] != 1000 || tf.levels[0] + tf.levels[1] != 990){
+        printf("почти полный резервуар: уровни %u, %u, %u вместо 1000 в приемнике и 990 в источниках\n",
+               tf.levels[0], tf.levels[1], tf.levels[2]);
+        failures++;
+    }
+    finalize_transfer_network(tn);
+    return failures;
+}
+
+static int _run_tick(transfer_network* tn, test_fleet* tf, int tick){
+    int failures = 0;
+    size_t settled_count = 0;
+    for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+        tf->levels[i] += (unsigned int)tf->credits[i];
+        tf->credits[i] = 0;
+        if (tf->levels[i] > tf->maximum_levels[i]){
+            printf("такт %d: резервуар %u переполнен (%u при максимуме %u)\n", tick, i, tf->levels[i], tf->maximum_levels[i]);
+            failures++;
+        }
+        if (tf->pending_debits[i] == 0) continue;
+        long long available = (long long)tf->levels[i] - tf->minimum_levels[i];
+        tf->taken[i] = available <= 0 ? 0 : available < tf->pending_debits[i] ? available : tf->pending_debits[i];
+        tf->levels[i] -= (unsigned int)tf->taken[i];
+        tf->pending_debits[i] = 0;
+        settled_count++;
+    }
+    if (settled_count > 0){
+        settle_transfer_network(tn, tf->taken, tf->credits, tf->numbers);
+        for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+            tf->taken[i] = -1;
+        }
+    }
+    for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+        tf->incoming[i] = tf->credits[i];
+    }
+    size_t count = solve_transfer_network(tn, tf->levels, tf->minimum_levels, tf->maximum_levels, tf->incoming, tf->outgoing,
+                                          tf->debits, tf->numbers);
+    for(size_t i = 0; i < count; ++i){
+        unsigned int number = tf->numbers[i];
+        if ((long long)tf->levels[number] - tf->debits[number] < (long long)tf->minimum_levels[number]){
+            printf("такт %d: списание %lld опускает резервуар %u ниже минимума\n", tick, tf->debits[number], number);
+            failures++;
+        }
+        tf->pending_debits[number] = tf->debits[number];
+        tf->debits[number] = 0;
+    }
+    return failures;
+}
+
+static long long _get_total(const test_fleet* tf){
+    long long total = 0;
+    for(unsigned int i = 0; i < TEST_TANKS_COUNT; ++i){
+        total += (long long)tf->levels[i] + tf->credits[i];
+    }
+    return total;
+}
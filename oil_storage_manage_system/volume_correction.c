@@ -0,0 +1,234 @@
+#include "volume_correction.h"
+#include <stdlib.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#define CORRECTION_BATCH_SIZE 4 //количество коэффициентов, рассчитываемых за один проход
+
+/**
+ * коэффициенты многочлена Тейлора exp(-x) седьмой степени, начиная со старшего
+ */
+static const float _exp_coefficients[] = {-1.0f / 5040.0f, 1.0f / 720.0f, -1.0f / 120.0f, 1.0f / 24.0f, -1.0f / 6.0f, 0.5f, -1.0f, 1.0f};
+
+/**
+ * коэффициенты приведения резервуаров
+ */
+struct _volume_correction{
+    /**
+     * количество резервуаров
+     */
+    size_t tanks_count;
+    /**
+     * виды продуктов
+     */
+    int* products;
+    /**
+     * плотности при 15 °C
+     */
+    float* densities;
+    /**
+     * температуры продуктов
+     */
+    float* temperatures;
+    /**
+     * коэффициенты приведения
+     */
+    float* factors;
+    /**
+     * признаки изменения данных резервуаров после последнего обновления
+     */
+    unsigned char* dirty;
+    /**
+     * номера резервуаров, данные которых изменились
+     */
+    unsigned int* dirty_tanks;
+    /**
+     * количество резервуаров, данные которых изменились
+     */
+    size_t dirty_count;
+};
+
+/**
+ * получить константы коэффициента расширения a = k0 / p^2 + k1 / p + k2 для продукта и плотности
+ * @param product вид продукта
+ * @param density плотность при 15 °C
+ * @param constants константы k0, k1, k2
+ */
+static void _get_constants(int product, float density, float* constants);
+
+/**
+ * рассчитать коэффициенты приведения для группы резервуаров
+ * @param vc указатель на коэффициенты приведения
+ * @param numbers номера резервуаров
+ * @param count количество резервуаров (не больше CORRECTION_BATCH_SIZE)
+ */
+static void _compute_batch(volume_correction* vc, const unsigned int* numbers, size_t count);
+
+#if !defined(__SSE2__)
+/**
+ * exp(-x) для малых x (|x| < 0.5) многочленом Тейлора
+ * @param x показатель
+ * @return exp(-x)
+ */
+static float _exp_negative(float x);
+#endif
+
+volume_correction* create_volume_correction(size_t tanks_count){
+    volume_correction* vc = malloc(sizeof(volume_correction));
+    size_t count = tanks_count > 0 ? tanks_count : 1;
+    vc->tanks_count = tanks_count;
+    vc->products = calloc(count, sizeof(int));
+    vc->densities = malloc(sizeof(float) * count);
+    vc->temperatures = malloc(sizeof(float) * count);
+    vc->factors = malloc(sizeof(float) * count);
+    vc->dirty = calloc(count, sizeof(unsigned char));
+    vc->dirty_tanks = malloc(sizeof(unsigned int) * count);
+    vc->dirty_count = 0;
+    for(size_t i = 0; i < tanks_count; ++i){
+        vc->products[i] = VOLUME_CORRECTION_CRUDE;
+        vc->densities[i] = VOLUME_CORRECTION_DEFAULT_DENSITY;
+        vc->temperatures[i] = VOLUME_CORRECTION_BASE_TEMPERATURE;
+        vc->factors[i] = 1.0f;
+    }
+    return vc;
+}
+
+int set_tank_volume_correction(volume_correction* vc, unsigned int number, int product, float density, float temperature){
+    if (product != VOLUME_CORRECTION_CRUDE && product != VOLUME_CORRECTION_REFINED) return -1;
+    if (!(density >= VOLUME_CORRECTION_MIN_DENSITY && density <= VOLUME_CORRECTION_MAX_DENSITY)) return -1;
+    if (!(temperature >= VOLUME_CORRECTION_MIN_TEMPERATURE && temperature <= VOLUME_CORRECTION_MAX_TEMPERATURE)) return -1;
+    if (vc->products[number] == product && vc->densities[number] == density && vc->temperatures[number] == temperature) return 0;
+    vc->products[number] = product;
+    vc->densities[number] = density;
+    vc->temperatures[number] = temperature;
+    if (!vc->dirty[number]){
+        vc->dirty[number] = 1;
+        vc->dirty_tanks[vc->dirty_count++] = number;
+    }
+    return 0;
+}
+
+void get_tank_volume_correction(const volume_correction* vc, unsigned int number, int* product, float* density, float* temperature){
+    *product = vc->products[number];
+    *density = vc->densities[number];
+    *temperature = vc->temperatures[number];
+}
+
+size_t update_volume_correction(volume_correction* vc){
+    size_t count = vc->dirty_count;
+    for(size_t i = 0; i < count; i += CORRECTION_BATCH_SIZE){
+        size_t batch_count = count - i < CORRECTION_BATCH_SIZE ? count - i : CORRECTION_BATCH_SIZE;
+        _compute_batch(vc, vc->dirty_tanks + i, batch_count);
+    }
+    for(size_t i = 0; i < count; ++i){
+        vc->dirty[vc->dirty_tanks[i]] = 0;
+    }
+    vc->dirty_count = 0;
+    return count;
+}
+
+float get_factor_volume_correction(const volume_correction* vc, unsigned int number){
+    return vc->factors[number];
+}
+
+double apply_volume_correction(const volume_correction* vc, unsigned int first, const float* volumes, size_t count, float* standard_volumes){
+    const float* factors = vc->factors + first;
+    double total = 0.0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128d totals = _mm_setzero_pd();
+    for(; i + 4 <= count; i += 4){
+        __m128 standard = _mm_mul_ps(_mm_loadu_ps(volumes + i), _mm_loadu_ps(factors + i));
+        _mm_storeu_ps(standard_volumes + i, standard);
+        totals = _mm_add_pd(totals, _mm_cvtps_pd(standard));
+        totals = _mm_add_pd(totals, _mm_cvtps_pd(_mm_movehl_ps(standard, standard)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, totals);
+    total = lanes[0] + lanes[1];
+#endif
+    for(; i < count; ++i){
+        standard_volumes[i] = volumes[i] * factors[i];
+        total += standard_volumes[i];
+    }
+    return total;
+}
+
+void finalize_volume_correction(volume_correction* vc){
+    free(vc->products);
+    free(vc->densities);
+    free(vc->temperatures);
+    free(vc->factors);
+    free(vc->dirty);
+    free(vc->dirty_tanks);
+    free(vc);
+}
+
+static void _get_constants(int product, float density, float* constants){
+    constants[2] = 0.0f;
+    if (product == VOLUME_CORRECTION_CRUDE){
+        constants[0] = 613.9723f;
+        constants[1] = 0.0f;
+    } else if (density >= 838.5f){
+        constants[0] = 186.9696f;   //топочные мазуты
+        constants[1] = 0.4862f;
+    } else if (density >= 787.5f){
+        constants[0] = 594.5418f;   //реактивные топлива
+        constants[1] = 0.0f;
+    } else if (density >= 770.5f){
+        constants[0] = 2680.3206f;  //переходная зона
+        constants[1] = 0.0f;
+        constants[2] = -0.00336312f;
+    } else {
+        constants[0] = 346.4228f;   //бензины
+        constants[1] = 0.4388f;
+    }
+}
+
+static void _compute_batch(volume_correction* vc, const unsigned int* numbers, size_t count){
+    float k0[CORRECTION_BATCH_SIZE], k1[CORRECTION_BATCH_SIZE], k2[CORRECTION_BATCH_SIZE];
+    float densities[CORRECTION_BATCH_SIZE], dt[CORRECTION_BATCH_SIZE], factors[CORRECTION_BATCH_SIZE];
+    for(size_t i = 0; i < CORRECTION_BATCH_SIZE; ++i){
+        unsigned int number = numbers[i < count ? i : 0];
+        float constants[3];
+        _get_constants(vc->products[number], vc->densities[number], constants);
+        k0[i] = constants[0];
+        k1[i] = constants[1];
+        k2[i] = constants[2];
+        densities[i] = vc->densities[number];
+        dt[i] = vc->temperatures[number] - VOLUME_CORRECTION_BASE_TEMPERATURE;
+    }
+#if defined(__SSE2__)
+    //a * dt не превышает 0.3 во всем допустимом диапазоне, поэтому экспонента считается многочленом сразу для четырех резервуаров
+    __m128 density = _mm_loadu_ps(densities);
+    __m128 alpha = _mm_add_ps(_mm_add_ps(_mm_div_ps(_mm_loadu_ps(k0), _mm_mul_ps(density, density)),
+                                         _mm_div_ps(_mm_loadu_ps(k1), density)), _mm_loadu_ps(k2));
+    __m128 alpha_dt = _mm_mul_ps(alpha, _mm_loadu_ps(dt));
+    __m128 x = _mm_mul_ps(alpha_dt, _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.8f), alpha_dt)));
+    __m128 y = _mm_set1_ps(_exp_coefficients[0]);
+    for(size_t j = 1; j < sizeof(_exp_coefficients) / sizeof(_exp_coefficients[0]); ++j){
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(_exp_coefficients[j]));
+    }
+    _mm_storeu_ps(factors, y);
+#else
+    for(size_t i = 0; i < CORRECTION_BATCH_SIZE; ++i){
+        float alpha = k0[i] / (densities[i] * densities[i]) + k1[i] / densities[i] + k2[i];
+        float alpha_dt = alpha * dt[i];
+        factors[i] = _exp_negative(alpha_dt * (1.0f + 0.8f * alpha_dt));
+    }
+#endif
+    for(size_t i = 0; i < count; ++i){
+        vc->factors[numbers[i]] = factors[i];
+    }
+}
+
+#if !defined(__SSE2__)
+static float _exp_negative(float x){
+    float y = _exp_coefficients[0];
+    for(size_t j = 1; j < sizeof(_exp_coefficients) / sizeof(_exp_coefficients[0]); ++j){
+        y = y * x + _exp_coefficients[j];
+    }
+    return y;
+}
+#endif
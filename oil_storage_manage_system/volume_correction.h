@@ -0,0 +1,86 @@
+#ifndef OIL_STORAGE_MANAGE_SYSTEM_VOLUME_CORRECTION_H
+#define OIL_STORAGE_MANAGE_SYSTEM_VOLUME_CORRECTION_H
+
+#include <stddef.h>
+
+/**
+ * приведение объема нефтепродуктов к стандартной температуре 15 °C (ASTM D1250, таблицы 54A и 54B):
+ * коэффициент VCF = exp(-a * dt * (1 + 0.8 * a * dt)), где dt = t - 15, a - коэффициент расширения
+ * при 15 °C, зависящий от плотности продукта
+ *
+ * коэффициенты резервуаров хранятся и пересчитываются только после изменения плотности или температуры
+ */
+struct _volume_correction;
+typedef struct _volume_correction volume_correction;
+
+#define VOLUME_CORRECTION_CRUDE             0       //сырая нефть (таблица 54A)
+#define VOLUME_CORRECTION_REFINED           1       //нефтепродукты (таблица 54B, группа по плотности)
+#define VOLUME_CORRECTION_BASE_TEMPERATURE  15.0f   //стандартная температура в °C
+#define VOLUME_CORRECTION_MIN_DENSITY       610.5f  //допустимая плотность при 15 °C в кг/м3
+#define VOLUME_CORRECTION_MAX_DENSITY       1075.0f
+#define VOLUME_CORRECTION_MIN_TEMPERATURE   -50.0f  //допустимая температура продукта в °C
+#define VOLUME_CORRECTION_MAX_TEMPERATURE   150.0f
+#define VOLUME_CORRECTION_DEFAULT_DENSITY   850.0f  //плотность резервуара, для которого она не задана
+
+/**
+ * создать коэффициенты приведения (все резервуары - сырая нефть плотности VOLUME_CORRECTION_DEFAULT_DENSITY
+ * при стандартной температуре, коэффициенты равны 1)
+ * @param tanks_count количество резервуаров
+ * @return указатель на коэффициенты приведения
+ */
+volume_correction* create_volume_correction(size_t tanks_count);
+
+/**
+ * задать продукт, плотность и температуру резервуара (коэффициент пересчитывается при следующем обновлении)
+ * @param vc указатель на коэффициенты приведения
+ * @param number номер резервуара
+ * @param product вид продукта (VOLUME_CORRECTION_CRUDE, VOLUME_CORRECTION_REFINED)
+ * @param density плотность при 15 °C в кг/м3
+ * @param temperature температура продукта в °C
+ * @return 0 - данные заданы, -1 - продукт, плотность или температура вне допустимых значений
+ */
+int set_tank_volume_correction(volume_correction* vc, unsigned int number, int product, float density, float temperature);
+
+/**
+ * получить продукт, плотность и температуру резервуара
+ * @param vc указатель на коэффициенты приведения
+ * @param number номер резервуара
+ * @param product вид продукта
+ * @param density плотность при 15 °C
+ * @param temperature температура продукта
+ */
+void get_tank_volume_correction(const volume_correction* vc, unsigned int number, int* product, float* density, float* temperature);
+
+/**
+ * пересчитать коэффициенты резервуаров, данные которых изменились с прошлого обновления
+ * @param vc указатель на коэффициенты приведения
+ * @return количество пересчитанных коэффициентов
+ */
+size_t update_volume_correction(volume_correction* vc);
+
+/**
+ * получить коэффициент приведения резервуара (на момент последнего обновления)
+ * @param vc указатель на коэффициенты приведения
+ * @param number номер резервуара
+ * @return коэффициент приведения
+ */
+float get_factor_volume_correction(const volume_correction* vc, unsigned int number);
+
+/**
+ * привести объемы подряд идущих резервуаров к стандартной температуре
+ * @param vc указатель на коэффициенты приведения
+ * @param first номер первого резервуара
+ * @param volumes объемы резервуаров first, first + 1, ...
+ * @param count количество резервуаров
+ * @param standard_volumes приведенные объемы
+ * @return сумма приведенных объемов
+ */
+double apply_volume_correction(const volume_correction* vc, unsigned int first, const float* volumes, size_t count, float* standard_volumes);
+
+/**
+ * уничтожить коэффициенты приведения
+ * @param vc указатель на коэффициенты приведения
+ */
+void finalize_volume_correction(volume_correction* vc);
+
+#endif //OIL_STORAGE_MANAGE_SYSTEM_VOLUME_CORRECTION_H
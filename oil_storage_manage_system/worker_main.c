@@ -0,0 +1,28 @@
+#include "tank_worker.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+    if (argc < 4){
+        return 1;
+    }
+    unsigned int number = (unsigned int)strtoul(argv[1], NULL, 10);
+    size_t cnt_tanks = (size_t)strtoul(argv[2], NULL, 10);
+    int channel_type = atoi(argv[3]);
+    tanks_table* tt = attach_tanks_table(TANK_WORKER_FD_TABLE, cnt_tanks);
+    if (tt == NULL){
+        return 1;
+    }
+    tank_channel* ch = attach_tank_channel(channel_type, TANK_WORKER_FD_IN, TANK_WORKER_FD_OUT);
+    if (ch == NULL){
+        finalize_tanks_table(tt);
+        return 1;
+    }
+    init_trace(TRACE_ATTACH);
+    run_tank_worker(ch, tt, number);
+    finalize_trace();
+    finalize_tank_channel(ch);
+    finalize_tanks_table(tt);
+    return 0;
+}